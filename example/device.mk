@@ -10,21 +10,21 @@ $(BINDIR)/device_first_pass: $(DEVICE_LIB)
 	@$(LINKER) -o $@ $(filter %.o,$^)
 
 # memory map (in the BIN directory!) is calculated after linking the firmware the first time.
-$(BINDIR)/memory_map.h: $(BINDIR)/device_first_pass memory_map.yaml
+# mpu_calc doesn't touch memory_map.h if the table didn't change, so new_mpu_table.o isn't rebuilt
+# and the final link only reruns when the mpu table moved.
+$(BINDIR)/memory_map.h: $(BINDIR)/device_first_pass memory_map.yaml device.ld
 	@echo ""
-	@echo "--> extracting symbols"
-	$(OBJDUMP) -t $(BINDIR)/device_first_pass > $(BINDIR)/device_first_pass.syms
-	# note, the script sets the mpu table size to 15. This has to match the value of MPU_TABLE_SIZE
+	@echo "--> calculating the mpu table"
+	# note, the mpu table size is set to 15. This has to match the value of MPU_TABLE_SIZE
 	# in mpu_table.h
-	sh ../scripts/run_update_memory_map.sh \
-	     $(BINDIR)/device_first_pass.syms \
-	     memory_map.yaml $(BINDIR)/memory_map.h 15
+	mpu_calc elf=$(BINDIR)/device_first_pass linker_script=device.ld \
+	     memory_map=memory_map.yaml output_filename=$(BINDIR)/memory_map.h mpu_table_size=15
 
 # recompile the memory map with the results of the first firmware link.
 # note the very very important -I$(BINDIR) at the beginning of the compile line to prefer our new memory_map.h file.
 $(DEVICE_OBJDIR)/new_mpu_table.o: ../device/core/m7/mpu_table.cpp $(BINDIR)/memory_map.h
 	@echo " compiling device $(notdir $<) (note with -I$(BINDIR) to use new memory_map.h)"
-	@echo " if compiling new_mpu_table fails see run_update_memory_map.sh or contact Byron or Vas"
+	@echo " if compiling new_mpu_table fails see mpu_calc/readme_mpu_calc.md or contact Byron or Vas"
 	@$(CC) -I$(BINDIR) $(CFLAGS) -o $@ -c $<
 
 # create libdevice_final.a by removing the first pass mpu table from libdevice.a and substituting the new mpu_table
@@ -39,3 +39,17 @@ $(BINDIR)/device: $(DEVICE_OBJDIR)/device_main.o $(DEVICE_LIB_FINAL)
 	@$(LINK) $(LFLAGS) -o $@ \
 		$(filter %.o,$^) \
 		$(patsubst lib%.a,-l%,$(notdir $(filter %.a,$^)))
+
+# single link alternative to everything above: link once with the default memory_map.h (which has
+# MPU_TABLE_SIZE entries, so .mpu_table is already the right size) then write the calculated table,
+# and its mpu_verify() crc and mask (mpuTableVerify, the end of .mpu_table) straight into the firmware.
+# only the global table is patched: a memory map with task: or hotness: regions fails here
+# (mpuTaskSettings and mpuVirtualTable are generated headers, so those need the two pass link above).
+$(BINDIR)/device_single_link: $(DEVICE_OBJDIR)/device_main.o $(DEVICE_LIB)
+	@echo " linking device $@"
+	@mkdir -p $(BINDIR)
+	@$(LINK) $(LFLAGS) -o $@ \
+		$(filter %.o,$^) \
+		$(patsubst lib%.a,-l%,$(notdir $(filter %.a,$^)))
+	mpu_calc elf=$@ patch_elf=$@ linker_script=device.ld \
+	     memory_map=memory_map.yaml output_filename=$(BINDIR)/memory_map.h mpu_table_size=15
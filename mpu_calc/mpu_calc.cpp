@@ -19,512 +19,407 @@
 * 
 * see device/core/m7/unit_test/readme_mpu_cal.md for notes.
 * 
-* google libyaml for tutorials on traverse_yaml_node()
+* the work is done by mpu_calc_session_t (src/mpu_calc_session.h, libmpucalc),
+* this file only turns the options into calls.
 */
 
 // Include Files
-#include <yaml.h>
 #include <iostream>
+#include <thread>
 #include "mpu_calculator.h"
 #include "configure_mpu.h"
 #include "mpu_display.h"
+#include "mpu_diff.h"
+#include "mpu_emitter.h"
+#include "mpu_fleet.h"
+#include "mpu_host_model.h"
+#include "mpu_snapshot.h"
+#include "mpu_stats.h"
+#include "mpu_table_reader.h"
+#include "mpu_virtual.h"
 #include "cmd_line_options.h"
+#include "elf_patch.h"
+#include "mpu_batch.h"
+#include "mpu_calc_session.h"
 #include "dbg_log.h"
 #include <assert.h>
 //#include "dx2_gtest_base.h"
 
-uint32_t global_region_number = 0;
-mpu_display_t global_display;
-
-static void add_region( uint32_t start_addr, uint32_t size, uint32_t end_addr, uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes, std::string comment, std::string attributes __attribute__((unused)) )
+/// read the regions and tasks in the memory map (exits if the yaml can't be read)
+static void read_memory_map_from_file(const char *file_name, mpu_calc_session_t *session)
 {
-    mpu_calculator_t mpu_calc;
-    mpu_calc.mpu_region_number = global_region_number;
-    if (size != 0)
+    printf("Loading '%s'\n", file_name);
+
+    if (!session->load_file(file_name))
     {
-        end_addr = start_addr+size;
+        exit(-1);
     }
-    if (!mpu_calc.build_best_mpu_entries(start_addr,end_addr,DisableExec,AccessPermission,AccessAttributes))
+}
+
+static StringOption option_memory_map_filename( "memory_map.yaml", "memory_map", "input memory map (yaml)");
+static StringOption option_output_filename( "memory_map.h", "output_filename", "output filename (.h)");
+static UintOption option_mpu_table_size(16, "mpu_table_size", "mpu table size 1-16");
+static StringOption option_output_format( "header", "output_format", "output format (header, json, csv, ld or bin)");
+static StringOption option_task_output_filename( "", "task_output_filename", "output filename for the per task regions (.h, see mpu_task_table.h)");
+static UintOption option_virtual_slots(0, "virtual_slots", "regions for the regions with hotness: (see mpu_virtual.h)");
+static StringOption option_virtual_output_filename( "", "virtual_output_filename", "output filename for the virtual regions (.h, see mpu_virtual.h)");
+static StringOption option_virtual_trace( "", "virtual_trace", "addresses to replay on the simulated mpu, shows how often virtual regions are swapped in");
+static StringOption option_manifest( "", "manifest", "also write the size and crcs of the binary table to this file");
+static UintOption option_verify_mask(MPU_VERIFY_DEFAULT_MASK, "verify_mask", "bitmask of regions that mpu_verify() does not check (default is region 15, the unused entries are added)");
+static StringOption option_diff_old( "", "diff_old", "old memory_map.h (or RBAR/RASR list) to compare with diff_new");
+static StringOption option_diff_new( "", "diff_new", "new memory_map.h (or RBAR/RASR list) to compare with diff_old");
+static StringOption option_fleet( "", "fleet", "directory of snapshots to analyze (with the shipped memory_map.h for each build)");
+static UintOption option_threads(0, "threads", "threads for fleet analysis and batch (default is one per cpu)");
+static StringOption option_snapshot( "", "snapshot", "display a binary snapshot logged by mpu_dump()");
+static StringOption option_stats( "", "stats", "display the cycle statistics logged by mpu_stats_log()");
+static StringOption option_elf( "", "elf", "elf file with the linker symbols used as $symbol in the memory map");
+static StringOption option_linker_script( "", "linker_script", "linker script with the MEMORY regions used as memory: in the memory map");
+static StringOption option_patch_elf( "", "patch_elf", "linked firmware to write the table into (.mpu_table section)");
+static StringOption option_batch( "", "batch", "manifest (yaml) of firmware variants to calculate in one run");
+
+/// mpu_crc32() of a whole file (for the manifest)
+static uint32_t file_crc32(const char *filename)
+{
+    FILE *f = fopen(filename,"rb");
+    if (f == NULL)
     {
-        printf("error building entries for 0x%08x to 0x%08x (region:%d)\n",start_addr,end_addr,global_region_number);
+        return 0;
     }
-
-    for (uint32_t i=0;i<mpu_calc.num_entries;i++)
+    uint32_t crc = 0;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer,1,sizeof(buffer),f)) > 0)
     {
-        global_display.set(global_region_number,mpu_calc.mpu_table[i].RBAR,mpu_calc.mpu_table[i].RASR,comment);
-        global_region_number++;
+        crc = mpu_crc32(crc,buffer,n);
     }
+    fclose(f);
+    return crc;
 }
 
-#if 0
-static void print_escaped(yaml_char_t * str, size_t length)
+/*
+ * compare the effective memory map of two tables, e.g.
+ *   mpu_calc diff_old=old/memory_map.h diff_new=new/memory_map.h
+ * returns 1 if they differ so it can be used to gate CI builds.
+ */
+static int diff_tables(const char *old_filename, const char *new_filename)
 {
-    int i;
-    char c;
-
-    for (i = 0; i < length; i++) {
-        c = *(str + i);
-        if (c == '\\')
-            printf("\\\\");
-        else if (c == '\0')
-            printf("\\0");
-        else if (c == '\b')
-            printf("\\b");
-        else if (c == '\n')
-            printf("\\n");
-        else if (c == '\r')
-            printf("\\r");
-        else if (c == '\t')
-            printf("\\t");
-        else
-            printf("%c", c);
+    mpu_display_t old_display;
+    mpu_display_t new_display;
+    if (!read_mpu_table(old_filename,&old_display) || !read_mpu_table(new_filename,&new_display))
+    {
+        return -1;
     }
+    mpu_diff_t diff;
+    diff.compare(old_display,new_display);
+    diff.print(stdout,"");
+    return diff.differs() ? 1 : 0;
 }
-#endif
 
-#define DEBUG_PRINT(...)   do { \
-    if (MDX2_LOG_IS_WRITABLE(MDX2_LOG_LEVEL_DEBUG)) { \
-        printf(__VA_ARGS__); \
-    } \
-} while(0)
-
-static void printl_utf8(unsigned char *str, size_t length, FILE *stream)
+/*
+ * decode and display the snapshot logged by mpu_dump() on the target, e.g.
+ *   mpu_calc snapshot=mpu_snapshot.bin
+ */
+static int display_snapshot(const char *filename)
 {
-    if (MDX2_LOG_IS_WRITABLE(MDX2_LOG_LEVEL_DEBUG))
+    FILE *f = fopen(filename,"rb");
+    if (f == NULL)
     {
-        fwrite(str, 1, length, stream);
+        printf("error opening '%s'\n",filename);
+        return -1;
     }
+    uint8_t record[sizeof(mpu_snapshot_t)];
+    uint32_t size = fread(record,1,sizeof(record),f);
+    fclose(f);
+
+    mpu_display_t display;
+    uint32_t mpu_TYPE;
+    uint32_t mpu_CTRL;
+    printf("%s: ",filename);
+    if (!display.load_snapshot(record,size,&mpu_TYPE,&mpu_CTRL))
+    {
+        return -1;
+    }
+    printf("TYPE=0x%08x (%u regions) CTRL=0x%08x (%s%s%s)\n",mpu_TYPE,(uint32_t)((mpu_TYPE & MPU_TYPE_DREGION_Msk) >> MPU_TYPE_DREGION_Pos),mpu_CTRL,
+        (mpu_CTRL & MPU_CTRL_ENABLE_Msk) ? "ENABLE" : "disabled",
+        (mpu_CTRL & MPU_CTRL_HFNMIENA_Msk) ? " HFNMIENA" : "",
+        (mpu_CTRL & MPU_CTRL_PRIVDEFENA_Msk) ? " PRIVDEFENA" : "");
+    output_buffer_t out;
+    display.display_memory_map(out,"");
+    display.display_entries(out,"");
+    out.flush(stdout);
+    return 0;
 }
 
-static bool token_matches( yaml_node_t *node, const char *token_name )
+/*
+ * decode and display the statistics logged by mpu_stats_log() on the target, e.g.
+ *   mpu_calc stats=mpu_stats.bin
+ */
+static int display_stats(const char *filename)
 {
-    MDX2_ASSERT(node->type == YAML_SCALAR_NODE,"line: %d",(int)node->start_mark.line);
-    uint32_t len = strlen(token_name);
-    if (len != node->data.scalar.length)
-        return false;
-    if (strncmp( (const char *)node->data.scalar.value, token_name, len ) != 0)
-        return false;
-    return true;
-}
+    FILE *f = fopen(filename,"rb");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",filename);
+        return -1;
+    }
+    mpu_stats_t stats;
+    uint32_t size = fread(&stats,1,sizeof(stats),f);
+    fclose(f);
 
-static uint32_t token_to_hex( yaml_node_t *node ) __attribute((unused));
-static uint32_t token_to_hex( yaml_node_t *node )
-{
-    MDX2_ASSERT(node->type == YAML_SCALAR_NODE,"line: %d",(int)node->start_mark.line);
-    char buffer[100];
-    char *temp;
-    uint32_t len = node->data.scalar.length;
-    MDX2_ASSERT(len < sizeof(buffer));
-    strncpy(buffer,(const char *)node->data.scalar.value,len);
-    buffer[len] = 0;
-    uint32_t value = strtol( buffer, &temp, 16 );
-    if (*temp != 0)
+    const char *error = mpu_stats_check(&stats,size);
+    if (error != NULL)
     {
-        printf("expected hexadecimal in '%s' at line %d\n",buffer,(int)node->start_mark.line);
-        exit(-1);
+        printf("%s: %s\n",filename,error);
+        return -1;
     }
-    return value;
+    printf("%s: %u cycles/us\n",filename,stats.cycles_per_us);
+    output_buffer_t out;
+    mpu_stats_print(out,&stats);
+    out.flush(stdout);
+    return 0;
 }
 
-typedef struct {
-    const char *token_name;
-    uint32_t value;
-} token_value_t;
-
-static int token_to_from_list( yaml_node_t *node, const char *what, const token_value_t *token_values, uint32_t len )
+/*
+ * statistics over a directory of snapshots, e.g.
+ *   mpu_calc fleet=snapshots/
+ * returns 1 if any unit is running a table that differs from its build.
+ */
+static int analyze_fleet(const char *path)
 {
-    for (uint32_t i=0;i<len;i++)
+    mpu_fleet_t fleet;
+    fleet.verify_mask = option_verify_mask.value;
+    fleet.num_threads = option_threads.value;
+    if (fleet.num_threads == 0)
     {
-        const token_value_t *tv = &token_values[i];
-        if (token_matches(node,tv->token_name))
-        {
-            return tv->value;
-        }
+        fleet.num_threads = std::thread::hardware_concurrency();
     }
-    char buffer[100];
-    uint32_t token_len = node->data.scalar.length;
-    strncpy(buffer,(const char *)node->data.scalar.value,token_len);
-    buffer[token_len] = 0;
-    printf("unknown %s in '%s' at line %d\n",what,buffer,(int)node->start_mark.line);
-    printf("valid values:\n");
-    for (uint32_t i=0;i<len;i++)
+    if (!fleet.add_directory(path))
     {
-        const token_value_t *tv = &token_values[i];
-        printf("    %s\n",tv->token_name);
+        return -1;
     }
-    exit(-1);
-}
-
-
-static uint32_t token_to_DisableExec( yaml_node_t *node )
-{
-    const token_value_t token_values[] = {
-        {"EXECUTE", 0},
-        {"NEVER_EXECUTE", 1},
-    };
-    return token_to_from_list( node, "DisableExec", token_values, sizeof(token_values)/sizeof(token_values[0]));
-}
-
-
-static uint32_t token_to_AccessPermission( yaml_node_t *node )
-{
-    const token_value_t token_values[] = {
-        {"ARM_MPU_AP_RO", ARM_MPU_AP_RO},
-        {"ARM_MPU_AP_NONE", ARM_MPU_AP_NONE},
-        {"ARM_MPU_AP_FULL", ARM_MPU_AP_FULL},
-    };
-    return token_to_from_list( node, "AccessPermission", token_values, sizeof(token_values)/sizeof(token_values[0]));
+    fleet.analyze();
+    output_buffer_t out;
+    fleet.report(out);
+    out.flush(stdout);
+    for (uint32_t b=0;b<fleet.builds.size();b++)
+    {
+        if (fleet.builds[b].num_differ != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
 }
 
-
-static uint32_t token_to_AccessAttributes( yaml_node_t *node )
+/*
+ * calculate every variant listed in a manifest, e.g.
+ *   mpu_calc batch=variants.yaml
+ * returns 1 if any variant failed or doesn't fit in its mpu_table_size.
+ */
+static int run_batch(const char *filename)
 {
-    const token_value_t token_values[] = {
-        {"NO_ACCESS", NO_ACCESS},
-        {"STRONGLY_ORDERED", STRONGLY_ORDERED},
-        {"DEVICE_SHAREABLE", DEVICE_SHAREABLE},
-        {"DEVICE_NON_SHAREABLE", DEVICE_NON_SHAREABLE},
-        {"NORMAL_UNCACHED", NORMAL_UNCACHED},
-        {"NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE", NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE},
-        {"NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE", NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE},
-        {"NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE},
-        {"NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE},
-        // repeat the 'normal' memory without 'normal'
-        {"UNCACHED", NORMAL_UNCACHED},
-        {"WRITE_THROUGH_NO_WRITE_ALLOCATE", NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE},
-        {"WRITE_BACK_NO_WRITE_ALLOCATE", NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE},
-        {"WRITE_BACK_READ_AND_WRITE_ALLOCATE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE},
-        {"WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE},
-    };
-    return token_to_from_list( node, "AccessAttributes", token_values, sizeof(token_values)/sizeof(token_values[0]));
+    mpu_batch_t batch;
+    batch.num_threads = option_threads.value;
+    if (batch.num_threads == 0)
+    {
+        batch.num_threads = std::thread::hardware_concurrency();
+    }
+    if (!batch.load_manifest(filename))
+    {
+        return -1;
+    }
+    bool ok = batch.run();
+    output_buffer_t out;
+    batch.report(out);
+    out.flush(stdout);
+    return ok ? 0 : 1;
 }
 
-
-static uint32_t token_to_dec( yaml_node_t *node )
+/*
+ * replay an access trace on the simulated mpu with the tables just calculated, e.g.
+ *   mpu_calc memory_map=memory_map.yaml virtual_slots=4 virtual_trace=trace.txt
+ * the trace is one address per line (hex or decimal), # starts a comment.
+ */
+static bool simulate_virtual(const char *filename, mpu_calc_session_t &session)
 {
-    MDX2_ASSERT(node->type == YAML_SCALAR_NODE,"line: %d",(int)node->start_mark.line);
-    char buffer[100];
-    char *temp;
-    uint32_t len = node->data.scalar.length;
-    MDX2_ASSERT(len < sizeof(buffer));
-    strncpy(buffer,(const char *)node->data.scalar.value,len);
-    buffer[len] = 0;
-    uint32_t value;
-    if (strncmp(buffer,"0x",2) == 0) {
-        value = strtol( &buffer[2], &temp, 16 );
-        if (*temp != 0)
-        {
-            printf("expected hex in '%s' at line %d\n",buffer,(int)node->start_mark.line);
-            exit(-1);
-        }
-    } else {
-        value = strtol( buffer, &temp, 10 );
-        if ((strcmp(temp,"G")==0) || (strcmp(temp,"GB") == 0))
-        {
-            value *= 1024*1024*1024;
-        }
-        else if ((strcmp(temp,"M")==0) || (strcmp(temp,"MB") == 0))
+    FILE *f = fopen(filename,"r");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",filename);
+        return false;
+    }
+    mpu_host.reset();
+    mpu_apply(session.builder.display.mpu_table,NULL,0,session.mpu_table_size);
+    mpu_virtual_table_t table = session.virtual_regions.table();
+    mpu_virtual_t vmpu;
+    mpu_virtual_load(&vmpu,&table);
+    ARM_MPU_Enable(MPU_CTRL_HFNMIENA_Msk);
+
+    std::vector<uint32_t> loads(table.num_entries);
+    uint32_t accesses = 0;
+    uint32_t line_number = 0;
+    char line[256];
+    while (fgets(line,sizeof(line),f) != NULL)
+    {
+        line_number++;
+        char *p = line + strspn(line," \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
         {
-            value *= 1024*1024;
+            continue;
         }
-        else if ((strcmp(temp,"K")==0) || (strcmp(temp,"KB") == 0))
+        char *end;
+        uint32_t address = strtoul(p,&end,0);
+        if (end == p)
         {
-            value *= 1024;
+            printf("expected an address at line %u of '%s'\n",line_number,filename);
+            fclose(f);
+            return false;
         }
-        else if (*temp != 0)
+        accesses++;
+        if (mpu_virtual_simulate(&vmpu,address) == MPU_VIRTUAL_SWAP)
         {
-            printf("expected decimal in '%s' at line %d\n",buffer,(int)node->start_mark.line);
-            exit(-1);
+            loads[mpu_virtual_find(&table,address)]++;
         }
     }
-    return value;
-}
+    fclose(f);
 
-/// close your eyes,... global variables used to hold values while parsing a 'region'.
-// one function per element type style of parsing.
-uint32_t global_start_addr;
-uint32_t global_size;
-uint32_t global_end_addr;
-std::string global_comment;
-std::string global_attributes;
-uint32_t global_DisableExec;
-uint32_t global_AccessPermission;
-uint32_t global_AccessAttributes;
-
-static void traverse_yaml_node(yaml_document_t *document_p, yaml_node_t *node, uint32_t nesting)
-{
-    yaml_node_t *next_node_p;
-    yaml_node_t *key_node_p;
-    yaml_node_t *value_node_p;
-
-    DEBUG_PRINT("%*s",nesting*4,"");
-    switch (node->type) {
-        case YAML_NO_NODE:
-            DEBUG_PRINT("Empty node(%d:%d):\n", (int)node->start_mark.line, (int)node->start_mark.column);
-            break;
-        case YAML_SCALAR_NODE:
-            DEBUG_PRINT("Scalar node(%d:%d):\n", (int)node->start_mark.line, (int)node->start_mark.column);
-            DEBUG_PRINT("%*s",nesting*4,"");
-            printl_utf8(node->data.scalar.value, node->data.scalar.length, stdout);
-            break;
-        case YAML_SEQUENCE_NODE:
-            DEBUG_PRINT("Sequence node(%d:%d):\n", (int)node->start_mark.line, (int)node->start_mark.column);
-            yaml_node_item_t *i_node;
-            for (i_node = node->data.sequence.items.start; i_node < node->data.sequence.items.top; i_node++) {
-                next_node_p = yaml_document_get_node(document_p, *i_node);
-                if (next_node_p)
-                    traverse_yaml_node(document_p, next_node_p, nesting+1);
-            }
-            break;
-        case YAML_MAPPING_NODE:
-            DEBUG_PRINT("Mapping node(%d:%d):\n", (int)node->start_mark.line, (int)node->start_mark.column);
-
-            yaml_node_pair_t *i_node_p;
-            for (i_node_p = node->data.mapping.pairs.start; i_node_p < node->data.mapping.pairs.top; i_node_p++) {
-                key_node_p = yaml_document_get_node(document_p, i_node_p->key);
-                if (key_node_p) {
-                    DEBUG_PRINT("%*s",nesting*4,"");
-                    DEBUG_PRINT("Key:");
-                    traverse_yaml_node(document_p, key_node_p, nesting+1);
-                } else {
-                    fputs("Couldn't find next node\n", stderr);
-                    exit(1);
-                }
-
-                if (token_matches(key_node_p,"region"))
-                {
-                    // starting a new region
-                    global_start_addr = 0;
-                    global_end_addr = 0;
-                    global_size = 0;
-                    global_comment = "";
-                    global_attributes = "";
-                    global_DisableExec = 1;
-                    global_AccessPermission = ARM_MPU_AP_FULL;
-                    global_AccessAttributes = 0;
-                }
-
-                value_node_p = yaml_document_get_node(document_p, i_node_p->value);
-                if (value_node_p) {
-                    DEBUG_PRINT("%*s",nesting*4,"");
-                    DEBUG_PRINT("Value:");
-                    traverse_yaml_node(document_p, value_node_p, nesting+1);
-                } else {
-                    fputs("Couldn't find next node\n", stderr);
-                    exit(1);
-                }
-                if (key_node_p->type == YAML_SCALAR_NODE)
-                {
-                    if (token_matches(key_node_p,"start_addr"))
-                    {
-                        global_start_addr = token_to_dec(value_node_p);
-                        DEBUG_PRINT("start_addr = %s (0x%08x)\n",value_node_p->data.scalar.value,global_start_addr);
-                    }
-                    else if (token_matches(key_node_p,"size"))
-                    {
-                        global_size = token_to_dec(value_node_p);
-                        DEBUG_PRINT("size = %s (0x%08x)\n",value_node_p->data.scalar.value,global_size);
-                    }
-                    else if (token_matches(key_node_p,"end_addr"))
-                    {
-                        global_end_addr = token_to_dec(value_node_p);
-                        DEBUG_PRINT("end_addr = %s (0x%08x)\n",value_node_p->data.scalar.value,global_end_addr);
-                    }
-                    else if (token_matches(key_node_p,"DisableExec"))
-                    {
-                        global_DisableExec = token_to_DisableExec(value_node_p);
-                        DEBUG_PRINT("DisableExec = %s (0x%08x)\n",value_node_p->data.scalar.value,global_DisableExec);
-                    }
-                    else if (token_matches(key_node_p,"AccessPermission"))
-                    {
-                        global_AccessPermission = token_to_AccessPermission(value_node_p);
-                        DEBUG_PRINT("AccessPermission = %s (0x%08x)\n",value_node_p->data.scalar.value,global_AccessPermission);
-                    }
-                    else if (token_matches(key_node_p,"AccessAttributes"))
-                    {
-                        global_AccessAttributes = token_to_AccessAttributes(value_node_p);
-                        DEBUG_PRINT("AccessAttributes = %s (0x%08x)\n",value_node_p->data.scalar.value,global_AccessAttributes);
-                    }
-                    else if (token_matches(key_node_p,"comment"))
-                    {
-                        global_comment = (const char *)value_node_p->data.scalar.value;
-                        DEBUG_PRINT("comment = \"%s\"\n",global_comment.c_str());
-                    }
-                    else if (token_matches(key_node_p,"attributes"))
-                    {
-                        global_attributes = (const char *)value_node_p->data.scalar.value;
-                        DEBUG_PRINT("attributes = \"%s\"\n",global_attributes.c_str());
-                    }
-                    else if (token_matches(key_node_p,"region"))
-                    {
-                        // .. finished parsing the region...
-                        DEBUG_PRINT("%s: global_start_addr=0x%x global_size=0x%x global_end_addr=0x%x global_comment=%s\n",
-                               "region",
-                               global_start_addr,
-                               global_size,
-                               global_end_addr,
-                               global_comment.c_str());
-                        add_region( global_start_addr, global_size, global_end_addr, global_DisableExec, global_AccessPermission, global_AccessAttributes, global_comment, global_attributes );
-
-                        // add region object...
-                    }
-                }
-
-            }
-            break;
-        default:
-            fputs("Unknown node type\n", stderr);
-            exit(1);
-            break;
+    output_buffer_t out;
+    out.print("%s: %u accesses, %u swaps (%.2f%%), %u real faults\n",filename,accesses,vmpu.swaps,
+        accesses == 0 ? 0.0 : 100.0 * vmpu.swaps / accesses,vmpu.misses);
+    if (table.num_slots != 0)
+    {
+        out.print("%u virtual entries in regions %u..%u\n",table.num_entries,table.first_slot,table.first_slot+table.num_slots-1);
     }
-
-    DEBUG_PRINT("%*s",nesting*4,"");
-    DEBUG_PRINT("END NODE(%d:%d)\n", (int)node->start_mark.line, (int)node->start_mark.column);
-}
-
-static void traverse_yaml_document(yaml_document_t *document_p)
-{
-    DEBUG_PRINT("NEW DOCUMENT");
-
-    traverse_yaml_node(document_p, yaml_document_get_root_node(document_p), 0);
-
-    DEBUG_PRINT("END DOCUMENT");
+    out.print("entry hotness    loads\n");
+    for (uint32_t i=0;i<table.num_entries;i++)
+    {
+        out.print("%5u %7u %8u  %s\n",i,table.weights[i],loads[i],session.virtual_regions.comments[i].c_str());
+    }
+    out.flush(stdout);
+    return true;
 }
 
-static void read_memory_map_from_file(const char *file_name)
+int main(int argc, const char **argv)
 {
-    yaml_parser_t parser;
-    yaml_document_t document;
+    /* parse googletest options */
+    //testing::InitGoogleTest(&argc, (char **)argv);
 
-    printf("Loading '%s'\n", file_name);
+    /* parse other options (these options are saved in option_*) */
+    CmdLineOptions::GetInstance()->ParseOptions(argc,argv);
 
-    FILE *file = fopen(file_name, "rb");
-    if (file == 0)
+    if (option_diff_old.is_set || option_diff_new.is_set)
     {
-        printf("error opening '%s'\n",file_name);
-        exit(-1);
+        return diff_tables(option_diff_old.value,option_diff_new.value);
     }
-    assert(file);
-
-    assert(yaml_parser_initialize(&parser));
 
-    yaml_parser_set_input_file(&parser, file);
-
-    int done = 0;
-    while (!done)
+    if (option_fleet.is_set)
     {
-        if (!yaml_parser_load(&parser, &document)) {
-
-            /* Display a parser error message. */
-        
-            switch (parser.error)
-            {
-                case YAML_MEMORY_ERROR:
-                    fprintf(stderr, "Memory error: Not enough memory for parsing\n");
-                    break;
-        
-                case YAML_READER_ERROR:
-                    if (parser.problem_value != -1) {
-                        fprintf(stderr, "Reader error: %s: #%X at %d\n", parser.problem,
-                                parser.problem_value, (int)parser.problem_offset);
-                    }
-                    else {
-                        fprintf(stderr, "Reader error: %s at %d\n", parser.problem,
-                                (int)parser.problem_offset);
-                    }
-                    break;
-        
-                case YAML_SCANNER_ERROR:
-                    if (parser.context) {
-                        fprintf(stderr, "Scanner error: %s at line %d, column %d\n"
-                                "%s at line %d, column %d\n", parser.context,
-                                (int)parser.context_mark.line+1, (int)parser.context_mark.column+1,
-                                parser.problem, (int)parser.problem_mark.line+1,
-                                (int)parser.problem_mark.column+1);
-                    }
-                    else {
-                        fprintf(stderr, "Scanner error: %s at line %d, column %d\n",
-                                parser.problem, (int)parser.problem_mark.line+1,
-                                (int)parser.problem_mark.column+1);
-                    }
-                    break;
-        
-                case YAML_PARSER_ERROR:
-                    if (parser.context) {
-                        fprintf(stderr, "Parser error: %s at line %d, column %d\n"
-                                "%s at line %d, column %d\n", parser.context,
-                                (int)parser.context_mark.line+1, (int)parser.context_mark.column+1,
-                                parser.problem, (int)parser.problem_mark.line+1,
-                                (int)parser.problem_mark.column+1);
-                    }
-                    else {
-                        fprintf(stderr, "Parser error: %s at line %d, column %d\n",
-                                parser.problem, (int)parser.problem_mark.line+1,
-                                (int)parser.problem_mark.column+1);
-                    }
-                    break;
-        
-                case YAML_COMPOSER_ERROR:
-                    if (parser.context) {
-                        fprintf(stderr, "Composer error: %s at line %d, column %d\n"
-                                "%s at line %d, column %d\n", parser.context,
-                                (int)parser.context_mark.line+1, (int)parser.context_mark.column+1,
-                                parser.problem, (int)parser.problem_mark.line+1,
-                                (int)parser.problem_mark.column+1);
-                    }
-                    else {
-                        fprintf(stderr, "Composer error: %s at line %d, column %d\n",
-                                parser.problem, (int)parser.problem_mark.line+1,
-                                (int)parser.problem_mark.column+1);
-                    }
-                    break;
-        
-                default:
-                    /* Couldn't happen. */
-                    fprintf(stderr, "Internal error\n");
-                    break;
-            }
-            fprintf(stderr, "Failed to load document in %s\n", file_name);
-            break;
-        }
-
-        done = (!yaml_document_get_root_node(&document));
-
-        if (!done)
-            traverse_yaml_document(&document);
-
-        yaml_document_delete(&document);
+        return analyze_fleet(option_fleet.value);
     }
 
-    yaml_parser_delete(&parser);
-
-    assert(!fclose(file));
-
-}
-
-static StringOption option_memory_map_filename( "memory_map.yaml", "memory_map", "input memory map (yaml)");
-static StringOption option_output_filename( "memory_map.h", "output_filename", "output filename (.h)");
-static UintOption option_mpu_table_size(16, "mpu_table_size", "mpu table size 1-16");
+    if (option_snapshot.is_set)
+    {
+        return display_snapshot(option_snapshot.value);
+    }
 
-int main(int argc, const char **argv)
-{
-    /* parse googletest options */
-    //testing::InitGoogleTest(&argc, (char **)argv);
+    if (option_stats.is_set)
+    {
+        return display_stats(option_stats.value);
+    }
 
-    /* parse other options (these options are saved in option_*) */
-    CmdLineOptions::GetInstance()->ParseOptions(argc,argv);
+    if (option_batch.is_set)
+    {
+        return run_batch(option_batch.value);
+    }
 
     if (option_memory_map_filename.is_set)
     {
-        read_memory_map_from_file(option_memory_map_filename.value);
-        while (global_region_number < option_mpu_table_size.value)
+        mpu_calc_session_t session;
+        session.mpu_table_size = option_mpu_table_size.value;
+        session.verify_mask = option_verify_mask.value;
+        session.virtual_slots = option_virtual_slots.value;
+        if ((option_elf.is_set && !session.load_elf(option_elf.value)) ||
+            (option_linker_script.is_set && !session.load_linker_script(option_linker_script.value)))
         {
-            global_display.set(global_region_number,ARM_MPU_RBAR(global_region_number,0),0,"unused");
-            global_region_number++;
+            exit(-1);
+        }
+        read_memory_map_from_file(option_memory_map_filename.value,&session);
+        if (!session.compute())
+        {
+            exit(-1);
+        }
+        memory_map_builder_t &builder = session.builder;
+        uint32_t verify_mask = session.table_verify_mask;
+        output_buffer_t out;
+        if (!session.emit(option_output_format.value,out))
+        {
+            exit(-1);
+        }
+        // an unchanged table is not rewritten, so new_mpu_table.o and the final link are not redone
+        bool changed;
+        if (!out.write_if_changed(option_output_filename.value,&changed))
+        {
+            exit(-1);
+        }
+        if (!changed)
+        {
+            printf("'%s' is up to date\n",option_output_filename.value);
+        }
+        if (option_task_output_filename.is_set)
+        {
+            session.emit_tasks(out);
+            if (!out.write_if_changed(option_task_output_filename.value,&changed))
+            {
+                exit(-1);
+            }
+        }
+        else if (!session.loader.tasks.empty())
+        {
+            printf("%u tasks in '%s' are ignored without task_output_filename=\n",(uint32_t)session.loader.tasks.size(),option_memory_map_filename.value);
+        }
+        if (option_virtual_output_filename.is_set)
+        {
+            session.emit_virtual(out);
+            if (!out.write_if_changed(option_virtual_output_filename.value,&changed))
+            {
+                exit(-1);
+            }
+        }
+        else if (!session.virtual_regions.entries.empty())
+        {
+            printf("the virtual regions in '%s' are ignored without virtual_output_filename=\n",option_memory_map_filename.value);
+        }
+        if (option_virtual_trace.is_set && !simulate_virtual(option_virtual_trace.value,session))
+        {
+            exit(-1);
+        }
+        if (option_manifest.is_set)
+        {
+            mpu_binary_emitter_t binary;
+            binary.verify_mask = verify_mask;
+            binary.source_crc = file_crc32(option_memory_map_filename.value);
+            binary.manifest(builder.display,out);
+            if (!out.write_if_changed(option_manifest.value,&changed))
+            {
+                exit(-1);
+            }
+        }
+        if (option_patch_elf.is_set)
+        {
+            // mpuTaskSettings and mpuVirtualTable aren't patched, they'd keep the first pass defaults
+            if (!session.loader.tasks.empty() || !session.virtual_regions.entries.empty())
+            {
+                printf("patch_elf= only writes mpuTable, '%s' has task or virtual regions: link twice with task_output_filename= / virtual_output_filename=\n",option_memory_map_filename.value);
+                exit(-1);
+            }
+            elf_patch_constants_t constants;
+            constants.verify_mask = verify_mask;
+            constants.verify_crc = mpu_table_verify_crc(builder.display.mpu_table,MPU_VERIFY_REGIONS,constants.verify_mask);
+            if (!elf_patch_mpu_table(option_patch_elf.value,builder.display.mpu_table,builder.num_entries,&constants,&changed))
+            {
+                exit(-1);
+            }
+            printf("'%s' %s\n",option_patch_elf.value,changed ? "patched" : "is up to date");
         }
-        FILE *f = fopen(option_output_filename.value,"w");
-        global_display.display_memory_map(f,"// ");
-        global_display.display_entries(f,"    // ");
-        fclose(f);
     }
 }
\ No newline at end of file
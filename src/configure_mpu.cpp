@@ -3,23 +3,35 @@
 * @file
 * @brief
 *   This file configures the m7 MPU
+*
+* on the host the registers are simulated (see mpu_host_model.h) so this runs under the unit tests.
 */
 #ifdef MDX2_FREERTOS_TARGET
-
 #include "cpu_m7.h"
 #include "mpu_armv7.h"
+#else
+#include "mpu_host_model.h"
+#endif
 //#include "top.h"
 //#include "mdx2_freertos.h"
 #include "configure_mpu.h"
 #include "dbg_log.h"
 //#include "device_ocr_addr.h"
 //#include "mdx2_shared_memory.h"
-#include "mpu_calculator.h"
+#include "mpu_cache_plan.h"
 #include "mpu_display.h"
+#include "mpu_region_fit.h"
+#include "mpu_slots.h"
+#include "mpu_snapshot.h"
+#include "mpu_stats.h"
+#include "mpu_stack_guard.h"
+#include "mpu_verify.h"
+#include "mpu_virtual.h"
 //#include "multitask.h" // for STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES
 
 
 #include "mpu_table.h"
+#include "mpu_task_table.h"
 
 extern uint32_t _end_of_rodata;
 extern uint32_t __data_start__;
@@ -40,26 +52,32 @@ extern uint32_t __logging_end__;
 
 void Configure_MPU()
 {
+    mpu_stats_timer timer(MPU_STATS_CONFIGURE);
+
     // set SBC->CACR.SIWT=1 because Jason Thomson says so.
     // or if one was to read the documentation it would make sense.
     // see also a variety of performance issues with various cortex-m ports
     // pointing to "woops,... needs to set SIWT=1"
     SCB->CACR = SCB->CACR | SCB_CACR_SIWT_Msk;
 
-    __DMB();
-
     ARM_MPU_Disable();
-    for (uint32_t i=0;i<16;i++)
+
+    // every region is written, the ones after the table are disabled,
+    // so nothing is left over from before a warm restart.
+    for (uint32_t i=MPU_TABLE_SIZE;i<16;i++)
     {
         ARM_MPU_ClrRegion(i);
     }
+    mpu_apply(mpuTable, NULL, 0, MPU_TABLE_SIZE);
+    // the hottest virtual regions, the others are swapped in by mpu_virtual_fault()
+    mpu_virtual_load(&mpuVirtual, &mpuVirtualTable);
 
-    const ARM_MPU_Region_t *mpu_table = mpuTable;
-
-    ARM_MPU_Load(mpu_table, MPU_TABLE_SIZE);
-
-    __DSB();
-    __ISB();
+    // what's left over can be handed out by scoped_mpu_region.
+    // region 15 is the stack guard and mpu_configure_region()'s, so it's never in the pool.
+    uint32_t reserved = ((1UL << mpuTaskNumRegions) - 1) << mpuTaskFirstRegion;
+    reserved |= ((1UL << mpuVirtualTable.num_slots) - 1) << mpuVirtualTable.first_slot;
+    reserved |= 1UL << MPU_STACK_GUARD_REGION;
+    mpu_slots_init(mpu_slots_pool(mpuTable, MPU_TABLE_SIZE, mpuTableVerify.mask, reserved));
 
     //  --> MPU_CTRL_HFNMIENA_Msk=1   Enable MPU during hard fault, NMI, and FAULTMASK handlers execution    
     //      MPU_CTRL_HFNMIENA_Msk=0   Disable MPU during hard fault, NMI, and FAULTMASK handler execution
@@ -68,48 +86,188 @@ void Configure_MPU()
 
     // note: DX2SW-485 tried calling ARM_MPU_Enable(0) e.g. MPU_CTRL_HFNMIENA_Msk=0 but this didn't help.
     ARM_MPU_Enable(MPU_CTRL_HFNMIENA_Msk);
+}
 
-    __DSB();
-    __ISB();
+/// RBAR/RASR of the n'th region of a burst (MPU->RBAR_A1 etc. are aliases of MPU->RBAR)
+static inline void mpu_write_alias( uint32_t n, uint32_t RBAR, uint32_t RASR )
+{
+    switch (n)
+    {
+        case 0:
+            MPU->RBAR = RBAR;
+            MPU->RASR = RASR;
+            break;
+        case 1:
+            MPU->RBAR_A1 = RBAR;
+            MPU->RASR_A1 = RASR;
+            break;
+        case 2:
+            MPU->RBAR_A2 = RBAR;
+            MPU->RASR_A2 = RASR;
+            break;
+        default:
+            MPU->RBAR_A3 = RBAR;
+            MPU->RASR_A3 = RASR;
+            break;
+    }
+}
 
+/**
+ * @brief
+ *   program regions first_region .. first_region+num_regions-1 from next, only writing the ones that differ from current.
+ *
+ * each region is written with VALID and its own region number in RBAR, so up to 4 changed regions
+ * in a row go through RBAR..RASR_A3 without writing RNR, and an all zero entry clears its own region.
+ * the barriers are only done once, and not at all if nothing changed.
+ *
+ * the caller keeps interrupts from reprogramming the mpu in between (e.g. it's called from the context switch).
+ *
+ * @param[in] next - the regions to program
+ * @param[in] current - what the regions hold now, NULL to write all of them
+ * @param[in] first_region - region number of next[0]
+ * @param[in] num_regions - entries in next (and current)
+ */
+void mpu_apply( const ARM_MPU_Region_t *next, const ARM_MPU_Region_t *current, uint32_t first_region, uint32_t num_regions )
+{
+    bool barrier = false;
+    uint32_t i = 0;
+    while (i < num_regions)
+    {
+        if (current != NULL && next[i].RBAR == current[i].RBAR && next[i].RASR == current[i].RASR)
+        {
+            i++;
+            continue;
+        }
+        if (!barrier)
+        {
+            __DMB();
+            barrier = true;
+        }
+        // a run of changed regions, 4 at a time
+        for (uint32_t n=0;n<MPU_TYPE_RALIASES && i<num_regions;n++,i++)
+        {
+            if (n != 0 && current != NULL && next[i].RBAR == current[i].RBAR && next[i].RASR == current[i].RASR)
+            {
+                break;
+            }
+            uint32_t region = (first_region + i) & MPU_RBAR_REGION_Msk;
+            mpu_write_alias(n, (next[i].RBAR & MPU_RBAR_ADDR_Msk) | MPU_RBAR_VALID_Msk | region, next[i].RASR);
+        }
+    }
+    if (barrier)
+    {
+        __DSB();
+        __ISB();
+    }
+}
+
+
+
+/// read one region's RBAR/RASR. MPU->RNR is shared with anything reprogramming a region from an
+/// interrupt, so interrupts are disabled while the region is read
+static void mpu_region_read( uint32_t i, ARM_MPU_Region_t *region )
+{
+    mpu_stats_window interrupts_disabled(MPU_STATS_INTERRUPTS_DISABLED);
+    cpu_interrupt_disable_guard disable_interrupts;
+    interrupts_disabled.start();
+    MPU->RNR = i;
+    region->RBAR = MPU->RBAR;
+    region->RASR = MPU->RASR;
+    interrupts_disabled.stop();
 }
 
+/**
+ * @brief
+ *   check that the live mpu registers still match mpuTable.
+ *
+ * reads the 16 regions and compares their crc with the one mpu_calc put in memory_map.h,
+ * which is cheap enough (a few hundred cycles) to call periodically from an idle hook.
+ * the regions in MPU_TABLE_VERIFY_MASK are reprogrammed at run time and are not checked.
+ *
+ * @return false if the mpu has been corrupted or unexpectedly reprogrammed
+ */
+bool mpu_verify()
+{
+    mpu_stats_timer timer(MPU_STATS_VERIFY);
+    uint32_t crc = mpu_verify_crc( mpuTableVerify.mask, mpu_region_read );
+    return crc == mpuTableVerify.crc;
+}
 
+/**
+ * @brief
+ *   read MPU->TYPE, MPU->CTRL and the RBAR/RASR of every data region into a snapshot
+ *
+ * @return the number of bytes of the snapshot to log
+ */
+uint32_t mpu_snapshot_capture( mpu_snapshot_t *snapshot )
+{
+    uint32_t mpu_TYPE = MPU->TYPE;
+    uint32_t d_regions = (mpu_TYPE & MPU_TYPE_DREGION_Msk) >> MPU_TYPE_DREGION_Pos;
+    if (d_regions > MPU_SNAPSHOT_MAX_REGIONS)
+    {
+        d_regions = MPU_SNAPSHOT_MAX_REGIONS;
+    }
+    snapshot->mpu_TYPE = mpu_TYPE;
+    snapshot->mpu_CTRL = MPU->CTRL;
+    for (uint32_t i = 0; i<d_regions;i++)
+    {
+        MPU->RNR = i;
+        snapshot->regions[i].RBAR = MPU->RBAR;
+        snapshot->regions[i].RASR = MPU->RASR;
+    }
+    return mpu_snapshot_seal( snapshot, d_regions );
+}
 
+/**
+ * log the mpu registers as a single snapshot record.
+ *
+ * formatting the memory map on the target was slow and flooded the log,
+ * so the record is decoded and displayed on the host:
+ *
+ *    mpu_calc snapshot=mpu_snapshot.bin
+ */
 extern "C" void mpu_dump()
 {
+    mpu_stats_timer timer(MPU_STATS_DUMP);
     LOG_STRING("read_only_start",0x00400000);
     LOG_STRING("read_only_end",(uint32_t)&__data_start__);
     LOG_STRING("write_through_START",(uint32_t)&__logging_start__);
     LOG_STRING("write_through_END",(uint32_t)&__logging_end__);
-    uint32_t mpu_TYPE = MPU->TYPE;
-    uint32_t d_regions = (mpu_TYPE & 0xff00) >> 8;
-    //uint32_t i_regions = (mpu_TYPE & 0xff);
-    //LOG_STRING( "mpu_TYPE", mpu_TYPE );
-    //LOG_STRING( "d_regions", d_regions );
-    //LOG_STRING( "i_regions", i_regions );
-    //uint32_t mpu_CTRL = MPU->CTRL;
-    //uint32_t mpu_Enable = mpu_CTRL & 0x4;
-    //uint32_t mpu_HFNMIENA = mpu_CTRL & 0x2;
-    //uint32_t mpu_PRIVDEFENA = mpu_CTRL & 0x1;
-    //LOG_STRING( "mpu_CTRL", mpu_CTRL );
-    //LOG_STRING( "mpu_Enable", mpu_Enable );
-    //LOG_STRING( "mpu_HFNMIENA", mpu_HFNMIENA );
-    //LOG_STRING( "mpu_PRIVDEFENA", mpu_PRIVDEFENA );
-    // TODO: add log codes for mpu_ctrl and mpu_type
-    mpu_display_t mpu_display;
-    for (uint32_t i = 0; i<d_regions;i++)
+    mpu_snapshot_t snapshot;
+    uint32_t size = mpu_snapshot_capture( &snapshot );
+    MDX2_LOG_BLOB_INFO( MDX2_DIGIHAL_MPU_SNAPSHOT, &snapshot, size );
+}
+
+
+/**
+ * @brief
+ *   switch the task regions to another task's (called from the context switch).
+ *
+ * the entries were calculated by mpu_calc, so this is at most mpuTaskNumRegions register pairs
+ * (4 at a time through the RBAR/RASR aliases), and with the previous task's settings only the
+ * regions that differ are written.
+ * a NULL task (no task: in memory_map.yaml) disables the task regions.
+ *
+ * @param[in] task - the task being switched to
+ * @param[in] previous - the task being switched from, NULL if unknown
+ */
+void mpu_task_apply( const mpu_task_settings_t *task, const mpu_task_settings_t *previous )
+{
+    mpu_stats_timer timer(MPU_STATS_TASK_APPLY);
+    if (task != NULL)
     {
-        MPU->RNR = i;
-        uint32_t mpu_RBAR = MPU->RBAR;
-        uint32_t mpu_RASR = MPU->RASR;
-        mpu_display.set(i,mpu_RBAR,mpu_RASR);
-        MDX2_LOG4_INFO( MDX2_DIGIHAL_MPU_REGION_RBAR_RASR, i, mpu_RBAR, mpu_RASR, (uint32_t)(size_t)"dump" );
+        mpu_apply(task->regions,previous != NULL ? previous->regions : NULL,mpuTaskFirstRegion,mpuTaskNumRegions);
+        return;
+    }
+    __DMB();
+    for (uint32_t i=0;i<mpuTaskNumRegions;i++)
+    {
+        ARM_MPU_ClrRegion(mpuTaskFirstRegion+i);
     }
-    mpu_display.display_memory_map(NULL,"");
+    __DSB();
+    __ISB();
 }
 
-
 #if( configUSE_MPU_THREAD_STACK_GUARD == 1 )
 
     // for debugging generate a debug log when calling MPUThreadGuard_apply inside vTaskSwitchContext
@@ -118,14 +276,16 @@ extern "C" void mpu_dump()
         MDX2_LOG4_INFO( MDX2_DIGIHAL_MPU_REGION_RBAR_RASR, xThreadGuard->MPU_thread_guard[0].RBAR & MPU_RBAR_REGION_Msk, xThreadGuard->MPU_thread_guard[0].RBAR, xThreadGuard->MPU_thread_guard[0].RASR, (uint32_t)(size_t)xThreadGuard->task_name );
     }
 
-    // calculate the mpu region that covers a region at the end of the thread's task
+    // the mpu region that covers a region at the end of the thread's task.
+    // the guard is one naturally aligned region (see mpu_stack_guard.h) so this is a few instructions,
+    // and with stacks from mpu_stack_guard_malloc() it is the whole guard size at pxStack.
+    // it never goes past the first STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES of the stack.
     void MPUThreadGuard_calculate( MPUThreadStackGuard_t *xThreadGuard, StackType_t *pxStack, const char *task_name )
     {
+        mpu_stats_timer timer(MPU_STATS_STACK_GUARD);
+        typedef mpu_stack_guard_t<STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES> stack_guard_t;
         xThreadGuard->task_name = task_name;
-        mpu_calculator_t mpu_calc;
-        mpu_calc.mpu_region_number = 15;
-        mpu_calc.start_addr = (uint32_t)pxStack;
-        mpu_calc.end_addr = mpu_calc.start_addr+STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES-1;
+        uint32_t stack = (uint32_t)(size_t)pxStack;
 
 // 
 // Table B3-15 Access permissions field encoding
@@ -148,21 +308,7 @@ extern "C" void mpu_dump()
 #define ARM_MPU_AP_PRO  5U ///!< MPU Access Permission privileged access read-only
 #define ARM_MPU_AP_RO   6U ///!< MPU Access Permission read-only access
 
-        mpu_calc.build_best_mpu_entries(mpu_calc.start_addr,mpu_calc.end_addr,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE);
-        // mpu_display_t mpu_display;
-        // for (uint32_t i = 0; i<15;i++)
-        // {
-        //     MPU->RNR = i;
-        //     uint32_t mpu_RBAR = MPU->RBAR;
-        //     uint32_t mpu_RASR = MPU->RASR;
-        //     mpu_display.set(i,mpu_RBAR,mpu_RASR);
-        // }
-        //     uint32_t mpu_RBAR = mpu_calc.mpu_table[0].RBAR;
-        //     uint32_t mpu_RASR = mpu_calc.mpu_table[0].RASR;
-        // mpu_display.set(15,mpu_RBAR,mpu_RASR);
-        // MDX2_LOG3_CRITICAL( MDX2_DIGIHAL_MPU_REGION_RBAR_RASR, 15, mpu_RBAR, mpu_RASR );
-        // mpu_display.display_memory_map(NULL,"");
-        xThreadGuard->MPU_thread_guard[0] = mpu_calc.mpu_table[0];
+        xThreadGuard->MPU_thread_guard[0] = stack_guard_t::encode(stack);
         SCB_CleanDCache_by_Addr(pxStack,STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES);
     }
 #endif
@@ -170,6 +316,126 @@ extern "C" void mpu_dump()
 #define MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS 15
 
 
+/**
+ * @brief
+ *   write RBAR/RASR of one region, with interrupts disabled for just the two stores.
+ *
+ * RBAR with VALID selects the region, so nothing else may select another one before RASR is written.
+ * the barriers are the caller's, outside the window. the RBAR store changes the base before the RASR
+ * store changes the rest, so the region should be disabled, or RBAR should be its current base.
+ */
+void mpu_region_store( uint32_t region, uint32_t RBAR, uint32_t RASR )
+{
+    mpu_stats_window interrupts_disabled(MPU_STATS_INTERRUPTS_DISABLED);
+    cpu_interrupt_disable_guard disable_interrupts;
+    interrupts_disabled.start();
+    MPU->RBAR = (RBAR & MPU_RBAR_ADDR_Msk) | MPU_RBAR_VALID_Msk | (region & MPU_RBAR_REGION_Msk);
+    MPU->RASR = RASR;
+    interrupts_disabled.stop();
+}
+
+/// disable a region whose base isn't known (RNR then RASR, with interrupts disabled for the two stores)
+void mpu_region_retire( uint32_t region )
+{
+    mpu_stats_window interrupts_disabled(MPU_STATS_INTERRUPTS_DISABLED);
+    cpu_interrupt_disable_guard disable_interrupts;
+    interrupts_disabled.start();
+    ARM_MPU_ClrRegion(region);
+    interrupts_disabled.stop();
+}
+
+/**
+ * @brief
+ *   reprogram a region that may be in use without a spare, in one window with interrupts disabled.
+ *
+ * with the same base only RASR is written, so the region changes in one store.  otherwise it's
+ * disabled, moved and enabled again before interrupts are, so no interrupt sees it unmapped.
+ * the window is 3 mpu accesses, or 5 when the base moves.
+ */
+static void mpu_region_rewrite( uint32_t region, uint32_t RBAR, uint32_t RASR )
+{
+    mpu_stats_window interrupts_disabled(MPU_STATS_INTERRUPTS_DISABLED);
+    cpu_interrupt_disable_guard disable_interrupts;
+    interrupts_disabled.start();
+    MPU->RNR = region;
+    if ((MPU->RBAR & MPU_RBAR_ADDR_Msk) != (RBAR & MPU_RBAR_ADDR_Msk))
+    {
+        MPU->RASR = 0;
+        MPU->RBAR = (RBAR & MPU_RBAR_ADDR_Msk) | MPU_RBAR_VALID_Msk | (region & MPU_RBAR_REGION_Msk);
+    }
+    MPU->RASR = RASR;
+    interrupts_disabled.stop();
+}
+
+/**
+ * @brief
+ *   clean/invalidate the data cache for the addresses whose cache policy changes when region
+ *   becomes RBAR/RASR (see mpu_cache_plan.h), so e.g. mpu_configure_region() going from cached
+ *   to uncached doesn't leave dirty lines behind.
+ */
+static void mpu_region_cache_maintenance( uint32_t region, uint32_t RBAR, uint32_t RASR )
+{
+    ARM_MPU_Region_t current[16];
+    ARM_MPU_Region_t next[16];
+    for (uint32_t i=0;i<16;i++)
+    {
+        mpu_region_read(i,&current[i]);
+        next[i] = current[i];
+    }
+    next[region & MPU_RBAR_REGION_Msk] = ARM_MPU_Region_t{ (uint32_t)((RBAR & MPU_RBAR_ADDR_Msk) | (region & MPU_RBAR_REGION_Msk)), RASR };
+    mpu_cache_plan_t plan;
+    mpu_cache_plan( &plan, current, next, 16, MPU_CACHE_PLAN_DCACHE_SIZE, (SCB->CACR & SCB_CACR_SIWT_Msk) != 0 );
+    mpu_cache_plan_run( &plan );
+}
+
+/**
+ * @brief
+ *   reprogram a region that may be in use, make before break.
+ *
+ * the new entry is built in a spare region from the pool (see mpu_slots.h) first, then the old one is
+ * retired, the region is written while it's disabled, and the spare is cleared and given back.
+ * every step is one register pair with interrupts disabled and leaves whole entries, so an interrupt in
+ * between sees the old or the new mapping, never the new base with the old size.
+ * while the spare stands in, regions above it win where they overlap. with no spare (every slot taken)
+ * the region is rewritten in one window instead, see mpu_region_rewrite().
+ * the data cache maintenance the change needs is done first.
+ *
+ * @param[in] RASR - 0 to only retire the region
+ */
+void mpu_region_handover( uint32_t region, uint32_t RBAR, uint32_t RASR )
+{
+    mpu_region_cache_maintenance(region, RBAR, RASR);
+    bool enable = (RASR & MPU_RASR_ENABLE_Msk) != 0;
+    int32_t spare = enable ? mpu_slot_alloc() : -1;
+    __DMB();
+    if (enable && spare < 0)
+    {
+        mpu_region_rewrite(region, RBAR, RASR);
+        __DSB();
+        __ISB();
+        return;
+    }
+    if (spare >= 0)
+    {
+        mpu_region_store((uint32_t)spare, RBAR, RASR);
+    }
+    mpu_region_retire(region);
+    if (enable)
+    {
+        mpu_region_store(region, RBAR, RASR);
+    }
+    if (spare >= 0)
+    {
+        mpu_region_store((uint32_t)spare, RBAR, 0);
+    }
+    __DSB();
+    __ISB();
+    if (spare >= 0)
+    {
+        mpu_slot_free((uint32_t)spare);
+    }
+}
+
 /**
  * when googling for what's the M7 L1 cache prefetch instruction (it's PLD) found a nice read about the M7 cache:
  *
@@ -178,50 +444,25 @@ extern "C" void mpu_dump()
  * use MPU entry 15 to configure base_addres + size as cacheable.
  *
  * programs mpu entry 15 to be cached for addresses in [base_address,base_address+size)
+ * (region 15 is kept out of the pool in mpu_slots.h, other temporary regions should use scoped_mpu_region)
  *
- * e.g.
+ * the entry is the largest one inside the range (see mpu_region_fit.h), so nothing outside it changes.
+ * it's handed over with mpu_region_handover(), so interrupts are only disabled for a register pair at a time.
  *
  * @param[in] base_address - base_address
  * @param[in] size_in_bytes - size in bytes
  * @param[in] DisableExec - NEVER_EXECUTE
  * @param[in] AccessPermission - ARM_MPU_AP_RO
  * @param[in] AccessAttributes - NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE or NORMAL_UNCACHED
+ *
+ * @return the bytes of the range one region couldn't cover (0 if it's all covered)
  */
-void mpu_configure_region( uint32_t base_address, uint32_t size_in_bytes, uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes )
+uint32_t mpu_configure_region( uint32_t base_address, uint32_t size_in_bytes, uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes )
 {
-    mpu_calculator_t mpu_calc;
-    mpu_calc.mpu_region_number = MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS;
-    mpu_calc.start_addr = base_address;
-    mpu_calc.end_addr = base_address+size_in_bytes;
-
-    #define MAX_ENTRIES 1
-    LOG_STRING("start_addr",mpu_calc.start_addr);
-    LOG_STRING("end_addr",mpu_calc.end_addr);
-    do {
-        mpu_calc.find_size_and_subregions();
-        mpu_calc.build_entry(DisableExec,AccessPermission,AccessAttributes);
-        mpu_calc.start_addr = mpu_calc.next_addr;
-        LOG_STRING("next_addr",mpu_calc.next_addr);
-    } while (mpu_calc.num_entries < MAX_ENTRIES && (mpu_calc.end_addr - mpu_calc.start_addr >= 32));
-
-
-    // need to ensure no memory operations are in flight when we disable an MPU region and reprogram it.
-    // so we disable interrupts and wait for all memory operations to complete.
-    {
-        cpu_interrupt_disable_guard disable_interrupts;
-
-        __DSB();
-        __ISB();
-        __DMB();
-
-        // assuming just 1 entry:
-        ARM_MPU_ClrRegion(MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS);
-        ARM_MPU_SetRegion(mpu_calc.mpu_table[0].RBAR,mpu_calc.mpu_table[0].RASR);
-    }
-
-    MDX2_LOG4_ERROR( MDX2_DIGIHAL_MPU_REGION_RBAR_RASR, mpu_calc.mpu_region_number, mpu_calc.mpu_table[0].RBAR, mpu_calc.mpu_table[0].RASR, (uint32_t)(size_t)"config" );
-    // note: as an optimization we could create a const_expr expression for the MPU entry that corresponds to a particular base_address and size
-    // which would allow us to know the RBAR and RASR for a fixed range of memory.
+    mpu_stats_timer timer(MPU_STATS_CONFIGURE_REGION);
+    mpu_region_fit_t fit = mpu_region_inside(MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS,base_address,size_in_bytes,DisableExec,AccessPermission,AccessAttributes);
+    mpu_region_handover(MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS,fit.entry.RBAR,fit.entry.RASR);
+    return fit.under;
 }
 
 /**
@@ -229,14 +470,5 @@ void mpu_configure_region( uint32_t base_address, uint32_t size_in_bytes, uint32
  */
 void mpu_clear_region()
 {
-    cpu_interrupt_disable_guard disable_interrupts;
-
-    __DSB();
-    __ISB();
-    __DMB();
-
-    // assuming just 1 entry:
-    ARM_MPU_ClrRegion(MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS);
+    mpu_region_handover(MPU_ENTRY_15_FOR_TESTING_PMON_CACHED_READS,0,0);
 }
-
-#endif
\ No newline at end of file
@@ -12,6 +12,8 @@
 
 extern "C" void mpu_dump();
 
+bool mpu_verify();
+
 #define TEX_111 7UL
 #define TEX_110 6UL
 #define TEX_101 5UL
@@ -112,7 +114,13 @@ cache.
 
 void Configure_MPU();
 
-void mpu_configure_region( uint32_t base_address, uint32_t size_in_bytes, uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes );
+void mpu_apply( const ARM_MPU_Region_t *next, const ARM_MPU_Region_t *current, uint32_t first_region, uint32_t num_regions );
+
+void mpu_region_store( uint32_t region, uint32_t RBAR, uint32_t RASR );
+void mpu_region_retire( uint32_t region );
+void mpu_region_handover( uint32_t region, uint32_t RBAR, uint32_t RASR );
+
+uint32_t mpu_configure_region( uint32_t base_address, uint32_t size_in_bytes, uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes );
 
 void mpu_clear_region();
 
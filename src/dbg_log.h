@@ -2,7 +2,8 @@
 // stubbing out the dbg_log module.
 
 #define LOG_STRING(...) do {} while(0)
-#define MDX2_LOG4_INFO(...) do {} while(0)
-#define MDX2_LOG4_ERROR(...) do {} while(0)
+#define MDX2_LOG4_INFO(id,a,b,c,d) do { (void)(a); (void)(b); (void)(c); (void)(d); } while(0)
+#define MDX2_LOG4_ERROR(id,a,b,c,d) do { (void)(a); (void)(b); (void)(c); (void)(d); } while(0)
+#define MDX2_LOG_BLOB_INFO(id,data,size) do { (void)(data); (void)(size); } while(0)
 #define MDX2_ASSERT(x,...) assert(x)
 #define MDX2_LOG_IS_WRITABLE(...) (0)
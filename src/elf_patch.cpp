@@ -0,0 +1,167 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   write a calculated mpu table into a linked firmware (see elf_patch.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "elf_patch.h"
+#include "mpu_verify.h"
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static bool read_file( const char *filename, std::vector<uint8_t> *image )
+{
+    FILE *f = fopen(filename,"rb");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",filename);
+        return false;
+    }
+    bool ok = fseek(f,0,SEEK_END) == 0;
+    long size = ftell(f);
+    ok = ok && size > 0;
+    rewind(f);
+    if (ok)
+    {
+        image->resize(size);
+        ok = fread(image->data(),1,image->size(),f) == image->size();
+    }
+    fclose(f);
+    if (!ok)
+    {
+        printf("error reading '%s'\n",filename);
+    }
+    return ok;
+}
+
+/// write to a temporary file next to the original and rename it, so the firmware is never half written
+static bool write_file_atomic( const char *filename, const std::vector<uint8_t> &image )
+{
+    std::string temp = std::string(filename) + ".mpu_calc.tmp";
+    FILE *f = fopen(temp.c_str(),"wb");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",temp.c_str());
+        return false;
+    }
+    bool ok = fwrite(image.data(),1,image.size(),f) == image.size();
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    struct stat st;
+    if (ok && stat(filename,&st) == 0)
+    {
+        // keep the execute bits of the firmware
+        chmod(temp.c_str(),st.st_mode & 07777);
+    }
+    ok = ok && rename(temp.c_str(),filename) == 0;
+    if (!ok)
+    {
+        printf("error writing '%s'\n",filename);
+        unlink(temp.c_str());
+    }
+    return ok;
+}
+
+/// replace bytes in the image, noting if anything changed
+static void patch( std::vector<uint8_t> &image, uint32_t offset, const void *data, uint32_t size, bool *changed )
+{
+    if (memcmp(&image[offset],data,size) != 0)
+    {
+        memcpy(&image[offset],data,size);
+        *changed = true;
+    }
+}
+
+static bool section_in_file( const std::vector<uint8_t> &image, const Elf32_Shdr *section )
+{
+    return section->sh_type != SHT_NOBITS && section->sh_offset <= image.size() && section->sh_size <= image.size() - section->sh_offset;
+}
+
+/**
+ * @brief
+ *   replace the contents of .mpu_table in a linked firmware.
+ *
+ * the section must be num_entries long (i.e. mpu_table_size= matches MPU_TABLE_SIZE) followed by
+ * the mpuTableVerify trailer, which is rewritten with the new crc and mask.
+ * the file is only rewritten if something changed.
+ *
+ * @return false if the file isn't a 32 bit little endian elf with a matching .mpu_table (an error is printed)
+ */
+bool elf_patch_mpu_table( const char *filename, const ARM_MPU_Region_t *table, uint32_t num_entries, const elf_patch_constants_t *constants, bool *changed )
+{
+    *changed = false;
+    std::vector<uint8_t> image;
+    if (!read_file(filename,&image))
+    {
+        return false;
+    }
+    // the m7 firmware is always elf32 little endian, the same as the host
+    const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)image.data();
+    if (image.size() < sizeof(Elf32_Ehdr) || memcmp(ehdr->e_ident,ELFMAG,SELFMAG) != 0 ||
+        ehdr->e_ident[EI_CLASS] != ELFCLASS32 || ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+    {
+        printf("%s: not a 32 bit little endian elf file\n",filename);
+        return false;
+    }
+    if (ehdr->e_shentsize != sizeof(Elf32_Shdr) || ehdr->e_shoff > image.size() ||
+        ehdr->e_shnum > (image.size() - ehdr->e_shoff) / sizeof(Elf32_Shdr) || ehdr->e_shstrndx >= ehdr->e_shnum)
+    {
+        printf("%s: bad section headers\n",filename);
+        return false;
+    }
+    const Elf32_Shdr *sections = (const Elf32_Shdr *)&image[ehdr->e_shoff];
+    const Elf32_Shdr *shstrtab = &sections[ehdr->e_shstrndx];
+    if (!section_in_file(image,shstrtab))
+    {
+        printf("%s: bad section headers\n",filename);
+        return false;
+    }
+
+    const Elf32_Shdr *mpu_table = NULL;
+    for (uint32_t s=0;s<ehdr->e_shnum;s++)
+    {
+        if (sections[s].sh_name + sizeof(".mpu_table") <= shstrtab->sh_size &&
+            strcmp((const char *)&image[shstrtab->sh_offset + sections[s].sh_name],".mpu_table") == 0)
+        {
+            mpu_table = &sections[s];
+            break;
+        }
+    }
+    if (mpu_table == NULL || !section_in_file(image,mpu_table))
+    {
+        printf("%s: no .mpu_table section\n",filename);
+        return false;
+    }
+    uint32_t table_size = num_entries * sizeof(ARM_MPU_Region_t);
+    if (mpu_table->sh_size != table_size + sizeof(mpu_table_verify_t))
+    {
+        printf("%s: .mpu_table is %u bytes but %u entries and the mpuTableVerify trailer are %u (check mpu_table_size= and MPU_TABLE_SIZE)\n",
+            filename,mpu_table->sh_size,num_entries,(uint32_t)(table_size + sizeof(mpu_table_verify_t)));
+        return false;
+    }
+    uint32_t magic;
+    memcpy(&magic,&image[mpu_table->sh_offset + table_size],sizeof(magic));
+    if (magic != MPU_TABLE_VERIFY_MAGIC)
+    {
+        printf("%s: no mpuTableVerify trailer at the end of .mpu_table\n",filename);
+        return false;
+    }
+    patch(image,mpu_table->sh_offset,table,table_size,changed);
+    mpu_table_verify_t trailer = { MPU_TABLE_VERIFY_MAGIC, constants->verify_crc, constants->verify_mask };
+    patch(image,mpu_table->sh_offset + table_size,&trailer,sizeof(trailer),changed);
+
+    if (!*changed)
+    {
+        return true;
+    }
+    return write_file_atomic(filename,image);
+}
+
+#endif
@@ -0,0 +1,33 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   write a calculated mpu table straight into the .mpu_table section of a linked firmware
+*
+* device.ld puts mpuTable[] in its own section with a fixed size (MPU_TABLE_SIZE entries),
+* so the table can be replaced without moving anything else, e.g.
+*
+*    link device  ->  mpu_calc elf=device patch_elf=device  ->  done
+*
+* instead of linking a first pass, recompiling mpu_table.cpp and linking again.
+*/
+
+#ifndef ELF_PATCH_H
+#define ELF_PATCH_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+
+/// what is written besides the table (mpuTableVerify, at the end of .mpu_table)
+typedef struct {
+    uint32_t verify_crc;   ///< mpuTableVerify.crc
+    uint32_t verify_mask;  ///< mpuTableVerify.mask
+} elf_patch_constants_t;
+
+bool elf_patch_mpu_table( const char *filename, const ARM_MPU_Region_t *table, uint32_t num_entries, const elf_patch_constants_t *constants, bool *changed );
+
+#endif
+
+#endif
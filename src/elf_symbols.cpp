@@ -0,0 +1,243 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read the symbol table of an elf file (see elf_symbols.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "elf_symbols.h"
+#include <stdio.h>
+#include <string.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+elf_symbols_t::~elf_symbols_t()
+{
+    unload();
+}
+
+/// forget the symbols and unmap the file, so a failed load() doesn't leave half a table behind
+void elf_symbols_t::unload()
+{
+    symbols.clear();
+    sections.clear();
+    if (image != NULL)
+    {
+        munmap(image,image_size);
+        image = NULL;
+    }
+}
+
+/**
+ * @brief
+ *   map an elf file and index the names in its symbol table.
+ *
+ * @return false if the file can't be read or has no symbol table (an error message is printed)
+ */
+bool elf_symbols_t::load( const char *filename )
+{
+    unload();
+    int fd = open(filename,O_RDONLY);
+    if (fd < 0)
+    {
+        printf("error opening '%s'\n",filename);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd,&st) != 0 || st.st_size < EI_NIDENT)
+    {
+        printf("%s: not an elf file\n",filename);
+        close(fd);
+        return false;
+    }
+    image_size = st.st_size;
+    image = mmap(NULL,image_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        image = NULL;
+        printf("error reading '%s'\n",filename);
+        return false;
+    }
+    if (!index_image(filename))
+    {
+        unload();
+        return false;
+    }
+    return true;
+}
+
+/// check the elf header and index the symbols of the mapped file
+bool elf_symbols_t::index_image( const char *filename )
+{
+    const unsigned char *ident = (const unsigned char *)image;
+    if (memcmp(ident,ELFMAG,SELFMAG) != 0)
+    {
+        printf("%s: not an elf file\n",filename);
+        return false;
+    }
+    // both the m7 and the build machines are little endian
+    if (ident[EI_DATA] != ELFDATA2LSB)
+    {
+        printf("%s: only little endian elf files are supported\n",filename);
+        return false;
+    }
+    if (ident[EI_CLASS] == ELFCLASS32)
+    {
+        return index_symbols<Elf32_Ehdr,Elf32_Shdr,Elf32_Sym>( filename );
+    }
+    if (ident[EI_CLASS] == ELFCLASS64)
+    {
+        return index_symbols<Elf64_Ehdr,Elf64_Shdr,Elf64_Sym>( filename );
+    }
+    printf("%s: unknown elf class %d\n",filename,ident[EI_CLASS]);
+    return false;
+}
+
+/// prefer a global symbol to a static symbol with the same name
+void elf_symbols_t::add_symbol( std::string_view name, uint32_t value, bool global )
+{
+    symbol_t symbol = { value, global };
+    std::pair<std::unordered_map<std::string_view,symbol_t>::iterator,bool> result = symbols.insert(std::make_pair(name,symbol));
+    if (!result.second && global && !result.first->second.global)
+    {
+        result.first->second = symbol;
+    }
+}
+
+/// the names of the sections are in .shstrtab, a bad .shstrtab just means no sections
+template<typename Ehdr, typename Shdr>
+void elf_symbols_t::index_sections( const Ehdr *ehdr, const Shdr *shdrs )
+{
+    if (ehdr->e_shstrndx == SHN_UNDEF || ehdr->e_shstrndx >= ehdr->e_shnum)
+    {
+        return;
+    }
+    const Shdr *shstrtab = &shdrs[ehdr->e_shstrndx];
+    if (shstrtab->sh_offset > image_size || shstrtab->sh_size > image_size - shstrtab->sh_offset || shstrtab->sh_size == 0)
+    {
+        return;
+    }
+    const char *names = (const char *)image + shstrtab->sh_offset;
+    for (uint32_t s=1;s<ehdr->e_shnum;s++)
+    {
+        const Shdr *section = &shdrs[s];
+        if ((section->sh_flags & SHF_ALLOC) == 0 || section->sh_name >= shstrtab->sh_size)
+        {
+            continue;
+        }
+        const char *name = &names[section->sh_name];
+        section_t value = { (uint32_t)section->sh_addr, (uint32_t)section->sh_size };
+        sections.insert(std::make_pair(std::string_view(name,strnlen(name,shstrtab->sh_size - section->sh_name)),value));
+    }
+}
+
+/// walk the section headers to .symtab and its string table
+template<typename Ehdr, typename Shdr, typename Sym>
+bool elf_symbols_t::index_symbols( const char *filename )
+{
+    const uint8_t *base = (const uint8_t *)image;
+    if (image_size < sizeof(Ehdr))
+    {
+        printf("%s: truncated elf header\n",filename);
+        return false;
+    }
+    const Ehdr *ehdr = (const Ehdr *)base;
+    if (ehdr->e_shentsize != sizeof(Shdr) || ehdr->e_shoff > image_size ||
+        ehdr->e_shnum > (image_size - ehdr->e_shoff) / sizeof(Shdr))
+    {
+        printf("%s: bad section headers\n",filename);
+        return false;
+    }
+    const Shdr *shdrs = (const Shdr *)(base + ehdr->e_shoff);
+    index_sections(ehdr,shdrs);
+    for (uint32_t s=0;s<ehdr->e_shnum;s++)
+    {
+        const Shdr *symtab = &shdrs[s];
+        if (symtab->sh_type != SHT_SYMTAB)
+        {
+            continue;
+        }
+        if (symtab->sh_link >= ehdr->e_shnum)
+        {
+            printf("%s: bad symbol table\n",filename);
+            return false;
+        }
+        const Shdr *strtab = &shdrs[symtab->sh_link];
+        if (symtab->sh_offset > image_size || symtab->sh_size > image_size - symtab->sh_offset ||
+            strtab->sh_offset > image_size || strtab->sh_size > image_size - strtab->sh_offset ||
+            strtab->sh_size == 0)
+        {
+            printf("%s: truncated symbol table\n",filename);
+            return false;
+        }
+        const Sym *syms = (const Sym *)(base + symtab->sh_offset);
+        const char *names = (const char *)(base + strtab->sh_offset);
+        uint32_t num_syms = symtab->sh_size / sizeof(Sym);
+        // the string table ends with a 0 so strnlen() can't run off the end
+        for (uint32_t i=1;i<num_syms;i++)
+        {
+            const Sym *sym = &syms[i];
+            uint32_t type = sym->st_info & 0xf;
+            uint32_t binding = sym->st_info >> 4;
+            // an undefined symbol (e.g. an unresolved weak reference) has no address, its 0 isn't one
+            if (sym->st_name == 0 || sym->st_name >= strtab->sh_size || type == STT_SECTION || type == STT_FILE ||
+                sym->st_shndx == SHN_UNDEF)
+            {
+                continue;
+            }
+            const char *name = &names[sym->st_name];
+            uint32_t value = sym->st_value;
+            // thumb functions have bit 0 set to say they are thumb
+            if (ehdr->e_machine == EM_ARM && type == STT_FUNC)
+            {
+                value &= ~1U;
+            }
+            add_symbol( std::string_view(name,strnlen(name,strtab->sh_size - sym->st_name)), value, binding != STB_LOCAL );
+        }
+        return true;
+    }
+    printf("%s: no symbol table (was it stripped?)\n",filename);
+    return false;
+}
+
+/**
+ * @brief
+ *   look up the value of a symbol.
+ *
+ * @return false if the symbol isn't in the symbol table
+ */
+bool elf_symbols_t::find( std::string_view name, uint32_t *value ) const
+{
+    std::unordered_map<std::string_view,symbol_t>::const_iterator it = symbols.find(name);
+    if (it == symbols.end())
+    {
+        return false;
+    }
+    *value = it->second.value;
+    return true;
+}
+
+/**
+ * @brief
+ *   look up the address and size of an allocated section (e.g. .mpu_table).
+ *
+ * @return false if there is no allocated section with that name
+ */
+bool elf_symbols_t::find_section( std::string_view name, uint32_t *addr, uint32_t *size ) const
+{
+    std::unordered_map<std::string_view,section_t>::const_iterator it = sections.find(name);
+    if (it == sections.end())
+    {
+        return false;
+    }
+    *addr = it->second.addr;
+    *size = it->second.size;
+    return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read the symbol table of an elf file (e.g. the first pass firmware) so mpu_calc
+*   can use linker symbols like __data_start__ without running objdump.
+*/
+
+#ifndef ELF_SYMBOLS_H
+#define ELF_SYMBOLS_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+#include <unordered_map>
+#include "mpu_expression.h"
+
+/**
+ * the file is mmap'd and the names in the symbol table are referenced in place,
+ * so loading a large image only costs one pass over .symtab.
+ *
+ * e.g.
+ *    elf_symbols_t symbols;
+ *    uint32_t data_start;
+ *    if (symbols.load("device_first_pass") && symbols.find("__data_start__",&data_start)) ...
+ */
+class elf_symbols_t : public mpu_symbol_table_t {
+public:
+    elf_symbols_t():image(NULL),image_size(0),symbols(),sections(){}
+    ~elf_symbols_t();
+    elf_symbols_t( const elf_symbols_t & ) = delete;
+    elf_symbols_t &operator=( const elf_symbols_t & ) = delete;
+
+    bool load( const char *filename );
+    bool find( std::string_view name, uint32_t *value ) const;
+    bool find_section( std::string_view name, uint32_t *addr, uint32_t *size ) const;
+    bool is_loaded() const { return image != NULL; }
+    size_t size() const { return symbols.size(); }
+
+private:
+    struct symbol_t {
+        uint32_t value;
+        bool global;
+    };
+    void *image;
+    size_t image_size;
+    std::unordered_map<std::string_view,symbol_t> symbols;
+    struct section_t {
+        uint32_t addr;
+        uint32_t size;
+    };
+    /// the allocated sections (the ones that take up memory on the target)
+    std::unordered_map<std::string_view,section_t> sections;
+
+    void unload();
+    bool index_image( const char *filename );
+    template<typename Ehdr, typename Shdr, typename Sym>
+    bool index_symbols( const char *filename );
+    template<typename Ehdr, typename Shdr>
+    void index_sections( const Ehdr *ehdr, const Shdr *shdrs );
+    void add_symbol( std::string_view name, uint32_t value, bool global );
+};
+
+#endif
+
+#endif
@@ -0,0 +1,495 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read the MEMORY regions and output sections of a linker script (see linker_script.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "linker_script.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+/// region and section names, e.g. OCR_SHMEM, .ARM.exidx, /DISCARD/
+static bool is_ld_name_char( char c )
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$' || c == '/' || c == '-';
+}
+
+static bool at_end( const std::string_view &text, size_t pos )
+{
+    return pos >= text.size();
+}
+
+/// the comments are replaced with spaces (keeping the newlines) so the line numbers stay right
+static std::string blank_comments( const char *text, size_t length )
+{
+    std::string result(text,length);
+    size_t i = 0;
+    while (i+1 < result.size())
+    {
+        if (result[i] != '/' || result[i+1] != '*')
+        {
+            i++;
+            continue;
+        }
+        size_t end = result.find("*/",i+2);
+        end = (end == std::string::npos) ? result.size() : end+2;
+        for (;i<end;i++)
+        {
+            if (result[i] != '\n')
+            {
+                result[i] = ' ';
+            }
+        }
+    }
+    return result;
+}
+
+static void skip_space( std::string_view text, size_t *pos, uint32_t *line )
+{
+    while (!at_end(text,*pos) && isspace((unsigned char)text[*pos]))
+    {
+        if (text[*pos] == '\n')
+        {
+            (*line)++;
+        }
+        (*pos)++;
+    }
+}
+
+static std::string_view read_name( std::string_view text, size_t *pos )
+{
+    size_t start = *pos;
+    while (!at_end(text,*pos) && is_ld_name_char(text[*pos]))
+    {
+        (*pos)++;
+    }
+    return text.substr(start,*pos-start);
+}
+
+bool linker_script_t::error( const cursor_t &c, const char *message, std::string_view text )
+{
+    printf("%s:%u: %s '%.*s'\n",filename.c_str(),c.line+1,message,(int)text.size(),text.data());
+    return false;
+}
+
+/*
+ * the value runs to a ',' or the end of the line, or to the next attribute when they
+ * are on the same line without a comma, e.g.
+ *   OCR_DEV (RWX) : ORIGIN = 0x400000 LENGTH = 0x208000
+ */
+bool linker_script_t::parse_memory_value( cursor_t &c, const std::string &region, uint32_t *value )
+{
+    skip_space(c.text,&c.pos,&c.line);
+    size_t start = c.pos;
+    uint32_t depth = 0;
+    while (!at_end(c.text,c.pos))
+    {
+        char ch = c.text[c.pos];
+        if (ch == '(')
+        {
+            depth++;
+        }
+        else if (ch == ')' && depth > 0)
+        {
+            depth--;
+        }
+        else if (depth == 0 && (ch == ',' || ch == '}' || ch == '\n'))
+        {
+            break;
+        }
+        else if (depth == 0 && isalpha((unsigned char)ch) && (c.pos == start || !is_ld_name_char(c.text[c.pos-1])))
+        {
+            // a name followed by '=' is the next attribute
+            size_t next = c.pos;
+            uint32_t line = c.line;
+            read_name(c.text,&next);
+            skip_space(c.text,&next,&line);
+            if (next > c.pos && !at_end(c.text,next) && c.text[next] == '=')
+            {
+                break;
+            }
+        }
+        c.pos++;
+    }
+    std::string_view text = c.text.substr(start,c.pos-start);
+    while (!text.empty() && isspace((unsigned char)text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    mpu_expression_t expression;
+    if (!expression.compile(text) || !expression.evaluate(this,value))
+    {
+        printf("%s:%u: %s in '%.*s' (memory %s)\n",filename.c_str(),c.line+1,expression.error.c_str(),(int)text.size(),text.data(),region.c_str());
+        return false;
+    }
+    return true;
+}
+
+/// after 'MEMORY {', e.g. OCR_SHMEM (RWX) : ORIGIN = 0x6F8000, LENGTH = 0x7C00
+bool linker_script_t::parse_memory( cursor_t &c )
+{
+    while (true)
+    {
+        skip_space(c.text,&c.pos,&c.line);
+        if (at_end(c.text,c.pos))
+        {
+            return error(c,"missing '}' at the end of","MEMORY");
+        }
+        if (c.text[c.pos] == '}')
+        {
+            c.pos++;
+            return true;
+        }
+        memory_t memory;
+        memory.line = c.line + 1;
+        memory.name = std::string(read_name(c.text,&c.pos));
+        if (memory.name.empty())
+        {
+            return error(c,"expected a memory region at",c.text.substr(c.pos,1));
+        }
+        if (find_memory(memory.name) != NULL)
+        {
+            return error(c,"duplicate memory region",memory.name);
+        }
+        skip_space(c.text,&c.pos,&c.line);
+        if (!at_end(c.text,c.pos) && c.text[c.pos] == '(')
+        {
+            // the attributes, (RWX) etc. aren't used
+            while (!at_end(c.text,c.pos) && c.text[c.pos] != ')')
+            {
+                c.pos++;
+            }
+            c.pos++;
+            skip_space(c.text,&c.pos,&c.line);
+        }
+        if (at_end(c.text,c.pos) || c.text[c.pos] != ':')
+        {
+            return error(c,"expected ':' after",memory.name);
+        }
+        c.pos++;
+        bool has_origin = false;
+        bool has_length = false;
+        while (!has_origin || !has_length)
+        {
+            skip_space(c.text,&c.pos,&c.line);
+            std::string_view key = read_name(c.text,&c.pos);
+            skip_space(c.text,&c.pos,&c.line);
+            if (at_end(c.text,c.pos) || c.text[c.pos] != '=')
+            {
+                return error(c,"expected ORIGIN = and LENGTH = for",memory.name);
+            }
+            c.pos++;
+            if (key == "ORIGIN" || key == "org" || key == "o")
+            {
+                has_origin = parse_memory_value(c,memory.name,&memory.origin);
+                if (!has_origin)
+                {
+                    return false;
+                }
+            }
+            else if (key == "LENGTH" || key == "len" || key == "l")
+            {
+                has_length = parse_memory_value(c,memory.name,&memory.length);
+                if (!has_length)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return error(c,"unknown memory attribute",key);
+            }
+            skip_space(c.text,&c.pos,&c.line);
+            if (!at_end(c.text,c.pos) && c.text[c.pos] == ',')
+            {
+                c.pos++;
+            }
+        }
+        memories.push_back(memory);
+    }
+}
+
+/*
+ * after 'SECTIONS {', only the output sections are kept, e.g.
+ *   .mpu_table : { ... } > OCR_DEV
+ *   .data : AT(__etext) { ... } > RAM AT> FLASH
+ * assignments and everything inside the braces are skipped.
+ */
+bool linker_script_t::parse_sections( cursor_t &c )
+{
+    while (true)
+    {
+        skip_space(c.text,&c.pos,&c.line);
+        if (at_end(c.text,c.pos))
+        {
+            return error(c,"missing '}' at the end of","SECTIONS");
+        }
+        if (c.text[c.pos] == '}')
+        {
+            c.pos++;
+            return true;
+        }
+        // a statement ends with ';', or is a header followed by { ... }
+        size_t start = c.pos;
+        uint32_t line = c.line;
+        uint32_t parens = 0;
+        while (!at_end(c.text,c.pos))
+        {
+            char ch = c.text[c.pos];
+            if (ch == '(')
+            {
+                parens++;
+            }
+            else if (ch == ')' && parens > 0)
+            {
+                parens--;
+            }
+            else if (parens == 0 && (ch == ';' || ch == '{' || ch == '}'))
+            {
+                break;
+            }
+            else if (ch == '\n')
+            {
+                c.line++;
+            }
+            c.pos++;
+        }
+        if (at_end(c.text,c.pos) || c.text[c.pos] != '{')
+        {
+            if (!at_end(c.text,c.pos) && c.text[c.pos] == ';')
+            {
+                c.pos++;
+            }
+            continue;
+        }
+        std::string_view header = c.text.substr(start,c.pos-start);
+        uint32_t depth = 0;
+        while (!at_end(c.text,c.pos))
+        {
+            char ch = c.text[c.pos++];
+            if (ch == '{')
+            {
+                depth++;
+            }
+            else if (ch == '}' && --depth == 0)
+            {
+                break;
+            }
+            else if (ch == '\n')
+            {
+                c.line++;
+            }
+        }
+        if (depth != 0)
+        {
+            return error(c,"missing '}' at the end of",header);
+        }
+        if (header.find(':') == std::string_view::npos)
+        {
+            continue;
+        }
+        section_t section;
+        section.line = line + 1;
+        size_t name_end = 0;
+        section.name = std::string(read_name(header,&name_end));
+        // '> REGION', 'AT> REGION', ':phdr' and '= fill' can follow the closing brace
+        while (true)
+        {
+            size_t pos = c.pos;
+            uint32_t trailer_line = c.line;
+            skip_space(c.text,&pos,&trailer_line);
+            if (at_end(c.text,pos))
+            {
+                break;
+            }
+            bool is_lma = false;
+            if (c.text.substr(pos,2) == "AT")
+            {
+                size_t after = pos+2;
+                skip_space(c.text,&after,&trailer_line);
+                if (at_end(c.text,after) || c.text[after] != '>')
+                {
+                    break;
+                }
+                is_lma = true;
+                pos = after;
+            }
+            char ch = c.text[pos];
+            if (ch != '>' && ch != ':' && ch != '=')
+            {
+                break;
+            }
+            pos++;
+            skip_space(c.text,&pos,&trailer_line);
+            std::string_view name = read_name(c.text,&pos);
+            if (ch == '>' && !is_lma && section.memory.empty())
+            {
+                section.memory = std::string(name);
+            }
+            c.pos = pos;
+            c.line = trailer_line;
+        }
+        if (!section.memory.empty() && find_memory(section.memory) == NULL)
+        {
+            return error(c,"unknown memory region",section.memory);
+        }
+        sections.push_back(section);
+    }
+}
+
+/**
+ * @brief
+ *   read the MEMORY regions and output sections from linker script text.
+ *
+ * @return false if there is an error (it is printed with name and the line number)
+ */
+bool linker_script_t::load_string( const char *text, size_t length, const char *name )
+{
+    filename = name;
+    memories.clear();
+    sections.clear();
+    std::string script = blank_comments(text,length);
+    cursor_t c = { script, 0, 0 };
+    while (true)
+    {
+        skip_space(c.text,&c.pos,&c.line);
+        if (at_end(c.text,c.pos))
+        {
+            return true;
+        }
+        char ch = c.text[c.pos];
+        if (ch == '"')
+        {
+            // e.g. OUTPUT_FORMAT("elf32-littlearm")
+            size_t end = c.text.find('"',c.pos+1);
+            c.pos = (end == std::string_view::npos) ? c.text.size() : end+1;
+            continue;
+        }
+        if (!is_ld_name_char(ch))
+        {
+            c.pos++;
+            continue;
+        }
+        std::string_view keyword = read_name(c.text,&c.pos);
+        if (keyword != "MEMORY" && keyword != "SECTIONS")
+        {
+            continue;
+        }
+        skip_space(c.text,&c.pos,&c.line);
+        bool ok = !at_end(c.text,c.pos) && c.text[c.pos] == '{';
+        if (!ok)
+        {
+            error(c,"expected '{' after",keyword);
+        }
+        else
+        {
+            c.pos++;
+            ok = (keyword == "MEMORY") ? parse_memory(c) : parse_sections(c);
+        }
+        if (!ok)
+        {
+            filename.clear();
+            return false;
+        }
+    }
+}
+
+/// same as load_string() for a file
+bool linker_script_t::load_file( const char *name )
+{
+    FILE *f = fopen(name,"rb");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",name);
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer,1,sizeof(buffer),f)) > 0)
+    {
+        text.append(buffer,n);
+    }
+    fclose(f);
+    return load_string(text.data(),text.size(),name);
+}
+
+const linker_script_t::memory_t *linker_script_t::find_memory( std::string_view name ) const
+{
+    for (uint32_t i=0;i<memories.size();i++)
+    {
+        if (memories[i].name == name)
+        {
+            return &memories[i];
+        }
+    }
+    return NULL;
+}
+
+const linker_script_t::section_t *linker_script_t::find_output_section( std::string_view name ) const
+{
+    for (uint32_t i=0;i<sections.size();i++)
+    {
+        if (sections[i].name == name)
+        {
+            return &sections[i];
+        }
+    }
+    return NULL;
+}
+
+/// ORIGIN(name) and LENGTH(name) of a memory region, anything else is passed on to next
+bool linker_script_t::find( std::string_view name, uint32_t *value ) const
+{
+    bool is_origin = name.substr(0,7) == "ORIGIN(";
+    bool is_length = name.substr(0,7) == "LENGTH(";
+    if ((is_origin || is_length) && name.back() == ')')
+    {
+        const memory_t *memory = find_memory(name.substr(7,name.size()-8));
+        if (memory == NULL)
+        {
+            return false;
+        }
+        *value = is_origin ? memory->origin : memory->length;
+        return true;
+    }
+    return next != NULL && next->find(name,value);
+}
+
+/**
+ * @brief
+ *   the script doesn't know where the linker put a section, that comes from next (the elf file).
+ *
+ * when next doesn't have it the script's SECTIONS say why, e.g. a typo in the yaml or a
+ * section the linker dropped because nothing went in it.
+ */
+bool linker_script_t::find_section( std::string_view name, uint32_t *addr, uint32_t *size ) const
+{
+    if (next != NULL && next->find_section(name,addr,size))
+    {
+        return true;
+    }
+    const section_t *section = find_output_section(name);
+    if (section == NULL)
+    {
+        if (!sections.empty())
+        {
+            printf("'%.*s' isn't an output section in '%s'\n",(int)name.size(),name.data(),filename.c_str());
+        }
+    }
+    else if (section->memory.empty())
+    {
+        printf("'%.*s' (line %d of '%s') isn't in the elf file\n",(int)name.size(),name.data(),(int)section->line,filename.c_str());
+    }
+    else
+    {
+        printf("'%.*s' goes in %s (line %d of '%s') but isn't in the elf file\n",(int)name.size(),name.data(),
+            section->memory.c_str(),(int)section->line,filename.c_str());
+    }
+    return false;
+}
+
+#endif
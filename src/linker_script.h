@@ -0,0 +1,89 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read the MEMORY regions and output sections of a linker script (e.g. example/device.ld)
+*   so memory_map.yaml can name them instead of repeating their addresses, e.g.
+*
+*    region:
+*            memory:           OCR_SHMEM
+*            AccessAttributes: UNCACHED
+*    region:
+*            section:          .mpu_table
+*            AccessPermission: ARM_MPU_AP_RO
+*    region:
+*            start_addr:       ORIGIN(OCR_SHMEM)
+*            size:             16K
+*
+* only what mpu_calc needs is understood: the MEMORY block (ORIGIN/org/o and LENGTH/len/l,
+* with expressions that can use ORIGIN() and LENGTH() of the regions above them), and the
+* name and '> REGION' of each output section in SECTIONS. the rest of the script is skipped.
+*/
+
+#ifndef LINKER_SCRIPT_H
+#define LINKER_SCRIPT_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mpu_expression.h"
+
+/**
+ * also a symbol table, ORIGIN(name) and LENGTH(name) are looked up here and
+ * anything else in next (normally the elf file), e.g.
+ *    linker_script_t script;
+ *    script.next = &elf_symbols;
+ *    if (!script.load_file("device.ld")) exit(-1);
+ *    loader.symbols = &script;
+ */
+class linker_script_t : public mpu_symbol_table_t {
+public:
+    struct memory_t {
+        std::string name;
+        uint32_t origin;
+        uint32_t length;
+        uint32_t line;
+    };
+    struct section_t {
+        std::string name;
+        std::string memory; ///< the '> REGION' it is placed in, empty if it doesn't say
+        uint32_t line;
+    };
+
+    std::vector<memory_t> memories;
+    std::vector<section_t> sections;
+    /// where symbols that aren't ORIGIN()/LENGTH() are looked up, NULL if there are none
+    const mpu_symbol_table_t *next;
+
+    linker_script_t():memories(),sections(),next(NULL),filename(){}
+
+    bool load_file( const char *filename );
+    bool load_string( const char *text, size_t length, const char *name = "string" );
+    bool is_loaded() const { return !filename.empty(); }
+
+    const memory_t *find_memory( std::string_view name ) const;
+    const section_t *find_output_section( std::string_view name ) const;
+    bool find( std::string_view name, uint32_t *value ) const;
+    bool find_section( std::string_view name, uint32_t *addr, uint32_t *size ) const;
+
+private:
+    std::string filename;
+
+    /// where parse_*() are up to in the script (comments already blanked out)
+    struct cursor_t {
+        std::string_view text;
+        size_t pos;
+        uint32_t line;
+    };
+    bool parse_memory( cursor_t &c );
+    bool parse_sections( cursor_t &c );
+    bool parse_memory_value( cursor_t &c, const std::string &region, uint32_t *value );
+    bool error( const cursor_t &c, const char *message, std::string_view text );
+};
+
+#endif
+
+#endif
@@ -159,3 +159,6 @@
         .RBAR = ARM_MPU_RBAR(13UL, 0x00000000UL),
         .RASR = 0
     },
+    // crc for mpu_verify(), the regions in MPU_TABLE_VERIFY_MASK are reprogrammed at run time and are not checked
+#define MPU_TABLE_VERIFY_MASK 0x0000b800UL
+#define MPU_TABLE_VERIFY_CRC 0x832ccce0UL
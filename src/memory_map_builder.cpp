@@ -0,0 +1,322 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   turn the regions read from memory_map.yaml into an mpu table (see memory_map_builder.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "memory_map_builder.h"
+#include "mpu_calculator.h"
+#include "mpu_stack_guard.h"
+#include <algorithm>
+#include <stdio.h>
+
+/// add the mpu entries for one region after the ones already added
+void memory_map_builder_t::add_region( const region_spec_t &region )
+{
+    mpu_calculator_t mpu_calc;
+    mpu_calc.mpu_region_number = num_entries;
+    uint32_t end_addr = region.end_addr;
+    if (region.size != 0)
+    {
+        end_addr = region.start_addr+region.size;
+    }
+    if (!mpu_calc.build_best_mpu_entries(region.start_addr,end_addr,region.DisableExec,region.AccessPermission,region.AccessAttributes))
+    {
+        printf("error building entries for 0x%08x to 0x%08x (region:%d)\n",region.start_addr,end_addr,num_entries);
+        ok = false;
+    }
+
+    for (uint32_t i=0;i<mpu_calc.num_entries;i++)
+    {
+        // keep counting past the end of the display so overflow() can say by how much
+        if (num_entries < mpu_display_t::MAX_ENTRIES)
+        {
+            display.set(num_entries,mpu_calc.mpu_table[i].RBAR,mpu_calc.mpu_table[i].RASR,region.comment);
+        }
+        num_entries++;
+    }
+}
+
+/// add the regions of one task (-1 is the global table)
+void memory_map_builder_t::add_regions( const std::vector<region_spec_t> &regions, int32_t task )
+{
+    for (uint32_t i=0;i<regions.size();i++)
+    {
+        if (regions[i].task == task && regions[i].hotness < 0)
+        {
+            add_region(regions[i]);
+        }
+    }
+}
+
+/// fill the rest of the table with disabled entries
+void memory_map_builder_t::pad( uint32_t table_size )
+{
+    while (num_entries < table_size && num_entries < mpu_display_t::MAX_ENTRIES)
+    {
+        display.set(num_entries,ARM_MPU_RBAR(num_entries,0),0,"unused");
+        num_entries++;
+    }
+}
+
+/**
+ * @brief
+ *   calculate the entries of every task in the slots from first_region to table_size-1.
+ *
+ * region 15 (the stack guard and mpu_configure_region()) is never a task slot, whatever table_size is.
+ *
+ * @param[in] first_region - entries used by the global table (before it is padded)
+ * @param[in] table_size - regions available (i.e. mpu_table_size=)
+ *
+ * @return false if a task needs more slots than are free or a region fails (an error is printed)
+ */
+bool mpu_task_tables_t::build( const memory_map_loader_t &loader, uint32_t first_region_, uint32_t table_size )
+{
+    first_region = first_region_;
+    table_size = table_size < MPU_STACK_GUARD_REGION ? table_size : MPU_STACK_GUARD_REGION;
+    num_regions = table_size > first_region ? table_size - first_region : 0;
+    names.clear();
+    tasks.clear();
+    tasks.resize(loader.tasks.size());
+    bool ok = true;
+    for (uint32_t t=0;t<loader.tasks.size();t++)
+    {
+        memory_map_builder_t &builder = tasks[t];
+        names.push_back(loader.tasks[t].name);
+        builder.num_entries = first_region;
+        for (uint32_t i=0;i<loader.regions.size();i++)
+        {
+            if (loader.regions[i].task == (int32_t)t)
+            {
+                region_spec_t region = loader.regions[i];
+                if (region.comment.empty())
+                {
+                    region.comment = loader.tasks[t].name;
+                }
+                builder.add_region(region);
+            }
+        }
+        if (builder.overflow(table_size))
+        {
+            printf("task '%s' needs %u regions but only %u are left after the global table\n",
+                loader.tasks[t].name.c_str(),builder.num_entries - first_region,num_regions);
+            ok = false;
+            continue;
+        }
+        builder.pad(table_size);
+        ok = ok && builder.ok;
+    }
+    return ok;
+}
+
+/*
+ * the header #included by mpu_task_table.cpp, e.g.
+ *
+ *   #define MPU_TASK_FIRST_REGION 12UL
+ *   #define MPU_TASK_NUM_REGIONS 3UL
+ *   static const ARM_MPU_Region_t mpuTask_net_rx[MPU_TASK_NUM_REGIONS] = { ... };
+ *   #define MPU_TASK_SETTINGS { "net_rx", mpuTask_net_rx },
+ */
+void mpu_task_tables_t::emit( output_buffer_t &out )
+{
+    out.print("// per task mpu regions, generated by mpu_calc\n");
+    out.print("// each task's entries are copied to regions %u..%u when it is switched in\n",first_region,first_region+num_regions-1);
+    out.print("#define MPU_TASK_FIRST_REGION %uUL\n",first_region);
+    out.print("#define MPU_TASK_NUM_REGIONS %uUL\n",num_regions);
+    out.print("#define MPU_TASK_COUNT %uUL\n",(uint32_t)tasks.size());
+    for (uint32_t t=0;t<tasks.size();t++)
+    {
+        out.print("\n// task %s\n",names[t].c_str());
+        out.print("static const ARM_MPU_Region_t mpuTask_%s[MPU_TASK_NUM_REGIONS] = {\n",names[t].c_str());
+        tasks[t].display.display_entries(out,"    // ");
+        out.print("};\n");
+    }
+    out.print("\n#define MPU_TASK_SETTINGS");
+    for (uint32_t t=0;t<tasks.size();t++)
+    {
+        out.print(" \\\n    { \"%s\", mpuTask_%s },",names[t].c_str(),names[t].c_str());
+    }
+    if (tasks.empty())
+    {
+        out.print(" { NULL, NULL },");
+    }
+    out.print("\n");
+}
+
+/// true if an enabled subregion of e is in [start,end)
+static bool entry_overlaps( mpu_entry_t &e, uint64_t start, uint64_t end )
+{
+    for (uint32_t i=0;i<8;i++)
+    {
+        uint64_t sub_start = (uint64_t)e.BaseAddress + (uint64_t)e.subregion_size*i;
+        if (e.region_active(i) && sub_start < end && start < sub_start + e.subregion_size)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// true if enabled subregions of a and b overlap
+static bool entries_overlap( mpu_entry_t &a, mpu_entry_t &b )
+{
+    for (uint32_t i=0;i<8;i++)
+    {
+        uint64_t sub_start = (uint64_t)b.BaseAddress + (uint64_t)b.subregion_size*i;
+        if (b.region_active(i) && entry_overlaps(a,sub_start,sub_start + b.subregion_size))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief
+ *   calculate the entries of the virtual regions, hottest first.
+ *
+ * @param[in] global - the global table (the virtual regions must be where it faults)
+ * @param[in] first_slot_ - entries used by the global table
+ * @param[in] num_slots_ - slots for the virtual regions (i.e. virtual_slots=)
+ *
+ * @return false if a region fails, is mapped by the global table or overlaps another virtual region (an error is printed)
+ */
+bool mpu_virtual_regions_t::build( const memory_map_loader_t &loader, mpu_display_t &global, uint32_t first_slot_, uint32_t num_slots_ )
+{
+    first_slot = first_slot_;
+    num_slots = num_slots_;
+    entries.clear();
+    weights.clear();
+    comments.clear();
+    std::vector<uint32_t> order;
+    for (uint32_t i=0;i<loader.regions.size();i++)
+    {
+        if (loader.regions[i].hotness >= 0)
+        {
+            order.push_back(i);
+        }
+    }
+    if (order.empty())
+    {
+        num_slots = 0;
+        return true;
+    }
+    if (num_slots == 0 || num_slots > MPU_VIRTUAL_MAX_SLOTS)
+    {
+        printf("%u virtual regions (hotness:) need virtual_slots= 1-%u\n",(uint32_t)order.size(),MPU_VIRTUAL_MAX_SLOTS);
+        return false;
+    }
+    std::stable_sort(order.begin(),order.end(),[&loader]( uint32_t a, uint32_t b ) {
+        return loader.regions[a].hotness > loader.regions[b].hotness;
+    });
+
+    std::vector<mpu_interval_t> intervals;
+    global.flatten_memory_map(intervals);
+    std::vector<uint32_t> lines;
+    bool ok = true;
+    for (uint32_t r : order)
+    {
+        const region_spec_t &region = loader.regions[r];
+        mpu_calculator_t mpu_calc;
+        mpu_calc.mpu_region_number = 0;
+        uint32_t end_addr = region.size != 0 ? region.start_addr+region.size : region.end_addr;
+        if (!mpu_calc.build_best_mpu_entries(region.start_addr,end_addr,region.DisableExec,region.AccessPermission,region.AccessAttributes))
+        {
+            printf("error building entries for 0x%08x to 0x%08x (virtual region at line %d)\n",region.start_addr,end_addr,(int)region.line);
+            ok = false;
+            continue;
+        }
+        for (uint32_t i=0;i<mpu_calc.num_entries;i++)
+        {
+            ARM_MPU_Region_t entry = { (uint32_t)(mpu_calc.mpu_table[i].RBAR & MPU_RBAR_ADDR_Msk), mpu_calc.mpu_table[i].RASR };
+            mpu_entry_t e;
+            e.set(entry.RBAR,entry.RASR);
+            for (const mpu_interval_t &interval : intervals)
+            {
+                if (interval.entry != NULL && interval.entry->AccessPermission != ARM_MPU_AP_NONE &&
+                    entry_overlaps(e,interval.start,(uint64_t)interval.stop+1))
+                {
+                    printf("virtual region at line %d overlaps '%s' in the global table, an access to it wouldn't fault\n",
+                        (int)region.line,interval.entry->comment.c_str());
+                    ok = false;
+                    break;
+                }
+            }
+            for (uint32_t j=0;j<entries.size();j++)
+            {
+                mpu_entry_t other;
+                other.set(entries[j].RBAR,entries[j].RASR);
+                if (lines[j] != region.line && entries_overlap(e,other))
+                {
+                    printf("virtual region at line %d overlaps the one at line %d\n",(int)region.line,(int)lines[j]);
+                    ok = false;
+                    break;
+                }
+            }
+            entries.push_back(entry);
+            weights.push_back(region.hotness);
+            comments.push_back(region.comment);
+            lines.push_back(region.line);
+        }
+    }
+    if (entries.size() >= MPU_VIRTUAL_NO_ENTRY)
+    {
+        printf("the virtual regions need %u entries, the most is %u\n",(uint32_t)entries.size(),MPU_VIRTUAL_NO_ENTRY-1);
+        ok = false;
+    }
+    return ok;
+}
+
+/*
+ * the header #included by mpu_virtual_table.cpp, e.g.
+ *
+ *   #define MPU_VIRTUAL_FIRST_SLOT 10UL
+ *   #define MPU_VIRTUAL_NUM_SLOTS 4UL
+ *   #define MPU_VIRTUAL_NUM_ENTRIES 9UL
+ *   static const ARM_MPU_Region_t mpuVirtualEntries[] = { ... };
+ *   static const uint8_t mpuVirtualWeights[] = { 200, 200, 50, ... };
+ */
+void mpu_virtual_regions_t::emit( output_buffer_t &out )
+{
+    out.print("// virtual mpu regions, generated by mpu_calc\n");
+    if (num_slots != 0)
+    {
+        out.print("// the hottest entries are loaded into regions %u..%u at boot, mpu_virtual_fault() swaps in the others\n",first_slot,first_slot+num_slots-1);
+    }
+    out.print("#define MPU_VIRTUAL_FIRST_SLOT %uUL\n",first_slot);
+    out.print("#define MPU_VIRTUAL_NUM_SLOTS %uUL\n",num_slots);
+    out.print("#define MPU_VIRTUAL_NUM_ENTRIES %uUL\n",(uint32_t)entries.size());
+    out.print("\nstatic const ARM_MPU_Region_t mpuVirtualEntries[] = {\n");
+    for (uint32_t i=0;i<entries.size();i++)
+    {
+        mpu_entry_t e;
+        e.comment = comments[i];
+        e.set(entries[i].RBAR,entries[i].RASR);
+        e.print(out,"    // ");
+    }
+    if (entries.empty())
+    {
+        out.print("    { 0, 0 }\n");
+    }
+    out.print("};\n");
+    out.print("static const uint8_t mpuVirtualWeights[] = {");
+    for (uint32_t i=0;i<weights.size();i++)
+    {
+        out.print(" %u,",weights[i]);
+    }
+    if (weights.empty())
+    {
+        out.print(" 0");
+    }
+    out.print(" };\n");
+}
+
+mpu_virtual_table_t mpu_virtual_regions_t::table() const
+{
+    mpu_virtual_table_t table = { entries.data(), weights.data(), (uint32_t)entries.size(), first_slot, num_slots };
+    return table;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   turn the regions read from memory_map.yaml into an mpu table
+*
+* everything about one table is in one memory_map_builder_t, so several tables can be
+* calculated at the same time (see mpu_batch.h).
+*/
+
+#ifndef MEMORY_MAP_BUILDER_H
+#define MEMORY_MAP_BUILDER_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <vector>
+#include "mpu_display.h"
+#include "memory_map_loader.h"
+#include "mpu_virtual.h"
+#include "output_buffer.h"
+#include <string>
+
+/**
+ * e.g.
+ *    memory_map_builder_t builder;
+ *    for (const region_spec_t &region : loader.regions) builder.add_region(region);
+ *    builder.pad(MPU_TABLE_SIZE);
+ *    emitter->emit(builder.display,out);
+ */
+class memory_map_builder_t {
+public:
+    mpu_display_t display;
+    uint32_t num_entries;   ///< entries used so far (may be more than MAX_ENTRIES, see overflow())
+    bool ok;                ///< false if a region could not be converted to mpu entries
+
+    memory_map_builder_t():display(),num_entries(0),ok(true){}
+
+    void add_region( const region_spec_t &region );
+    void add_regions( const std::vector<region_spec_t> &regions, int32_t task = -1 );
+    void pad( uint32_t table_size );
+    bool overflow( uint32_t table_size ) const { return num_entries > table_size; }
+};
+
+/**
+ * the regions of each task, calculated at build time so a context switch only copies
+ * RBAR/RASR pairs (see mpu_task_table.h).
+ *
+ * every task gets the same slots, the ones after the global table up to the table size (but never region 15),
+ * and the slots a task doesn't use are disabled so nothing is left over from the previous
+ * task. the slots are higher than the global table's so a task's regions win where they overlap.
+ */
+class mpu_task_tables_t {
+public:
+    uint32_t first_region;
+    uint32_t num_regions;
+    std::vector<std::string> names;
+    std::vector<memory_map_builder_t> tasks;
+
+    mpu_task_tables_t():first_region(0),num_regions(0),names(),tasks(){}
+
+    bool build( const memory_map_loader_t &loader, uint32_t first_region, uint32_t table_size );
+    void emit( output_buffer_t &out );
+    /// the task slots change at run time, so mpu_verify() has to skip them
+    uint32_t verify_mask() const { return (tasks.empty() || num_regions == 0) ? 0 : ((1U << num_regions)-1) << first_region; }
+};
+
+/**
+ * the regions with hotness:, which are swapped into a few slots when an access to them
+ * faults (see mpu_virtual.h).
+ *
+ * each region is calculated on its own and the entries are ranked hottest first, so the
+ * hottest are loaded at boot. a virtual region has to be where the global table faults
+ * (unmapped or ARM_MPU_AP_NONE), otherwise nothing would ever swap it in.
+ */
+class mpu_virtual_regions_t {
+public:
+    uint32_t first_slot;
+    uint32_t num_slots;
+    std::vector<ARM_MPU_Region_t> entries;
+    std::vector<uint8_t> weights;
+    std::vector<std::string> comments;
+
+    mpu_virtual_regions_t():first_slot(0),num_slots(0),entries(),weights(),comments(){}
+
+    bool build( const memory_map_loader_t &loader, mpu_display_t &global, uint32_t first_slot, uint32_t num_slots );
+    void emit( output_buffer_t &out );
+    /// the entries as mpu_virtual_load() takes them, valid until the next build()
+    mpu_virtual_table_t table() const;
+    /// the virtual slots change at run time, so mpu_verify() has to skip them
+    uint32_t verify_mask() const { return num_slots == 0 ? 0 : ((1U << num_slots)-1) << first_slot; }
+};
+
+#endif
+
+#endif
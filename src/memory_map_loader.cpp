@@ -0,0 +1,713 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read the regions from memory_map.yaml (see memory_map_loader.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "memory_map_loader.h"
+#include "configure_mpu.h"
+#include <yaml.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+region_spec_t::region_spec_t():
+    start_addr(0),
+    size(0),
+    end_addr(0),
+    DisableExec(1),
+    AccessPermission(ARM_MPU_AP_FULL),
+    AccessAttributes(0),
+    comment(),
+    attributes(),
+    memory(),
+    section(),
+    task(-1),
+    hotness(-1),
+    line(0)
+{
+}
+
+/// one key comparison per call, the length picks the candidates
+memory_map_loader_t::key_t memory_map_loader_t::lookup_key( const char *key, size_t length )
+{
+    switch (length)
+    {
+        case 4:
+            if (memcmp(key,"size",4) == 0) return KEY_SIZE;
+            if (memcmp(key,"task",4) == 0) return KEY_TASK;
+            if (memcmp(key,"name",4) == 0) return KEY_NAME;
+            return KEY_NONE;
+        case 6:
+            if (memcmp(key,"region",6) == 0) return KEY_REGION;
+            if (memcmp(key,"memory",6) == 0) return KEY_MEMORY;
+            return KEY_NONE;
+        case 7:
+            if (memcmp(key,"comment",7) == 0) return KEY_COMMENT;
+            if (memcmp(key,"section",7) == 0) return KEY_SECTION;
+            if (memcmp(key,"hotness",7) == 0) return KEY_HOTNESS;
+            return KEY_NONE;
+        case 8:
+            return memcmp(key,"end_addr",8) == 0 ? KEY_END_ADDR : KEY_NONE;
+        case 10:
+            if (memcmp(key,"start_addr",10) == 0) return KEY_START_ADDR;
+            if (memcmp(key,"attributes",10) == 0) return KEY_ATTRIBUTES;
+            return KEY_NONE;
+        case 11:
+            return memcmp(key,"DisableExec",11) == 0 ? KEY_DISABLE_EXEC : KEY_NONE;
+        case 16:
+            if (memcmp(key,"AccessPermission",16) == 0) return KEY_ACCESS_PERMISSION;
+            if (memcmp(key,"AccessAttributes",16) == 0) return KEY_ACCESS_ATTRIBUTES;
+            return KEY_NONE;
+        default:
+            return KEY_NONE;
+    }
+}
+
+typedef struct {
+    const char *token_name;
+    uint32_t value;
+} token_value_t;
+
+static const token_value_t DisableExec_values[] = {
+    {"EXECUTE", 0},
+    {"NEVER_EXECUTE", 1},
+};
+
+static const token_value_t AccessPermission_values[] = {
+    {"ARM_MPU_AP_RO", ARM_MPU_AP_RO},
+    {"ARM_MPU_AP_NONE", ARM_MPU_AP_NONE},
+    {"ARM_MPU_AP_FULL", ARM_MPU_AP_FULL},
+};
+
+static const token_value_t AccessAttributes_values[] = {
+    {"NO_ACCESS", NO_ACCESS},
+    {"STRONGLY_ORDERED", STRONGLY_ORDERED},
+    {"DEVICE_SHAREABLE", DEVICE_SHAREABLE},
+    {"DEVICE_NON_SHAREABLE", DEVICE_NON_SHAREABLE},
+    {"NORMAL_UNCACHED", NORMAL_UNCACHED},
+    {"NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE", NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE},
+    {"NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE", NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE},
+    {"NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE},
+    {"NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE},
+    {"UNCACHED", NORMAL_UNCACHED},
+    {"WRITE_THROUGH_NO_WRITE_ALLOCATE", NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE},
+    {"WRITE_BACK_NO_WRITE_ALLOCATE", NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE},
+    {"WRITE_BACK_READ_AND_WRITE_ALLOCATE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE},
+    {"WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE},
+};
+
+static bool token_to_from_list( const std::string &text, uint32_t line, const char *what, const token_value_t *token_values, uint32_t len, uint32_t *value )
+{
+    for (uint32_t i=0;i<len;i++)
+    {
+        if (text == token_values[i].token_name)
+        {
+            *value = token_values[i].value;
+            return true;
+        }
+    }
+    printf("unknown %s in '%s' at line %d\n",what,text.c_str(),(int)line);
+    printf("valid values:\n");
+    for (uint32_t i=0;i<len;i++)
+    {
+        printf("    %s\n",token_values[i].token_name);
+    }
+    return false;
+}
+
+static bool is_symbol_char( char c )
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+/*
+ * replace $symbol with the value of the symbol as 8 hex digits, e.g.
+ *   end_addr: 0x$__data_start__   ->   end_addr: 0x0044f800
+ * this is what scripts/run_update_memory_map.sh did with objdump and perl.
+ * without symbols the text is used as is.
+ */
+bool memory_map_loader_t::expand_symbols( const std::string &text, uint32_t line, std::string *expanded ) const
+{
+    if (symbols == NULL || text.find('$') == std::string::npos)
+    {
+        *expanded = text;
+        return true;
+    }
+    expanded->clear();
+    size_t i = 0;
+    while (i < text.size())
+    {
+        // names start like a c identifier, so "$0x4f0000" is left alone
+        if (text[i] != '$' || i+1 >= text.size() || !is_symbol_char(text[i+1]) || isdigit((unsigned char)text[i+1]))
+        {
+            *expanded += text[i++];
+            continue;
+        }
+        size_t end = i+1;
+        while (end < text.size() && is_symbol_char(text[end]))
+        {
+            end++;
+        }
+        std::string_view name(&text[i+1],end-i-1);
+        uint32_t value;
+        if (!symbols->find(name,&value))
+        {
+            printf("unknown symbol '%.*s' at line %d\n",(int)name.size(),name.data(),(int)line);
+            return false;
+        }
+        char hex[9];
+        snprintf(hex,sizeof(hex),"%08x",value);
+        *expanded += hex;
+        i = end;
+    }
+    return true;
+}
+
+/// a plain number, with the messages mpu_calc has always given
+static bool literal_to_address( const std::string &text, uint32_t line, uint32_t *value )
+{
+    char *temp;
+    if (strncmp(text.c_str(),"0x",2) == 0) {
+        *value = strtol( &text[2], &temp, 16 );
+        if (*temp != 0)
+        {
+            printf("expected hex in '%s' at line %d\n",text.c_str(),(int)line);
+            return false;
+        }
+        return true;
+    }
+    *value = strtol( text.c_str(), &temp, 10 );
+    if ((strcmp(temp,"G")==0) || (strcmp(temp,"GB") == 0))
+    {
+        *value *= 1024*1024*1024;
+    }
+    else if ((strcmp(temp,"M")==0) || (strcmp(temp,"MB") == 0))
+    {
+        *value *= 1024*1024;
+    }
+    else if ((strcmp(temp,"K")==0) || (strcmp(temp,"KB") == 0))
+    {
+        *value *= 1024;
+    }
+    else if (*temp != 0)
+    {
+        printf("expected decimal in '%s' at line %d\n",text.c_str(),(int)line);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * start_addr, end_addr and size are a number (hex, or decimal with K, M or G) or an expression, e.g.
+ *   end_addr: __data_start__ - 1
+ *   size:     ALIGN(__bss_end__, 4K) - __bss_start__
+ *
+ * the expression was compiled when the yaml was read, only $symbol has to be expanded (and the
+ * result compiled) each time.
+ */
+bool memory_map_loader_t::to_address( const address_field_t &field, uint32_t *value ) const
+{
+    std::string error;
+    if (field.text.find('$') != std::string::npos)
+    {
+        std::string text;
+        if (!expand_symbols(field.text,field.line,&text))
+        {
+            return false;
+        }
+        if (symbols == NULL && !mpu_expression_t::is_expression(text))
+        {
+            return literal_to_address(text,field.line,value);
+        }
+        mpu_expression_t expression;
+        if (!expression.compile(text) || !expression.evaluate(symbols,value))
+        {
+            printf("%s in '%s' at line %d\n",expression.error.c_str(),text.c_str(),(int)field.line);
+            return false;
+        }
+        return true;
+    }
+    // plain literals keep the original messages
+    if (symbols == NULL && !mpu_expression_t::is_expression(field.text))
+    {
+        return literal_to_address(field.text,field.line,value);
+    }
+    if (!field.expression.is_compiled() || !field.expression.evaluate(symbols,value,&error))
+    {
+        printf("%s in '%s' at line %d\n",field.expression.is_compiled() ? error.c_str() : field.expression.error.c_str(),field.text.c_str(),(int)field.line);
+        return false;
+    }
+    return true;
+}
+
+bool memory_map_loader_t::set_field( key_t key, const std::string &value, uint32_t line, region_source_t *source )
+{
+    region_spec_t *region = &source->spec;
+    region_source_t::field_t field;
+    switch (key)
+    {
+        case KEY_MEMORY:
+            region->memory = value;
+            return true;
+        case KEY_SECTION:
+            region->section = value;
+            return true;
+        case KEY_START_ADDR:
+            field = region_source_t::START_ADDR;
+            break;
+        case KEY_SIZE:
+            field = region_source_t::SIZE;
+            break;
+        case KEY_END_ADDR:
+            field = region_source_t::END_ADDR;
+            break;
+        case KEY_HOTNESS:
+            if (region->task >= 0)
+            {
+                printf("hotness '%s' at line %d has to be 0-255 and outside of a task\n",value.c_str(),(int)line);
+                return false;
+            }
+            field = region_source_t::HOTNESS;
+            break;
+        case KEY_DISABLE_EXEC:
+            return token_to_from_list(value,line,"DisableExec",DisableExec_values,sizeof(DisableExec_values)/sizeof(DisableExec_values[0]),&region->DisableExec);
+        case KEY_ACCESS_PERMISSION:
+            return token_to_from_list(value,line,"AccessPermission",AccessPermission_values,sizeof(AccessPermission_values)/sizeof(AccessPermission_values[0]),&region->AccessPermission);
+        case KEY_ACCESS_ATTRIBUTES:
+            return token_to_from_list(value,line,"AccessAttributes",AccessAttributes_values,sizeof(AccessAttributes_values)/sizeof(AccessAttributes_values[0]),&region->AccessAttributes);
+        case KEY_COMMENT:
+            region->comment = value;
+            return true;
+        case KEY_ATTRIBUTES:
+            region->attributes = value;
+            return true;
+        case KEY_NONE:
+        case KEY_REGION:
+        case KEY_TASK:
+        case KEY_NAME:
+        default:
+            return true;
+    }
+    // compiled once here, a syntax error is reported when the region is resolved (a plain
+    // literal without symbols keeps its old message)
+    address_field_t &f = source->fields[field];
+    f.text = value;
+    f.line = line;
+    f.expression = mpu_expression_t();
+    if (value.find('$') == std::string::npos)
+    {
+        f.expression.compile(value);
+    }
+    source->given |= 1U << field;
+    return true;
+}
+
+/// a region with the symbols applied
+bool memory_map_loader_t::resolve_region( const region_source_t &source, region_spec_t *region ) const
+{
+    *region = source.spec;
+    if (!expand_symbols(source.spec.comment,region->line,&region->comment) ||
+        !expand_symbols(source.spec.attributes,region->line,&region->attributes))
+    {
+        return false;
+    }
+    uint32_t *addresses[] = { &region->start_addr, &region->size, &region->end_addr };
+    for (uint32_t i=0;i<sizeof(addresses)/sizeof(addresses[0]);i++)
+    {
+        if ((source.given & (1U << i)) && !to_address(source.fields[i],addresses[i]))
+        {
+            return false;
+        }
+    }
+    if (source.given & (1U << region_source_t::HOTNESS))
+    {
+        const address_field_t &field = source.fields[region_source_t::HOTNESS];
+        uint32_t hotness;
+        if (!to_address(field,&hotness))
+        {
+            return false;
+        }
+        if (hotness > 255)
+        {
+            printf("hotness '%s' at line %d has to be 0-255 and outside of a task\n",field.text.c_str(),(int)field.line);
+            return false;
+        }
+        region->hotness = hotness;
+    }
+    return finish_region(source,region);
+}
+
+/*
+ * fill in the addresses of a region that named a linker script MEMORY region or an output
+ * section, keeping any start_addr, size or end_addr the region gave itself.
+ */
+bool memory_map_loader_t::finish_region( const region_source_t &source, region_spec_t *region ) const
+{
+    if (region->memory.empty() && region->section.empty())
+    {
+        return true;
+    }
+    if (!region->memory.empty() && !region->section.empty())
+    {
+        printf("region at line %d has both memory and section\n",(int)region->line);
+        return false;
+    }
+    uint32_t origin;
+    uint32_t length;
+    const std::string &name = region->memory.empty() ? region->section : region->memory;
+    if (!region->memory.empty())
+    {
+        if (symbols == NULL || !symbols->find("ORIGIN(" + name + ")",&origin) || !symbols->find("LENGTH(" + name + ")",&length))
+        {
+            printf("unknown memory '%s' at line %d%s\n",name.c_str(),(int)region->line,symbols == NULL ? " (memory needs linker_script=)" : "");
+            return false;
+        }
+    }
+    else if (symbols == NULL || !symbols->find_section(name,&origin,&length))
+    {
+        printf("unknown section '%s' at line %d%s\n",name.c_str(),(int)region->line,symbols == NULL ? " (section needs elf=)" : "");
+        return false;
+    }
+    if ((source.given & (1U << region_source_t::START_ADDR)) == 0)
+    {
+        region->start_addr = origin;
+    }
+    if ((source.given & ((1U << region_source_t::SIZE) | (1U << region_source_t::END_ADDR))) == 0)
+    {
+        if ((source.given & (1U << region_source_t::START_ADDR)) == 0)
+        {
+            region->size = length;
+        }
+        else
+        {
+            region->end_addr = origin + length;
+        }
+    }
+    if (region->comment.empty())
+    {
+        region->comment = name;
+    }
+    return true;
+}
+
+/// the task's name becomes part of a c identifier in the generated table
+bool memory_map_loader_t::finish_task()
+{
+    if (current_task < 0)
+    {
+        return false;
+    }
+    const task_spec_t &task = tasks[current_task];
+    current_task = -1;
+    if (task.name.empty())
+    {
+        printf("task at line %d has no name\n",(int)task.line);
+        return false;
+    }
+    for (uint32_t i=0;i<task.name.size();i++)
+    {
+        char c = task.name[i];
+        if (!(isalnum((unsigned char)c) || c == '_') || (i == 0 && isdigit((unsigned char)c)))
+        {
+            printf("task name '%s' at line %d must be a c identifier\n",task.name.c_str(),(int)task.line);
+            return false;
+        }
+    }
+    for (int32_t i=0;i<(int32_t)tasks.size()-1;i++)
+    {
+        if (tasks[i].name == task.name)
+        {
+            printf("duplicate task '%s' at line %d\n",task.name.c_str(),(int)task.line);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// same messages as libyaml's own examples
+static void print_parser_error( yaml_parser_t *parser, const char *name )
+{
+    switch (parser->error)
+    {
+        case YAML_MEMORY_ERROR:
+            fprintf(stderr, "Memory error: Not enough memory for parsing\n");
+            break;
+        case YAML_READER_ERROR:
+            if (parser->problem_value != -1) {
+                fprintf(stderr, "Reader error: %s: #%X at %d\n", parser->problem,
+                        parser->problem_value, (int)parser->problem_offset);
+            }
+            else {
+                fprintf(stderr, "Reader error: %s at %d\n", parser->problem,
+                        (int)parser->problem_offset);
+            }
+            break;
+        case YAML_SCANNER_ERROR:
+        case YAML_PARSER_ERROR:
+            if (parser->context) {
+                fprintf(stderr, "%s error: %s at line %d, column %d\n"
+                        "%s at line %d, column %d\n", parser->error == YAML_SCANNER_ERROR ? "Scanner" : "Parser",
+                        parser->context, (int)parser->context_mark.line+1, (int)parser->context_mark.column+1,
+                        parser->problem, (int)parser->problem_mark.line+1,
+                        (int)parser->problem_mark.column+1);
+            }
+            else {
+                fprintf(stderr, "%s error: %s at line %d, column %d\n", parser->error == YAML_SCANNER_ERROR ? "Scanner" : "Parser",
+                        parser->problem, (int)parser->problem_mark.line+1,
+                        (int)parser->problem_mark.column+1);
+            }
+            break;
+        default:
+            /* Couldn't happen. */
+            fprintf(stderr, "Internal error\n");
+            break;
+    }
+    fprintf(stderr, "Failed to load document in %s\n", name);
+}
+
+/*
+ * one pass over the events, a stack of open mappings/sequences says whether the next
+ * scalar is a key or a value. a 'region' key starts a new region_source_t, and the end of
+ * its value (normally a mapping of the fields) adds it to sources.
+ */
+bool memory_map_loader_t::load( void *p )
+{
+    yaml_parser_t *parser = (yaml_parser_t *)p;
+    std::vector<frame_t> stack;
+    region_source_t region;
+    std::string value;
+    bool ok = true;
+    bool done = false;
+    while (ok && !done)
+    {
+        yaml_event_t event;
+        if (!yaml_parser_parse(parser,&event))
+        {
+            return false;
+        }
+        uint32_t line = event.start_mark.line;
+        frame_t *top = stack.empty() ? NULL : &stack.back();
+        switch (event.type)
+        {
+            case YAML_STREAM_END_EVENT:
+                done = true;
+                break;
+            case YAML_MAPPING_START_EVENT:
+            case YAML_SEQUENCE_START_EVENT:
+            {
+                frame_t frame = { event.type == YAML_MAPPING_START_EVENT, true, KEY_NONE };
+                stack.push_back(frame);
+                break;
+            }
+            case YAML_SCALAR_EVENT:
+            case YAML_ALIAS_EVENT:
+                if (top == NULL || !top->is_mapping)
+                {
+                    break;
+                }
+                if (top->expect_key)
+                {
+                    top->key = event.type == YAML_SCALAR_EVENT ? lookup_key((const char *)event.data.scalar.value,event.data.scalar.length) : KEY_NONE;
+                    top->expect_key = false;
+                    if (top->key == KEY_REGION)
+                    {
+                        // starting a new region
+                        region = region_source_t();
+                        region.spec.line = line;
+                        region.spec.task = current_task;
+                    }
+                    else if (top->key == KEY_TASK && current_task >= 0)
+                    {
+                        printf("task inside a task at line %d\n",(int)line);
+                        ok = false;
+                    }
+                    else if (top->key == KEY_TASK)
+                    {
+                        task_spec_t task = { "", line };
+                        tasks.push_back(task);
+                        current_task = tasks.size()-1;
+                    }
+                    break;
+                }
+                if (top->key == KEY_TASK)
+                {
+                    printf("expected the task's name and regions at line %d\n",(int)line);
+                    ok = false;
+                    break;
+                }
+                if (top->key == KEY_NAME)
+                {
+                    if (current_task >= 0 && event.type == YAML_SCALAR_EVENT)
+                    {
+                        tasks[current_task].name.assign((const char *)event.data.scalar.value,event.data.scalar.length);
+                    }
+                    top->expect_key = true;
+                    break;
+                }
+                if (top->key == KEY_REGION)
+                {
+                    // 'region:' with no fields is still a region
+                    sources.push_back(region);
+                }
+                else if (top->key != KEY_NONE)
+                {
+                    if (event.type != YAML_SCALAR_EVENT)
+                    {
+                        printf("expected a value at line %d\n",(int)line);
+                        ok = false;
+                        break;
+                    }
+                    value.assign((const char *)event.data.scalar.value,event.data.scalar.length);
+                    ok = set_field(top->key,value,line,&region);
+                }
+                top->expect_key = true;
+                break;
+            case YAML_MAPPING_END_EVENT:
+            case YAML_SEQUENCE_END_EVENT:
+                stack.pop_back();
+                top = stack.empty() ? NULL : &stack.back();
+                if (top == NULL || !top->is_mapping)
+                {
+                    break;
+                }
+                if (top->expect_key)
+                {
+                    // a mapping or sequence used as a key is ignored
+                    top->key = KEY_NONE;
+                    top->expect_key = false;
+                    break;
+                }
+                if (top->key == KEY_REGION)
+                {
+                    sources.push_back(region);
+                }
+                else if (top->key == KEY_TASK)
+                {
+                    ok = finish_task();
+                }
+                else if (top->key != KEY_NONE)
+                {
+                    printf("expected a value at line %d\n",(int)line);
+                    ok = false;
+                }
+                top->expect_key = true;
+                break;
+            default:
+                break;
+        }
+        yaml_event_delete(&event);
+    }
+    return ok;
+}
+
+/**
+ * @brief
+ *   resolve sources[first..] into regions, with the task numbers moved up by task_offset.
+ *
+ * @return false at the first region with an unknown symbol or a bad expression (the error is printed)
+ */
+bool memory_map_loader_t::resolve( const std::vector<region_source_t> &from, size_t first, int32_t task_offset )
+{
+    regions.reserve(regions.size() + from.size() - first);
+    for (size_t i=first;i<from.size();i++)
+    {
+        region_spec_t region;
+        if (!resolve_region(from[i],&region))
+        {
+            return false;
+        }
+        if (region.task >= 0)
+        {
+            region.task += task_offset;
+        }
+        regions.push_back(region);
+    }
+    return true;
+}
+
+/**
+ * @brief
+ *   add the regions in a yaml file to regions.
+ *
+ * @return false if the file can't be read or there is an error (the error is printed)
+ */
+bool memory_map_loader_t::load_file( const char *file_name )
+{
+    size_t first = sources.size();
+    return parse_file(file_name) && resolve(sources,first,0);
+}
+
+/// same as load_file() for yaml in memory (e.g. for unit tests)
+bool memory_map_loader_t::load_string( const char *text, size_t length )
+{
+    size_t first = sources.size();
+    return parse_string(text,length) && resolve(sources,first,0);
+}
+
+/**
+ * @brief
+ *   the regions another loader parsed, resolved with this one's symbols (the other loader is only read).
+ *
+ * e.g. one memory map for many elf files:
+ *    memory_map_loader_t parsed;
+ *    parsed.parse_file("memory_map.yaml");
+ *    ... then for each elf file
+ *    loader.symbols = &elf;
+ *    loader.add_regions(parsed);
+ */
+bool memory_map_loader_t::add_regions( const memory_map_loader_t &parsed )
+{
+    int32_t task_offset = tasks.size();
+    tasks.insert(tasks.end(),parsed.tasks.begin(),parsed.tasks.end());
+    return resolve(parsed.sources,0,task_offset);
+}
+
+/// read a yaml file into sources (and tasks), without the symbols
+bool memory_map_loader_t::parse_file( const char *file_name )
+{
+    FILE *file = fopen(file_name, "rb");
+    if (file == NULL)
+    {
+        printf("error opening '%s'\n",file_name);
+        return false;
+    }
+    yaml_parser_t parser;
+    if (!yaml_parser_initialize(&parser))
+    {
+        fclose(file);
+        return false;
+    }
+    yaml_parser_set_input_file(&parser, file);
+    bool ok = load(&parser);
+    if (!ok && parser.error != YAML_NO_ERROR)
+    {
+        print_parser_error(&parser,file_name);
+    }
+    yaml_parser_delete(&parser);
+    fclose(file);
+    return ok;
+}
+
+/// same as parse_file() for yaml in memory
+bool memory_map_loader_t::parse_string( const char *text, size_t length )
+{
+    yaml_parser_t parser;
+    if (!yaml_parser_initialize(&parser))
+    {
+        return false;
+    }
+    yaml_parser_set_input_string(&parser, (const unsigned char *)text, length);
+    bool ok = load(&parser);
+    if (!ok && parser.error != YAML_NO_ERROR)
+    {
+        print_parser_error(&parser,"string");
+    }
+    yaml_parser_delete(&parser);
+    return ok;
+}
+
+#endif
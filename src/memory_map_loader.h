@@ -0,0 +1,172 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read the regions from memory_map.yaml
+*
+* the yaml is read as a stream of libyaml events, the document tree is never built,
+* so a generated map with thousands of regions loads in one pass, e.g.
+*
+*    region:
+*            comment:          OCR
+*            start_addr:       0x400000
+*            size:             1MB
+*            AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE
+*
+* a region ends when its mapping ends. the keys are recognized at any depth,
+* so regions can also be listed in a sequence.
+*
+* with a linker script (see linker_script.h) a region can name a MEMORY region or an
+* output section instead of giving its addresses:
+*
+*    region:
+*            memory:           OCR_SHMEM
+*            AccessAttributes: UNCACHED
+*
+* memory: gives start_addr and size (ORIGIN and LENGTH), section: gives the address and
+* size the elf file has for the section. start_addr, size or end_addr in the same region
+* replace the ones from memory/section, e.g. 'memory: OCR_DEV' with 'size: 1MB'.
+*
+* regions inside a task are only mapped while that task runs (see mpu_task_tables_t):
+*
+*    task:
+*            name:             net_rx
+*            region:
+*                    comment:          net_rx stack
+*                    start_addr:       net_rx_stack
+*                    size:             4K
+*
+* a region with hotness: (0-255, hotter is kept longer) is virtual: it isn't in the table but
+* swapped into one of a few slots when an access to it faults (see mpu_virtual_regions_t).
+*
+* reading the yaml and applying the symbols are separate steps: the yaml is parsed into sources
+* once, with the address expressions compiled, and the sources are resolved against a symbol
+* table. load_file() does both, parse_file() and add_regions() let many symbol tables (e.g.
+* mpu_batch_t's variants) share one parse.
+*/
+
+#ifndef MEMORY_MAP_LOADER_H
+#define MEMORY_MAP_LOADER_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "mpu_expression.h"
+
+/// one region from the yaml, with the same defaults mpu_calc has always used
+struct region_spec_t {
+    uint32_t start_addr;
+    uint32_t size;
+    uint32_t end_addr;
+    uint32_t DisableExec;
+    uint32_t AccessPermission;
+    uint32_t AccessAttributes;
+    std::string comment;
+    std::string attributes;
+    std::string memory;   ///< MEMORY region in the linker script, empty if not given
+    std::string section;  ///< output section, empty if not given
+    int32_t task;         ///< index in memory_map_loader_t::tasks, -1 for the global table
+    int32_t hotness;      ///< 0-255 for a virtual region, -1 if it's in the table
+    uint32_t line; ///< line of the 'region' key (counting from 0 like the error messages)
+
+    region_spec_t();
+};
+
+/// start_addr, size, end_addr or hotness as written, compiled when the yaml is read
+struct address_field_t {
+    std::string text;
+    uint32_t line;
+    mpu_expression_t expression;  ///< not compiled if the text uses $symbol, which is expanded first
+
+    address_field_t():text(),line(0),expression(){}
+};
+
+/// a region as read from the yaml, before the symbols are applied
+struct region_source_t {
+    enum field_t { START_ADDR, SIZE, END_ADDR, HOTNESS, NUM_FIELDS };
+
+    region_spec_t spec;                 ///< the fields that don't need symbols (comment and attributes not expanded yet)
+    address_field_t fields[NUM_FIELDS];
+    uint32_t given;                     ///< the fields the region has (1 << field_t)
+
+    region_source_t():spec(),fields(),given(0){}
+};
+
+/// a 'task:' in the yaml, its regions have region_spec_t::task set to its index
+struct task_spec_t {
+    std::string name;
+    uint32_t line;
+};
+
+/**
+ * e.g.
+ *    memory_map_loader_t loader;
+ *    loader.symbols = &elf_symbols;
+ *    if (!loader.load_file("memory_map.yaml")) exit(-1);
+ *    for (const region_spec_t &region : loader.regions) ...
+ *
+ * errors are printed, and load_file() returns false.
+ */
+class memory_map_loader_t {
+public:
+    /// symbols for $symbol, address expressions, memory: and section:, NULL if there is no elf file or linker script
+    const mpu_symbol_table_t *symbols;
+    std::vector<region_spec_t> regions;
+    std::vector<task_spec_t> tasks;
+    std::vector<region_source_t> sources;
+
+    memory_map_loader_t():symbols(NULL),regions(),tasks(),sources(),current_task(-1){}
+
+    bool load_file( const char *file_name );
+    bool load_string( const char *text, size_t length );
+
+    // the two steps of load_file()
+    bool parse_file( const char *file_name );
+    bool parse_string( const char *text, size_t length );
+    bool add_regions( const memory_map_loader_t &parsed );
+
+private:
+    enum key_t {
+        KEY_NONE,
+        KEY_REGION,
+        KEY_START_ADDR,
+        KEY_SIZE,
+        KEY_END_ADDR,
+        KEY_DISABLE_EXEC,
+        KEY_ACCESS_PERMISSION,
+        KEY_ACCESS_ATTRIBUTES,
+        KEY_COMMENT,
+        KEY_ATTRIBUTES,
+        KEY_MEMORY,
+        KEY_SECTION,
+        KEY_TASK,
+        KEY_NAME,
+        KEY_HOTNESS,
+    };
+    /// one open mapping or sequence
+    struct frame_t {
+        bool is_mapping;
+        bool expect_key;
+        key_t key;
+    };
+
+    /// the task being read, -1 outside of a task
+    int32_t current_task;
+
+    bool load( void *parser );
+    bool finish_task();
+    static key_t lookup_key( const char *key, size_t length );
+    bool set_field( key_t key, const std::string &value, uint32_t line, region_source_t *source );
+
+    bool resolve( const std::vector<region_source_t> &from, size_t first, int32_t task_offset );
+    bool resolve_region( const region_source_t &source, region_spec_t *region ) const;
+    bool finish_region( const region_source_t &source, region_spec_t *region ) const;
+    bool expand_symbols( const std::string &text, uint32_t line, std::string *expanded ) const;
+    bool to_address( const address_field_t &field, uint32_t *value ) const;
+};
+
+#endif
+
+#endif
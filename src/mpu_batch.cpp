@@ -0,0 +1,343 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   calculate the mpu tables for many firmware variants in one run (see mpu_batch.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "mpu_batch.h"
+#include "mpu_calc_session.h"
+#include "parallel_for.h"
+#include <yaml.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+
+/*
+ * same idea as memory_map_loader_t::load(), a 'variant' key starts a new variant
+ * and the end of its mapping adds it to variants.
+ */
+bool mpu_batch_t::parse_manifest( void *p )
+{
+    yaml_parser_t *parser = (yaml_parser_t *)p;
+    struct frame_t {
+        bool is_mapping;
+        bool expect_key;
+        std::string key;
+    };
+    std::vector<frame_t> stack;
+    variant_t variant;
+    bool ok = true;
+    bool done = false;
+    while (ok && !done)
+    {
+        yaml_event_t event;
+        if (!yaml_parser_parse(parser,&event))
+        {
+            printf("manifest: %s at line %d\n",parser->problem ? parser->problem : "yaml error",(int)parser->problem_mark.line+1);
+            return false;
+        }
+        frame_t *top = stack.empty() ? NULL : &stack.back();
+        switch (event.type)
+        {
+            case YAML_STREAM_END_EVENT:
+                done = true;
+                break;
+            case YAML_MAPPING_START_EVENT:
+            case YAML_SEQUENCE_START_EVENT:
+                stack.push_back(frame_t{ event.type == YAML_MAPPING_START_EVENT, true, "" });
+                break;
+            case YAML_SCALAR_EVENT:
+            {
+                if (top == NULL || !top->is_mapping)
+                {
+                    break;
+                }
+                std::string value((const char *)event.data.scalar.value,event.data.scalar.length);
+                if (top->expect_key)
+                {
+                    top->key = value;
+                    top->expect_key = false;
+                    if (value == "variant")
+                    {
+                        variant = variant_t();
+                    }
+                    break;
+                }
+                top->expect_key = true;
+                const std::string &key = top->key;
+                if (key == "name") variant.name = value;
+                else if (key == "memory_map") variant.memory_map = value;
+                else if (key == "elf") variant.elf = value;
+                else if (key == "linker_script") variant.linker_script = value;
+                else if (key == "output_filename") variant.output_filename = value;
+                else if (key == "output_format") variant.output_format = value;
+                else if (key == "mpu_table_size" || key == "verify_mask")
+                {
+                    char *end;
+                    uint32_t number = strtoul(value.c_str(),&end,0);
+                    if (end == value.c_str() || *end != 0)
+                    {
+                        printf("manifest: expected a number for %s in '%s' at line %d\n",key.c_str(),value.c_str(),(int)event.start_mark.line);
+                        ok = false;
+                    }
+                    (key == "mpu_table_size" ? variant.mpu_table_size : variant.verify_mask) = number;
+                }
+                break;
+            }
+            case YAML_MAPPING_END_EVENT:
+            case YAML_SEQUENCE_END_EVENT:
+                stack.pop_back();
+                top = stack.empty() ? NULL : &stack.back();
+                if (top == NULL || !top->is_mapping)
+                {
+                    break;
+                }
+                if (!top->expect_key && top->key == "variant")
+                {
+                    if (variant.memory_map.empty() || variant.output_filename.empty())
+                    {
+                        printf("manifest: variant at line %d needs memory_map and output_filename\n",(int)event.start_mark.line);
+                        ok = false;
+                    }
+                    if (variant.name.empty())
+                    {
+                        variant.name = variant.output_filename;
+                    }
+                    variants.push_back(variant);
+                }
+                top->expect_key = !top->expect_key;
+                break;
+            default:
+                break;
+        }
+        yaml_event_delete(&event);
+    }
+    return ok;
+}
+
+/**
+ * @brief
+ *   read the list of variants.
+ *
+ * @return false if the manifest can't be read or a variant is incomplete (an error is printed)
+ */
+bool mpu_batch_t::load_manifest( const char *filename )
+{
+    FILE *file = fopen(filename,"rb");
+    if (file == NULL)
+    {
+        printf("error opening '%s'\n",filename);
+        return false;
+    }
+    yaml_parser_t parser;
+    if (!yaml_parser_initialize(&parser))
+    {
+        fclose(file);
+        return false;
+    }
+    yaml_parser_set_input_file(&parser,file);
+    bool ok = parse_manifest(&parser);
+    yaml_parser_delete(&parser);
+    fclose(file);
+    return ok;
+}
+
+bool mpu_batch_t::load_manifest_string( const char *text, size_t length )
+{
+    yaml_parser_t parser;
+    if (!yaml_parser_initialize(&parser))
+    {
+        return false;
+    }
+    yaml_parser_set_input_string(&parser,(const unsigned char *)text,length);
+    bool ok = parse_manifest(&parser);
+    yaml_parser_delete(&parser);
+    return ok;
+}
+
+/// read every memory map, linker script and elf file once, a missing one only fails the variants that use it
+bool mpu_batch_t::load_inputs()
+{
+    bool ok = true;
+    std::vector<std::string> elf_files;
+    std::set<std::string> missing;
+    for (uint32_t i=0;i<variants.size();i++)
+    {
+        const variant_t &v = variants[i];
+        // parsed (and the expressions compiled) once, each variant resolves it with its own symbols
+        if (templates.find(v.memory_map) == templates.end() && missing.find(v.memory_map) == missing.end())
+        {
+            std::unique_ptr<memory_map_loader_t> parsed(new memory_map_loader_t);
+            if (parsed->parse_file(v.memory_map.c_str()))
+            {
+                templates[v.memory_map] = std::move(parsed);
+            }
+            else
+            {
+                missing.insert(v.memory_map);
+                ok = false;
+            }
+        }
+        if (!v.linker_script.empty() && linker_scripts.find(v.linker_script) == linker_scripts.end())
+        {
+            std::unique_ptr<linker_script_t> script(new linker_script_t);
+            if (!script->load_file(v.linker_script.c_str()))
+            {
+                script.reset();
+                ok = false;
+            }
+            linker_scripts[v.linker_script] = std::move(script);
+        }
+        if (!v.elf.empty() && symbols.find(v.elf) == symbols.end())
+        {
+            symbols[v.elf] = std::unique_ptr<elf_symbols_t>(new elf_symbols_t);
+            elf_files.push_back(v.elf);
+        }
+    }
+    // map::operator[] isn't safe from several threads, so look the tables up first
+    std::vector<elf_symbols_t *> tables(elf_files.size());
+    for (uint32_t i=0;i<elf_files.size();i++)
+    {
+        tables[i] = symbols[elf_files[i]].get();
+    }
+    std::vector<uint8_t> loaded(elf_files.size());
+    parallel_for( elf_files.size(), num_threads, [&]( uint32_t i ) {
+        loaded[i] = tables[i]->load(elf_files[i].c_str());
+    } );
+    for (uint32_t i=0;i<elf_files.size();i++)
+    {
+        if (!loaded[i])
+        {
+            symbols[elf_files[i]].reset();
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/// one mpu_calc_session_t per variant (the shared inputs are only read)
+void mpu_batch_t::run_variant( variant_t *v )
+{
+    const memory_map_loader_t *parsed = templates.find(v->memory_map)->second.get();
+    mpu_calc_session_t session;
+    session.mpu_table_size = v->mpu_table_size;
+    session.verify_mask = v->verify_mask;
+    if (!v->elf.empty())
+    {
+        const elf_symbols_t *elf = symbols.find(v->elf)->second.get();
+        if (elf == NULL)
+        {
+            return;
+        }
+        session.use_symbols(elf);
+    }
+    // the parsed script is shared, each session chains its own copy to its own elf
+    if (!v->linker_script.empty())
+    {
+        const linker_script_t *shared = linker_scripts.find(v->linker_script)->second.get();
+        if (shared == NULL)
+        {
+            return;
+        }
+        session.use_linker_script(*shared);
+    }
+    if (!session.load_parsed(*parsed))
+    {
+        printf("%s: error in '%s'\n",v->name.c_str(),v->memory_map.c_str());
+        return;
+    }
+    bool tasks_ok = session.compute();
+    v->num_entries = session.num_entries;
+    if (session.overflow())
+    {
+        v->overflow = true;
+        return;
+    }
+    if (!tasks_ok)
+    {
+        printf("%s: error in '%s'\n",v->name.c_str(),v->memory_map.c_str());
+        return;
+    }
+    output_buffer_t out;
+    if (!session.emit(v->output_format.c_str(),out))
+    {
+        printf("%s: no table written\n",v->name.c_str());
+        return;
+    }
+    v->ok = out.write_if_changed(v->output_filename.c_str(),&v->changed) && session.builder.ok;
+}
+
+/**
+ * @brief
+ *   calculate and write every variant.
+ *
+ * @return false if any variant failed or has more entries than its mpu_table_size
+ */
+bool mpu_batch_t::run()
+{
+    load_inputs();
+    parallel_for( variants.size(), num_threads, [this]( uint32_t i ) {
+        variant_t *v = &variants[i];
+        if (templates.find(v->memory_map) != templates.end())
+        {
+            run_variant(v);
+        }
+    } );
+    bool ok = true;
+    for (uint32_t i=0;i<variants.size();i++)
+    {
+        ok = ok && variants[i].ok && !variants[i].overflow;
+    }
+    return ok;
+}
+
+/*
+ * e.g.
+ *
+ * variant                        entries budget status
+ * ------------------------------ ------- ------ ----------
+ * board_a                             12     15 written
+ * board_a_debug                       12     15 up to date
+ * board_b                             17     15 OVERFLOW by 2 entries
+ *
+ * 3 variants, 1 written, 1 up to date, 1 failed
+ */
+void mpu_batch_t::report( output_buffer_t &out )
+{
+    uint32_t num_written = 0;
+    uint32_t num_up_to_date = 0;
+    uint32_t num_failed = 0;
+    out.print("%-30s %7s %6s %s\n","variant","entries","budget","status");
+    out.print("------------------------------ ------- ------ ----------\n");
+    for (uint32_t i=0;i<variants.size();i++)
+    {
+        const variant_t &v = variants[i];
+        out.print("%-30s %7u %6u ",v.name.c_str(),v.num_entries,v.mpu_table_size);
+        if (v.overflow)
+        {
+            out.print("OVERFLOW by %u entries\n",v.num_entries - v.mpu_table_size);
+            num_failed++;
+        }
+        else if (!v.ok)
+        {
+            out.print("FAILED\n");
+            num_failed++;
+        }
+        else if (v.changed)
+        {
+            out.print("written\n");
+            num_written++;
+        }
+        else
+        {
+            out.print("up to date\n");
+            num_up_to_date++;
+        }
+    }
+    out.print("\n%u variants, %u written, %u up to date, %u failed\n",(uint32_t)variants.size(),num_written,num_up_to_date,num_failed);
+}
+
+#endif
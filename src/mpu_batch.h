@@ -0,0 +1,93 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   calculate the mpu tables for many firmware variants in one run
+*
+* the variants are listed in a yaml manifest, e.g.
+*
+*    variant:
+*            name:             board_a
+*            memory_map:       memory_map.yaml
+*            elf:              builds/board_a/device_first_pass
+*            output_filename:  builds/board_a/memory_map.h
+*            mpu_table_size:   15
+*    variant:
+*            name:             board_b_lite
+*            memory_map:       memory_map.yaml
+*            elf:              builds/board_b_lite/device_first_pass
+*            output_filename:  builds/board_b_lite/memory_map.h
+*            mpu_table_size:   15
+*
+* linker_script, output_format and verify_mask can be given as well (the defaults are the same as mpu_calc's).
+* each memory map and elf file is read once however many variants use it (a memory map is parsed
+* and its expressions compiled once, then resolved with each variant's symbols), and the variants
+* are calculated on a pool of threads.
+*/
+
+#ifndef MPU_BATCH_H
+#define MPU_BATCH_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "elf_symbols.h"
+#include "linker_script.h"
+#include "memory_map_loader.h"
+#include "mpu_verify.h"
+#include "output_buffer.h"
+
+class mpu_batch_t {
+public:
+    struct variant_t {
+        std::string name;
+        std::string memory_map;
+        std::string elf;
+        std::string linker_script;
+        std::string output_filename;
+        std::string output_format;
+        uint32_t mpu_table_size;
+        uint32_t verify_mask;
+
+        // results
+        bool ok;                ///< the table was calculated and written
+        bool changed;           ///< output_filename was rewritten
+        uint32_t num_entries;   ///< entries the memory map needs
+        bool overflow;          ///< more entries than mpu_table_size (output_filename is not written)
+
+        variant_t():name(),memory_map(),elf(),linker_script(),output_filename(),output_format("header"),mpu_table_size(16),
+            verify_mask(MPU_VERIFY_DEFAULT_MASK),ok(false),changed(false),num_entries(0),overflow(false){}
+    };
+
+    uint32_t num_threads;
+    std::vector<variant_t> variants;
+
+    mpu_batch_t():num_threads(1),variants(),templates(),symbols(),linker_scripts(){}
+
+    bool load_manifest( const char *filename );
+    bool load_manifest_string( const char *text, size_t length );
+    bool run();
+    void report( output_buffer_t &out );
+
+    /// how many memory maps and elf files were read for all the variants
+    uint32_t num_templates() const { return templates.size(); }
+    uint32_t num_symbol_tables() const { return symbols.size(); }
+
+private:
+    /// the memory maps and symbol tables shared by the variants (read only while the variants run)
+    std::map<std::string,std::unique_ptr<memory_map_loader_t>> templates;
+    std::map<std::string,std::unique_ptr<elf_symbols_t>> symbols;
+    std::map<std::string,std::unique_ptr<linker_script_t>> linker_scripts;
+
+    bool parse_manifest( void *parser );
+    bool load_inputs();
+    void run_variant( variant_t *variant );
+};
+
+#endif
+
+#endif
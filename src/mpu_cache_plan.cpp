@@ -0,0 +1,291 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   plan the data cache maintenance for a change of mpu regions (see mpu_cache_plan.h)
+*/
+#ifdef MDX2_FREERTOS_TARGET
+#include "cpu_m7.h"
+#include "mpu_armv7.h"
+#else
+#include "mpu_host_model.h"
+#endif
+#include "mpu_cache_plan.h"
+#include "mpu_region_fit.h"
+#include <stddef.h>
+
+/**
+ * @brief
+ *   the L1 data cache policy of a region's TEX/C/B/S (ARMv7-M Table B3-13, inner attributes for TEX=1xx)
+ *
+ * @param[in] RASR - the region, 0 (disabled) if nothing maps the address
+ * @param[in] shared_write_through - SCB->CACR.SIWT, shareable cacheable memory is write-through (otherwise the m7 doesn't cache it)
+ */
+mpu_cache_policy_t mpu_cache_policy( uint32_t RASR, bool shared_write_through )
+{
+    if ((RASR & MPU_RASR_ENABLE_Msk) == 0)
+    {
+        return MPU_CACHE_POLICY_UNCACHED;
+    }
+    uint32_t TEX = (RASR & MPU_RASR_TEX_Msk) >> MPU_RASR_TEX_Pos;
+    uint32_t CB = (RASR & (MPU_RASR_C_Msk | MPU_RASR_B_Msk)) >> MPU_RASR_B_Pos;
+    mpu_cache_policy_t policy = MPU_CACHE_POLICY_UNCACHED;
+    if (TEX & 4)
+    {
+        // CB is the inner policy: 00 non-cacheable, 01 write-back write allocate, 10 write-through, 11 write-back
+        policy = CB == 0 ? MPU_CACHE_POLICY_UNCACHED : CB == 2 ? MPU_CACHE_POLICY_WRITE_THROUGH : MPU_CACHE_POLICY_WRITE_BACK;
+    }
+    else if (TEX == 0 && CB == 2)
+    {
+        policy = MPU_CACHE_POLICY_WRITE_THROUGH;
+    }
+    else if ((TEX == 0 || TEX == 1) && CB == 3)
+    {
+        policy = MPU_CACHE_POLICY_WRITE_BACK;
+    }
+    if (policy != MPU_CACHE_POLICY_UNCACHED && (RASR & MPU_RASR_S_Msk))
+    {
+        policy = shared_write_through ? MPU_CACHE_POLICY_WRITE_THROUGH : MPU_CACHE_POLICY_UNCACHED;
+    }
+    return policy;
+}
+
+/// what has to be done to the lines of memory going from old_policy to new_policy (the table in mpu_cache_plan.h)
+mpu_cache_op_t mpu_cache_op( mpu_cache_policy_t old_policy, mpu_cache_policy_t new_policy )
+{
+    if (new_policy >= old_policy)
+    {
+        return MPU_CACHE_OP_NONE;
+    }
+    if (old_policy == MPU_CACHE_POLICY_WRITE_THROUGH)
+    {
+        return MPU_CACHE_OP_INVALIDATE;
+    }
+    return new_policy == MPU_CACHE_POLICY_WRITE_THROUGH ? MPU_CACHE_OP_CLEAN : MPU_CACHE_OP_CLEAN_INVALIDATE;
+}
+
+static inline uint32_t region_log2_size( const ARM_MPU_Region_t &region )
+{
+    return ((region.RASR & MPU_RASR_SIZE_Msk) >> MPU_RASR_SIZE_Pos) + 1;
+}
+
+static inline uint32_t region_base( const ARM_MPU_Region_t &region )
+{
+    uint32_t log2_size = region_log2_size(region);
+    return log2_size >= 32 ? 0 : region.RBAR & MPU_RBAR_ADDR_Msk & ~((1UL << log2_size) - 1);
+}
+
+/// the RASR of the region the mpu uses for addr (the highest numbered one that covers it), 0 if none does
+static uint32_t effective_RASR( const ARM_MPU_Region_t *regions, uint32_t num_regions, uint32_t addr )
+{
+    for (uint32_t i=num_regions;i-- > 0;)
+    {
+        if (mpu_region_contains(regions[i],addr))
+        {
+            return regions[i].RASR;
+        }
+    }
+    return 0;
+}
+
+/// true if a and b map the same memory the same way (the region number in RBAR doesn't matter)
+static bool same_region( const ARM_MPU_Region_t &a, const ARM_MPU_Region_t &b )
+{
+    if ((a.RASR & MPU_RASR_ENABLE_Msk) == 0 && (b.RASR & MPU_RASR_ENABLE_Msk) == 0)
+    {
+        return true;
+    }
+    return a.RASR == b.RASR && (a.RBAR & MPU_RBAR_ADDR_Msk) == (b.RBAR & MPU_RBAR_ADDR_Msk);
+}
+
+/// the edges of the enabled subregion runs of a region that are inside [lo,hi), false if there isn't room for them
+static bool add_edges( uint32_t *edges, uint32_t &num_edges, const ARM_MPU_Region_t &region, uint64_t lo, uint64_t hi )
+{
+    if ((region.RASR & MPU_RASR_ENABLE_Msk) == 0)
+    {
+        return true;
+    }
+    uint32_t log2_size = region_log2_size(region);
+    uint64_t base = region_base(region);
+    uint32_t SRD = log2_size >= 8 ? (region.RASR & MPU_RASR_SRD_Msk) >> MPU_RASR_SRD_Pos : 0;
+    uint64_t sub = 1ULL << (log2_size >= 8 ? log2_size-3 : log2_size);
+    uint32_t num_subregions = log2_size >= 8 ? 8 : 1;
+    for (uint32_t j=0;j<=num_subregions;j++)
+    {
+        // an edge is where a run of enabled subregions starts or stops
+        uint32_t before = j == 0 ? 1 : (SRD >> (j-1)) & 1;
+        uint32_t after = j == num_subregions ? 1 : (SRD >> j) & 1;
+        uint64_t edge = base + j*sub;
+        if (before == after || edge <= lo || edge >= hi)
+        {
+            continue;
+        }
+        if (num_edges == MPU_CACHE_PLAN_MAX_EDGES)
+        {
+            return false;
+        }
+        edges[num_edges++] = (uint32_t)edge;
+    }
+    return true;
+}
+
+/// append [start,stop) to the plan, merging it with the last range if it's the same op. false if the plan is full
+static bool add_range( mpu_cache_plan_t *plan, mpu_cache_op_t op, uint64_t start, uint64_t stop )
+{
+    uint64_t lines = (stop - start + MPU_CACHE_PLAN_LINE_SIZE-1) / MPU_CACHE_PLAN_LINE_SIZE;
+    plan->num_lines = lines > 0xffffffff - plan->num_lines ? 0xffffffff : plan->num_lines + (uint32_t)lines;
+    uint32_t size = stop - start > 0x7fffffe0 ? 0x7fffffe0 : (uint32_t)(stop - start);
+    if (plan->num_ranges != 0)
+    {
+        mpu_cache_range_t &last = plan->ranges[plan->num_ranges-1];
+        if (last.op == (uint32_t)op && (uint64_t)last.start + last.size == start)
+        {
+            last.size = (uint64_t)last.size + size > 0x7fffffe0 ? 0x7fffffe0 : last.size + size;
+            return true;
+        }
+    }
+    if (plan->num_ranges == MPU_CACHE_PLAN_MAX_RANGES)
+    {
+        return false;
+    }
+    plan->ranges[plan->num_ranges++] = mpu_cache_range_t{ (uint32_t)op, (uint32_t)start, size };
+    return true;
+}
+
+/**
+ * @brief
+ *   the cache maintenance to do before the mpu goes from old_regions to new_regions
+ *
+ * only the addresses covered by regions that differ can change policy, so only their part of
+ * the memory map is compared: it's cut at every edge of a region inside it and each piece is
+ * looked up in both tables.
+ *
+ * @param[out] plan - the ranges, or the whole cache
+ * @param[in] old_regions - what the regions hold now (e.g. from mpu_snapshot_capture())
+ * @param[in] new_regions - what they will hold
+ * @param[in] num_regions - entries in each (region i is entry i)
+ * @param[in] dcache_size - bytes in the data cache, more lines than this in the ranges and the whole cache is done instead
+ * @param[in] shared_write_through - SCB->CACR.SIWT (Configure_MPU() sets it)
+ */
+void mpu_cache_plan( mpu_cache_plan_t *plan, const ARM_MPU_Region_t *old_regions, const ARM_MPU_Region_t *new_regions, uint32_t num_regions,
+                     uint32_t dcache_size, bool shared_write_through )
+{
+    plan->whole_cache = MPU_CACHE_OP_NONE;
+    plan->num_ranges = 0;
+    plan->num_lines = 0;
+
+    // the part of the memory map the changed regions cover, before or after
+    uint64_t lo = 0x100000000ULL;
+    uint64_t hi = 0;
+    for (uint32_t i=0;i<num_regions;i++)
+    {
+        if (same_region(old_regions[i],new_regions[i]))
+        {
+            continue;
+        }
+        const ARM_MPU_Region_t *both[2] = { &old_regions[i], &new_regions[i] };
+        for (const ARM_MPU_Region_t *region : both)
+        {
+            if (region->RASR & MPU_RASR_ENABLE_Msk)
+            {
+                uint64_t base = region_base(*region);
+                uint64_t end = base + (1ULL << region_log2_size(*region));
+                lo = base < lo ? base : lo;
+                hi = end > hi ? end : hi;
+            }
+        }
+    }
+    if (hi <= lo)
+    {
+        return;
+    }
+
+    uint32_t edges[MPU_CACHE_PLAN_MAX_EDGES];
+    uint32_t num_edges = 0;
+    bool fits = true;
+    for (uint32_t i=0;i<num_regions && fits;i++)
+    {
+        fits = add_edges(edges,num_edges,old_regions[i],lo,hi);
+        if (fits && !same_region(old_regions[i],new_regions[i]))
+        {
+            fits = add_edges(edges,num_edges,new_regions[i],lo,hi);
+        }
+    }
+
+    // sort the edges (there are only a few), the duplicates are skipped below
+    for (uint32_t i=1;i<num_edges && fits;i++)
+    {
+        uint32_t edge = edges[i];
+        uint32_t j = i;
+        for (;j > 0 && edges[j-1] > edge;j--)
+        {
+            edges[j] = edges[j-1];
+        }
+        edges[j] = edge;
+    }
+
+    uint64_t start = lo;
+    uint32_t all_ops = 0;
+    for (uint32_t i=0;i<=num_edges && fits;i++)
+    {
+        uint64_t stop = i < num_edges ? edges[i] : hi;
+        if (stop == start)
+        {
+            continue;
+        }
+        mpu_cache_op_t op = mpu_cache_op( mpu_cache_policy(effective_RASR(old_regions,num_regions,(uint32_t)start),shared_write_through),
+                                          mpu_cache_policy(effective_RASR(new_regions,num_regions,(uint32_t)start),shared_write_through) );
+        if (op != MPU_CACHE_OP_NONE)
+        {
+            all_ops |= 1U << op;
+            fits = add_range(plan,op,start,stop);
+        }
+        start = stop;
+    }
+
+    // too many pieces to keep track of, or more lines than the cache has
+    if (!fits)
+    {
+        plan->whole_cache = MPU_CACHE_OP_CLEAN_INVALIDATE;
+    }
+    else if (plan->num_lines > dcache_size / MPU_CACHE_PLAN_LINE_SIZE)
+    {
+        plan->whole_cache = all_ops == (1U << MPU_CACHE_OP_CLEAN) ? MPU_CACHE_OP_CLEAN : MPU_CACHE_OP_CLEAN_INVALIDATE;
+    }
+    if (plan->whole_cache != MPU_CACHE_OP_NONE)
+    {
+        plan->num_ranges = 0;
+        plan->num_lines = dcache_size / MPU_CACHE_PLAN_LINE_SIZE;
+    }
+}
+
+/// do the maintenance in a plan (before reprogramming the mpu)
+void mpu_cache_plan_run( const mpu_cache_plan_t *plan )
+{
+    if (plan->whole_cache == MPU_CACHE_OP_CLEAN)
+    {
+        SCB_CleanDCache();
+    }
+    else if (plan->whole_cache == MPU_CACHE_OP_CLEAN_INVALIDATE)
+    {
+        SCB_CleanInvalidateDCache();
+    }
+    for (uint32_t i=0;i<plan->num_ranges;i++)
+    {
+        const mpu_cache_range_t &range = plan->ranges[i];
+        switch (range.op)
+        {
+            case MPU_CACHE_OP_CLEAN:
+                SCB_CleanDCache_by_Addr((uint32_t *)(size_t)range.start,(int32_t)range.size);
+                break;
+            case MPU_CACHE_OP_INVALIDATE:
+                SCB_InvalidateDCache_by_Addr((void *)(size_t)range.start,(int32_t)range.size);
+                break;
+            case MPU_CACHE_OP_CLEAN_INVALIDATE:
+                SCB_CleanInvalidateDCache_by_Addr((uint32_t *)(size_t)range.start,(int32_t)range.size);
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   the data cache maintenance needed when regions change attributes
+*
+* when memory goes from cached to uncached (or write-back to write-through) the lines the cache
+* holds for it have to be cleaned and/or invalidated before the mpu is reprogrammed.
+* mpu_cache_plan() compares what the 16 regions do before and after, and only plans maintenance
+* for the addresses whose cache policy changes:
+*
+*    old \ new       uncached            write-through       write-back
+*    uncached        -                   -                   -
+*    write-through   invalidate          -                   -
+*    write-back      clean+invalidate    clean               -
+*
+* nothing is needed going to a cached policy: every way out of the cache invalidates, so no line
+* survives an uncached period. when walking the ranges line by line would take longer than doing
+* the whole cache, the plan is the whole cache instead, e.g.
+*
+*    mpu_cache_plan_t plan;
+*    mpu_cache_plan( &plan, current, next, 16, MPU_CACHE_PLAN_DCACHE_SIZE, true );
+*    mpu_cache_plan_run( &plan );
+*    mpu_apply( next, current, 0, 16 );
+*/
+
+#ifndef MPU_CACHE_PLAN_H
+#define MPU_CACHE_PLAN_H
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+
+#define MPU_CACHE_PLAN_LINE_SIZE 32
+/// the m7's data cache is 4-64K, set this to what's fitted
+#ifndef MPU_CACHE_PLAN_DCACHE_SIZE
+#define MPU_CACHE_PLAN_DCACHE_SIZE (16*1024)
+#endif
+#define MPU_CACHE_PLAN_MAX_RANGES 8
+/// region edges looked at inside the changed regions, past that the plan is the whole cache
+#define MPU_CACHE_PLAN_MAX_EDGES 64
+
+/// how the L1 data cache treats a region
+enum mpu_cache_policy_t {
+    MPU_CACHE_POLICY_UNCACHED,       ///< also device, strongly ordered and unmapped
+    MPU_CACHE_POLICY_WRITE_THROUGH,
+    MPU_CACHE_POLICY_WRITE_BACK
+};
+
+enum mpu_cache_op_t {
+    MPU_CACHE_OP_NONE,
+    MPU_CACHE_OP_CLEAN,             ///< SCB_CleanDCache_by_Addr()
+    MPU_CACHE_OP_INVALIDATE,        ///< SCB_InvalidateDCache_by_Addr()
+    MPU_CACHE_OP_CLEAN_INVALIDATE   ///< SCB_CleanInvalidateDCache_by_Addr()
+};
+
+struct mpu_cache_range_t {
+    uint32_t op;    ///< mpu_cache_op_t
+    uint32_t start;
+    uint32_t size;
+};
+
+struct mpu_cache_plan_t {
+    uint32_t whole_cache;           ///< if not MPU_CACHE_OP_NONE, do this to the whole cache (SCB_CleanDCache() etc.) and ignore the ranges
+    uint32_t num_ranges;
+    mpu_cache_range_t ranges[MPU_CACHE_PLAN_MAX_RANGES];
+    uint32_t num_lines;             ///< cache lines the ranges walk
+};
+
+mpu_cache_policy_t mpu_cache_policy( uint32_t RASR, bool shared_write_through );
+mpu_cache_op_t mpu_cache_op( mpu_cache_policy_t old_policy, mpu_cache_policy_t new_policy );
+void mpu_cache_plan( mpu_cache_plan_t *plan, const ARM_MPU_Region_t *old_regions, const ARM_MPU_Region_t *new_regions, uint32_t num_regions,
+                     uint32_t dcache_size, bool shared_write_through );
+void mpu_cache_plan_run( const mpu_cache_plan_t *plan );
+
+#endif
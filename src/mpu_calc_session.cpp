@@ -0,0 +1,126 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   everything mpu_calc does for one memory map (see mpu_calc_session.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "mpu_calc_session.h"
+#include "mpu_emitter.h"
+#include "mpu_stack_guard.h"
+#include <stdio.h>
+
+bool mpu_calc_session_t::load_elf( const char *filename )
+{
+    return elf.load(filename);
+}
+
+bool mpu_calc_session_t::load_linker_script( const char *filename )
+{
+    return linker_script.load_file(filename);
+}
+
+/// symbols loaded by someone else (e.g. one elf file shared by several sessions), they must outlive the session
+void mpu_calc_session_t::use_symbols( const mpu_symbol_table_t *symbols_ )
+{
+    shared_symbols = symbols_;
+}
+
+/// a copy of an already parsed linker script, so each session can chain it to its own elf file
+void mpu_calc_session_t::use_linker_script( const linker_script_t &script )
+{
+    linker_script = script;
+}
+
+/// ORIGIN()/LENGTH() come from the linker script, everything else from the elf file
+const mpu_symbol_table_t *mpu_calc_session_t::symbols()
+{
+    const mpu_symbol_table_t *next = elf.is_loaded() ? &elf : shared_symbols;
+    if (!linker_script.is_loaded())
+    {
+        return next;
+    }
+    linker_script.next = next;
+    return &linker_script;
+}
+
+bool mpu_calc_session_t::load_file( const char *filename )
+{
+    loader.symbols = symbols();
+    return loader.load_file(filename);
+}
+
+bool mpu_calc_session_t::load_string( const char *text, size_t length )
+{
+    loader.symbols = symbols();
+    return loader.load_string(text,length);
+}
+
+/// a memory map parsed once by someone else (e.g. shared by several sessions), resolved with this session's symbols
+bool mpu_calc_session_t::load_parsed( const memory_map_loader_t &parsed )
+{
+    loader.symbols = symbols();
+    return loader.add_regions(parsed);
+}
+
+/// a region that didn't come from yaml (the defaults are region_spec_t's)
+void mpu_calc_session_t::add_region( const region_spec_t &region )
+{
+    loader.regions.push_back(region);
+}
+
+/**
+ * @brief
+ *   calculate the global table, the virtual regions and the task tables.
+ *
+ * @return false if the virtual regions or a task don't fit in the slots after the global table.
+ *   a global table with more than mpu_table_size entries is still calculated (see overflow()),
+ *   and so is one with a region that can't be converted (see builder.ok).
+ */
+bool mpu_calc_session_t::compute()
+{
+    builder = memory_map_builder_t();
+    builder.add_regions(loader.regions);
+    num_entries = builder.num_entries;
+    // the virtual regions get the slots after the global table, and the tasks the ones after those
+    // region 15 is the stack guard's, like the task slots they stop below it whatever mpu_table_size is
+    bool ok = virtual_regions.build(loader,builder.display,builder.num_entries,virtual_slots);
+    uint32_t slots_end = mpu_table_size < MPU_STACK_GUARD_REGION ? mpu_table_size : MPU_STACK_GUARD_REGION;
+    if (virtual_regions.num_slots != 0 && builder.num_entries + virtual_regions.num_slots > slots_end)
+    {
+        printf("the global table and %u virtual slots need %u regions but only %u are free below region 15 (mpu_table_size is %u)\n",
+            virtual_regions.num_slots,builder.num_entries + virtual_regions.num_slots,slots_end,mpu_table_size);
+        ok = false;
+    }
+    ok = tasks.build(loader,builder.num_entries + virtual_regions.num_slots,mpu_table_size) && ok;
+    // from verify_mask every time, so a session computed again doesn't keep the old slots.
+    // the unused entries are the pool scoped_mpu_region takes from (region 15 is the stack guard's).
+    table_verify_mask = verify_mask | tasks.verify_mask() | virtual_regions.verify_mask();
+    for (uint32_t i=builder.num_entries;i<mpu_table_size && i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (i != MPU_STACK_GUARD_REGION)
+        {
+            table_verify_mask |= 1UL << i;
+        }
+    }
+    builder.pad(mpu_table_size);
+    return ok;
+}
+
+/// the table in one of the mpu_emitter_formats()
+bool mpu_calc_session_t::emit( const char *format, output_buffer_t &out )
+{
+    mpu_emitter_t *emitter = mpu_emitter_create(format);
+    if (emitter == NULL)
+    {
+        printf("unknown output_format '%s', valid formats are: %s\n",format,mpu_emitter_formats());
+        return false;
+    }
+    emitter->verify_mask = table_verify_mask;
+    emitter->emit(builder.display,out);
+    delete emitter;
+    return true;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   everything mpu_calc does for one memory map, as a library (libmpucalc)
+*
+* a session owns its symbols, regions and tables, nothing is global, so a build daemon
+* can run as many sessions as it likes on different threads. the symbol tables can
+* also be shared between sessions, they are only read once they are loaded.
+*
+* e.g.
+*    mpu_calc_session_t session;
+*    session.mpu_table_size = 15;
+*    if (!session.load_elf("device_first_pass") ||
+*        !session.load_file("memory_map.yaml") ||
+*        !session.compute() ||
+*        !session.emit("header",out)) exit(-1);
+*
+* errors are printed (the same messages as mpu_calc) and the call returns false.
+*/
+
+#ifndef MPU_CALC_SESSION_H
+#define MPU_CALC_SESSION_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <vector>
+#include "elf_symbols.h"
+#include "linker_script.h"
+#include "memory_map_builder.h"
+#include "memory_map_loader.h"
+#include "mpu_display.h"
+#include "mpu_verify.h"
+#include "output_buffer.h"
+
+class mpu_calc_session_t {
+public:
+    uint32_t mpu_table_size;   ///< 1-16, the unused entries are disabled
+    uint32_t verify_mask;      ///< regions mpu_verify() skips, as given (compute() doesn't change it)
+    uint32_t virtual_slots;    ///< slots for the regions with hotness: (see mpu_virtual.h)
+
+    memory_map_loader_t loader;
+    memory_map_builder_t builder;
+    mpu_task_tables_t tasks;
+    mpu_virtual_regions_t virtual_regions;
+    uint32_t num_entries;      ///< entries the global table needs (before it is padded to mpu_table_size)
+    uint32_t table_verify_mask;///< what mpuTableVerify.mask gets: verify_mask, the task and virtual slots and the unused entries
+
+    mpu_calc_session_t():mpu_table_size(16),verify_mask(MPU_VERIFY_DEFAULT_MASK),virtual_slots(0),loader(),builder(),tasks(),
+        virtual_regions(),num_entries(0),table_verify_mask(MPU_VERIFY_DEFAULT_MASK),
+        elf(),linker_script(),shared_symbols(NULL){}
+    mpu_calc_session_t( const mpu_calc_session_t & ) = delete;
+    mpu_calc_session_t &operator=( const mpu_calc_session_t & ) = delete;
+
+    // symbols, before the memory map is loaded
+    bool load_elf( const char *filename );
+    bool load_linker_script( const char *filename );
+    void use_symbols( const mpu_symbol_table_t *symbols );
+    void use_linker_script( const linker_script_t &script );
+
+    // regions, from yaml or one at a time
+    bool load_file( const char *filename );
+    bool load_string( const char *text, size_t length );
+    bool load_parsed( const memory_map_loader_t &parsed );
+    void add_region( const region_spec_t &region );
+
+    bool compute();
+    bool overflow() const { return num_entries > mpu_table_size; }
+    void resolve( std::vector<mpu_interval_t> &intervals ) { builder.display.flatten_memory_map(intervals); }
+    bool emit( const char *format, output_buffer_t &out );
+    void emit_tasks( output_buffer_t &out ) { tasks.emit(out); }
+    void emit_virtual( output_buffer_t &out ) { virtual_regions.emit(out); }
+
+private:
+    elf_symbols_t elf;
+    linker_script_t linker_script;
+    const mpu_symbol_table_t *shared_symbols;
+
+    const mpu_symbol_table_t *symbols();
+};
+
+#endif
+
+#endif
@@ -60,6 +60,8 @@ void mpu_calculator_t::find_size_and_subregions()
     }
     DEBUG_LOG_STRING(size_pwr_2);
 
+    // build_entry() encodes region_size
+    region_size = size_pwr_2;
     uint32_t subregion_size = size_pwr_2 / 8;
     DEBUG_LOG_STRING(subregion_size);
     num_subregions = (actual_size) / subregion_size;
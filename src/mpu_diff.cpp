@@ -0,0 +1,131 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   class for comparing the effective memory map of two mpu tables
+*/
+
+#include "mpu_diff.h"
+
+/**
+ * @brief
+ *   returns true if the two entries give memory the same effective attributes
+ *   (region number, size and subregions are just the encoding and are ignored)
+ */
+bool mpu_diff_t::same_attributes( const mpu_entry_t *a, const mpu_entry_t *b )
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+    return (a->DisableExec == b->DisableExec) &&
+           (a->AccessPermission == b->AccessPermission) &&
+           (a->AccessAttributes == b->AccessAttributes);
+}
+
+/**
+ * @brief
+ *   flatten both tables and merge them in one linear sweep, recording the
+ *   address ranges where the effective attributes differ.
+ *
+ * adjacent changes with the same old and new attributes are combined, so a region that
+ * was split across several entries in one table is reported as one range.
+ */
+void mpu_diff_t::compare( mpu_display_t &old_display, mpu_display_t &new_display )
+{
+    std::vector<mpu_interval_t> old_map;
+    std::vector<mpu_interval_t> new_map;
+    old_display.flatten_memory_map(old_map);
+    new_display.flatten_memory_map(new_map);
+    old_num_entries = old_display.num_enabled_entries();
+    new_num_entries = new_display.num_enabled_entries();
+
+    changes.clear();
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint32_t start = 0;
+    while (i < old_map.size() && j < new_map.size())
+    {
+        uint32_t stop = old_map[i].stop < new_map[j].stop ? old_map[i].stop : new_map[j].stop;
+        const mpu_entry_t *old_entry = old_map[i].entry;
+        const mpu_entry_t *new_entry = new_map[j].entry;
+        if (!same_attributes(old_entry,new_entry))
+        {
+            if (!changes.empty() &&
+                (changes.back().stop + 1 == start) &&
+                same_attributes(changes.back().old_entry,old_entry) &&
+                same_attributes(changes.back().new_entry,new_entry))
+            {
+                changes.back().stop = stop;
+            }
+            else
+            {
+                change_t change = { start, stop, old_entry, new_entry };
+                changes.push_back(change);
+            }
+        }
+        if (old_map[i].stop == stop)
+        {
+            i++;
+        }
+        if (new_map[j].stop == stop)
+        {
+            j++;
+        }
+        if (stop == 0xffffffff)
+        {
+            break;
+        }
+        start = stop + 1;
+    }
+}
+
+static const char *describe( const mpu_entry_t *e )
+{
+    if (e == NULL)
+    {
+        return "unmapped";
+    }
+    return e->access_type_to_string();
+}
+
+/*
+ * display the differences like:
+ *
+ * entries: 11 -> 12 (+1)
+ * start    end      size   old -> new
+ * -------- -------- ------ ----------
+ * 0044f800 0045ffff    66K WRITE_BACK_READ_AND_WRITE_ALLOCATE (fully cached) -> WRITE_BACK_READ_AND_WRITE_ALLOCATE (read-only, execute allowed)
+ */
+void mpu_diff_t::print( FILE *f, const char *prefix )
+{
+    output_buffer_t out;
+    print(out,prefix);
+    out.flush(f);
+}
+
+void mpu_diff_t::print( output_buffer_t &out, const char *prefix )
+{
+    out.print("%sentries: %u -> %u (%+d)\n",prefix,old_num_entries,new_num_entries,(int)new_num_entries-(int)old_num_entries);
+    if (changes.empty())
+    {
+        out.print("%sno changes to the memory map\n",prefix);
+        return;
+    }
+    out.print("%sstart    end      size   old -> new\n",prefix);
+    out.print("%s-------- -------- ------ ----------\n",prefix);
+    for (uint32_t i=0;i<changes.size();i++)
+    {
+        const change_t *c = &changes[i];
+        char size_string[10];
+        if (c->start == 0 && c->stop == 0xffffffff)
+        {
+            sprintf(size_string,"4G");
+        }
+        else
+        {
+            format_size(size_string,c->stop-c->start+1);
+        }
+        out.print("%s%08x %08x %6s %s -> %s\n",prefix,c->start,c->stop,size_string,describe(c->old_entry),describe(c->new_entry));
+    }
+}
@@ -0,0 +1,51 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   class for comparing the effective memory map of two mpu tables
+*/
+
+#ifndef MPU_DIFF_H
+#define MPU_DIFF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include "mpu_display.h"
+
+/**
+ * compares what two mpu tables actually do rather than how they are encoded.
+ *
+ * e.g. when .text grows the region numbers shift and the subregion tables in memory_map.h
+ * all change, but only a few K of memory actually changes attributes.
+ *
+ * note: the changes point at entries owned by the two mpu_display_t objects,
+ *       so those must outlive the mpu_diff_t.
+ */
+class mpu_diff_t {
+public:
+    /// an address range whose effective attributes changed (entry is NULL if unmapped)
+    struct change_t {
+        uint32_t start;
+        uint32_t stop;
+        const mpu_entry_t *old_entry;
+        const mpu_entry_t *new_entry;
+    };
+    std::vector<change_t> changes;
+    uint32_t old_num_entries;
+    uint32_t new_num_entries;
+
+    mpu_diff_t():changes(),old_num_entries(),new_num_entries(){}
+
+    void compare( mpu_display_t &old_display, mpu_display_t &new_display );
+
+    void print( FILE *f, const char *prefix );
+    void print( output_buffer_t &out, const char *prefix );
+
+    /// returns true if the tables differ in either effective attributes or number of entries
+    bool differs() const { return !changes.empty() || old_num_entries != new_num_entries; }
+
+    static bool same_attributes( const mpu_entry_t *a, const mpu_entry_t *b );
+};
+
+#endif
@@ -9,12 +9,13 @@
 #include "range_vector.h"
 #include "mpu_armv7.h"
 #include "configure_mpu.h"
+#include "mpu_snapshot.h"
 #include <cstring>
 
 #ifdef MDX2_SMALL_MEMORY
 #define PRINTF(...) printf(__VA_ARGS__)
 #else
-#define PRINTF(...) fprintf(f,__VA_ARGS__)
+#define PRINTF(...) out.print(__VA_ARGS__)
 #endif
 
 /// return string describing the memory region (a combination of three of the arguments to the CMSIS ARM_MPU_RASR_EX() macro)
@@ -204,7 +205,7 @@ static void format_fraction_1_dp( char buffer[10], uint32_t numerator, uint32_t
         *tail = 0;
     }
 }
-static void format_size( char buffer[10], uint32_t size_in_bytes )
+void format_size( char buffer[10], uint32_t size_in_bytes )
 {
     const char *units;
     if (size_in_bytes >= 1024*1024*1024)
@@ -230,7 +231,7 @@ static void format_size( char buffer[10], uint32_t size_in_bytes )
     strcat(buffer,units);
 }
 
-void mpu_entry_t::print(FILE *f __attribute__((unused)), const char *prefix __attribute__((unused)))
+void mpu_entry_t::print(output_buffer_t &out __attribute__((unused)), const char *prefix __attribute__((unused)))
 {
     if (enable)
     {
@@ -311,45 +312,26 @@ void mpu_entry_t::print(FILE *f __attribute__((unused)), const char *prefix __at
     }
 }
 
-static void display_interval( const DisjointInterval<uint32_t,mpu_entry_t*>& rl, FILE *f __attribute__((unused)), const char *prefix  __attribute__((unused)))
+static void display_interval( const mpu_interval_t &interval, output_buffer_t &out __attribute__((unused)), const char *prefix  __attribute__((unused)))
 {
-    uint32_t size = rl.stop-rl.start+1;
+    uint32_t size = interval.stop-interval.start+1;
     char size_string[10];
     format_size(size_string,size);
-    if (rl._list.empty())
+    if (interval.entry == NULL)
     {
 #ifdef MDX2_SMALL_MEMORY
-        //MDX2_LOG2_ERROR(MDX2_DIGIHAL_MPU_MEMORY_UNMAPPED,rl.start,rl.stop);
+        //MDX2_LOG2_ERROR(MDX2_DIGIHAL_MPU_MEMORY_UNMAPPED,interval.start,interval.stop);
 #else
 #endif
-        PRINTF("%s%08x %08x %6s  . unmapped\n",prefix,(uint32_t)rl.start,(uint32_t)rl.stop,size_string);
+        PRINTF("%s%08x %08x %6s  . unmapped\n",prefix,interval.start,interval.stop,size_string);
     }
     else
     {
-        uint32_t max_region = 0;
-        mpu_entry_t *max_entry;
-        for( typename std::list< RangeValue<uint32_t,mpu_entry_t*> >::const_iterator i=rl._list.begin();
-             i != rl._list.end();
-             i++)
-        {
-            RangeValue<uint32_t,mpu_entry_t*> rv = *i;
-            mpu_entry_t *e = rv.value;
-            if (e->Region >= max_region)
-                max_entry = e;
-        }
 #ifdef MDX2_SMALL_MEMORY
-        //MDX2_LOG4_ERROR(MDX2_DIGIHAL_MPU_MEMORY_MAP,rl.start,rl.stop,max_entry->Region,(uint32_t)(size_t)max_entry->access_type_to_string());
+        //MDX2_LOG4_ERROR(MDX2_DIGIHAL_MPU_MEMORY_MAP,interval.start,interval.stop,interval.entry->Region,(uint32_t)(size_t)interval.entry->access_type_to_string());
 #else
 #endif
-        PRINTF("%s%08x %08x %6s %2u %s\n",prefix,rl.start,rl.stop,size_string,max_entry->Region,max_entry->access_type_to_string());
-    }
-}
-static void display_range( const  DisjointRangeVector<uint32_t,mpu_entry_t*>& arv, FILE *f, const char *prefix ) {
-    for (typename std::vector< DisjointInterval<uint32_t,mpu_entry_t*> >::const_iterator i = arv._vector_of_disjoint_intervals.begin();
-        i != arv._vector_of_disjoint_intervals.end();
-        i++)
-    {
-        display_interval( *i, f, prefix );
+        PRINTF("%s%08x %08x %6s %2u %s\n",prefix,interval.start,interval.stop,size_string,interval.entry->Region,interval.entry->access_type_to_string());
     }
 }
 
@@ -378,23 +360,42 @@ static void display_range( const  DisjointRangeVector<uint32_t,mpu_entry_t*>& ar
  *
  * see mpu_calculator_test.cpp for example usage,
  *
- * also called by mpu_dump() in configure_mpu.cpp
- * 
- * TODO: refactoring suggestion: first convert from a DisjointRangeVector<> to a normal vector<>
- *  then print or return the vector<> for easier unit tests or custom formatting.  (currently the formatting and algorithm are tightly coupled)
+ * also used to render the snapshot logged by mpu_dump() (see load_snapshot())
+ *
+ * the intervals come from flatten_memory_map(), so this shows what mpu_diff_t and the emitters compare.
  */
 void mpu_display_t::display_memory_map(FILE *f, const char *prefix)
 {
-    for (uint32_t i=0;i<MAX_ENTRIES;i++)
+    output_buffer_t out;
+    display_memory_map(out,prefix);
+    out.flush(f);
+}
+
+void mpu_display_t::display_memory_map(output_buffer_t &out, const char *prefix)
+{
+    std::vector<mpu_interval_t> intervals;
+    flatten_memory_map(intervals);
+
+    PRINTF("%sstart    end      size   #  description\n",prefix);
+    PRINTF("%s-------- -------- ------ -- -----------\n",prefix);
+
+    for (const mpu_interval_t &interval : intervals)
     {
-        mpu_entry_t *e = &mpu_entries[i];
-        e->set(mpu_table[i].RBAR,mpu_table[i].RASR);
+        display_interval( interval, out, prefix );
     }
+    PRINTF("\n");
 
-    DisjointRangeVector<uint32_t,mpu_entry_t*>::range_vector v;
-    for (uint32_t i=0;i<MAX_ENTRIES;i++)
+}
+
+/*
+ * the address ranges of the enabled subregions of every entry, in table order
+ * (a run of enabled subregions is one range)
+ */
+static void entry_ranges( mpu_entry_t *entries, uint32_t num_entries, DisjointRangeVector<uint32_t,mpu_entry_t*>::range_vector &v )
+{
+    for (uint32_t i=0;i<num_entries;i++)
     {
-        mpu_entry_t *e = &mpu_entries[i];
+        mpu_entry_t *e = &entries[i];
         if (e->enable)
         {
             uint32_t subregions = (~e->SubRegionDisable) & 0xff;
@@ -407,7 +408,6 @@ void mpu_display_t::display_memory_map(FILE *f, const char *prefix)
                     subregions &= ~(1<<next_subregion);
                     next_subregion++;
                 }
-                //uint32_t last_subregion = next_subregion-1;
                 uint32_t start_addr = e->BaseAddress + e->subregion_size*first_subregion;
                 uint32_t end_addr = e->BaseAddress + e->subregion_size*next_subregion-1;
                 DisjointRangeVector<uint32_t,mpu_entry_t*>::range_value RangeValue(start_addr,end_addr,e);
@@ -415,6 +415,27 @@ void mpu_display_t::display_memory_map(FILE *f, const char *prefix)
             }
         }
     }
+}
+
+/*
+ * flatten the mpu table into a sorted vector of disjoint intervals covering 0x00000000 .. 0xffffffff
+ *
+ * each interval records the entry that the hardware would use for that address range,
+ * (when entries overlap, the last one in the table wins) or NULL if unmapped.
+ * adjacent intervals resolving to the same entry are not merged so the region boundaries are preserved.
+ *
+ * display_memory_map() prints it, and mpu_diff_t compares two tables with a single linear sweep of it.
+ */
+void mpu_display_t::flatten_memory_map( std::vector<mpu_interval_t> &intervals )
+{
+    for (uint32_t i=0;i<MAX_ENTRIES;i++)
+    {
+        mpu_entry_t *e = &mpu_entries[i];
+        e->set(mpu_table[i].RBAR,mpu_table[i].RASR);
+    }
+
+    DisjointRangeVector<uint32_t,mpu_entry_t*>::range_vector v;
+    entry_ranges(mpu_entries,MAX_ENTRIES,v);
 
     // set the minimum and maximum values to 0,0xffffffff
     // and initialize the disjoint vector to 'v'
@@ -422,13 +443,44 @@ void mpu_display_t::display_memory_map(FILE *f, const char *prefix)
     // into a disjoint set of intervals
     DisjointRangeVector<uint32_t,mpu_entry_t*> rv(0,0xffffffff,&v);
 
-    PRINTF("%sstart    end      size   #  description\n",prefix);
-    PRINTF("%s-------- -------- ------ -- -----------\n",prefix);
-
-    // display the disjoint vector.
-    ::display_range( rv, f, prefix );
-    PRINTF("\n");
+    intervals.clear();
+    intervals.reserve(rv._vector_of_disjoint_intervals.size());
+    for (typename std::vector< DisjointInterval<uint32_t,mpu_entry_t*> >::const_iterator i = rv._vector_of_disjoint_intervals.begin();
+        i != rv._vector_of_disjoint_intervals.end();
+        i++)
+    {
+        // where entries overlap the last one in the table wins.  in a real table the slot is the
+        // region number (the hardware's rule), and the entries past the 16th, whose region
+        // numbers wrap, still show up in an overflowing one
+        const mpu_entry_t *winner = NULL;
+        for( typename std::list< RangeValue<uint32_t,mpu_entry_t*> >::const_iterator j=i->_list.begin();
+             j != i->_list.end();
+             j++)
+        {
+            if (winner == NULL || j->value > winner)
+            {
+                winner = j->value;
+            }
+        }
+        mpu_interval_t interval = { i->start, i->stop, winner };
+        intervals.push_back(interval);
+    }
+}
 
+/*
+ * return the number of enabled entries in the table.
+ */
+uint32_t mpu_display_t::num_enabled_entries()
+{
+    uint32_t count = 0;
+    for (uint32_t i=0;i<MAX_ENTRIES;i++)
+    {
+        if (mpu_table[i].RASR & MPU_RASR_ENABLE_Msk)
+        {
+            count++;
+        }
+    }
+    return count;
 }
 
 /*
@@ -503,18 +555,69 @@ void mpu_display_t::get_first_and_last_address(uint32_t *first_addr_ptr, uint32_
  *
  * see mpu_calculator_test.cpp for example usage,
  *
- * also called by mpu_dump() in configure_mpu.cpp
+ * also used to render the snapshot logged by mpu_dump() (see load_snapshot())
  * 
  */
-void mpu_display_t::display_entries(FILE *f __attribute__((unused)), const char *prefix __attribute__((unused)))
+void mpu_display_t::display_entries(FILE *f, const char *prefix)
+{
+    output_buffer_t out;
+    display_entries(out,prefix);
+    out.flush(f);
+}
+
+void mpu_display_t::display_entries(output_buffer_t &out __attribute__((unused)), const char *prefix __attribute__((unused)))
 {
 #ifndef MDX2_SMALL_MEMORY
     for (uint32_t i=0;i<MAX_ENTRIES;i++)
     {
         mpu_entry_t *e = &mpu_entries[i];
         e->set(mpu_table[i].RBAR,mpu_table[i].RASR);
-        e->print(f,prefix);
+        e->print(out,prefix);
     }
 #endif
 }
 
+/*
+ * refresh and return entry i (so the decoded fields match mpu_table[i])
+ */
+const mpu_entry_t *mpu_display_t::get_entry(uint32_t i)
+{
+    mpu_entry_t *e = &mpu_entries[i];
+    e->set(mpu_table[i].RBAR,mpu_table[i].RASR);
+    return e;
+}
+
+
+#ifndef MDX2_FREERTOS_TARGET
+/**
+ * @brief
+ *   decode a snapshot logged by mpu_dump() so it can be displayed on the host.
+ *
+ * @param[in] record - the bytes of the log record (any alignment)
+ * @param[in] record_size - number of bytes in the record
+ * @param[out] mpu_TYPE - MPU->TYPE when the snapshot was taken
+ * @param[out] mpu_CTRL - MPU->CTRL when the snapshot was taken
+ *
+ * @return false if the record is not a valid snapshot (an error message is printed)
+ */
+bool mpu_display_t::load_snapshot(const void *record, uint32_t record_size, uint32_t *mpu_TYPE, uint32_t *mpu_CTRL)
+{
+    mpu_snapshot_t snapshot;
+    memset(&snapshot,0,sizeof(snapshot));
+    memcpy(&snapshot,record,record_size < sizeof(snapshot) ? record_size : sizeof(snapshot));
+    const char *error = mpu_snapshot_check(&snapshot,record_size);
+    if (error != NULL)
+    {
+        printf("%s\n",error);
+        return false;
+    }
+    memset(mpu_table,0,sizeof(mpu_table));
+    for (uint32_t i=0;i<snapshot.num_regions;i++)
+    {
+        set(i,snapshot.regions[i].RBAR,snapshot.regions[i].RASR);
+    }
+    *mpu_TYPE = snapshot.mpu_TYPE;
+    *mpu_CTRL = snapshot.mpu_CTRL;
+    return true;
+}
+#endif
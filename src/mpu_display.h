@@ -14,10 +14,15 @@
 #include "cpu_m7.h"
 #endif
 #include "mpu_armv7.h"
+#include "output_buffer.h"
+#include <vector>
 #ifndef MDX2_SMALL_MEMORY
 #include <string>
 #endif
 
+/// format a size in bytes like 4G, 1.5M, 256K or 32 (used for the memory map display)
+void format_size( char buffer[10], uint32_t size_in_bytes );
+
 // failed attempt to print a nice memory map,... maybe could be done as a debug_cmd or from the host,...
 // kinda hard to figure out the end of the region unless you simply scan forward 32 bytes at a time.
 class mpu_entry_t {
@@ -47,7 +52,7 @@ public:
     std::string comment;
 #endif
     void set( uint32_t RBAR, uint32_t RASR );
-    void print( FILE *f, const char *prefix );
+    void print( output_buffer_t &out, const char *prefix );
     bool region_active(uint32_t subregion_number)
     {
         if (enable && !(SubRegionDisable & (1<<subregion_number)))
@@ -65,6 +70,14 @@ public:
     const char *access_permission_to_code() const;
 };
 
+/// one disjoint interval of the flattened memory map,
+/// entry is the mpu entry that wins for this interval (highest region number) or NULL if unmapped.
+struct mpu_interval_t {
+    uint32_t start;
+    uint32_t stop;
+    const mpu_entry_t *entry;
+};
+
 class mpu_display_t {
 public:
     // pretending there are more entries available so that we can
@@ -73,7 +86,15 @@ public:
     ARM_MPU_Region_t mpu_table[MAX_ENTRIES];
     void get_first_and_last_address(uint32_t *first_addr_ptr, uint32_t *last_addr_ptr);
     void display_memory_map( FILE *f, const char *prefix );
+    void display_memory_map( output_buffer_t &out, const char *prefix );
     void display_entries( FILE *f, const char *prefix );
+    void display_entries( output_buffer_t &out, const char *prefix );
+    const mpu_entry_t *get_entry( uint32_t i );
+    void flatten_memory_map( std::vector<mpu_interval_t> &intervals );
+    uint32_t num_enabled_entries();
+#ifndef MDX2_FREERTOS_TARGET
+    bool load_snapshot(const void *record, uint32_t record_size, uint32_t *mpu_TYPE, uint32_t *mpu_CTRL);
+#endif
     void set(uint32_t i,uint32_t RBAR,uint32_t RASR)
     {
         mpu_table[i].RBAR=RBAR;
@@ -0,0 +1,340 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   output formats for a calculated mpu table
+*
+* all of the emitters write to an output_buffer_t, so generating a table
+* costs a single fwrite() no matter how many lines it contains.
+*/
+
+#include "mpu_emitter.h"
+#include "configure_mpu.h"
+#include <string.h>
+#include <vector>
+
+/// entries that mpu_calc lists in the table (disabled entries for region 0 are just padding)
+static bool entry_is_listed( const mpu_entry_t *e )
+{
+    return e->enable || e->Region != 0;
+}
+
+/// number of entries in the table including trailing unused entries
+static uint32_t listed_entries( mpu_display_t &display )
+{
+    uint32_t num_entries = 0;
+    for (uint32_t i=0;i<mpu_display_t::MAX_ENTRIES;i++)
+    {
+        if (entry_is_listed(display.get_entry(i)))
+        {
+            num_entries = i+1;
+        }
+    }
+    return num_entries;
+}
+
+static uint64_t region_size( const mpu_entry_t *e )
+{
+    return e->size_pwr_2 == 0 ? 0x100000000ULL : e->size_pwr_2;
+}
+
+static const char *interval_description( const mpu_interval_t &interval )
+{
+    if (interval.entry == NULL)
+    {
+        return "unmapped";
+    }
+    return interval.entry->access_type_to_string();
+}
+
+/// crc that mpu_verify() expects from the registers once the table has been loaded
+static uint32_t table_verify_crc( mpu_display_t &display, uint32_t verify_mask )
+{
+    return mpu_table_verify_crc( display.mpu_table, MPU_VERIFY_REGIONS, verify_mask );
+}
+
+void mpu_header_emitter_t::emit( mpu_display_t &display, output_buffer_t &out )
+{
+    display.display_memory_map(out,"// ");
+    display.display_entries(out,"    // ");
+    // mpu_table.cpp includes this file inside the initializer for mpuTable[], which is fine for a #define
+    out.print("    // crc for mpu_verify(), the regions in MPU_TABLE_VERIFY_MASK are reprogrammed at run time and are not checked\n");
+    out.print("#define MPU_TABLE_VERIFY_MASK 0x%08xUL\n", verify_mask);
+    out.print("#define MPU_TABLE_VERIFY_CRC 0x%08xUL\n", table_verify_crc(display,verify_mask));
+}
+
+/// write a json string with quotes, backslashes and control characters escaped
+static void json_string( output_buffer_t &out, const char *s )
+{
+    out.append("\"",1);
+    for (const char *p = s; *p != 0; p++)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            out.print("\\%c",*p);
+        }
+        else if ((unsigned char)*p < 0x20)
+        {
+            out.print("\\u%04x",(unsigned char)*p);
+        }
+        else
+        {
+            out.append(p,1);
+        }
+    }
+    out.append("\"",1);
+}
+
+/*
+ * e.g.
+ * {
+ *   "verify_mask": "0x00008000", "verify_crc": "0x235a2131",
+ *   "entries": [
+ *     {"region": 0, "RBAR": "0x00000010", "RASR": "0x1000003f", "enable": 1, "base_address": "0x00000000", "size": 4294967296, "SRD": "0x00", "XN": 1, "AP": 0, "access": "NO_ACCESS", "comment": "..."},
+ *     ...
+ *   ],
+ *   "memory_map": [
+ *     {"start": "0x00000000", "end": "0x003fffff", "region": 0, "XN": 1, "AP": 0, "access": "NO_ACCESS", "description": "NO_ACCESS"},
+ *     ...
+ *   ]
+ * }
+ */
+void mpu_json_emitter_t::emit( mpu_display_t &display, output_buffer_t &out )
+{
+    uint32_t num_entries = listed_entries(display);
+    out.print("{\n  \"verify_mask\": \"0x%08x\", \"verify_crc\": \"0x%08x\",\n", verify_mask, table_verify_crc(display,verify_mask));
+    out.print("  \"entries\": [");
+    const char *separator = "\n";
+    for (uint32_t i=0;i<num_entries;i++)
+    {
+        const mpu_entry_t *e = display.get_entry(i);
+        out.print("%s    {\"region\": %u, \"RBAR\": \"0x%08x\", \"RASR\": \"0x%08x\", \"enable\": %u",
+            separator, i, e->mpu_RBAR, e->mpu_RASR, e->enable);
+        if (e->enable)
+        {
+            out.print(", \"base_address\": \"0x%08x\", \"size\": %llu, \"SRD\": \"0x%02x\", \"XN\": %u, \"AP\": %u, \"access\": \"%s\"",
+                e->BaseAddress, (unsigned long long)region_size(e), e->SubRegionDisable, e->DisableExec, e->AccessPermission, e->access_type_to_code());
+        }
+#ifndef MDX2_SMALL_MEMORY
+        out.print(", \"comment\": ");
+        json_string(out,e->comment.c_str());
+#endif
+        out.print("}");
+        separator = ",\n";
+    }
+    out.print("\n  ],\n  \"memory_map\": [");
+
+    std::vector<mpu_interval_t> intervals;
+    display.flatten_memory_map(intervals);
+    separator = "\n";
+    for (uint32_t i=0;i<intervals.size();i++)
+    {
+        const mpu_interval_t &interval = intervals[i];
+        out.print("%s    {\"start\": \"0x%08x\", \"end\": \"0x%08x\"", separator, interval.start, interval.stop);
+        if (interval.entry != NULL)
+        {
+            const mpu_entry_t *e = interval.entry;
+            out.print(", \"region\": %u, \"XN\": %u, \"AP\": %u, \"access\": \"%s\"",
+                e->Region, e->DisableExec, e->AccessPermission, e->access_type_to_code());
+        }
+        out.print(", \"description\": ");
+        json_string(out,interval_description(interval));
+        out.print("}");
+        separator = ",\n";
+    }
+    out.print("\n  ]\n}\n");
+}
+
+/*
+ * e.g.
+ * start,end,size,region,XN,AP,access,description
+ * 0x00000000,0x003fffff,4194304,0,1,0,NO_ACCESS,NO_ACCESS
+ * 0x00400000,0x0043ffff,262144,6,0,6,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,WRITE_BACK_READ_AND_WRITE_ALLOCATE (read-only, execute allowed)
+ *
+ * unmapped intervals have empty region/XN/AP/access columns.
+ */
+void mpu_csv_emitter_t::emit( mpu_display_t &display, output_buffer_t &out )
+{
+    std::vector<mpu_interval_t> intervals;
+    display.flatten_memory_map(intervals);
+    out.print("start,end,size,region,XN,AP,access,description\n");
+    for (uint32_t i=0;i<intervals.size();i++)
+    {
+        const mpu_interval_t &interval = intervals[i];
+        unsigned long long size = (unsigned long long)interval.stop - interval.start + 1;
+        out.print("0x%08x,0x%08x,%llu,", interval.start, interval.stop, size);
+        if (interval.entry != NULL)
+        {
+            const mpu_entry_t *e = interval.entry;
+            out.print("%u,%u,%u,%s,", e->Region, e->DisableExec, e->AccessPermission, e->access_type_to_code());
+        }
+        else
+        {
+            out.print(",,,,");
+        }
+        // descriptions contain ", " so quote them
+        out.print("\"%s\"\n", interval_description(interval));
+    }
+}
+
+typedef struct {
+    const char *section;
+    const char *requirement;
+    bool (*allowed)( const mpu_entry_t *e );
+} section_check_t;
+
+static bool execute_allowed( const mpu_entry_t *e )
+{
+    return e != NULL && e->DisableExec == 0 && e->AccessPermission != ARM_MPU_AP_NONE;
+}
+
+static bool write_allowed( const mpu_entry_t *e )
+{
+    return e != NULL && (e->AccessPermission == ARM_MPU_AP_FULL || e->AccessPermission == ARM_MPU_AP_PRIV);
+}
+
+/// sections from example/device.ld that must end up in memory with the right permissions
+static const section_check_t section_checks[] = {
+    { ".text", "execute allowed", execute_allowed },
+    { ".data", "writable", write_allowed },
+    { ".bss", "writable", write_allowed },
+};
+
+/*
+ * e.g.
+ * ASSERT(SIZEOF(.mpu_table) == 15 * 8 + 12, "mpu_calc: .mpu_table does not match the generated table, rerun mpu_calc");
+ * ASSERT((ADDR(.text) >= 0x00400000 && ADDR(.text) + SIZEOF(.text) <= 0x0044f800), "mpu_calc: .text is not execute allowed in the mpu table");
+ *
+ * include it at the end of the SECTIONS block (INCLUDE mpu_asserts.ld) so the final link
+ * fails if the sections moved after the table was calculated.
+ */
+void mpu_linker_assert_emitter_t::emit( mpu_display_t &display, output_buffer_t &out )
+{
+    out.print("/* generated by mpu_calc, include at the end of SECTIONS */\n");
+    // the table then the mpuTableVerify trailer
+    out.print("ASSERT(SIZEOF(.mpu_table) == %u * 8 + %u, \"mpu_calc: .mpu_table does not match the generated table, rerun mpu_calc\");\n",listed_entries(display),(uint32_t)sizeof(mpu_table_verify_t));
+
+    std::vector<mpu_interval_t> intervals;
+    display.flatten_memory_map(intervals);
+    for (uint32_t c=0;c<sizeof(section_checks)/sizeof(section_checks[0]);c++)
+    {
+        const section_check_t *check = &section_checks[c];
+        out.print("ASSERT(");
+        const char *separator = "";
+        uint32_t i = 0;
+        bool any = false;
+        while (i < intervals.size())
+        {
+            if (!check->allowed(intervals[i].entry))
+            {
+                i++;
+                continue;
+            }
+            // merge adjacent intervals with the same permission into one span
+            uint32_t span_start = intervals[i].start;
+            uint64_t span_end = (uint64_t)intervals[i].stop + 1;
+            i++;
+            while (i < intervals.size() && check->allowed(intervals[i].entry))
+            {
+                span_end = (uint64_t)intervals[i].stop + 1;
+                i++;
+            }
+            out.print("%s(ADDR(%s) >= 0x%08x && ADDR(%s) + SIZEOF(%s) <= 0x%08llx)",
+                separator, check->section, span_start, check->section, check->section, (unsigned long long)span_end);
+            separator = " || ";
+            any = true;
+        }
+        if (!any)
+        {
+            out.print("SIZEOF(%s) == 0", check->section);
+        }
+        out.print(", \"mpu_calc: %s is not %s in the mpu table\");\n", check->section, check->requirement);
+    }
+}
+
+/// little endian, the same as the m7
+static void append_u32( output_buffer_t &out, uint32_t value )
+{
+    char bytes[4] = { (char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+    out.append(bytes,sizeof(bytes));
+}
+
+void mpu_binary_emitter_t::emit( mpu_display_t &display, output_buffer_t &out )
+{
+    uint32_t num_entries = listed_entries(display);
+    for (uint32_t i=0;i<num_entries;i++)
+    {
+        append_u32(out,display.mpu_table[i].RBAR);
+        append_u32(out,display.mpu_table[i].RASR);
+    }
+    // the mpuTableVerify trailer, so replacing .mpu_table with the blob keeps mpu_verify() matching
+    append_u32(out,MPU_TABLE_VERIFY_MAGIC);
+    append_u32(out,table_verify_crc(display,verify_mask));
+    append_u32(out,verify_mask);
+}
+
+/*
+ * e.g.
+ * # mpu_calc binary table
+ * entries=15
+ * size=132
+ * crc32=0x1f0e3c6a
+ * verify_mask=0x00008000
+ * verify_crc=0x235a2131
+ * source_crc32=0x6b1c2f07
+ */
+void mpu_binary_emitter_t::manifest( mpu_display_t &display, output_buffer_t &out )
+{
+    output_buffer_t blob;
+    emit(display,blob);
+    out.print("# mpu_calc binary table\n");
+    out.print("entries=%u\n",(uint32_t)((blob.size() - sizeof(mpu_table_verify_t))/sizeof(ARM_MPU_Region_t)));
+    out.print("size=%u\n",(uint32_t)blob.size());
+    out.print("crc32=0x%08x\n",mpu_crc32(0,blob.data(),blob.size()));
+    out.print("verify_mask=0x%08x\n",verify_mask);
+    out.print("verify_crc=0x%08x\n",table_verify_crc(display,verify_mask));
+    out.print("source_crc32=0x%08x\n",source_crc);
+}
+
+typedef struct {
+    const char *name;
+    mpu_emitter_t *(*create)();
+} emitter_format_t;
+
+static mpu_emitter_t *create_header() { return new mpu_header_emitter_t; }
+static mpu_emitter_t *create_json() { return new mpu_json_emitter_t; }
+static mpu_emitter_t *create_csv() { return new mpu_csv_emitter_t; }
+static mpu_emitter_t *create_linker_assert() { return new mpu_linker_assert_emitter_t; }
+static mpu_emitter_t *create_binary() { return new mpu_binary_emitter_t; }
+
+static const emitter_format_t emitter_formats[] = {
+    { "header", create_header },
+    { "json", create_json },
+    { "csv", create_csv },
+    { "ld", create_linker_assert },
+    { "bin", create_binary },
+};
+
+/**
+ * @brief
+ *   create an emitter by name (header, json, csv, ld or bin)
+ *
+ * @return NULL if the format is unknown, otherwise an emitter that the caller must delete.
+ */
+mpu_emitter_t *mpu_emitter_create( const char *format )
+{
+    for (uint32_t i=0;i<sizeof(emitter_formats)/sizeof(emitter_formats[0]);i++)
+    {
+        if (strcmp(format,emitter_formats[i].name) == 0)
+        {
+            return emitter_formats[i].create();
+        }
+    }
+    return NULL;
+}
+
+/// list of valid formats for error messages
+const char *mpu_emitter_formats()
+{
+    return "header, json, csv, ld, bin";
+}
@@ -0,0 +1,80 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   output formats for a calculated mpu table
+*/
+
+#ifndef MPU_EMITTER_H
+#define MPU_EMITTER_H
+
+#include <stdint.h>
+#include "mpu_display.h"
+#include "output_buffer.h"
+#include "mpu_verify.h"
+
+/**
+ * an emitter formats the entries and resolved memory map of an mpu_display_t into an output_buffer_t.
+ *
+ * e.g.
+ *    mpu_emitter_t *emitter = mpu_emitter_create("json");
+ *    output_buffer_t out;
+ *    emitter->emit(display,out);
+ *    out.flush(f);
+ *    delete emitter;
+ */
+class mpu_emitter_t {
+public:
+    mpu_emitter_t():verify_mask(MPU_VERIFY_DEFAULT_MASK){}
+    virtual ~mpu_emitter_t() {}
+    virtual void emit( mpu_display_t &display, output_buffer_t &out ) = 0;
+
+    /// regions that mpu_verify() skips when checking the crc of the table
+    uint32_t verify_mask;
+};
+
+/// the memory_map.h that is #included by mpu_table.cpp (the original mpu_calc output)
+class mpu_header_emitter_t : public mpu_emitter_t {
+public:
+    void emit( mpu_display_t &display, output_buffer_t &out );
+};
+
+/// json with an "entries" array and a "memory_map" array
+class mpu_json_emitter_t : public mpu_emitter_t {
+public:
+    void emit( mpu_display_t &display, output_buffer_t &out );
+};
+
+/// csv of the resolved memory map, one interval per row
+class mpu_csv_emitter_t : public mpu_emitter_t {
+public:
+    void emit( mpu_display_t &display, output_buffer_t &out );
+};
+
+/// linker script fragment with ASSERT()s that fail the final link if the table no longer matches
+class mpu_linker_assert_emitter_t : public mpu_emitter_t {
+public:
+    void emit( mpu_display_t &display, output_buffer_t &out );
+};
+
+/**
+ * the table as a packed little endian ARM_MPU_Region_t[] then the mpuTableVerify trailer
+ * (what mpu_table.cpp puts in .mpu_table), e.g.
+ *    arm-none-eabi-objcopy --update-section .mpu_table=mpu_table.bin device
+ * manifest() describes the blob so a build can check it before using it.
+ */
+class mpu_binary_emitter_t : public mpu_emitter_t {
+public:
+    mpu_binary_emitter_t():source_crc(0){}
+    void emit( mpu_display_t &display, output_buffer_t &out );
+    void manifest( mpu_display_t &display, output_buffer_t &out );
+
+    /// mpu_crc32() of the memory map the table was calculated from
+    uint32_t source_crc;
+};
+
+mpu_emitter_t *mpu_emitter_create( const char *format );
+
+const char *mpu_emitter_formats();
+
+#endif
@@ -0,0 +1,378 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   address expressions in memory_map.yaml (see mpu_expression.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "mpu_expression.h"
+#include <ctype.h>
+#include <stdio.h>
+
+static bool is_name_start( char c )
+{
+    return isalpha((unsigned char)c) || c == '_' || c == '.';
+}
+
+static bool is_name_char( char c )
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '.';
+}
+
+static void skip_spaces( std::string_view text, size_t *pos )
+{
+    while (*pos < text.size() && isspace((unsigned char)text[*pos]))
+    {
+        (*pos)++;
+    }
+}
+
+bool mpu_expression_t::is_expression( std::string_view text )
+{
+    return text.find_first_of("+-*/(), \t") != std::string_view::npos;
+}
+
+/// children are always added before their parent, so evaluate() can run through the nodes in order
+uint32_t mpu_expression_t::add_node( op_t op, uint32_t value, uint32_t left, uint32_t right )
+{
+    node_t node = { op, value, left, right };
+    nodes.push_back(node);
+    return nodes.size()-1;
+}
+
+bool mpu_expression_t::syntax_error( parser_t &p, const char *expected )
+{
+    char buffer[200];
+    if (p.pos < p.text.size())
+    {
+        snprintf(buffer,sizeof(buffer),"expected %s at '%.*s'",expected,(int)(p.text.size()-p.pos),p.text.data()+p.pos);
+    }
+    else
+    {
+        snprintf(buffer,sizeof(buffer),"expected %s at the end",expected);
+    }
+    error = buffer;
+    return false;
+}
+
+/**
+ * @brief
+ *   parse an expression.
+ *
+ * @return false if there is a syntax error (see error)
+ */
+bool mpu_expression_t::compile( std::string_view text )
+{
+    nodes.clear();
+    names.clear();
+    error.clear();
+    parser_t p = { text, 0 };
+    if (!parse_sum(p,&root))
+    {
+        return false;
+    }
+    skip_spaces(p.text,&p.pos);
+    if (p.pos != p.text.size())
+    {
+        return syntax_error(p,"an operator");
+    }
+    return true;
+}
+
+// sum := product { ('+' | '-') product }
+bool mpu_expression_t::parse_sum( parser_t &p, uint32_t *node )
+{
+    if (!parse_product(p,node))
+    {
+        return false;
+    }
+    for (;;)
+    {
+        skip_spaces(p.text,&p.pos);
+        if (p.pos >= p.text.size() || (p.text[p.pos] != '+' && p.text[p.pos] != '-'))
+        {
+            return true;
+        }
+        op_t op = p.text[p.pos] == '+' ? ADD : SUBTRACT;
+        p.pos++;
+        uint32_t right;
+        if (!parse_product(p,&right))
+        {
+            return false;
+        }
+        *node = add_node(op,0,*node,right);
+    }
+}
+
+// product := unary { ('*' | '/') unary }
+bool mpu_expression_t::parse_product( parser_t &p, uint32_t *node )
+{
+    if (!parse_unary(p,node))
+    {
+        return false;
+    }
+    for (;;)
+    {
+        skip_spaces(p.text,&p.pos);
+        if (p.pos >= p.text.size() || (p.text[p.pos] != '*' && p.text[p.pos] != '/'))
+        {
+            return true;
+        }
+        op_t op = p.text[p.pos] == '*' ? MULTIPLY : DIVIDE;
+        p.pos++;
+        uint32_t right;
+        if (!parse_unary(p,&right))
+        {
+            return false;
+        }
+        *node = add_node(op,0,*node,right);
+    }
+}
+
+// unary := '-' unary | primary
+bool mpu_expression_t::parse_unary( parser_t &p, uint32_t *node )
+{
+    skip_spaces(p.text,&p.pos);
+    if (p.pos < p.text.size() && p.text[p.pos] == '-')
+    {
+        p.pos++;
+        uint32_t operand;
+        if (!parse_unary(p,&operand))
+        {
+            return false;
+        }
+        *node = add_node(NEGATE,0,operand,0);
+        return true;
+    }
+    return parse_primary(p,node);
+}
+
+// primary := number | name | ALIGN '(' sum ',' sum ')' | '(' sum ')'
+bool mpu_expression_t::parse_primary( parser_t &p, uint32_t *node )
+{
+    skip_spaces(p.text,&p.pos);
+    if (p.pos >= p.text.size())
+    {
+        return syntax_error(p,"a number or symbol");
+    }
+    char c = p.text[p.pos];
+    if (isdigit((unsigned char)c))
+    {
+        return parse_number(p,node);
+    }
+    if (c == '(')
+    {
+        p.pos++;
+        if (!parse_sum(p,node))
+        {
+            return false;
+        }
+        skip_spaces(p.text,&p.pos);
+        if (p.pos >= p.text.size() || p.text[p.pos] != ')')
+        {
+            return syntax_error(p,"')'");
+        }
+        p.pos++;
+        return true;
+    }
+    if (!is_name_start(c))
+    {
+        return syntax_error(p,"a number or symbol");
+    }
+    size_t start = p.pos;
+    while (p.pos < p.text.size() && is_name_char(p.text[p.pos]))
+    {
+        p.pos++;
+    }
+    std::string_view name = p.text.substr(start,p.pos-start);
+    skip_spaces(p.text,&p.pos);
+    if (name == "ALIGN" && p.pos < p.text.size() && p.text[p.pos] == '(')
+    {
+        p.pos++;
+        uint32_t value;
+        uint32_t alignment;
+        if (!parse_sum(p,&value))
+        {
+            return false;
+        }
+        skip_spaces(p.text,&p.pos);
+        if (p.pos >= p.text.size() || p.text[p.pos] != ',')
+        {
+            return syntax_error(p,"','");
+        }
+        p.pos++;
+        if (!parse_sum(p,&alignment))
+        {
+            return false;
+        }
+        skip_spaces(p.text,&p.pos);
+        if (p.pos >= p.text.size() || p.text[p.pos] != ')')
+        {
+            return syntax_error(p,"')'");
+        }
+        p.pos++;
+        *node = add_node(ALIGN,0,value,alignment);
+        return true;
+    }
+    if ((name == "ORIGIN" || name == "LENGTH") && p.pos < p.text.size() && p.text[p.pos] == '(')
+    {
+        // the linker script's ORIGIN(OCR_SHMEM) is looked up as the symbol "ORIGIN(OCR_SHMEM)"
+        p.pos++;
+        skip_spaces(p.text,&p.pos);
+        size_t region_start = p.pos;
+        while (p.pos < p.text.size() && is_name_char(p.text[p.pos]))
+        {
+            p.pos++;
+        }
+        if (p.pos == region_start)
+        {
+            return syntax_error(p,"a memory region");
+        }
+        std::string_view region = p.text.substr(region_start,p.pos-region_start);
+        skip_spaces(p.text,&p.pos);
+        if (p.pos >= p.text.size() || p.text[p.pos] != ')')
+        {
+            return syntax_error(p,"')'");
+        }
+        p.pos++;
+        names.push_back(std::string(name) + "(" + std::string(region) + ")");
+        *node = add_node(SYMBOL,names.size()-1,0,0);
+        return true;
+    }
+    names.push_back(std::string(name));
+    *node = add_node(SYMBOL,names.size()-1,0,0);
+    return true;
+}
+
+// number := 0x hex | decimal [K|KB|M|MB|G|GB]
+bool mpu_expression_t::parse_number( parser_t &p, uint32_t *node )
+{
+    uint64_t value = 0;
+    size_t start = p.pos;
+    if (p.text.substr(p.pos,2) == "0x")
+    {
+        p.pos += 2;
+        while (p.pos < p.text.size() && isxdigit((unsigned char)p.text[p.pos]))
+        {
+            char c = tolower(p.text[p.pos++]);
+            value = value*16 + (isdigit((unsigned char)c) ? c-'0' : c-'a'+10);
+        }
+        if (p.pos == start+2 || (p.pos < p.text.size() && is_name_char(p.text[p.pos])))
+        {
+            p.pos = start;
+            return syntax_error(p,"hex");
+        }
+    }
+    else
+    {
+        while (p.pos < p.text.size() && isdigit((unsigned char)p.text[p.pos]))
+        {
+            value = value*10 + (p.text[p.pos++]-'0');
+        }
+        size_t suffix = p.pos;
+        while (p.pos < p.text.size() && is_name_char(p.text[p.pos]))
+        {
+            p.pos++;
+        }
+        std::string_view unit = p.text.substr(suffix,p.pos-suffix);
+        if (unit == "G" || unit == "GB")
+        {
+            value *= 1024*1024*1024;
+        }
+        else if (unit == "M" || unit == "MB")
+        {
+            value *= 1024*1024;
+        }
+        else if (unit == "K" || unit == "KB")
+        {
+            value *= 1024;
+        }
+        else if (!unit.empty())
+        {
+            p.pos = start;
+            return syntax_error(p,"decimal");
+        }
+    }
+    *node = add_node(NUMBER,(uint32_t)value,0,0);
+    return true;
+}
+
+/**
+ * @brief
+ *   evaluate a compiled expression.
+ *
+ * const, so one compiled expression can be evaluated from several threads (e.g. mpu_batch_t's variants).
+ *
+ * @param symbols  may be NULL if the expression doesn't use any symbols
+ * @param error  set if it fails
+ * @return false if a symbol is unknown, on divide by zero or for a bad alignment
+ */
+bool mpu_expression_t::evaluate( const mpu_symbol_table_t *symbols, uint32_t *value, std::string *error ) const
+{
+    if (nodes.empty())
+    {
+        *error = "expression not compiled";
+        return false;
+    }
+    std::vector<uint32_t> values(nodes.size());
+    for (uint32_t i=0;i<nodes.size();i++)
+    {
+        const node_t &n = nodes[i];
+        uint32_t left = values[n.left];
+        uint32_t right = values[n.right];
+        switch (n.op)
+        {
+            case NUMBER:
+                values[i] = n.value;
+                break;
+            case SYMBOL:
+                if (symbols == NULL || !symbols->find(names[n.value],&values[i]))
+                {
+                    *error = "unknown symbol '" + names[n.value] + "'";
+                    return false;
+                }
+                break;
+            case ADD:
+                values[i] = left + right;
+                break;
+            case SUBTRACT:
+                values[i] = left - right;
+                break;
+            case MULTIPLY:
+                values[i] = left * right;
+                break;
+            case DIVIDE:
+                if (right == 0)
+                {
+                    *error = "divide by zero";
+                    return false;
+                }
+                values[i] = left / right;
+                break;
+            case NEGATE:
+                values[i] = -left;
+                break;
+            case ALIGN:
+                if (right == 0 || (right & (right-1)) != 0)
+                {
+                    char buffer[64];
+                    snprintf(buffer,sizeof(buffer),"ALIGN to 0x%x is not a power of 2",right);
+                    *error = buffer;
+                    return false;
+                }
+                values[i] = (left + right-1) & ~(right-1);
+                break;
+        }
+    }
+    *value = values[root];
+    return true;
+}
+
+/// the same, with the error in error
+bool mpu_expression_t::evaluate( const mpu_symbol_table_t *symbols, uint32_t *value )
+{
+    return evaluate(symbols,value,&error);
+}
+
+#endif
@@ -0,0 +1,90 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   address expressions in memory_map.yaml, e.g.
+*
+*      start_addr:  __logging_start__
+*      end_addr:    __data_start__ - 1
+*      size:        ALIGN(__bss_end__, 4K) - __bss_start__
+*
+* numbers are hex (0x...) or decimal with an optional K, KB, M, MB, G or GB suffix,
+* the operators are + - * / and ( ), ALIGN(value, alignment) rounds up to a power of 2.
+* ORIGIN(name) and LENGTH(name) are looked up as the symbols "ORIGIN(name)" and "LENGTH(name)"
+* (see linker_script_t).
+* arithmetic wraps at 32 bits the same as the literals always have (so 4G is 0).
+*/
+
+#ifndef MPU_EXPRESSION_H
+#define MPU_EXPRESSION_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// where expressions look up symbols (see elf_symbols_t and linker_script_t)
+class mpu_symbol_table_t {
+public:
+    virtual ~mpu_symbol_table_t() {}
+    virtual bool find( std::string_view name, uint32_t *value ) const = 0;
+    /// address and size of an output section (for 'section:' in memory_map.yaml), only an elf file has them
+    virtual bool find_section( std::string_view name __attribute__((unused)), uint32_t *addr __attribute__((unused)), uint32_t *size __attribute__((unused)) ) const { return false; }
+};
+
+/**
+ * an expression is compiled once to a flat list of nodes and can then be
+ * evaluated against any number of symbol tables.
+ *
+ * e.g.
+ *    mpu_expression_t expression;
+ *    uint32_t end_addr;
+ *    if (!expression.compile("__data_start__ - 1") || !expression.evaluate(symbols,&end_addr))
+ *        printf("%s\n",expression.error.c_str());
+ */
+class mpu_expression_t {
+public:
+    std::string error;
+
+    mpu_expression_t():error(),nodes(),names(),root(0){}
+
+    bool compile( std::string_view text );
+    bool evaluate( const mpu_symbol_table_t *symbols, uint32_t *value );
+    bool evaluate( const mpu_symbol_table_t *symbols, uint32_t *value, std::string *error ) const;
+    bool is_compiled() const { return !nodes.empty(); }
+    bool uses_symbols() const { return !names.empty(); }
+
+    /// true if the text is more than a single number or name (used to keep the old literal error messages)
+    static bool is_expression( std::string_view text );
+
+private:
+    enum op_t { NUMBER, SYMBOL, ADD, SUBTRACT, MULTIPLY, DIVIDE, NEGATE, ALIGN };
+    struct node_t {
+        op_t op;
+        uint32_t value;  ///< the number or the index in names[]
+        uint32_t left;
+        uint32_t right;
+    };
+    std::vector<node_t> nodes;
+    std::vector<std::string> names;
+    uint32_t root;
+
+    /// recursive descent parser state, only used by compile()
+    struct parser_t {
+        std::string_view text;
+        size_t pos;
+    };
+    uint32_t add_node( op_t op, uint32_t value, uint32_t left, uint32_t right );
+    bool parse_sum( parser_t &p, uint32_t *node );
+    bool parse_product( parser_t &p, uint32_t *node );
+    bool parse_unary( parser_t &p, uint32_t *node );
+    bool parse_primary( parser_t &p, uint32_t *node );
+    bool parse_number( parser_t &p, uint32_t *node );
+    bool syntax_error( parser_t &p, const char *expected );
+};
+
+#endif
+
+#endif
@@ -0,0 +1,433 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   statistics over the mpu snapshots collected from a fleet of devices (see mpu_fleet.h)
+*
+* analyze() runs in three passes:
+*   1. read and hash every snapshot (in parallel, this is the only pass that is per file)
+*   2. deduplicate the tables by hash
+*   3. flatten and compare each unique (build, table) pair with the shipped table (in parallel)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "mpu_fleet.h"
+#include "mpu_display.h"
+#include "mpu_diff.h"
+#include "mpu_table_reader.h"
+#include "parallel_for.h"
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+/// read an mpu table (memory_map.h, RBAR/RASR list or snapshot) and normalize it
+static bool read_table( const char *filename, mpu_fleet_t::table_t *table )
+{
+    mpu_display_t display;
+    if (!read_mpu_table(filename,&display))
+    {
+        return false;
+    }
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        table->regions[i] = mpu_verify_normalize(display.mpu_table[i].RBAR,display.mpu_table[i].RASR);
+    }
+    return true;
+}
+
+static uint32_t count_entries( const mpu_fleet_t::table_t &table )
+{
+    uint32_t count = 0;
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (table.regions[i].RASR & MPU_RASR_ENABLE_Msk)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief
+ *   add the snapshots in a directory tree (see mpu_fleet.h for the layout).
+ *
+ * @return false if the directory could not be read (an error message is printed)
+ */
+bool mpu_fleet_t::add_directory( const char *path )
+{
+    return scan_directory( path, "." );
+}
+
+bool mpu_fleet_t::scan_directory( const std::string &path, const std::string &name )
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+    {
+        printf("error opening directory '%s'\n",path.c_str());
+        return false;
+    }
+    std::vector<std::string> filenames;
+    std::vector<std::string> subdirectories;
+    bool have_shipped = false;
+    struct dirent *d;
+    while ((d = readdir(dir)) != NULL)
+    {
+        if (d->d_name[0] == '.')
+        {
+            continue;
+        }
+        std::string filename = path + "/" + d->d_name;
+        struct stat st;
+        if (stat(filename.c_str(),&st) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+        {
+            subdirectories.push_back(d->d_name);
+        }
+        else if (strcmp(d->d_name,"memory_map.h") == 0)
+        {
+            have_shipped = true;
+        }
+        else
+        {
+            filenames.push_back(d->d_name);
+        }
+    }
+    closedir(dir);
+    // readdir() order depends on the file system, sort so the report is repeatable
+    std::sort(filenames.begin(),filenames.end());
+    std::sort(subdirectories.begin(),subdirectories.end());
+
+    if (!filenames.empty())
+    {
+        build_t build;
+        build.name = name;
+        build.have_shipped = false;
+        build.shipped_entries = 0;
+        build.num_units = 0;
+        build.num_differ = 0;
+        if (have_shipped)
+        {
+            std::string shipped = path + "/memory_map.h";
+            if (!read_table(shipped.c_str(),&build.shipped))
+            {
+                return false;
+            }
+            build.have_shipped = true;
+            build.shipped_entries = count_entries(build.shipped);
+        }
+        uint32_t build_index = builds.size();
+        builds.push_back(build);
+        for (uint32_t i=0;i<filenames.size();i++)
+        {
+            unit_t unit;
+            unit.filename = path + "/" + filenames[i];
+            unit.build = build_index;
+            unit.ok = false;
+            unit.hash = 0;
+            memset(&unit.table,0,sizeof(unit.table));
+            unit.changed_regions = 0;
+            unit.unique_table = 0;
+            units.push_back(unit);
+        }
+    }
+
+    for (uint32_t i=0;i<subdirectories.size();i++)
+    {
+        std::string subdirectory_name = (name == ".") ? subdirectories[i] : name + "/" + subdirectories[i];
+        if (!scan_directory( path + "/" + subdirectories[i], subdirectory_name ))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// FNV-1a of the regions that are not masked
+uint64_t mpu_fleet_t::table_hash( const table_t &table ) const
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (verify_mask & (1UL << i))
+        {
+            continue;
+        }
+        const uint8_t *p = (const uint8_t *)&table.regions[i];
+        for (uint32_t j=0;j<sizeof(table.regions[i]);j++)
+        {
+            hash = (hash ^ p[j]) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+bool mpu_fleet_t::same_table( const table_t &a, const table_t &b ) const
+{
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (verify_mask & (1UL << i))
+        {
+            continue;
+        }
+        if (a.regions[i].RBAR != b.regions[i].RBAR || a.regions[i].RASR != b.regions[i].RASR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// pass 1: read one snapshot, hash it and record which regions differ from the shipped table
+void mpu_fleet_t::read_unit( unit_t *unit )
+{
+    unit->ok = read_table(unit->filename.c_str(),&unit->table);
+    if (!unit->ok)
+    {
+        return;
+    }
+    unit->hash = table_hash(unit->table);
+    const build_t &build = builds[unit->build];
+    if (build.have_shipped)
+    {
+        for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+        {
+            if (unit->table.regions[i].RBAR != build.shipped.regions[i].RBAR ||
+                unit->table.regions[i].RASR != build.shipped.regions[i].RASR)
+            {
+                unit->changed_regions |= 1UL << i;
+            }
+        }
+    }
+}
+
+/// pass 2: give every unit the index of its unique table and group the units by (build, table)
+void mpu_fleet_t::deduplicate()
+{
+    std::unordered_map<uint64_t,std::vector<uint32_t>> tables_by_hash;
+    std::map<std::pair<uint32_t,uint32_t>,uint32_t> group_index;
+    for (uint32_t u=0;u<units.size();u++)
+    {
+        unit_t *unit = &units[u];
+        if (!unit->ok)
+        {
+            num_unreadable++;
+            continue;
+        }
+        std::vector<uint32_t> &candidates = tables_by_hash[unit->hash];
+        uint32_t t = 0;
+        while (t < candidates.size() && !same_table(unique_tables[candidates[t]].table,unit->table))
+        {
+            t++;
+        }
+        if (t == candidates.size())
+        {
+            unique_table_t unique;
+            unique.table = unit->table;
+            // the masked regions are not part of the table
+            for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+            {
+                if (verify_mask & (1UL << i))
+                {
+                    unique.table.regions[i].RBAR = 0;
+                    unique.table.regions[i].RASR = 0;
+                }
+            }
+            unique.hash = unit->hash;
+            unique.num_entries = count_entries(unique.table);
+            candidates.push_back(unique_tables.size());
+            unique_tables.push_back(unique);
+        }
+        unit->unique_table = candidates[t];
+
+        group_index.insert(std::make_pair(std::make_pair(unit->build,unit->unique_table),0U));
+        for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+        {
+            if (unit->changed_regions & (1UL << i))
+            {
+                region_changes[i]++;
+            }
+        }
+    }
+    // std::map keeps the groups sorted by build then table
+    for (std::map<std::pair<uint32_t,uint32_t>,uint32_t>::iterator it = group_index.begin(); it != group_index.end(); ++it)
+    {
+        it->second = groups.size();
+        group_t group;
+        group.build = it->first.first;
+        group.unique_table = it->first.second;
+        group.num_units = 0;
+        group.differs = false;
+        groups.push_back(group);
+    }
+    for (uint32_t u=0;u<units.size();u++)
+    {
+        if (units[u].ok)
+        {
+            groups[group_index[std::pair<uint32_t,uint32_t>(units[u].build,units[u].unique_table)]].num_units++;
+        }
+    }
+}
+
+/// pass 3: flatten the table and the shipped table and describe the differences
+void mpu_fleet_t::compare_group( group_t *group )
+{
+    const build_t &build = builds[group->build];
+    const unique_table_t &unique = unique_tables[group->unique_table];
+    if (!build.have_shipped || same_table(build.shipped,unique.table))
+    {
+        return;
+    }
+    group->differs = true;
+    mpu_display_t shipped_display;
+    mpu_display_t unit_display;
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (verify_mask & (1UL << i))
+        {
+            continue;
+        }
+        shipped_display.set(i,ARM_MPU_RBAR(i,build.shipped.regions[i].RBAR),build.shipped.regions[i].RASR);
+        unit_display.set(i,ARM_MPU_RBAR(i,unique.table.regions[i].RBAR),unique.table.regions[i].RASR);
+    }
+    mpu_diff_t diff;
+    diff.compare(shipped_display,unit_display);
+    diff.print(group->diff,"    ");
+}
+
+/**
+ * @brief
+ *   read all of the snapshots added with add_directory() and calculate the statistics.
+ */
+void mpu_fleet_t::analyze()
+{
+    parallel_for( units.size(), num_threads, [this]( uint32_t i ) { read_unit(&units[i]); } );
+    deduplicate();
+    parallel_for( groups.size(), num_threads, [this]( uint32_t i ) { compare_group(&groups[i]); } );
+    for (uint32_t g=0;g<groups.size();g++)
+    {
+        builds[groups[g].build].num_units += groups[g].num_units;
+        if (groups[g].differs)
+        {
+            builds[groups[g].build].num_differ += groups[g].num_units;
+        }
+    }
+}
+
+/*
+ * e.g.
+ *
+ * snapshots: 5000, unreadable: 0, unique tables: 3
+ *
+ * build                units tables shipped running differ
+ * -------------------- ----- ------ ------- ------- ------
+ * v1.2.0                3000      2      11   11-12      2
+ * v1.3.0                2000      1      12      12      0
+ *
+ * v1.2.0: 2 units (e.g. fleet/v1.2.0/unit_0002.bin) run table 2 which differs from memory_map.h
+ *     entries: 11 -> 12 (+1)
+ *     ...
+ *
+ * region units reprogrammed
+ * ------ ----- ------------
+ *     15  4980 99.6%
+ *
+ * the entry counts do not include the masked regions (region 15 by default).
+ */
+void mpu_fleet_t::report( output_buffer_t &out )
+{
+    out.print("snapshots: %u, unreadable: %u, unique tables: %u\n\n",(uint32_t)units.size(),num_unreadable,(uint32_t)unique_tables.size());
+
+    out.print("build                units tables shipped running differ\n");
+    out.print("-------------------- ----- ------ ------- ------- ------\n");
+    for (uint32_t b=0;b<builds.size();b++)
+    {
+        const build_t &build = builds[b];
+        uint32_t num_tables = 0;
+        uint32_t min_entries = MPU_VERIFY_REGIONS;
+        uint32_t max_entries = 0;
+        for (uint32_t g=0;g<groups.size();g++)
+        {
+            if (groups[g].build == b)
+            {
+                uint32_t num_entries = unique_tables[groups[g].unique_table].num_entries;
+                num_tables++;
+                min_entries = std::min(min_entries,num_entries);
+                max_entries = std::max(max_entries,num_entries);
+            }
+        }
+        char shipped[10] = "-";
+        char running[20] = "-";
+        if (build.have_shipped)
+        {
+            snprintf(shipped,sizeof(shipped),"%u",build.shipped_entries);
+        }
+        if (num_tables != 0 && min_entries == max_entries)
+        {
+            snprintf(running,sizeof(running),"%u",min_entries);
+        }
+        else if (num_tables != 0)
+        {
+            snprintf(running,sizeof(running),"%u-%u",min_entries,max_entries);
+        }
+        out.print("%-20s %5u %6u %7s %7s %6u\n",build.name.c_str(),build.num_units,num_tables,shipped,running,build.num_differ);
+    }
+
+    for (uint32_t g=0;g<groups.size();g++)
+    {
+        const group_t &group = groups[g];
+        if (!group.differs)
+        {
+            continue;
+        }
+        const char *example = "";
+        for (uint32_t u=0;u<units.size();u++)
+        {
+            if (units[u].ok && units[u].build == group.build && units[u].unique_table == group.unique_table)
+            {
+                example = units[u].filename.c_str();
+                break;
+            }
+        }
+        out.print("\n%s: %u unit%s (e.g. %s) run table %u which differs from memory_map.h\n",
+            builds[group.build].name.c_str(),group.num_units,group.num_units == 1 ? "" : "s",example,group.unique_table);
+        out.append(group.diff.data(),group.diff.size());
+    }
+
+    uint32_t num_compared = 0;
+    for (uint32_t b=0;b<builds.size();b++)
+    {
+        if (builds[b].have_shipped)
+        {
+            num_compared += builds[b].num_units;
+        }
+    }
+    std::vector<uint32_t> regions;
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (region_changes[i] != 0)
+        {
+            regions.push_back(i);
+        }
+    }
+    if (regions.empty())
+    {
+        return;
+    }
+    std::stable_sort(regions.begin(),regions.end(),[this]( uint32_t a, uint32_t b ) { return region_changes[a] > region_changes[b]; });
+    out.print("\nregion units reprogrammed\n");
+    out.print("------ ----- ------------\n");
+    for (uint32_t i=0;i<regions.size();i++)
+    {
+        uint32_t r = regions[i];
+        out.print("%6u %5u %.1f%%\n",r,region_changes[r],100.0*region_changes[r]/num_compared);
+    }
+}
+
+#endif
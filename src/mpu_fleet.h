@@ -0,0 +1,102 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   statistics over the mpu snapshots collected from a fleet of devices
+*
+* the snapshots are found by scanning a directory tree, the memory_map.h in a directory is the
+* table that was shipped with the build the devices in that directory are running, e.g.
+*
+*    fleet/v1.2.0/memory_map.h
+*    fleet/v1.2.0/unit_0001.bin
+*    fleet/v1.2.0/unit_0002.bin
+*    fleet/v1.3.0/memory_map.h
+*    fleet/v1.3.0/unit_0003.bin
+*
+* most devices run identical tables, so the snapshots are hashed and only the unique
+* (build, table) pairs are flattened and compared.
+*/
+
+#ifndef MPU_FLEET_H
+#define MPU_FLEET_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "mpu_armv7.h"
+#include "mpu_verify.h"
+#include "output_buffer.h"
+
+class mpu_fleet_t {
+public:
+    /// a table read from a snapshot or memory_map.h (see mpu_verify_normalize())
+    struct table_t {
+        ARM_MPU_Region_t regions[MPU_VERIFY_REGIONS];
+    };
+
+    /// one directory, i.e. one firmware build
+    struct build_t {
+        std::string name;
+        bool have_shipped;
+        table_t shipped;
+        uint32_t shipped_entries;
+        uint32_t num_units;
+        uint32_t num_differ;
+    };
+
+    /// one snapshot file
+    struct unit_t {
+        std::string filename;
+        uint32_t build;
+        bool ok;
+        uint64_t hash;
+        table_t table;
+        uint32_t changed_regions; ///< bitmask of regions that differ from the shipped table
+        uint32_t unique_table;
+    };
+
+    /// a distinct table (masked regions are ignored when deciding if two tables are the same)
+    struct unique_table_t {
+        table_t table;
+        uint64_t hash;
+        uint32_t num_entries;
+    };
+
+    /// the units of one build that run one unique table
+    struct group_t {
+        uint32_t build;
+        uint32_t unique_table;
+        uint32_t num_units;
+        bool differs;
+        output_buffer_t diff;
+    };
+
+    uint32_t verify_mask;
+    uint32_t num_threads;
+    std::vector<build_t> builds;
+    std::vector<unit_t> units;
+    std::vector<unique_table_t> unique_tables;
+    std::vector<group_t> groups;
+    uint32_t num_unreadable;
+    uint32_t region_changes[MPU_VERIFY_REGIONS];
+
+    mpu_fleet_t():verify_mask(MPU_VERIFY_DEFAULT_MASK),num_threads(1),builds(),units(),unique_tables(),groups(),num_unreadable(),region_changes(){}
+
+    bool add_directory( const char *path );
+    void analyze();
+    void report( output_buffer_t &out );
+
+private:
+    bool scan_directory( const std::string &path, const std::string &name );
+    void read_unit( unit_t *unit );
+    void deduplicate();
+    void compare_group( group_t *group );
+    uint64_t table_hash( const table_t &table ) const;
+    bool same_table( const table_t &a, const table_t &b ) const;
+};
+
+#endif
+
+#endif
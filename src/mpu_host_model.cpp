@@ -0,0 +1,200 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   simulated MPU and SCB registers (see mpu_host_model.h)
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "mpu_host_model.h"
+#include "mpu_region_fit.h"
+#include <string.h>
+
+mpu_host_model_t mpu_host;
+
+/// the state after a reset: mpu disabled, every region cleared, interrupts enabled
+void mpu_host_model_t::reset()
+{
+    CTRL = 0;
+    RNR = 0;
+    memset(regions,0,sizeof(regions));
+    SHCSR = 0;
+    CACR = 0;
+    primask = 0;
+    reset_counters();
+}
+
+void mpu_host_model_t::reset_counters()
+{
+    memset(reads,0,sizeof(reads));
+    memset(writes,0,sizeof(writes));
+    num_dmb = 0;
+    num_dsb = 0;
+    num_isb = 0;
+    num_interrupt_disables = 0;
+    num_dcache_cleans = 0;
+    dcache_clean_bytes = 0;
+    num_dcache_invalidates = 0;
+    dcache_invalidate_bytes = 0;
+    num_dcache_clean_invalidates = 0;
+    dcache_clean_invalidate_bytes = 0;
+    num_dcache_whole = 0;
+    masked_accesses = 0;
+    masked_barriers = 0;
+    max_masked_accesses = 0;
+    max_masked_barriers = 0;
+}
+
+/// a window starts when interrupts are disabled, and is measured when they're enabled again
+void mpu_host_model_t::set_primask( uint32_t value )
+{
+    if (primask == 0 && value != 0)
+    {
+        masked_accesses = 0;
+        masked_barriers = 0;
+    }
+    if (primask != 0 && value == 0)
+    {
+        max_masked_accesses = masked_accesses > max_masked_accesses ? masked_accesses : max_masked_accesses;
+        max_masked_barriers = masked_barriers > max_masked_barriers ? masked_barriers : max_masked_barriers;
+    }
+    primask = value;
+}
+
+uint32_t mpu_host_model_t::read( mpu_host_register_id_t id )
+{
+    reads[id]++;
+    masked_accesses += primask != 0;
+    switch (id)
+    {
+        case MPU_HOST_TYPE:
+            return MPU_HOST_REGIONS << MPU_TYPE_DREGION_Pos;
+        case MPU_HOST_CTRL:
+            return CTRL;
+        case MPU_HOST_RNR:
+            return RNR;
+        case MPU_HOST_RBAR:
+        case MPU_HOST_RBAR_A1:
+        case MPU_HOST_RBAR_A2:
+        case MPU_HOST_RBAR_A3:
+            return region(RNR).RBAR;
+        case MPU_HOST_RASR:
+        case MPU_HOST_RASR_A1:
+        case MPU_HOST_RASR_A2:
+        case MPU_HOST_RASR_A3:
+            return region(RNR).RASR;
+        case MPU_HOST_SCB_SHCSR:
+            return SHCSR;
+        case MPU_HOST_SCB_CACR:
+            return CACR;
+        default:
+            return 0;
+    }
+}
+
+void mpu_host_model_t::write( mpu_host_register_id_t id, uint32_t value )
+{
+    writes[id]++;
+    masked_accesses += primask != 0;
+    switch (id)
+    {
+        case MPU_HOST_CTRL:
+            CTRL = value & (MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_HFNMIENA_Msk | MPU_CTRL_ENABLE_Msk);
+            break;
+        case MPU_HOST_RNR:
+            RNR = value & MPU_RNR_REGION_Msk;
+            break;
+        case MPU_HOST_RBAR:
+        case MPU_HOST_RBAR_A1:
+        case MPU_HOST_RBAR_A2:
+        case MPU_HOST_RBAR_A3:
+            if (value & MPU_RBAR_VALID_Msk)
+            {
+                RNR = value & MPU_RBAR_REGION_Msk;
+            }
+            regions[RNR % MPU_HOST_REGIONS].RBAR = value & MPU_RBAR_ADDR_Msk;
+            break;
+        case MPU_HOST_RASR:
+        case MPU_HOST_RASR_A1:
+        case MPU_HOST_RASR_A2:
+        case MPU_HOST_RASR_A3:
+            regions[RNR % MPU_HOST_REGIONS].RASR = value;
+            break;
+        case MPU_HOST_SCB_SHCSR:
+            SHCSR = value;
+            break;
+        case MPU_HOST_SCB_CACR:
+            CACR = value;
+            break;
+        default:
+            // TYPE is read only
+            break;
+    }
+}
+
+uint32_t mpu_host_model_t::mpu_writes() const
+{
+    uint32_t n = 0;
+    for (uint32_t i=MPU_HOST_TYPE;i<=MPU_HOST_RASR_A3;i++)
+    {
+        n += writes[i];
+    }
+    return n;
+}
+
+uint32_t mpu_host_model_t::mpu_reads() const
+{
+    uint32_t n = 0;
+    for (uint32_t i=MPU_HOST_TYPE;i<=MPU_HOST_RASR_A3;i++)
+    {
+        n += reads[i];
+    }
+    return n;
+}
+
+ARM_MPU_Region_t mpu_host_model_t::region( uint32_t i ) const
+{
+    ARM_MPU_Region_t r;
+    r.RBAR = regions[i % MPU_HOST_REGIONS].RBAR | (i & MPU_RBAR_REGION_Msk);
+    r.RASR = regions[i % MPU_HOST_REGIONS].RASR;
+    return r;
+}
+
+/*
+ * the highest numbered region that covers addr decides, like the mpu. AP is the only
+ * permission looked at, so this is a privileged read: ARM_MPU_AP_NONE faults and the rest don't.
+ */
+bool mpu_host_model_t::accessible( uint32_t addr ) const
+{
+    if ((CTRL & MPU_CTRL_ENABLE_Msk) == 0)
+    {
+        return true;
+    }
+    for (uint32_t i=MPU_HOST_REGIONS;i-- > 0;)
+    {
+        if (mpu_region_contains(regions[i],addr))
+        {
+            return ((regions[i].RASR & MPU_RASR_AP_Msk) >> MPU_RASR_AP_Pos) != ARM_MPU_AP_NONE;
+        }
+    }
+    return (CTRL & MPU_CTRL_PRIVDEFENA_Msk) != 0;
+}
+
+bool mpu_host_model_t::writable( uint32_t addr ) const
+{
+    if ((CTRL & MPU_CTRL_ENABLE_Msk) == 0)
+    {
+        return true;
+    }
+    for (uint32_t i=MPU_HOST_REGIONS;i-- > 0;)
+    {
+        if (mpu_region_contains(regions[i],addr))
+        {
+            uint32_t AP = (regions[i].RASR & MPU_RASR_AP_Msk) >> MPU_RASR_AP_Pos;
+            return AP == ARM_MPU_AP_PRIV || AP == ARM_MPU_AP_URO || AP == ARM_MPU_AP_FULL;
+        }
+    }
+    return (CTRL & MPU_CTRL_PRIVDEFENA_Msk) != 0;
+}
+
+#endif
@@ -0,0 +1,280 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   simulated MPU and SCB registers so configure_mpu.cpp runs on the host
+*
+* on the target MPU and SCB point at the core's registers. on the host configure_mpu.cpp
+* includes this file instead of cpu_m7.h, and MPU->RBAR etc. are a register file that
+* behaves like the ARMv7-M MPU:
+*
+*   - writing RBAR with VALID set also writes RNR (that is how ARM_MPU_Load() works)
+*   - reading RBAR returns the address and the current region number (VALID reads as 0)
+*   - RBAR_A1..A3 and RASR_A1..A3 are aliases of RBAR and RASR
+*
+* every register access and barrier is counted, so a unit test can check how much register
+* traffic a function does as well as what it leaves in the mpu, e.g.
+*
+*    mpu_host.reset();
+*    Configure_MPU();
+*    EXPECT_TRUE(mpu_verify());
+*    printf("%u writes %u barriers\n",mpu_host.mpu_writes(),mpu_host.barriers());
+*/
+
+#ifndef MPU_HOST_MODEL_H
+#define MPU_HOST_MODEL_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <time.h>
+#include "mpu_armv7.h"
+
+#define MPU_HOST_REGIONS 16
+
+// from core_cm7.h (which can't be used on the host)
+#define MPU_TYPE_RALIASES                  4U
+#define SCB_SHCSR_MEMFAULTENA_Pos          16U
+#define SCB_SHCSR_MEMFAULTENA_Msk          (1UL << SCB_SHCSR_MEMFAULTENA_Pos)
+#define SCB_CACR_SIWT_Pos                   0U
+#define SCB_CACR_SIWT_Msk                  (1UL /*<< SCB_CACR_SIWT_Pos*/)
+
+/// the simulated registers, in the same order as MPU_Type and then the SCB ones
+enum mpu_host_register_id_t {
+    MPU_HOST_TYPE,
+    MPU_HOST_CTRL,
+    MPU_HOST_RNR,
+    MPU_HOST_RBAR,
+    MPU_HOST_RASR,
+    MPU_HOST_RBAR_A1,
+    MPU_HOST_RASR_A1,
+    MPU_HOST_RBAR_A2,
+    MPU_HOST_RASR_A2,
+    MPU_HOST_RBAR_A3,
+    MPU_HOST_RASR_A3,
+    MPU_HOST_SCB_SHCSR,
+    MPU_HOST_SCB_CACR,
+    MPU_HOST_NUM_REGISTERS
+};
+
+/// one register, reads and writes go to mpu_host
+class mpu_host_register_t {
+public:
+    explicit mpu_host_register_t( mpu_host_register_id_t id_ ):id(id_){}
+    inline operator uint32_t() const;
+    inline mpu_host_register_t &operator=( uint32_t value );
+    mpu_host_register_t &operator|=( uint32_t value ) { return *this = *this | value; }
+    mpu_host_register_t &operator&=( uint32_t value ) { return *this = *this & value; }
+private:
+    mpu_host_register_id_t id;
+};
+
+/// what MPU points to
+struct mpu_host_mpu_t {
+    mpu_host_register_t TYPE{MPU_HOST_TYPE};
+    mpu_host_register_t CTRL{MPU_HOST_CTRL};
+    mpu_host_register_t RNR{MPU_HOST_RNR};
+    mpu_host_register_t RBAR{MPU_HOST_RBAR};
+    mpu_host_register_t RASR{MPU_HOST_RASR};
+    mpu_host_register_t RBAR_A1{MPU_HOST_RBAR_A1};
+    mpu_host_register_t RASR_A1{MPU_HOST_RASR_A1};
+    mpu_host_register_t RBAR_A2{MPU_HOST_RBAR_A2};
+    mpu_host_register_t RASR_A2{MPU_HOST_RASR_A2};
+    mpu_host_register_t RBAR_A3{MPU_HOST_RBAR_A3};
+    mpu_host_register_t RASR_A3{MPU_HOST_RASR_A3};
+};
+
+/// what SCB points to (only the registers configure_mpu.cpp uses)
+struct mpu_host_scb_t {
+    mpu_host_register_t SHCSR{MPU_HOST_SCB_SHCSR};
+    mpu_host_register_t CACR{MPU_HOST_SCB_CACR};
+};
+
+class mpu_host_model_t {
+public:
+    // the state of the registers
+    uint32_t CTRL;
+    uint32_t RNR;
+    ARM_MPU_Region_t regions[MPU_HOST_REGIONS]; ///< RBAR is only the address (what was written without VALID and REGION)
+    uint32_t SHCSR;
+    uint32_t CACR;
+    uint32_t primask;
+
+    // counters since reset()
+    uint32_t reads[MPU_HOST_NUM_REGISTERS];
+    uint32_t writes[MPU_HOST_NUM_REGISTERS];
+    uint32_t num_dmb;
+    uint32_t num_dsb;
+    uint32_t num_isb;
+    uint32_t num_interrupt_disables;
+    uint32_t num_dcache_cleans;
+    uint32_t dcache_clean_bytes;
+    uint32_t num_dcache_invalidates;
+    uint32_t dcache_invalidate_bytes;
+    uint32_t num_dcache_clean_invalidates;
+    uint32_t dcache_clean_invalidate_bytes;
+    uint32_t num_dcache_whole;              ///< SCB_CleanDCache() and SCB_CleanInvalidateDCache()
+    // what's done with interrupts disabled: register accesses (and other work, see work()) and barriers
+    // in the current window, and the most in one window, the latency bound (e.g. mpu_region_store() is
+    // 2 accesses and no barriers)
+    uint32_t masked_accesses;
+    uint32_t masked_barriers;
+    uint32_t max_masked_accesses;
+    uint32_t max_masked_barriers;
+
+    mpu_host_mpu_t mpu;
+    mpu_host_scb_t scb;
+
+    mpu_host_model_t() { reset(); }
+    void reset();
+    void reset_counters();
+    uint32_t read( mpu_host_register_id_t id );
+    void write( mpu_host_register_id_t id, uint32_t value );
+
+    /// accesses to MPU->... (not SCB)
+    uint32_t mpu_writes() const;
+    uint32_t mpu_reads() const;
+    uint32_t barriers() const { return num_dmb + num_dsb + num_isb; }
+    /// what a region reads back as, the same as MPU->RNR = i; MPU->RBAR, MPU->RASR but not counted
+    ARM_MPU_Region_t region( uint32_t i ) const;
+    /// false if a privileged read of addr would fault with the regions as they are now
+    bool accessible( uint32_t addr ) const;
+    /// false if a privileged write to addr would fault
+    bool writable( uint32_t addr ) const;
+    void set_primask( uint32_t value );
+    void barrier() { masked_barriers += primask != 0; }
+    /// memory accesses other code does, counted in the window if interrupts are disabled
+    /// (the cycle counter reads that time the window aren't counted)
+    void work( uint32_t accesses ) { masked_accesses += primask != 0 ? accesses : 0; }
+};
+
+extern mpu_host_model_t mpu_host;
+
+#define MPU (&mpu_host.mpu)
+#define SCB (&mpu_host.scb)
+
+mpu_host_register_t::operator uint32_t() const
+{
+    return mpu_host.read(id);
+}
+
+mpu_host_register_t &mpu_host_register_t::operator=( uint32_t value )
+{
+    mpu_host.write(id,value);
+    return *this;
+}
+
+// the intrinsics from cmsis_gcc.h and cachel1_armv7.h
+static inline void __DMB() { mpu_host.num_dmb++; mpu_host.barrier(); }
+static inline void __DSB() { mpu_host.num_dsb++; mpu_host.barrier(); }
+static inline void __ISB() { mpu_host.num_isb++; mpu_host.barrier(); }
+static inline uint32_t __get_PRIMASK() { return mpu_host.primask; }
+static inline void __set_PRIMASK( uint32_t primask ) { mpu_host.set_primask(primask); }
+static inline void SCB_CleanDCache_by_Addr( volatile void *addr __attribute__((unused)), int32_t dsize )
+{
+    mpu_host.num_dcache_cleans++;
+    mpu_host.dcache_clean_bytes += dsize;
+}
+static inline void SCB_InvalidateDCache_by_Addr( void *addr __attribute__((unused)), int32_t dsize )
+{
+    mpu_host.num_dcache_invalidates++;
+    mpu_host.dcache_invalidate_bytes += dsize;
+}
+static inline void SCB_CleanInvalidateDCache_by_Addr( uint32_t *addr __attribute__((unused)), int32_t dsize )
+{
+    mpu_host.num_dcache_clean_invalidates++;
+    mpu_host.dcache_clean_invalidate_bytes += dsize;
+}
+static inline void SCB_CleanDCache() { mpu_host.num_dcache_whole++; }
+static inline void SCB_CleanInvalidateDCache() { mpu_host.num_dcache_whole++; }
+
+/// what DWT->CYCCNT is on the target, here nanoseconds
+static inline uint32_t mpu_host_cycles()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+/// same as the one in atomic_intrinsics.h (which uses ldrex/strex)
+static inline uint32_t atomic_cmpxchg( volatile uint32_t *ptr, uint32_t old_val, uint32_t new_val )
+{
+    __atomic_compare_exchange_n(ptr,&old_val,new_val,false,__ATOMIC_SEQ_CST,__ATOMIC_SEQ_CST);
+    return old_val;
+}
+
+/// same as the one in cpu_m7.h
+class cpu_interrupt_disable_guard {
+public:
+    cpu_interrupt_disable_guard():primask(__get_PRIMASK()) { __set_PRIMASK(1); mpu_host.num_interrupt_disables++; }
+    ~cpu_interrupt_disable_guard() { __set_PRIMASK(primask); }
+private:
+    uint32_t primask;
+};
+#define cpu_interrupt_disable_guard(x) cpu_interrupt_disable_guard needs to be used with a variable name!?!?!
+
+// the functions mpu_armv7.h only has on the target, doing the same register accesses
+static inline void ARM_MPU_Enable( uint32_t MPU_Control )
+{
+    __DMB();
+    MPU->CTRL = MPU_Control | MPU_CTRL_ENABLE_Msk;
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+    __DSB();
+    __ISB();
+}
+
+static inline void ARM_MPU_Disable()
+{
+    __DMB();
+    SCB->SHCSR &= (uint32_t)~SCB_SHCSR_MEMFAULTENA_Msk;
+    MPU->CTRL &= (uint32_t)~MPU_CTRL_ENABLE_Msk;
+    __DSB();
+    __ISB();
+}
+
+static inline void ARM_MPU_ClrRegion( uint32_t rnr )
+{
+    MPU->RNR = rnr;
+    MPU->RASR = 0U;
+}
+
+static inline void ARM_MPU_SetRegion( uint32_t rbar, uint32_t rasr )
+{
+    MPU->RBAR = rbar;
+    MPU->RASR = rasr;
+}
+
+static inline void ARM_MPU_SetRegionEx( uint32_t rnr, uint32_t rbar, uint32_t rasr )
+{
+    MPU->RNR = rnr;
+    MPU->RBAR = rbar;
+    MPU->RASR = rasr;
+}
+
+/// ARM_MPU_OrderedMemcpy() from &MPU->RBAR, so up to 4 regions go through RBAR..RASR_A3
+static inline void ARM_MPU_Load( ARM_MPU_Region_t const *table, uint32_t cnt )
+{
+    const uint32_t *src = &table->RBAR;
+    const uint32_t burst = MPU_TYPE_RALIASES*2;
+    for (uint32_t i=0;i<cnt*2;i++)
+    {
+        mpu_host.write((mpu_host_register_id_t)(MPU_HOST_RBAR + i % burst),src[i]);
+    }
+}
+
+// the parts of the FreeRTOS mpu port used by the stack guard in configure_mpu.cpp
+#ifndef configUSE_MPU_THREAD_STACK_GUARD
+#define configUSE_MPU_THREAD_STACK_GUARD 1
+#define STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES 256
+typedef uint32_t StackType_t;
+typedef struct {
+    ARM_MPU_Region_t MPU_thread_guard[1];
+    const char *task_name;
+} MPUThreadStackGuard_t;
+void MPUThreadGuard_log( MPUThreadStackGuard_t *xThreadGuard );
+void MPUThreadGuard_calculate( MPUThreadStackGuard_t *xThreadGuard, StackType_t *pxStack, const char *task_name );
+#endif
+
+#endif
+
+#endif
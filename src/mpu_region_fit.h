@@ -0,0 +1,164 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   the best single mpu entry for an address range, without running mpu_calculator_t
+*
+* mpu_calculator_t covers a range exactly with as many entries as it takes. a driver that
+* reprograms one region per transfer only has one entry, so it wants the closest one and to
+* know how far off it is:
+*
+*   - mpu_region_cover()  the smallest entry that covers the whole range (over = bytes outside it)
+*   - mpu_region_inside() the largest entry that doesn't go outside the range (under = bytes left out)
+*   - mpu_region_contains() whether an entry covers an address, the other way round
+*
+* both are a fixed number of steps with no logging, and constexpr, so a fixed range folds to a
+* constant, e.g.
+*
+*    constexpr mpu_region_fit_t fit = mpu_region_cover( 0, 0x20040100, 0x1000, NEVER_EXECUTE, ARM_MPU_AP_FULL, NORMAL_UNCACHED );
+*    static_assert( fit.over == 0x400, "" );
+*/
+
+#ifndef MPU_REGION_FIT_H
+#define MPU_REGION_FIT_H
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+
+struct mpu_region_fit_t {
+    ARM_MPU_Region_t entry; ///< RASR is 0 (disabled) if nothing fits
+    uint32_t start;         ///< first address the entry covers
+    uint64_t end;           ///< one past the last address it covers (can be 4G)
+    uint32_t over;          ///< bytes it covers outside the range
+    uint32_t under;         ///< bytes of the range it doesn't cover
+};
+
+/// the entry for the subregions of the 2^log2_size block at block_start that cover [start,end)
+constexpr mpu_region_fit_t mpu_region_fit_entry( uint32_t region, uint32_t log2_size, uint32_t block_start, uint64_t start, uint64_t end,
+                                                 uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes )
+{
+    // regions under 256 bytes have no subregions, then start and end are the whole block
+    uint32_t sub_shift = log2_size >= 8 ? log2_size-3 : log2_size;
+    uint32_t first = (uint32_t)((start - block_start) >> sub_shift);
+    uint32_t last = (uint32_t)((end - 1 - block_start) >> sub_shift);
+    uint32_t enabled = (2U << last) - (1U << first);
+    uint32_t SRD = log2_size >= 8 ? ~enabled & 0xff : 0;
+
+    mpu_region_fit_t fit{};
+    fit.entry.RBAR = ARM_MPU_RBAR( region, block_start );
+    fit.entry.RASR = ARM_MPU_RASR_EX( DisableExec, AccessPermission, AccessAttributes, SRD, log2_size-1 );
+    fit.start = block_start + (first << sub_shift);
+    fit.end = (uint64_t)block_start + ((uint64_t)(last+1) << sub_shift);
+    return fit;
+}
+
+/**
+ * @brief
+ *   the smallest single entry that covers [base_address,base_address+size_in_bytes)
+ *
+ * the smallest naturally aligned block holding the whole range, with the subregions outside it disabled.
+ *
+ * @return the entry and how many bytes it covers outside the range (under is always 0)
+ */
+constexpr mpu_region_fit_t mpu_region_cover( uint32_t region, uint32_t base_address, uint32_t size_in_bytes,
+                                             uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes )
+{
+    if (size_in_bytes == 0)
+    {
+        return mpu_region_fit_t{};
+    }
+    uint64_t end = (uint64_t)base_address + size_in_bytes;
+    end = end > 0x100000000ULL ? 0x100000000ULL : end;
+    uint32_t last = (uint32_t)(end - 1);
+    // the highest bit where the first and last address differ, at least 256 bytes:
+    // a 32-128 byte block is also whole 32 byte subregions of a 256 byte one, which can cover less
+    uint32_t log2_size = 32 - __builtin_clz( (base_address ^ last) | 255 );
+    uint32_t block_start = log2_size == 32 ? 0 : base_address & ~((1U << log2_size) - 1);
+    mpu_region_fit_t fit = mpu_region_fit_entry( region, log2_size, block_start, base_address, end, DisableExec, AccessPermission, AccessAttributes );
+    fit.over = (uint32_t)((fit.end - fit.start) - (end - base_address));
+    return fit;
+}
+
+/**
+ * @brief
+ *   the largest single entry inside [base_address,base_address+size_in_bytes)
+ *
+ * for a range of size 2^m only blocks of 2^(m-1) .. 2^(m+3) can be best: a smaller block covers less
+ * than the 2^(m-1) block the range always holds, and a bigger one's subregions are bigger than the range.
+ * so this tries 5 sizes, and for each the run of whole subregions at the start or the end of the range
+ * (or a whole block in the middle).
+ *
+ * @return the entry and how many bytes of the range it leaves out (over is always 0), RASR is 0 if the range holds no 32 byte block
+ */
+constexpr mpu_region_fit_t mpu_region_inside( uint32_t region, uint32_t base_address, uint32_t size_in_bytes,
+                                              uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes )
+{
+    uint64_t end = (uint64_t)base_address + size_in_bytes;
+    end = end > 0x100000000ULL ? 0x100000000ULL : end;
+    uint32_t m = 31 - __builtin_clz( (uint32_t)(end - base_address) | 1 );
+
+    uint64_t best_start = 0;
+    uint64_t best_end = 0;
+    uint32_t best_log2 = 5;
+    for (uint32_t k = m < 6 ? 5 : m-1; k <= m+3 && k <= 32; k++)
+    {
+        uint64_t block = 1ULL << k;
+        uint64_t sub = k >= 8 ? block >> 3 : block;
+        uint64_t A = ((uint64_t)base_address + sub-1) & ~(sub-1);
+        uint64_t B = end & ~(sub-1);
+        if (B <= A)
+        {
+            continue;
+        }
+        // the part in A's block, the part in the block of the last byte, or a whole block in between
+        uint64_t block_A = A & ~(block-1);
+        uint64_t block_B = (B-1) & ~(block-1);
+        uint64_t start = A;
+        uint64_t stop = B < block_A + block ? B : block_A + block;
+        if (B - block_B > stop - start)
+        {
+            start = block_B > A ? block_B : A;
+            stop = B;
+        }
+        if (block_B >= block_A + 2*block && block > stop - start)
+        {
+            start = block_A + block;
+            stop = start + block;
+        }
+        if (stop - start > best_end - best_start)
+        {
+            best_start = start;
+            best_end = stop;
+            best_log2 = k;
+        }
+    }
+
+    mpu_region_fit_t fit{};
+    if (best_end != best_start)
+    {
+        uint32_t block_start = best_log2 == 32 ? 0 : (uint32_t)best_start & ~((1U << best_log2) - 1);
+        fit = mpu_region_fit_entry( region, best_log2, block_start, best_start, best_end, DisableExec, AccessPermission, AccessAttributes );
+    }
+    fit.under = (uint32_t)((end - base_address) - (fit.end - fit.start));
+    return fit;
+}
+
+/// true if the entry is enabled and addr is in one of its enabled subregions
+constexpr bool mpu_region_contains( const ARM_MPU_Region_t &region, uint32_t addr )
+{
+    if ((region.RASR & MPU_RASR_ENABLE_Msk) == 0)
+    {
+        return false;
+    }
+    uint32_t log2_size = ((region.RASR & MPU_RASR_SIZE_Msk) >> MPU_RASR_SIZE_Pos) + 1;
+    uint32_t base = log2_size >= 32 ? 0 : region.RBAR & MPU_RBAR_ADDR_Msk & ~((1UL << log2_size) - 1);
+    uint64_t offset = (uint64_t)addr - base;
+    if (offset >> log2_size)
+    {
+        return false;
+    }
+    uint32_t SRD = (region.RASR & MPU_RASR_SRD_Msk) >> MPU_RASR_SRD_Pos;
+    return log2_size < 8 || (SRD & (1U << (offset >> (log2_size-3)))) == 0;
+}
+
+#endif
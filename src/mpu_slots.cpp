@@ -0,0 +1,115 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   the pool of free mpu regions and scoped_mpu_region (see mpu_slots.h)
+*/
+#ifdef MDX2_FREERTOS_TARGET
+#include "cpu_m7.h"
+#include "mpu_armv7.h"
+#include "atomic_intrinsics.h"
+#else
+#include "mpu_host_model.h"
+#endif
+#include "configure_mpu.h"
+#include "mpu_slots.h"
+#include "mpu_stats.h"
+
+volatile uint32_t mpuSlotsFree = 0;
+
+/**
+ * @brief
+ *   the regions that can be handed out at run time
+ *
+ * @param[in] table - mpuTable
+ * @param[in] table_size - MPU_TABLE_SIZE
+ * @param[in] verify_mask - mpuTableVerify.mask, regions outside it are checked by mpu_verify() so can't change
+ * @param[in] reserved - regions that are reprogrammed by something else (the task regions, the stack guard)
+ *
+ * @return bit i set if region i can be used
+ */
+uint32_t mpu_slots_pool( const ARM_MPU_Region_t *table, uint32_t table_size, uint32_t verify_mask, uint32_t reserved )
+{
+    uint32_t pool = verify_mask & ~reserved & 0xffff;
+    for (uint32_t i=0;i<table_size && i<16;i++)
+    {
+        if (table[i].RASR & MPU_RASR_ENABLE_Msk)
+        {
+            pool &= ~(1UL << i);
+        }
+    }
+    return pool;
+}
+
+/// called from Configure_MPU(), when no slot is in use
+void mpu_slots_init( uint32_t pool )
+{
+    mpuSlotsFree = pool;
+}
+
+/**
+ * @brief
+ *   take a free region. the highest numbered one is taken, so it takes priority over mpuTable where they overlap.
+ *
+ * @return the region number, -1 if there is none free
+ */
+int32_t mpu_slot_alloc()
+{
+    uint32_t free = mpuSlotsFree;
+    while (free != 0)
+    {
+        uint32_t region = 31 - __builtin_clz(free);
+        uint32_t previous = atomic_cmpxchg(&mpuSlotsFree,free,free & ~(1UL << region));
+        if (previous == free)
+        {
+            return (int32_t)region;
+        }
+        // someone else took or returned a slot, try again with what's free now
+        free = previous;
+    }
+    return -1;
+}
+
+/// return a region taken with mpu_slot_alloc()
+void mpu_slot_free( uint32_t region )
+{
+    uint32_t free = mpuSlotsFree;
+    while (1)
+    {
+        uint32_t previous = atomic_cmpxchg(&mpuSlotsFree,free,free | (1UL << region));
+        if (previous == free)
+        {
+            return;
+        }
+        free = previous;
+    }
+}
+
+/// write RBAR/RASR of a region without going through RNR, interrupts are only disabled for the two stores
+static void mpu_slot_write( uint32_t region, uint32_t RBAR, uint32_t RASR )
+{
+    mpu_stats_timer timer(MPU_STATS_SCOPED_REGION);
+    __DMB();
+    mpu_region_store(region, RBAR, RASR);
+    __DSB();
+    __ISB();
+}
+
+scoped_mpu_region::scoped_mpu_region( uint32_t RBAR_, uint32_t RASR ):RBAR(RBAR_),region(mpu_slot_alloc())
+{
+    if (region >= 0)
+    {
+        mpu_slot_write((uint32_t)region,RBAR,RASR);
+    }
+}
+
+/// the slots in the pool are disabled when they're free, so that's what's restored.
+/// RBAR is written back unchanged, so only the RASR store changes the mapping.
+scoped_mpu_region::~scoped_mpu_region()
+{
+    if (region >= 0)
+    {
+        mpu_slot_write((uint32_t)region,RBAR,0);
+        mpu_slot_free((uint32_t)region);
+    }
+}
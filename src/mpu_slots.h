@@ -0,0 +1,55 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   hand out the mpu regions mpuTable doesn't use to code that needs a region for a while
+*
+* Configure_MPU() puts the regions that are disabled in mpuTable, aren't checked by mpu_verify()
+* (MPU_TABLE_VERIFY_MASK) and aren't the task regions or the stack guard in a pool.
+* a scoped_mpu_region takes the highest free one, programs it and clears it again when it goes
+* out of scope, e.g. for a DMA window:
+*
+*    {
+*        scoped_mpu_region uncached( ARM_MPU_RBAR(0,0x20040000), ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_16KB) );
+*        if (!uncached.ok())
+*            return false; // every slot is in use
+*        ...
+*    }
+*
+* the free slots are a bitmap updated with atomic_cmpxchg(), so taking and returning a slot doesn't
+* disable interrupts and can be done from an interrupt.
+*/
+
+#ifndef MPU_SLOTS_H
+#define MPU_SLOTS_H
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+
+/// bit i set: region i is free to be handed out
+extern volatile uint32_t mpuSlotsFree;
+
+uint32_t mpu_slots_pool( const ARM_MPU_Region_t *table, uint32_t table_size, uint32_t verify_mask, uint32_t reserved );
+void mpu_slots_init( uint32_t pool );
+int32_t mpu_slot_alloc();
+void mpu_slot_free( uint32_t region );
+
+/// a region from the pool, programmed while it's in scope
+class scoped_mpu_region {
+public:
+    /// the region number in RBAR is ignored, the one from the pool is used
+    scoped_mpu_region( uint32_t RBAR, uint32_t RASR );
+    ~scoped_mpu_region();
+    scoped_mpu_region( const scoped_mpu_region & ) = delete;
+    scoped_mpu_region &operator=( const scoped_mpu_region & ) = delete;
+
+    /// false if there was no free slot (nothing was programmed)
+    bool ok() const { return region >= 0; }
+    /// the region number, -1 if !ok()
+    int32_t number() const { return region; }
+private:
+    uint32_t RBAR;
+    int32_t region;
+};
+
+#endif
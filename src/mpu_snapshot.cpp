@@ -0,0 +1,103 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   compact binary snapshot of the mpu registers (see mpu_snapshot.h)
+*/
+
+#include "mpu_snapshot.h"
+
+typedef struct {
+    uint32_t entry[256];
+} crc32_table_t;
+
+static constexpr crc32_table_t make_crc32_table()
+{
+    crc32_table_t table = {};
+    for (uint32_t i=0;i<256;i++)
+    {
+        uint32_t crc = i;
+        for (uint32_t bit=0;bit<8;bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : (crc >> 1);
+        }
+        table.entry[i] = crc;
+    }
+    return table;
+}
+
+/// built by the compiler and placed in flash (1K)
+static constexpr crc32_table_t crc32_table = make_crc32_table();
+
+/**
+ * @brief
+ *   crc32 (the zlib/ethernet polynomial) using a byte table,
+ *   mpu_verify() runs this over 120 bytes from an idle hook so it needs to be quick.
+ *
+ * @param[in] crc - 0 to start, or the result of a previous call to continue
+ * @param[in] data - bytes to add to the crc
+ * @param[in] size_in_bytes - number of bytes
+ */
+uint32_t mpu_crc32( uint32_t crc, const void *data, uint32_t size_in_bytes )
+{
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    for (uint32_t i=0;i<size_in_bytes;i++)
+    {
+        crc = (crc >> 8) ^ crc32_table.entry[(crc ^ p[i]) & 0xff];
+    }
+    return ~crc;
+}
+
+/**
+ * @brief
+ *   fill in the header of a snapshot whose mpu_TYPE, mpu_CTRL and regions[] have been set.
+ *
+ * @return the number of bytes of the snapshot to log (MPU_SNAPSHOT_SIZE(num_regions))
+ */
+uint32_t mpu_snapshot_seal( mpu_snapshot_t *snapshot, uint32_t num_regions )
+{
+    if (num_regions > MPU_SNAPSHOT_MAX_REGIONS)
+    {
+        num_regions = MPU_SNAPSHOT_MAX_REGIONS;
+    }
+    uint32_t size = MPU_SNAPSHOT_SIZE(num_regions);
+    snapshot->magic = MPU_SNAPSHOT_MAGIC;
+    snapshot->version = MPU_SNAPSHOT_VERSION;
+    snapshot->num_regions = num_regions;
+    snapshot->size = size;
+    snapshot->crc = mpu_crc32( 0, &snapshot->mpu_TYPE, size - offsetof(mpu_snapshot_t,mpu_TYPE) );
+    return size;
+}
+
+/**
+ * @brief
+ *   validate a snapshot record read back from the log.
+ *
+ * @param[in] snapshot - the record copied into an mpu_snapshot_t (so it is aligned)
+ * @param[in] record_size - number of bytes that were in the record
+ *
+ * @return NULL if the snapshot is valid, otherwise a description of what is wrong
+ */
+const char *mpu_snapshot_check( const mpu_snapshot_t *snapshot, uint32_t record_size )
+{
+    if (record_size < offsetof(mpu_snapshot_t,regions) || snapshot->magic != MPU_SNAPSHOT_MAGIC)
+    {
+        return "not an mpu snapshot";
+    }
+    if (snapshot->version != MPU_SNAPSHOT_VERSION)
+    {
+        return "unsupported snapshot version";
+    }
+    if (snapshot->num_regions > MPU_SNAPSHOT_MAX_REGIONS ||
+        snapshot->size != MPU_SNAPSHOT_SIZE(snapshot->num_regions) ||
+        snapshot->size > record_size)
+    {
+        return "truncated snapshot";
+    }
+    if (snapshot->crc != mpu_crc32( 0, &snapshot->mpu_TYPE, snapshot->size - offsetof(mpu_snapshot_t,mpu_TYPE) ))
+    {
+        return "snapshot crc mismatch";
+    }
+    return NULL;
+}
@@ -0,0 +1,51 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   compact binary snapshot of the mpu registers
+*
+* mpu_dump() captures MPU->TYPE, MPU->CTRL and the RBAR/RASR of every region
+* into one record and logs it, the host decodes it with mpu_display_t::load_snapshot()
+* and does all of the formatting.
+*/
+
+#ifndef MPU_SNAPSHOT_H
+#define MPU_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mpu_armv7.h"
+
+#define MPU_SNAPSHOT_MAGIC 0x5355504dUL // "MPUS" in little endian
+#define MPU_SNAPSHOT_VERSION 1
+#define MPU_SNAPSHOT_MAX_REGIONS 16
+
+/**
+ * the record is little endian (as written by the m7) and only contains
+ * num_regions entries of regions[], so a snapshot of 16 regions is 148 bytes.
+ *
+ * crc is a crc32 of everything after the crc field (mpu_TYPE .. regions[num_regions-1]).
+ */
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t num_regions;
+    uint16_t size; ///< bytes in the record including this header
+    uint32_t crc;
+    uint32_t mpu_TYPE;
+    uint32_t mpu_CTRL;
+    ARM_MPU_Region_t regions[MPU_SNAPSHOT_MAX_REGIONS];
+} mpu_snapshot_t;
+
+#define MPU_SNAPSHOT_SIZE(num_regions) (offsetof(mpu_snapshot_t,regions)+(num_regions)*sizeof(ARM_MPU_Region_t))
+
+uint32_t mpu_crc32( uint32_t crc, const void *data, uint32_t size_in_bytes );
+
+uint32_t mpu_snapshot_seal( mpu_snapshot_t *snapshot, uint32_t num_regions );
+
+const char *mpu_snapshot_check( const mpu_snapshot_t *snapshot, uint32_t record_size );
+
+/// read the live registers (the simulated ones on the host, see mpu_host_model.h)
+uint32_t mpu_snapshot_capture( mpu_snapshot_t *snapshot );
+
+#endif
@@ -0,0 +1,32 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   allocate task stacks aligned for the stack guard (see mpu_stack_guard.h)
+*/
+#include "mpu_stack_guard.h"
+
+/*
+ * one extra alignment's worth is allocated and the stack is moved up to the next multiple,
+ * the pointer allocate() returned is kept in the word just below the stack
+ * (the allocation is at least 8 byte aligned, so there's always room for it).
+ */
+void *mpu_stack_guard_malloc_aligned( size_t stack_bytes, uint32_t alignment, void *(*allocate)( size_t ) )
+{
+    uint8_t *block = (uint8_t *)allocate( stack_bytes + alignment );
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    uintptr_t stack = ((uintptr_t)block + alignment) & ~(uintptr_t)(alignment-1);
+    ((void **)stack)[-1] = block;
+    return (void *)stack;
+}
+
+void mpu_stack_guard_free( void *stack, void (*release)( void * ) )
+{
+    if (stack != NULL)
+    {
+        release( ((void **)stack)[-1] );
+    }
+}
@@ -0,0 +1,70 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   the stack overflow guard region, encoded without running mpu_calculator_t
+*
+* the guard is a single naturally aligned region of a compile time size, so for a stack that
+* starts on a multiple of the size its RASR is a constant and its RBAR is the stack, e.g.
+*
+*    ARM_MPU_Region_t guard = mpu_stack_guard_t<256>::encode( (uint32_t)pxStack );
+*
+* any other stack gets the subregions of a bigger region that fit in its first size bytes
+* (mpu_region_inside()), a smaller guard but never one over the usable stack above it. a guard
+* under 256 bytes has no subregions, so an unaligned stack isn't guarded at all.
+* mpu_stack_guard_malloc() allocates the stacks aligned, e.g. in FreeRTOSConfig.h:
+*
+*    #define pvPortMallocStack( x ) mpu_stack_guard_malloc( x, pvPortMalloc )
+*    #define vPortFreeStack( x )    mpu_stack_guard_free( x, vPortFree )
+*/
+
+#ifndef MPU_STACK_GUARD_H
+#define MPU_STACK_GUARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mpu_armv7.h"
+#include "configure_mpu.h"
+#include "mpu_region_fit.h"
+
+/// region 15 is reprogrammed for every task (see MPU_VERIFY_DEFAULT_MASK)
+#define MPU_STACK_GUARD_REGION 15
+
+template<uint32_t size>
+class mpu_stack_guard_t {
+public:
+    static_assert( size >= 32 && (size & (size-1)) == 0, "the guard has to be one mpu region, a power of 2 of at least 32 bytes" );
+
+    /// read only, so any write (e.g. a push past the end of the stack) faults
+    static constexpr uint32_t RASR = ARM_MPU_RASR_EX( NEVER_EXECUTE, ARM_MPU_AP_RO, NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE, 0, __builtin_ctz(size)-1 );
+
+    /// the guard inside [stack,stack+size), RASR is 0 if none fits
+    static constexpr mpu_region_fit_t fit( uint32_t stack )
+    {
+        return mpu_region_inside( MPU_STACK_GUARD_REGION, stack, size, NEVER_EXECUTE, ARM_MPU_AP_RO, NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE );
+    }
+
+    static constexpr ARM_MPU_Region_t encode( uint32_t stack )
+    {
+        return (stack & (size-1)) == 0 ? ARM_MPU_Region_t{ (uint32_t)ARM_MPU_RBAR( MPU_STACK_GUARD_REGION, stack ), RASR } : fit(stack).entry;
+    }
+};
+
+void *mpu_stack_guard_malloc_aligned( size_t stack_bytes, uint32_t alignment, void *(*allocate)( size_t ) );
+void mpu_stack_guard_free( void *stack, void (*release)( void * ) );
+
+/**
+ * @brief
+ *   allocate a stack that starts on a multiple of the guard size, so the guard is the whole
+ *   size rather than the subregions that fit.
+ *
+ * @return the stack (free it with mpu_stack_guard_free()), NULL if allocate() failed
+ */
+#ifdef STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES
+static inline void *mpu_stack_guard_malloc( size_t stack_bytes, void *(*allocate)( size_t ) )
+{
+    return mpu_stack_guard_malloc_aligned( stack_bytes, STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES, allocate );
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   move the stack guard down as the stack grows to find its deepest point (see mpu_stack_probe.h)
+*/
+#ifdef MDX2_FREERTOS_TARGET
+#include "cpu_m7.h"
+#include "mpu_armv7.h"
+#else
+#include "mpu_host_model.h"
+#endif
+#include "configure_mpu.h"
+#include "dbg_log.h"
+#include "mpu_region_fit.h"
+#include "mpu_stack_guard.h"
+#include "mpu_stack_probe.h"
+#include "mpu_stats.h"
+#include <stddef.h>
+
+/*
+ * the largest naturally aligned block that ends at the watermark and stays above the floor,
+ * or the stack guard again once not even one step fits.
+ */
+static void mpu_stack_probe_place( mpu_stack_probe_t *probe )
+{
+    uint32_t watermark = probe->watermark;
+    uint32_t size = watermark & (0U - watermark);
+    while (size >= probe->step && size > watermark - probe->floor)
+    {
+        size >>= 1;
+    }
+    if (watermark <= probe->floor || size < probe->step)
+    {
+        probe->watermark = probe->floor;
+        *probe->guard = probe->stack_guard;
+        return;
+    }
+    probe->guard->RBAR = ARM_MPU_RBAR(MPU_STACK_GUARD_REGION,watermark - size);
+    probe->guard->RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,__builtin_ctz(size)-1);
+}
+
+/**
+ * @brief
+ *   replace a task's stack guard with a probe just below the stack it's using.
+ *
+ * call it after MPUThreadGuard_calculate() and before the task first runs (the context switch applies the guard).
+ *
+ * @param[in] guard - the task's guard entry, holding the stack guard
+ * @param[in] top - the end of the stack (the stack grows down from here)
+ * @param[in] sp - the stack pointer the task starts with
+ * @param[in] step - the resolution, a power of 2 of at least 32 bytes
+ *
+ * @return false if step isn't a valid region size (the guard isn't changed)
+ */
+bool mpu_stack_probe_init( mpu_stack_probe_t *probe, ARM_MPU_Region_t *guard, uint32_t top, uint32_t sp, uint32_t step, const char *task_name )
+{
+    if (step < 32 || (step & (step-1)) != 0)
+    {
+        return false;
+    }
+    probe->guard = guard;
+    probe->stack_guard = *guard;
+    probe->task_name = task_name;
+    probe->top = top;
+    probe->floor = guard->RBAR & MPU_RBAR_ADDR_Msk;
+    if (guard->RASR & MPU_RASR_ENABLE_Msk)
+    {
+        probe->floor += 2U << ((guard->RASR & MPU_RASR_SIZE_Msk) >> MPU_RASR_SIZE_Pos);
+    }
+    probe->step = step;
+    probe->watermark = sp & ~(step-1);
+    probe->max_depth = top - sp;
+    probe->faults = 0;
+    mpu_stack_probe_place(probe);
+    return true;
+}
+
+/**
+ * @brief
+ *   the MemManage handler's hook: a write hit the probe, record it and move the probe below it.
+ *
+ * the task that faulted is the one running, so region 15 is reprogrammed as well as its guard entry.
+ *
+ * @param[in] address - SCB->MMFAR
+ *
+ * @return true if the probe moved and the access can be retried, false if it's a real fault
+ */
+bool mpu_stack_probe_fault( mpu_stack_probe_t *probe, uint32_t address )
+{
+    mpu_stats_timer timer(MPU_STATS_STACK_PROBE);
+    if (probe == NULL || probe->watermark <= probe->floor || !mpu_region_contains(*probe->guard,address))
+    {
+        return false;
+    }
+    uint32_t old_RBAR = probe->guard->RBAR;
+    probe->max_depth = probe->top - address;
+    probe->faults++;
+    probe->watermark = address & ~(probe->step-1);
+    mpu_stack_probe_place(probe);
+    // disabled with its old base first, so the new base never has the old size
+    __DMB();
+    mpu_region_store(MPU_STACK_GUARD_REGION,old_RBAR,0);
+    mpu_region_store(MPU_STACK_GUARD_REGION,probe->guard->RBAR,probe->guard->RASR);
+    __DSB();
+    __ISB();
+    return true;
+}
+
+/// the task name, its deepest write, the usable stack and the number of faults it took
+void mpu_stack_probe_log( const mpu_stack_probe_t *probe )
+{
+    MDX2_LOG4_INFO( MDX2_DIGIHAL_MPU_STACK_DEPTH, (uint32_t)(size_t)probe->task_name, probe->max_depth, probe->top - probe->floor, probe->faults );
+}
+
+#ifndef MDX2_FREERTOS_TARGET
+/**
+ * @brief
+ *   one write to the stack on the simulated mpu, doing what the MemManage handler would if it faults.
+ *
+ * @return false if the write faulted and the probe couldn't move (a real overflow)
+ */
+bool mpu_stack_probe_simulate( mpu_stack_probe_t *probe, uint32_t address )
+{
+    return mpu_host.writable(address) || mpu_stack_probe_fault(probe,address);
+}
+#endif
@@ -0,0 +1,60 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   measure how deep a task's stack gets by moving its stack guard down each time it's hit
+*
+* a profiling mode for sizing stacks instead of FreeRTOS's pattern fill high water mark (which has to
+* scan the stack and can't see a frame that wrote the fill pattern back).  the stack guard region
+* (region 15, see mpu_stack_guard.h) is moved from the bottom of the stack to just below the part
+* that's in use.  a push into it faults, the MemManage handler records the address and moves the
+* guard down below it, and the push is retried:
+*
+*    mpu_stack_probe_init( &probe, &xThreadGuard->MPU_thread_guard[0], stack_top, (uint32_t)pxTopOfStack, 64, task_name );
+*
+*    void MemManage_Handler()
+*    {
+*        if ((SCB->CFSR & SCB_CFSR_MMARVALID_Msk) && mpu_stack_probe_fault( current_task_probe(), SCB->MMFAR ))
+*        {
+*            SCB->CFSR = SCB_CFSR_MEMFAULTSR_Msk; // retry the access
+*            return;
+*        }
+*        ... a real fault
+*    }
+*
+* after a soak run mpu_stack_probe_log() gives each task's deepest write, to within the step.
+*
+* the guard is a naturally aligned power of 2 that ends at the watermark, as large as the watermark's
+* alignment allows (and never below the stack guard), so it's usually many steps deep.  a write that
+* jumps over all of it (a large local array written bottom up) isn't seen.  until the guard gets back
+* down to the stack guard the bottom of the stack isn't guarded, so this is for profiling builds.
+* a fault while the exception frame is stacked doesn't set MMFAR and is a real fault.
+*/
+
+#ifndef MPU_STACK_PROBE_H
+#define MPU_STACK_PROBE_H
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+
+typedef struct {
+    ARM_MPU_Region_t *guard;        ///< the task's guard entry, applied on the context switch
+    ARM_MPU_Region_t stack_guard;   ///< what it was (the overflow guard), put back when the probe gets down to it
+    const char *task_name;
+    uint32_t top;                   ///< the end of the stack
+    uint32_t floor;                 ///< the end of the stack guard, the probe stays above it
+    uint32_t step;                  ///< the resolution, a power of 2 of at least 32 bytes
+    uint32_t watermark;             ///< the probe ends here, nothing below it has been written
+    uint32_t max_depth;             ///< top - the lowest address that faulted
+    uint32_t faults;                ///< times the probe was moved
+} mpu_stack_probe_t;
+
+bool mpu_stack_probe_init( mpu_stack_probe_t *probe, ARM_MPU_Region_t *guard, uint32_t top, uint32_t sp, uint32_t step, const char *task_name );
+bool mpu_stack_probe_fault( mpu_stack_probe_t *probe, uint32_t address );
+void mpu_stack_probe_log( const mpu_stack_probe_t *probe );
+
+#ifndef MDX2_FREERTOS_TARGET
+bool mpu_stack_probe_simulate( mpu_stack_probe_t *probe, uint32_t address );
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   cycle statistics of the mpu functions (see mpu_stats.h)
+*/
+#include "mpu_stats.h"
+#include "mpu_snapshot.h"
+#include "dbg_log.h"
+#include <string.h>
+#ifndef MDX2_FREERTOS_TARGET
+#include "output_buffer.h"
+#endif
+
+mpu_stats_t mpuStats = { 0, 0, 0, 0, 0, 1000, {} };
+
+static const char *path_names[MPU_STATS_NUM_PATHS] = {
+    "Configure_MPU",
+    "mpu_configure_region",
+    "stack guard",
+    "mpu_task_apply",
+    "scoped_mpu_region",
+    "mpu_verify",
+    "mpu_dump",
+    "mpu_virtual_fault",
+    "mpu_stack_probe_fault",
+    "interrupts disabled",
+};
+
+/**
+ * @brief
+ *   start the cycle counter and clear the statistics
+ *
+ * @param[in] cycles_per_us - the core clock in MHz, so the host can show times
+ */
+void mpu_stats_init( uint32_t cycles_per_us )
+{
+#ifdef MDX2_FREERTOS_TARGET
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55; // the m7's DWT is locked out of reset
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    mpuStats.cycles_per_us = cycles_per_us;
+    mpu_stats_reset();
+}
+
+void mpu_stats_reset()
+{
+    memset(mpuStats.paths,0,sizeof(mpuStats.paths));
+}
+
+/**
+ * @brief
+ *   add one measurement.
+ *
+ * interrupts aren't disabled for this (that would be counted as interrupts disabled), so an interrupt
+ * that records the same path in the middle of it can lose one of the two updates.
+ */
+void mpu_stats_record( mpu_stats_id_t id, uint32_t cycles )
+{
+#ifndef MDX2_FREERTOS_TARGET
+    // the five fields below, so a record made with interrupts disabled shows up in the window
+    mpu_host.work(5);
+#endif
+    mpu_stats_path_t &path = mpuStats.paths[id];
+    uint32_t log2 = 31 - __builtin_clz(cycles | 1);
+    uint32_t bucket = log2 < 6 ? 0 : log2 - 5;
+    path.histogram[bucket < MPU_STATS_BUCKETS ? bucket : MPU_STATS_BUCKETS-1]++;
+    path.min = cycles < path.min || path.count == 0 ? cycles : path.min;
+    path.max = cycles > path.max ? cycles : path.max;
+    path.total += cycles;
+    path.count++;
+}
+
+/**
+ * @brief
+ *   fill in the header of a copy of mpuStats
+ *
+ * @return the number of bytes to log
+ */
+uint32_t mpu_stats_seal( mpu_stats_t *stats )
+{
+    stats->magic = MPU_STATS_MAGIC;
+    stats->version = MPU_STATS_VERSION;
+    stats->num_paths = MPU_STATS_NUM_PATHS;
+    stats->size = sizeof(mpu_stats_t);
+    stats->crc = mpu_crc32( 0, &stats->cycles_per_us, sizeof(mpu_stats_t) - offsetof(mpu_stats_t,cycles_per_us) );
+    return sizeof(mpu_stats_t);
+}
+
+/**
+ * @brief
+ *   validate a statistics record read back from the log.
+ *
+ * @return NULL if it's valid, otherwise a description of what is wrong
+ */
+const char *mpu_stats_check( const mpu_stats_t *stats, uint32_t record_size )
+{
+    if (record_size < offsetof(mpu_stats_t,paths) || stats->magic != MPU_STATS_MAGIC)
+    {
+        return "not mpu statistics";
+    }
+    if (stats->version != MPU_STATS_VERSION || stats->num_paths != MPU_STATS_NUM_PATHS)
+    {
+        return "unsupported statistics version";
+    }
+    if (stats->size != sizeof(mpu_stats_t) || stats->size > record_size)
+    {
+        return "truncated statistics";
+    }
+    if (stats->crc != mpu_crc32( 0, &stats->cycles_per_us, sizeof(mpu_stats_t) - offsetof(mpu_stats_t,cycles_per_us) ))
+    {
+        return "statistics crc mismatch";
+    }
+    return NULL;
+}
+
+/// log a copy of the statistics as one record (so it doesn't change while it's being logged)
+extern "C" void mpu_stats_log()
+{
+    mpu_stats_t stats = mpuStats;
+    uint32_t size = mpu_stats_seal( &stats );
+    MDX2_LOG_BLOB_INFO( MDX2_DIGIHAL_MPU_STATS, &stats, size );
+}
+
+#ifndef MDX2_FREERTOS_TARGET
+/// a table of the paths that ran, in cycles and microseconds, with the histogram
+void mpu_stats_print( output_buffer_t &out, const mpu_stats_t *stats )
+{
+    double cycles_per_us = stats->cycles_per_us != 0 ? stats->cycles_per_us : 1;
+    out.print("%-22s %8s %10s %10s %10s %10s\n","","count","min","mean","max","max us");
+    for (uint32_t i=0;i<MPU_STATS_NUM_PATHS;i++)
+    {
+        const mpu_stats_path_t &path = stats->paths[i];
+        if (path.count == 0)
+        {
+            continue;
+        }
+        out.print("%-22s %8u %10u %10u %10u %10.2f\n",path_names[i],path.count,path.min,(uint32_t)(path.total / path.count),path.max,path.max / cycles_per_us);
+        out.print("%-22s","");
+        for (uint32_t b=0;b<MPU_STATS_BUCKETS;b++)
+        {
+            if (path.histogram[b] != 0)
+            {
+                out.print(" %s%u:%u",b == MPU_STATS_BUCKETS-1 ? ">=" : "<",b == MPU_STATS_BUCKETS-1 ? 1U << (b+5) : 1U << (b+6),path.histogram[b]);
+            }
+        }
+        out.print("\n");
+    }
+}
+#endif
@@ -0,0 +1,127 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   how many cycles the mpu functions take, and how long they keep interrupts disabled
+*
+* each function in configure_mpu.cpp, mpu_slots.cpp, mpu_virtual.cpp and mpu_stack_probe.cpp has an mpu_stats_timer, which reads the
+* cycle counter (DWT->CYCCNT on the target, a nanosecond clock on the host) on the way in and out
+* and adds the difference to mpuStats: count, min, max, total and a log2 histogram.
+* the record has a fixed size, it's logged with mpu_stats_log() and displayed on the host with
+*
+*    mpu_calc stats=mpu_stats.bin
+*
+* build with MPU_STATS_ENABLED=0 to remove the timers.
+*/
+
+#ifndef MPU_STATS_H
+#define MPU_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef MPU_STATS_ENABLED
+#define MPU_STATS_ENABLED 1
+#endif
+
+#ifdef MDX2_FREERTOS_TARGET
+#include "cpu_m7.h"
+#define MPU_STATS_CYCLES() (DWT->CYCCNT)
+#else
+#include "mpu_host_model.h"
+#define MPU_STATS_CYCLES() mpu_host_cycles()
+#endif
+
+#define MPU_STATS_MAGIC 0x5453504dUL // "MPST" in little endian
+#define MPU_STATS_VERSION 3
+/// bucket 0 is under 64 cycles, bucket i is 2^(i+5) .. 2^(i+6)-1, the last one is everything above
+#define MPU_STATS_BUCKETS 12
+
+/// what's timed
+enum mpu_stats_id_t {
+    MPU_STATS_CONFIGURE,            ///< Configure_MPU()
+    MPU_STATS_CONFIGURE_REGION,     ///< mpu_configure_region()
+    MPU_STATS_STACK_GUARD,          ///< MPUThreadGuard_calculate()
+    MPU_STATS_TASK_APPLY,           ///< mpu_task_apply()
+    MPU_STATS_SCOPED_REGION,        ///< programming or clearing a scoped_mpu_region
+    MPU_STATS_VERIFY,               ///< mpu_verify()
+    MPU_STATS_DUMP,                 ///< mpu_dump()
+    MPU_STATS_VIRTUAL_FAULT,        ///< mpu_virtual_fault()
+    MPU_STATS_STACK_PROBE,          ///< mpu_stack_probe_fault()
+    MPU_STATS_INTERRUPTS_DISABLED,  ///< every cpu_interrupt_disable_guard in the above
+    MPU_STATS_NUM_PATHS
+};
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t histogram[MPU_STATS_BUCKETS];
+    uint64_t total;
+} mpu_stats_path_t;
+
+/// the record is little endian, crc is a crc32 of everything after the crc field
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t num_paths;
+    uint16_t size;                  ///< bytes in the record including this header
+    uint32_t crc;
+    uint32_t cycles_per_us;         ///< 1000 on the host (the clock is in nanoseconds)
+    mpu_stats_path_t paths[MPU_STATS_NUM_PATHS];
+} mpu_stats_t;
+
+extern mpu_stats_t mpuStats;
+
+void mpu_stats_init( uint32_t cycles_per_us );
+void mpu_stats_reset();
+void mpu_stats_record( mpu_stats_id_t id, uint32_t cycles );
+uint32_t mpu_stats_seal( mpu_stats_t *stats );
+const char *mpu_stats_check( const mpu_stats_t *stats, uint32_t record_size );
+extern "C" void mpu_stats_log();
+
+#ifndef MDX2_FREERTOS_TARGET
+class output_buffer_t;
+void mpu_stats_print( output_buffer_t &out, const mpu_stats_t *stats );
+#endif
+
+/// times the rest of the scope it's declared in
+class mpu_stats_timer {
+public:
+#if MPU_STATS_ENABLED
+    explicit mpu_stats_timer( mpu_stats_id_t id_ ):id(id_),start(MPU_STATS_CYCLES()){}
+    ~mpu_stats_timer() { mpu_stats_record(id,MPU_STATS_CYCLES() - start); }
+private:
+    mpu_stats_id_t id;
+    uint32_t start;
+#else
+    explicit mpu_stats_timer( mpu_stats_id_t ){}
+#endif
+};
+#define mpu_stats_timer(x) mpu_stats_timer needs to be used with a variable name!?!?!
+
+/**
+ * times a window with interrupts disabled without making it longer: declared before the
+ * cpu_interrupt_disable_guard, start() and stop() read the cycle counter inside the window and the
+ * destructor, which runs after the guard's, records it once interrupts are enabled again.
+ */
+class mpu_stats_window {
+public:
+#if MPU_STATS_ENABLED
+    explicit mpu_stats_window( mpu_stats_id_t id_ ):id(id_),start_cycles(0),stop_cycles(0){}
+    ~mpu_stats_window() { mpu_stats_record(id,stop_cycles - start_cycles); }
+    void start() { start_cycles = MPU_STATS_CYCLES(); }
+    void stop() { stop_cycles = MPU_STATS_CYCLES(); }
+private:
+    mpu_stats_id_t id;
+    uint32_t start_cycles;
+    uint32_t stop_cycles;
+#else
+    explicit mpu_stats_window( mpu_stats_id_t ){}
+    void start() {}
+    void stop() {}
+#endif
+};
+#define mpu_stats_window(x) mpu_stats_window needs to be used with a variable name!?!?!
+
+#endif
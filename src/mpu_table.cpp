@@ -11,6 +11,7 @@
 #include "cpu_m7.h"
 #include "mpu_armv7.h"
 #include "configure_mpu.h"
+#include "mpu_verify.h"
 #include "mpu_table.h"
 
 
@@ -21,3 +22,14 @@
 __attribute__((section(".mpu_table"))) const ARM_MPU_Region_t mpuTable[MPU_TABLE_SIZE] = {
 #include "memory_map.h"
 } ;
+
+#ifndef MPU_TABLE_VERIFY_CRC
+#error "memory_map.h was created by an older mpu_calc (no MPU_TABLE_VERIFY_CRC), regenerate it"
+#endif
+
+/// expected mpu_verify() crc of the registers loaded from mpuTable, device.ld puts it right after mpuTable[]
+__attribute__((section(".mpu_table.verify"))) const mpu_table_verify_t mpuTableVerify = {
+    MPU_TABLE_VERIFY_MAGIC,
+    MPU_TABLE_VERIFY_CRC,
+    MPU_TABLE_VERIFY_MASK
+};
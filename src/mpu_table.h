@@ -1,4 +1,5 @@
 /* copyright Microchip 2022, MIT License */
+#include "mpu_verify.h"
 
 /**
  *  special section for mpu data so that changing the order of linking doesn't affect the layout of the executable
@@ -10,3 +11,5 @@
 
 __attribute__((section(".mpu_table"))) extern const ARM_MPU_Region_t mpuTable[MPU_TABLE_SIZE];
 
+/// the trailer of .mpu_table (see mpu_verify.h)
+extern const mpu_table_verify_t mpuTableVerify;
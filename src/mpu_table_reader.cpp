@@ -0,0 +1,411 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read an mpu table back from a memory_map.h created by mpu_calc
+*   or from a list of RBAR/RASR pairs
+*   or from a binary table (output_format=bin)
+*   or from a binary snapshot logged by mpu_dump()
+*
+* the memory_map.h entries look like:
+*
+*    {
+*        .RBAR = ARM_MPU_RBAR(3UL, 0x00400000UL),
+*        .RASR = ARM_MPU_RASR_EX(EXECUTE, ARM_MPU_AP_RO, NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE, 0x0, ARM_MPU_REGION_SIZE_256KB)
+*    },
+*
+* and a list of RBAR/RASR pairs looks like:
+*
+*    0x00400013 0x060b0023
+*
+* entries written with ARM_MPU_RBAR() are stored at their region number (mpu_calc skips disabled
+* entries for region 0), raw pairs are stored in the order they are found. comments are ignored.
+*/
+#ifndef MDX2_FREERTOS_TARGET
+
+#include "mpu_table_reader.h"
+#include "configure_mpu.h"
+#include "mpu_snapshot.h"
+#include "mpu_verify.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+typedef struct {
+    const char *token_name;
+    uint32_t value;
+} code_value_t;
+
+static const code_value_t disable_exec_codes[] = {
+    {"EXECUTE", EXECUTE},
+    {"EXECUTABLE", EXECUTABLE},
+    {"NEVER_EXECUTE", NEVER_EXECUTE},
+};
+
+static const code_value_t access_permission_codes[] = {
+    {"ARM_MPU_AP_NONE", ARM_MPU_AP_NONE},
+    {"ARM_MPU_AP_PRIV", ARM_MPU_AP_PRIV},
+    {"ARM_MPU_AP_URO", ARM_MPU_AP_URO},
+    {"ARM_MPU_AP_FULL", ARM_MPU_AP_FULL},
+    {"ARM_MPU_AP_PRO", ARM_MPU_AP_PRO},
+    {"ARM_MPU_AP_RO", ARM_MPU_AP_RO},
+};
+
+static const code_value_t access_attributes_codes[] = {
+    {"NO_ACCESS", NO_ACCESS},
+    {"STRONGLY_ORDERED", STRONGLY_ORDERED},
+    {"DEVICE_SHAREABLE", DEVICE_SHAREABLE},
+    {"DEVICE_NON_SHAREABLE", DEVICE_NON_SHAREABLE},
+    {"NORMAL_UNCACHED", NORMAL_UNCACHED},
+    {"NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE", NORMAL_WRITE_THROUGH_NO_WRITE_ALLOCATE},
+    {"NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE", NORMAL_WRITE_BACK_NO_WRITE_ALLOCATE},
+    {"NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE},
+    {"NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE", NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE},
+};
+
+/// copy the next comma or ')' separated argument into token (with surrounding whitespace removed)
+static const char *next_argument( const char *p, char *token, uint32_t token_size )
+{
+    while (isspace(*p))
+    {
+        p++;
+    }
+    uint32_t len = 0;
+    while (*p != 0 && *p != ',' && *p != ')')
+    {
+        if (len < token_size-1)
+        {
+            token[len++] = *p;
+        }
+        p++;
+    }
+    while (len > 0 && isspace(token[len-1]))
+    {
+        len--;
+    }
+    token[len] = 0;
+    if (*p == ',')
+    {
+        p++;
+    }
+    return p;
+}
+
+/// convert a symbol from the list, or a number (e.g. 0x3, 1UL) to a value.
+static bool code_to_value( const char *token, const code_value_t *codes, uint32_t num_codes, uint32_t *value )
+{
+    for (uint32_t i=0;i<num_codes;i++)
+    {
+        if (strcmp(token,codes[i].token_name) == 0)
+        {
+            *value = codes[i].value;
+            return true;
+        }
+    }
+    char *temp;
+    *value = strtoul(token,&temp,0);
+    if (temp == token)
+    {
+        return false;
+    }
+    // allow a trailing U, UL or ULL
+    while (*temp == 'U' || *temp == 'L')
+    {
+        temp++;
+    }
+    return *temp == 0;
+}
+
+/// convert ARM_MPU_REGION_SIZE_256KB (or a number) to the RASR size field.
+static bool region_size_to_value( const char *token, uint32_t *value )
+{
+    const char *prefix = "ARM_MPU_REGION_SIZE_";
+    if (strncmp(token,prefix,strlen(prefix)) != 0)
+    {
+        return code_to_value( token, NULL, 0, value );
+    }
+    char *temp;
+    uint64_t size = strtoul(&token[strlen(prefix)],&temp,10);
+    if (strcmp(temp,"GB") == 0)
+    {
+        size *= 1024*1024*1024;
+    }
+    else if (strcmp(temp,"MB") == 0)
+    {
+        size *= 1024*1024;
+    }
+    else if (strcmp(temp,"KB") == 0)
+    {
+        size *= 1024;
+    }
+    else if (strcmp(temp,"B") != 0)
+    {
+        return false;
+    }
+    if (size < 32 || (size & (size-1)) != 0 || size > 0x100000000ULL)
+    {
+        return false;
+    }
+    // e.g. 32 == 4
+    *value = __builtin_ctzll(size)-1;
+    return true;
+}
+
+/// parse the arguments of ARM_MPU_RASR_EX(DisableExec, AccessPermission, AccessAttributes, SubRegionDisable, Size)
+static bool parse_rasr_ex( const char *p, uint32_t *RASR, char *bad_token, uint32_t bad_token_size )
+{
+    char token[100];
+    uint32_t DisableExec;
+    uint32_t AccessPermission;
+    uint32_t AccessAttributes;
+    uint32_t SubRegionDisable;
+    uint32_t Size;
+
+    p = next_argument( p, token, sizeof(token) );
+    if (!code_to_value( token, disable_exec_codes, sizeof(disable_exec_codes)/sizeof(disable_exec_codes[0]), &DisableExec ))
+    {
+        snprintf(bad_token,bad_token_size,"DisableExec '%s'",token);
+        return false;
+    }
+    p = next_argument( p, token, sizeof(token) );
+    if (!code_to_value( token, access_permission_codes, sizeof(access_permission_codes)/sizeof(access_permission_codes[0]), &AccessPermission ))
+    {
+        snprintf(bad_token,bad_token_size,"AccessPermission '%s'",token);
+        return false;
+    }
+    p = next_argument( p, token, sizeof(token) );
+    if (!code_to_value( token, access_attributes_codes, sizeof(access_attributes_codes)/sizeof(access_attributes_codes[0]), &AccessAttributes ))
+    {
+        snprintf(bad_token,bad_token_size,"AccessAttributes '%s'",token);
+        return false;
+    }
+    p = next_argument( p, token, sizeof(token) );
+    if (!code_to_value( token, NULL, 0, &SubRegionDisable ))
+    {
+        snprintf(bad_token,bad_token_size,"SubRegionDisable '%s'",token);
+        return false;
+    }
+    p = next_argument( p, token, sizeof(token) );
+    if (!region_size_to_value( token, &Size ))
+    {
+        snprintf(bad_token,bad_token_size,"Size '%s'",token);
+        return false;
+    }
+    *RASR = ARM_MPU_RASR_EX(DisableExec, AccessPermission, AccessAttributes, SubRegionDisable, Size);
+    return true;
+}
+
+/// read the rest of a binary snapshot (the magic has already been read)
+static bool read_snapshot( FILE *f, const char *name, mpu_display_t *display )
+{
+    mpu_snapshot_t snapshot;
+    snapshot.magic = MPU_SNAPSHOT_MAGIC;
+    uint32_t size = sizeof(snapshot.magic);
+    size += fread((uint8_t *)&snapshot + size,1,sizeof(snapshot)-size,f);
+    const char *error = mpu_snapshot_check(&snapshot,size);
+    if (error != NULL)
+    {
+        printf("%s: %s\n",name,error);
+        return false;
+    }
+    uint32_t mpu_TYPE;
+    uint32_t mpu_CTRL;
+    return display->load_snapshot(&snapshot,size,&mpu_TYPE,&mpu_CTRL);
+}
+
+static uint32_t read_u32( const uint8_t *p )
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/// the bytes of a binary table that are entries, less the mpuTableVerify trailer if it has one
+static size_t binary_table_entries_size( const uint8_t *data, size_t size )
+{
+    if (size >= sizeof(mpu_table_verify_t) && size % sizeof(ARM_MPU_Region_t) == sizeof(mpu_table_verify_t) % sizeof(ARM_MPU_Region_t) &&
+        read_u32(&data[size - sizeof(mpu_table_verify_t)]) == MPU_TABLE_VERIFY_MAGIC)
+    {
+        return size - sizeof(mpu_table_verify_t);
+    }
+    return size;
+}
+
+/// a packed ARM_MPU_Region_t[] from output_format=bin, the RBARs make it look like binary (0x1n bytes)
+static bool is_binary_table( const uint8_t *data, size_t size )
+{
+    size = binary_table_entries_size(data,size);
+    if (size == 0 || size % sizeof(ARM_MPU_Region_t) != 0 || size > mpu_display_t::MAX_ENTRIES*sizeof(ARM_MPU_Region_t))
+    {
+        return false;
+    }
+    for (size_t i=0;i<size;i++)
+    {
+        if (data[i] == 0 || (data[i] < 0x20 && !isspace(data[i])))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief
+ *   read an mpu table from either a memory_map.h, a list of RBAR/RASR pairs, a binary table or a binary snapshot.
+ *
+ * @param[in] f - file to read
+ * @param[in] name - filename used in error messages
+ * @param[out] display - entries are stored in display->mpu_table[0..]
+ *
+ * @return false if the file could not be parsed (an error message is printed)
+ */
+bool read_mpu_table( FILE *f, const char *name, mpu_display_t *display )
+{
+    char line[1024];
+    uint32_t line_number = 0;
+    uint32_t num_entries = 0;
+    uint32_t RBAR = 0;
+    uint32_t index = 0;
+    bool have_rbar = false;
+
+    uint32_t magic;
+    if (fread(&magic,sizeof(magic),1,f) == 1 && magic == MPU_SNAPSHOT_MAGIC)
+    {
+        return read_snapshot( f, name, display );
+    }
+    rewind(f);
+
+    uint8_t blob[mpu_display_t::MAX_ENTRIES*sizeof(ARM_MPU_Region_t)+sizeof(mpu_table_verify_t)+1];
+    size_t blob_size = fread(blob,1,sizeof(blob),f);
+    if (is_binary_table(blob,blob_size))
+    {
+        size_t entries_size = binary_table_entries_size(blob,blob_size);
+        for (uint32_t i=0;i<entries_size/sizeof(ARM_MPU_Region_t);i++)
+        {
+            const uint8_t *p = &blob[i*sizeof(ARM_MPU_Region_t)];
+            display->set(i,read_u32(p),read_u32(p+4));
+        }
+        return true;
+    }
+    rewind(f);
+
+    while (fgets(line,sizeof(line),f) != NULL)
+    {
+        line_number++;
+        const char *p = line;
+        while (isspace(*p))
+        {
+            p++;
+        }
+        if (*p == 0 || strncmp(p,"//",2) == 0 || strncmp(p,"/*",2) == 0 || *p == '*' || *p == '#')
+        {
+            continue;
+        }
+
+        uint32_t RASR;
+        bool have_rasr = false;
+        const char *rbar = strstr(p,"ARM_MPU_RBAR(");
+        const char *rasr_ex = strstr(p,"ARM_MPU_RASR_EX(");
+        if (rbar != NULL)
+        {
+            char token[100];
+            uint32_t region;
+            uint32_t base_address;
+            const char *q = next_argument( rbar+strlen("ARM_MPU_RBAR("), token, sizeof(token) );
+            bool ok = code_to_value( token, NULL, 0, &region );
+            next_argument( q, token, sizeof(token) );
+            ok = ok && code_to_value( token, NULL, 0, &base_address );
+            if (!ok)
+            {
+                printf("%s:%d: could not parse ARM_MPU_RBAR()\n",name,line_number);
+                return false;
+            }
+            RBAR = ARM_MPU_RBAR(region, base_address);
+            index = region;
+            have_rbar = true;
+        }
+        else if (rasr_ex != NULL)
+        {
+            char bad_token[150];
+            if (!parse_rasr_ex( rasr_ex+strlen("ARM_MPU_RASR_EX("), &RASR, bad_token, sizeof(bad_token) ))
+            {
+                printf("%s:%d: unknown %s in ARM_MPU_RASR_EX()\n",name,line_number,bad_token);
+                return false;
+            }
+            have_rasr = true;
+        }
+        else if (strncmp(p,".RASR",5) == 0)
+        {
+            // e.g. .RASR = 0 for an unused entry
+            const char *q = strchr(p,'=');
+            char token[100];
+            if (q == NULL)
+            {
+                printf("%s:%d: expected .RASR = <value>\n",name,line_number);
+                return false;
+            }
+            next_argument( q+1, token, sizeof(token) );
+            if (!code_to_value( token, NULL, 0, &RASR ))
+            {
+                printf("%s:%d: expected a number in '%s'\n",name,line_number,token);
+                return false;
+            }
+            have_rasr = true;
+        }
+        else if (isdigit(*p))
+        {
+            // a raw RBAR/RASR pair e.g. "0x00400013 0x060b0023" or "0x00400013, 0x060b0023"
+            char *temp;
+            RBAR = strtoul(p,&temp,0);
+            while (isspace(*temp) || *temp == ',')
+            {
+                temp++;
+            }
+            const char *q = temp;
+            RASR = strtoul(q,&temp,0);
+            if (temp == q)
+            {
+                printf("%s:%d: expected RBAR RASR pair\n",name,line_number);
+                return false;
+            }
+            index = num_entries;
+            have_rbar = true;
+            have_rasr = true;
+        }
+
+        if (have_rasr)
+        {
+            if (!have_rbar)
+            {
+                printf("%s:%d: .RASR without a preceding .RBAR\n",name,line_number);
+                return false;
+            }
+            if (index >= mpu_display_t::MAX_ENTRIES)
+            {
+                printf("%s:%d: more than %d entries\n",name,line_number,mpu_display_t::MAX_ENTRIES);
+                return false;
+            }
+            display->set(index,RBAR,RASR);
+            num_entries = index+1;
+            have_rbar = false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief
+ *   read an mpu table from a file (see above)
+ */
+bool read_mpu_table( const char *filename, mpu_display_t *display )
+{
+    FILE *f = fopen(filename,"r");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",filename);
+        return false;
+    }
+    bool ok = read_mpu_table( f, filename, display );
+    fclose(f);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,22 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   read an mpu table back from a memory_map.h created by mpu_calc
+*   or from a list of RBAR/RASR pairs
+*   or from a binary table (output_format=bin)
+*   or from a binary snapshot logged by mpu_dump()
+*/
+
+#ifndef MPU_TABLE_READER_H
+#define MPU_TABLE_READER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "mpu_display.h"
+
+bool read_mpu_table( FILE *f, const char *name, mpu_display_t *display );
+
+bool read_mpu_table( const char *filename, mpu_display_t *display );
+
+#endif
@@ -0,0 +1,11 @@
+/* copyright Microchip 2022, MIT License */
+/*
+ * no per task regions (this version is used for the first pass firmware linking)
+ *
+ * mpu_calc task_output_filename=... writes the real one.
+ */
+#define MPU_TASK_FIRST_REGION 0UL
+#define MPU_TASK_NUM_REGIONS 0UL
+#define MPU_TASK_COUNT 0UL
+
+#define MPU_TASK_SETTINGS { NULL, NULL },
@@ -0,0 +1,36 @@
+/* copyright Microchip 2022, MIT License */
+/*
+ * like mpu_table.cpp, mpu_task_regions.h is replaced by the one mpu_calc writes
+ * (task_output_filename=) when this file is recompiled for the final link.
+ */
+#include <stddef.h>
+#include <string.h>
+#include "mpu_task_table.h"
+#include "configure_mpu.h"
+#include "mpu_task_regions.h"
+
+const mpu_task_settings_t mpuTaskSettings[] = {
+    MPU_TASK_SETTINGS
+};
+
+const uint32_t mpuTaskCount = MPU_TASK_COUNT;
+const uint32_t mpuTaskFirstRegion = MPU_TASK_FIRST_REGION;
+const uint32_t mpuTaskNumRegions = MPU_TASK_NUM_REGIONS;
+
+/**
+ * @brief
+ *   find the regions for a task (when the task is created, not at each context switch).
+ *
+ * @return NULL if mpu_calc has no regions for the task
+ */
+const mpu_task_settings_t *mpu_task_find( const char *name )
+{
+    for (uint32_t i=0;i<mpuTaskCount;i++)
+    {
+        if (strcmp(mpuTaskSettings[i].name,name) == 0)
+        {
+            return &mpuTaskSettings[i];
+        }
+    }
+    return NULL;
+}
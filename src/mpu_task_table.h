@@ -0,0 +1,35 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+ *  the per task mpu regions calculated by mpu_calc (task: in memory_map.yaml).
+ *
+ *  look a task up once when it is created and keep the pointer with the task,
+ *  then the context switch is just mpu_task_apply(), e.g.
+ *
+ *     pxTCB->mpu_settings = mpu_task_find( pcName );
+ *     ...
+ *     mpu_task_apply( pxCurrentTCB->mpu_settings, previous_tcb->mpu_settings );
+ */
+
+#ifndef MPU_TASK_TABLE_H
+#define MPU_TASK_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mpu_armv7.h"
+
+typedef struct {
+    const char *name;
+    const ARM_MPU_Region_t *regions; ///< mpuTaskNumRegions entries, for regions mpuTaskFirstRegion and up
+} mpu_task_settings_t;
+
+extern const mpu_task_settings_t mpuTaskSettings[];
+extern const uint32_t mpuTaskCount;
+extern const uint32_t mpuTaskFirstRegion;
+extern const uint32_t mpuTaskNumRegions;
+
+const mpu_task_settings_t *mpu_task_find( const char *name );
+
+void mpu_task_apply( const mpu_task_settings_t *task, const mpu_task_settings_t *previous = NULL );
+
+#endif
@@ -0,0 +1,95 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   crc of the mpu regions used by mpu_verify() to detect a corrupted or reprogrammed mpu
+*
+* mpu_calc calculates the crc of the table it generates and writes it to memory_map.h as
+* MPU_TABLE_VERIFY_CRC, mpu_verify() calculates the same crc from the live registers.
+*/
+
+#ifndef MPU_VERIFY_H
+#define MPU_VERIFY_H
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+#include "mpu_snapshot.h"
+
+#define MPU_VERIFY_REGIONS 16
+
+/// region 15 is reprogrammed at run time (stack guard and mpu_configure_region()) so it is not checked by default
+#define MPU_VERIFY_DEFAULT_MASK (1UL << 15)
+
+#define MPU_TABLE_VERIFY_MAGIC 0x5654504dUL // "MPTV" in little endian
+
+/**
+ * what mpu_table.cpp puts in .mpu_table right after mpuTable[], so the section holds everything
+ * mpu_verify() compares against and replacing it (objcopy --update-section, patch_elf=) can't leave
+ * a stale crc behind.
+ */
+typedef struct {
+    uint32_t magic;     ///< MPU_TABLE_VERIFY_MAGIC
+    uint32_t crc;       ///< MPU_TABLE_VERIFY_CRC
+    uint32_t mask;      ///< MPU_TABLE_VERIFY_MASK
+} mpu_table_verify_t;
+
+/**
+ * the part of a region that is the same whether it was read from the registers or from mpuTable.
+ *
+ * reading RBAR back returns the current region number instead of the VALID bit,
+ * and the address of a disabled region is whatever was last written, so only the
+ * address of an enabled region is kept.
+ */
+static inline ARM_MPU_Region_t mpu_verify_normalize( uint32_t RBAR, uint32_t RASR )
+{
+    ARM_MPU_Region_t region;
+    region.RBAR = (RASR & MPU_RASR_ENABLE_Msk) ? (RBAR & MPU_RBAR_ADDR_Msk) : 0;
+    region.RASR = RASR;
+    return region;
+}
+
+/// add one region to the crc
+static inline uint32_t mpu_verify_fold( uint32_t crc, uint32_t RBAR, uint32_t RASR )
+{
+    ARM_MPU_Region_t region = mpu_verify_normalize( RBAR, RASR );
+    return mpu_crc32( crc, &region, sizeof(region) );
+}
+
+/**
+ * crc of regions 0-15 skipping the regions in mask,
+ * read_region(i,&region) supplies either the live registers or a table entry.
+ */
+template<typename read_region_t>
+uint32_t mpu_verify_crc( uint32_t mask, read_region_t read_region )
+{
+    uint32_t crc = 0;
+    for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+    {
+        if (mask & (1UL << i))
+        {
+            continue;
+        }
+        ARM_MPU_Region_t region;
+        read_region( i, &region );
+        crc = mpu_verify_fold( crc, region.RBAR, region.RASR );
+    }
+    return crc;
+}
+
+/// crc of a table (entries after num_entries are cleared, like Configure_MPU() does)
+static inline uint32_t mpu_table_verify_crc( const ARM_MPU_Region_t *table, uint32_t num_entries, uint32_t mask )
+{
+    return mpu_verify_crc( mask, [table,num_entries]( uint32_t i, ARM_MPU_Region_t *region ) {
+        if (i < num_entries)
+        {
+            *region = table[i];
+        }
+        else
+        {
+            region->RBAR = 0;
+            region->RASR = 0;
+        }
+    } );
+}
+
+#endif
@@ -0,0 +1,153 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   swap virtual regions into the mpu when an access faults (see mpu_virtual.h)
+*/
+#ifdef MDX2_FREERTOS_TARGET
+#include "cpu_m7.h"
+#include "mpu_armv7.h"
+#else
+#include "mpu_host_model.h"
+#endif
+#include "configure_mpu.h"
+#include "mpu_region_fit.h"
+#include "mpu_stats.h"
+#include "mpu_virtual.h"
+#include <string.h>
+
+mpu_virtual_t mpuVirtual;
+
+/**
+ * @brief
+ *   load the hottest entries into the slots and disable the rest of them.
+ *
+ * called by Configure_MPU() while the mpu is disabled.
+ */
+void mpu_virtual_load( mpu_virtual_t *vmpu, const mpu_virtual_table_t *table )
+{
+    memset(vmpu,0,sizeof(*vmpu));
+    vmpu->table = table;
+    uint32_t num_slots = table->num_slots < MPU_VIRTUAL_MAX_SLOTS ? table->num_slots : MPU_VIRTUAL_MAX_SLOTS;
+    ARM_MPU_Region_t slots[MPU_VIRTUAL_MAX_SLOTS];
+    for (uint32_t s=0;s<num_slots;s++)
+    {
+        if (s < table->num_entries)
+        {
+            slots[s] = table->entries[s];
+            vmpu->slot_entry[s] = s;
+            vmpu->slot_count[s] = table->weights[s];
+        }
+        else
+        {
+            slots[s].RBAR = 0;
+            slots[s].RASR = 0;
+            vmpu->slot_entry[s] = MPU_VIRTUAL_NO_ENTRY;
+        }
+    }
+    mpu_apply(slots, NULL, table->first_slot, num_slots);
+}
+
+/// the entry that covers address (the hottest if several do), -1 if none
+int32_t mpu_virtual_find( const mpu_virtual_table_t *table, uint32_t address )
+{
+    for (uint32_t i=0;i<table->num_entries;i++)
+    {
+        if (mpu_region_contains(table->entries[i],address))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * the slot the clock hand stops at, in one pass instead of one decrement at a time:
+ * the slot d places after the hand gets to 0 after count*num_slots+d steps, the first one
+ * there is the victim, and every slot is decremented once for each time the hand passed it.
+ */
+static uint32_t mpu_virtual_victim( mpu_virtual_t *vmpu, uint32_t num_slots )
+{
+    uint32_t best = 0;
+    uint32_t best_steps = UINT32_MAX;
+    for (uint32_t d=0;d<num_slots;d++)
+    {
+        uint32_t steps = vmpu->slot_count[(vmpu->hand + d) % num_slots] * num_slots + d;
+        if (steps < best_steps)
+        {
+            best_steps = steps;
+            best = d;
+        }
+    }
+    for (uint32_t d=0;d<num_slots;d++)
+    {
+        uint32_t passes = best_steps > d ? (best_steps - d + num_slots - 1) / num_slots : 0;
+        vmpu->slot_count[(vmpu->hand + d) % num_slots] -= passes;
+    }
+    return (vmpu->hand + best) % num_slots;
+}
+
+/**
+ * @brief
+ *   the MemManage handler's hook: load the virtual entry an access faulted on.
+ *
+ * @param[in] address - SCB->MMFAR
+ *
+ * @return true if an entry was loaded and the access can be retried, false if it's a real fault
+ *   (no virtual entry covers the address, or the one that does is already loaded and doesn't allow the access)
+ */
+bool mpu_virtual_fault( mpu_virtual_t *vmpu, uint32_t address )
+{
+    mpu_stats_timer timer(MPU_STATS_VIRTUAL_FAULT);
+    const mpu_virtual_table_t *table = vmpu->table;
+    uint32_t num_slots = table == NULL ? 0 : table->num_slots < MPU_VIRTUAL_MAX_SLOTS ? table->num_slots : MPU_VIRTUAL_MAX_SLOTS;
+    vmpu->faults++;
+    int32_t entry = num_slots == 0 ? -1 : mpu_virtual_find(table,address);
+    for (uint32_t s=0;s<num_slots && entry >= 0;s++)
+    {
+        if (vmpu->slot_entry[s] == entry)
+        {
+            entry = -1;
+        }
+    }
+    if (entry < 0)
+    {
+        vmpu->misses++;
+        return false;
+    }
+
+    uint32_t slot = mpu_virtual_victim(vmpu,num_slots);
+    uint32_t victim = vmpu->slot_entry[slot];
+    vmpu->slot_entry[slot] = entry;
+    vmpu->slot_count[slot] = table->weights[entry];
+    vmpu->hand = (slot + 1) % num_slots;
+    // the victim is disabled with its own base and then the slot is rewritten, so no access sees
+    // the new base with the victim's size (interrupts are only disabled for each RBAR/RASR pair)
+    __DMB();
+    if (victim != MPU_VIRTUAL_NO_ENTRY)
+    {
+        mpu_region_store(table->first_slot + slot, table->entries[victim].RBAR, 0);
+    }
+    mpu_region_store(table->first_slot + slot, table->entries[entry].RBAR, table->entries[entry].RASR);
+    __DSB();
+    __ISB();
+    vmpu->swaps++;
+    return true;
+}
+
+#ifndef MDX2_FREERTOS_TARGET
+/**
+ * @brief
+ *   one access on the simulated mpu, doing what the MemManage handler would if it faults.
+ *
+ * replaying a trace of addresses gives the swap rate of a memory map and number of slots.
+ */
+mpu_virtual_access_t mpu_virtual_simulate( mpu_virtual_t *vmpu, uint32_t address )
+{
+    if (mpu_host.accessible(address))
+    {
+        return MPU_VIRTUAL_HIT;
+    }
+    return mpu_virtual_fault(vmpu,address) ? MPU_VIRTUAL_SWAP : MPU_VIRTUAL_FAULT;
+}
+#endif
@@ -0,0 +1,75 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   more protected regions than the mpu has, by swapping entries in when an access faults
+*
+* the regions with hotness: in memory_map.yaml aren't in mpuTable. mpu_calc ranks their entries
+* hottest first (virtual_output_filename=, see mpu_virtual_regions_t) and gives them a few slots
+* after the global table (virtual_slots=). Configure_MPU() loads the hottest ones, and the
+* MemManage handler swaps in the one an access faulted on:
+*
+*    void MemManage_Handler()
+*    {
+*        if ((SCB->CFSR & SCB_CFSR_MMARVALID_Msk) && mpu_virtual_fault( &mpuVirtual, SCB->MMFAR ))
+*        {
+*            SCB->CFSR = SCB_CFSR_MEMFAULTSR_Msk; // retry the access
+*            return;
+*        }
+*        ... a real fault
+*    }
+*
+* the mpu doesn't say which regions are being used, so the slot that's replaced is picked by a clock
+* weighted by hotness: loading an entry sets its slot's count to the entry's hotness, and the hand
+* takes the first slot at 0, decrementing the ones it passes. a hot entry survives that many sweeps.
+*
+* only data accesses set MMFAR, so a virtual region is for data, not code. code above MemManage's
+* priority can't fault on a virtual region (that's a HardFault).
+*/
+
+#ifndef MPU_VIRTUAL_H
+#define MPU_VIRTUAL_H
+
+#include <stdint.h>
+#include "mpu_armv7.h"
+
+#define MPU_VIRTUAL_MAX_SLOTS 16
+/// slot_entry[] of a slot with nothing loaded
+#define MPU_VIRTUAL_NO_ENTRY 0xff
+
+/// what mpu_calc generated (mpu_virtual_regions.h)
+typedef struct {
+    const ARM_MPU_Region_t *entries;    ///< hottest first, the region number in RBAR is ignored
+    const uint8_t *weights;             ///< the hotness of each entry
+    uint32_t num_entries;               ///< up to 255
+    uint32_t first_slot;
+    uint32_t num_slots;
+} mpu_virtual_table_t;
+
+typedef struct {
+    const mpu_virtual_table_t *table;
+    uint8_t slot_entry[MPU_VIRTUAL_MAX_SLOTS];  ///< the entry in each slot
+    uint8_t slot_count[MPU_VIRTUAL_MAX_SLOTS];  ///< sweeps of the hand the slot survives
+    uint32_t hand;
+    uint32_t faults;                    ///< calls to mpu_virtual_fault()
+    uint32_t swaps;                     ///< entries it loaded
+    uint32_t misses;                    ///< faults that weren't for a virtual entry (real faults)
+} mpu_virtual_t;
+
+extern const mpu_virtual_table_t mpuVirtualTable;
+extern mpu_virtual_t mpuVirtual;
+
+void mpu_virtual_load( mpu_virtual_t *vmpu, const mpu_virtual_table_t *table );
+int32_t mpu_virtual_find( const mpu_virtual_table_t *table, uint32_t address );
+bool mpu_virtual_fault( mpu_virtual_t *vmpu, uint32_t address );
+
+#ifndef MDX2_FREERTOS_TARGET
+enum mpu_virtual_access_t {
+    MPU_VIRTUAL_HIT,        ///< the mpu allowed the access
+    MPU_VIRTUAL_SWAP,       ///< it faulted and an entry was swapped in
+    MPU_VIRTUAL_FAULT       ///< it faulted and mpu_virtual_fault() couldn't help
+};
+mpu_virtual_access_t mpu_virtual_simulate( mpu_virtual_t *vmpu, uint32_t address );
+#endif
+
+#endif
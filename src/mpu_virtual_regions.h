@@ -0,0 +1,12 @@
+/* copyright Microchip 2022, MIT License */
+/*
+ * no virtual regions (this version is used for the first pass firmware linking)
+ *
+ * mpu_calc virtual_output_filename=... writes the real one.
+ */
+#define MPU_VIRTUAL_FIRST_SLOT 0UL
+#define MPU_VIRTUAL_NUM_SLOTS 0UL
+#define MPU_VIRTUAL_NUM_ENTRIES 0UL
+
+static const ARM_MPU_Region_t mpuVirtualEntries[] = { { 0, 0 } };
+static const uint8_t mpuVirtualWeights[] = { 0 };
@@ -0,0 +1,16 @@
+/* copyright Microchip 2022, MIT License */
+/*
+ * like mpu_task_table.cpp, mpu_virtual_regions.h is replaced by the one mpu_calc writes
+ * (virtual_output_filename=) when this file is recompiled for the final link.
+ */
+#include <stdint.h>
+#include "mpu_virtual.h"
+#include "mpu_virtual_regions.h"
+
+const mpu_virtual_table_t mpuVirtualTable = {
+    mpuVirtualEntries,
+    mpuVirtualWeights,
+    MPU_VIRTUAL_NUM_ENTRIES,
+    MPU_VIRTUAL_FIRST_SLOT,
+    MPU_VIRTUAL_NUM_SLOTS
+};
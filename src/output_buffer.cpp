@@ -0,0 +1,125 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   growable text buffer that is written to a file once
+*/
+
+#include "output_buffer.h"
+#include <stdarg.h>
+#include <string.h>
+#ifndef MDX2_FREERTOS_TARGET
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+/// printf() to the end of the buffer, growing it as required.
+void output_buffer_t::print( const char *format, ... )
+{
+    size_t old_size = buffer.size();
+    // most lines fit in 256 bytes, so normally vsnprintf() is only called once.
+    size_t available = 256;
+    while (1)
+    {
+        buffer.resize(old_size + available);
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(&buffer[old_size], available, format, args);
+        va_end(args);
+        if (len < 0)
+        {
+            buffer.resize(old_size);
+            return;
+        }
+        if ((size_t)len < available)
+        {
+            buffer.resize(old_size + len);
+            return;
+        }
+        available = len + 1;
+    }
+}
+
+void output_buffer_t::append( const char *s, size_t len )
+{
+    buffer.insert(buffer.end(), s, s+len);
+}
+
+/// write the buffer with a single fwrite() and empty it.
+void output_buffer_t::flush( FILE *f )
+{
+    if (f != NULL && !buffer.empty())
+    {
+        fwrite(buffer.data(), 1, buffer.size(), f);
+    }
+    buffer.clear();
+}
+
+#ifndef MDX2_FREERTOS_TARGET
+
+/// true if the file exists and holds exactly what is in the buffer
+bool output_buffer_t::matches_file( const char *filename ) const
+{
+    FILE *f = fopen(filename,"rb");
+    if (f == NULL)
+    {
+        return false;
+    }
+    bool same = false;
+    if (fseek(f,0,SEEK_END) == 0 && (size_t)ftell(f) == buffer.size())
+    {
+        rewind(f);
+        std::vector<char> existing(buffer.size());
+        same = fread(existing.data(),1,existing.size(),f) == existing.size() &&
+               (buffer.empty() || memcmp(existing.data(),buffer.data(),buffer.size()) == 0);
+    }
+    fclose(f);
+    return same;
+}
+
+/**
+ * @brief
+ *   write the buffer to a file, unless the file already holds the same thing.
+ *
+ * leaving an unchanged file alone keeps its timestamp, so make doesn't rebuild
+ * everything that depends on it. a changed file is written next to it and renamed
+ * over it, so a full disk or an interrupted build never leaves half a header.
+ *
+ * @return false if the file can't be written (an error message is printed)
+ */
+bool output_buffer_t::write_if_changed( const char *filename, bool *changed )
+{
+    *changed = !matches_file(filename);
+    if (!*changed)
+    {
+        buffer.clear();
+        return true;
+    }
+    std::string temp = std::string(filename) + ".mpu_calc.tmp";
+    FILE *f = fopen(temp.c_str(),"w");
+    if (f == NULL)
+    {
+        printf("error opening '%s'\n",temp.c_str());
+        buffer.clear();
+        return false;
+    }
+    bool ok = buffer.empty() || fwrite(buffer.data(),1,buffer.size(),f) == buffer.size();
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    struct stat st;
+    if (ok && stat(filename,&st) == 0)
+    {
+        chmod(temp.c_str(),st.st_mode & 07777);
+    }
+    ok = ok && rename(temp.c_str(),filename) == 0;
+    if (!ok)
+    {
+        printf("error writing '%s'\n",filename);
+        unlink(temp.c_str());
+    }
+    buffer.clear();
+    return ok;
+}
+
+#endif
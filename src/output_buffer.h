@@ -0,0 +1,39 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   growable text buffer that is written to a file once
+*/
+
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * the displays and emitters format dozens of small lines per mpu entry,
+ * so rather than paying for a stdio call (and lock) per line they are
+ * accumulated here and written with a single fwrite().
+ */
+class output_buffer_t {
+public:
+    output_buffer_t():buffer(){}
+
+    void print( const char *format, ... ) __attribute__((format(printf,2,3)));
+    void append( const char *s, size_t len );
+    void flush( FILE *f );
+#ifndef MDX2_FREERTOS_TARGET
+    bool matches_file( const char *filename ) const;
+    bool write_if_changed( const char *filename, bool *changed );
+#endif
+
+    const char *data() const { return buffer.data(); }
+    size_t size() const { return buffer.size(); }
+    void clear() { buffer.clear(); }
+private:
+    std::vector<char> buffer;
+} ;
+
+#endif
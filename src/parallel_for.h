@@ -0,0 +1,47 @@
+/* copyright Microchip 2022, MIT License */
+/**
+* @file
+* @brief
+*   run independent jobs on a few threads (host tools only)
+*/
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#ifndef MDX2_FREERTOS_TARGET
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/// call job(0..num_jobs-1) from num_threads threads
+template<typename job_t>
+static void parallel_for( uint32_t num_jobs, uint32_t num_threads, job_t job )
+{
+    std::atomic<uint32_t> next_job(0);
+    auto worker = [&]() {
+        for (uint32_t i = next_job++; i < num_jobs; i = next_job++)
+        {
+            job(i);
+        }
+    };
+    if (num_threads > num_jobs)
+    {
+        num_threads = num_jobs;
+    }
+    std::vector<std::thread> threads;
+    for (uint32_t i=1;i<num_threads;i++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (uint32_t i=0;i<threads.size();i++)
+    {
+        threads[i].join();
+    }
+}
+
+#endif
+
+#endif
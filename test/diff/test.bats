@@ -0,0 +1,35 @@
+#!/usr/bin/env bats
+
+load "../libs/bats-support/load"
+load "../libs/bats-assert/load"
+
+@test "diff where .text grows by 4K" {
+  run ../../build/mpu_calc diff_old=old_memory_map.h diff_new=new_memory_map.h
+  [ $status -eq 1 ]
+
+  assert_output  --stdin <<END
+entries: 12 -> 11 (-1)
+start    end      size   old -> new
+-------- -------- ------ ----------
+0044f800 004507ff     4K WRITE_BACK_READ_AND_WRITE_ALLOCATE (fully cached) -> WRITE_BACK_READ_AND_WRITE_ALLOCATE (read-only, execute allowed)
+END
+}
+
+@test "diff with no changes" {
+  run ../../build/mpu_calc diff_old=old_memory_map.h diff_new=old_memory_map.h
+  [ $status -eq 0 ]
+
+  assert_output  --stdin <<END
+entries: 12 -> 12 (+0)
+no changes to the memory map
+END
+}
+
+@test "diff with missing file" {
+  run ../../build/mpu_calc diff_old=missing_memory_map.h diff_new=old_memory_map.h
+  [ $status -eq 255 ]
+
+  assert_output  --stdin <<END
+error opening 'missing_memory_map.h'
+END
+}
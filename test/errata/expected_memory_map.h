@@ -163,3 +163,6 @@
         .RBAR = ARM_MPU_RBAR(15UL, 0x00000000UL),
         .RASR = 0
     },
+    // crc for mpu_verify(), the regions in MPU_TABLE_VERIFY_MASK are reprogrammed at run time and are not checked
+#define MPU_TABLE_VERIFY_MASK 0x0000f000UL
+#define MPU_TABLE_VERIFY_CRC 0x7477ef26UL
@@ -0,0 +1,272 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for configure_mpu.cpp running against the simulated registers (mpu_host_model.h)
+*/
+#include "gtest/gtest.h"
+#include "mpu_host_model.h"
+#include "configure_mpu.h"
+#include "mpu_region_fit.h"
+#include "mpu_slots.h"
+#include "mpu_snapshot.h"
+#include "mpu_table.h"
+#include "mpu_task_table.h"
+
+TEST(CONFIGURE_MPU, configure)
+{
+    mpu_host.reset();
+    Configure_MPU();
+    EXPECT_EQ(mpu_host.CTRL,MPU_CTRL_ENABLE_Msk | MPU_CTRL_HFNMIENA_Msk);
+    EXPECT_EQ(mpu_host.CACR,SCB_CACR_SIWT_Msk);
+    EXPECT_EQ(mpu_host.SHCSR,SCB_SHCSR_MEMFAULTENA_Msk);
+    for (uint32_t i=0;i<MPU_TABLE_SIZE;i++)
+    {
+        // (memory_map.h may have fewer entries than MPU_TABLE_SIZE, the rest are 0)
+        EXPECT_EQ(mpu_host.region(i).RBAR,(mpuTable[i].RBAR & MPU_RBAR_ADDR_Msk) | i) << "region " << i;
+        EXPECT_EQ(mpu_host.region(i).RASR,mpuTable[i].RASR) << "region " << i;
+    }
+    EXPECT_EQ(mpu_host.region(15).RASR,0U);
+
+    // the register traffic: every region once (the table through the aliases) and MPU->CTRL twice
+    EXPECT_EQ(mpu_host.writes[MPU_HOST_RNR],16U - MPU_TABLE_SIZE);
+    EXPECT_EQ(mpu_host.mpu_writes(),16*2 + 2);
+    EXPECT_EQ(mpu_host.num_dmb,3U);
+    EXPECT_EQ(mpu_host.num_dsb,3U);
+    EXPECT_EQ(mpu_host.num_isb,3U);
+
+    EXPECT_TRUE(mpu_verify());
+
+    // region 15 isn't checked, the others are
+    ARM_MPU_SetRegionEx(15,ARM_MPU_RBAR(15,0x20000000),ARM_MPU_RASR(1,ARM_MPU_AP_RO,0,0,1,1,0,ARM_MPU_REGION_SIZE_256B));
+    EXPECT_TRUE(mpu_verify());
+    ARM_MPU_ClrRegion(3);
+    EXPECT_FALSE(mpu_verify());
+    EXPECT_EQ(mpu_host.primask,0U);
+}
+
+TEST(CONFIGURE_MPU, snapshot)
+{
+    mpu_host.reset();
+    Configure_MPU();
+    mpu_host.reset_counters();
+    mpu_snapshot_t snapshot;
+    uint32_t size = mpu_snapshot_capture(&snapshot);
+    EXPECT_EQ(size,MPU_SNAPSHOT_SIZE(16));
+    EXPECT_TRUE(mpu_snapshot_check(&snapshot,size) == NULL);
+    EXPECT_EQ(snapshot.mpu_CTRL,MPU_CTRL_ENABLE_Msk | MPU_CTRL_HFNMIENA_Msk);
+    for (uint32_t i=0;i<16;i++)
+    {
+        EXPECT_EQ(snapshot.regions[i].RBAR,mpu_host.region(i).RBAR);
+        EXPECT_EQ(snapshot.regions[i].RASR,mpu_host.region(i).RASR);
+    }
+    EXPECT_EQ(mpu_host.mpu_reads(),2U + 16*2);
+    EXPECT_EQ(mpu_host.mpu_writes(),16U);
+
+    // mpu_dump() is the same capture, logged
+    mpu_host.reset_counters();
+    mpu_dump();
+    EXPECT_EQ(mpu_host.mpu_reads(),2U + 16*2);
+}
+
+TEST(CONFIGURE_MPU, configure_region)
+{
+    mpu_host.reset();
+    Configure_MPU();
+    mpu_host.reset_counters();
+    EXPECT_EQ(mpu_configure_region(0x20000000,32*1024,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED),0U);
+    ARM_MPU_Region_t region = mpu_host.region(15);
+    EXPECT_EQ(region.RBAR,0x20000000U | 15);
+    EXPECT_EQ(region.RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_32KB));
+    // the 16 regions are read for the cache plan, then region 13, the highest free slot in
+    // memory_map.h, stands in while 15 is rewritten, interrupts disabled for each pair
+    EXPECT_EQ(mpu_host.num_interrupt_disables,16U + 4);
+    EXPECT_EQ(mpu_host.primask,0U);
+    EXPECT_EQ(mpu_host.mpu_writes(),16U + 8);
+    EXPECT_EQ(mpu_host.region(13).RASR,0U);
+    EXPECT_EQ(mpuSlotsFree,0x3800U);
+    EXPECT_EQ(mpu_host.max_masked_accesses,3U);
+    EXPECT_EQ(mpu_host.max_masked_barriers,0U);
+    EXPECT_TRUE(mpu_verify());
+
+    // 36K doesn't fit in one region, the 32K of it that does is programmed
+    EXPECT_EQ(mpu_configure_region(0x20000000,36*1024,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED),4*1024U);
+    EXPECT_EQ(mpu_host.region(15).RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_32KB));
+
+    mpu_clear_region();
+    EXPECT_EQ(mpu_host.region(15).RASR,0U);
+}
+
+TEST(CONFIGURE_MPU, configure_region_cache)
+{
+    mpu_host.reset();
+    Configure_MPU();
+    // uncached memory made cached needs nothing
+    mpu_host.reset_counters();
+    mpu_configure_region(0x20000000,4*1024,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE);
+    EXPECT_EQ(mpu_host.num_dcache_cleans + mpu_host.num_dcache_invalidates + mpu_host.num_dcache_clean_invalidates + mpu_host.num_dcache_whole,0U);
+
+    // and back again the lines it cached are dealt with, just those
+    mpu_host.reset_counters();
+    mpu_configure_region(0x20000000,4*1024,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED);
+    EXPECT_EQ(mpu_host.num_dcache_invalidates + mpu_host.num_dcache_clean_invalidates,1U);
+    EXPECT_EQ(mpu_host.dcache_invalidate_bytes + mpu_host.dcache_clean_invalidate_bytes,4*1024U);
+    EXPECT_EQ(mpu_host.num_dcache_whole,0U);
+
+    // the same when the region is cleared
+    mpu_configure_region(0x20000000,4*1024,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE);
+    mpu_host.reset_counters();
+    mpu_clear_region();
+    EXPECT_EQ(mpu_host.num_dcache_invalidates + mpu_host.num_dcache_clean_invalidates,1U);
+    EXPECT_EQ(mpu_host.dcache_invalidate_bytes + mpu_host.dcache_clean_invalidate_bytes,4*1024U);
+}
+
+TEST(CONFIGURE_MPU, handover)
+{
+    mpu_host.reset();
+    Configure_MPU();
+    mpu_configure_region(0x20000000,32*1024,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED);
+    mpu_slots_init(0x4000);
+    mpu_host.reset_counters();
+    uint32_t RASR_4K = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_4KB);
+    mpu_region_handover(15,ARM_MPU_RBAR(15,0x20040000),RASR_4K);
+    // region 14 stood in while 15 was rewritten, and is free and disabled again
+    // (after the 16 regions were read for the cache plan)
+    EXPECT_EQ(mpu_host.region(15).RBAR,0x20040000U | 15);
+    EXPECT_EQ(mpu_host.region(15).RASR,RASR_4K);
+    EXPECT_EQ(mpu_host.region(14).RBAR,0x20040000U | 14);
+    EXPECT_EQ(mpu_host.region(14).RASR,0U);
+    EXPECT_EQ(mpuSlotsFree,0x4000U);
+    EXPECT_EQ(mpu_host.num_interrupt_disables,16U + 4);
+    EXPECT_EQ(mpu_host.mpu_writes(),16U + 8);
+    EXPECT_EQ(mpu_host.max_masked_accesses,3U);
+    EXPECT_EQ(mpu_host.max_masked_barriers,0U);
+    EXPECT_EQ(mpu_host.barriers(),3U);
+
+    // mpu_verify() reads one region per window
+    mpu_host.reset_counters();
+    mpu_verify();
+    EXPECT_EQ(mpu_host.max_masked_accesses,3U);
+    EXPECT_EQ(mpu_host.max_masked_barriers,0U);
+}
+
+TEST(CONFIGURE_MPU, handover_no_spare)
+{
+    mpu_host.reset();
+    Configure_MPU();
+    // every slot memory_map.h leaves free is taken
+    uint32_t RASR_16K = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_16KB);
+    scoped_mpu_region a(ARM_MPU_RBAR(0,0x20040000),RASR_16K);
+    scoped_mpu_region b(ARM_MPU_RBAR(0,0x20044000),RASR_16K);
+    scoped_mpu_region c(ARM_MPU_RBAR(0,0x20048000),RASR_16K);
+    ASSERT_TRUE(a.ok() && b.ok() && c.ok());
+    ASSERT_EQ(mpuSlotsFree,0U);
+
+    // a new base: disabled, moved and enabled again in one window
+    mpu_host.reset_counters();
+    EXPECT_EQ(mpu_configure_region(0x20000000,32*1024,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED),0U);
+    EXPECT_EQ(mpu_host.region(15).RBAR,0x20000000U | 15);
+    EXPECT_EQ(mpu_host.region(15).RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_32KB));
+    EXPECT_EQ(mpu_host.num_interrupt_disables,16U + 1);
+    EXPECT_EQ(mpu_host.primask,0U);
+    EXPECT_EQ(mpu_host.max_masked_accesses,5U);
+    EXPECT_EQ(mpu_host.max_masked_barriers,0U);
+    EXPECT_EQ(mpu_host.barriers(),3U);
+
+    // the same base: only RASR is written
+    mpu_host.reset_counters();
+    EXPECT_EQ(mpu_configure_region(0x20000000,16*1024,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED),0U);
+    EXPECT_EQ(mpu_host.region(15).RBAR,0x20000000U | 15);
+    EXPECT_EQ(mpu_host.region(15).RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_16KB));
+    EXPECT_EQ(mpu_host.num_interrupt_disables,16U + 1);
+    EXPECT_EQ(mpu_host.mpu_writes(),16U + 2);
+    EXPECT_EQ(mpu_host.max_masked_accesses,3U);
+    EXPECT_EQ(mpuSlotsFree,0U);
+    EXPECT_TRUE(mpu_verify());
+}
+
+TEST(CONFIGURE_MPU, stack_guard)
+{
+    mpu_host.reset();
+    MPUThreadStackGuard_t guard;
+    MPUThreadGuard_calculate(&guard,(StackType_t *)(size_t)0x20010000,"net_rx");
+    EXPECT_STREQ(guard.task_name,"net_rx");
+    EXPECT_EQ(guard.MPU_thread_guard[0].RBAR,ARM_MPU_RBAR(15,0x20010000));
+    EXPECT_EQ(guard.MPU_thread_guard[0].RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_256B));
+    EXPECT_EQ(mpu_host.num_dcache_cleans,1U);
+    EXPECT_EQ(mpu_host.dcache_clean_bytes,(uint32_t)STACK_OVERFLOW_MPU_GUARD_SIZE_IN_BYTES);
+    // calculating it doesn't touch the mpu
+    EXPECT_EQ(mpu_host.mpu_writes(),0U);
+
+    // an unaligned stack is guarded by the subregions in its first 256 bytes
+    MPUThreadGuard_calculate(&guard,(StackType_t *)(size_t)0x20010008,"net_tx");
+    EXPECT_EQ(guard.MPU_thread_guard[0].RBAR,ARM_MPU_RBAR(15,0x20010000));
+    EXPECT_FALSE(mpu_region_contains(guard.MPU_thread_guard[0],0x20010008U + 256));
+    EXPECT_TRUE(mpu_region_contains(guard.MPU_thread_guard[0],0x20010020U));
+}
+
+/// 16 regions of 1K at 0x20000000, 0x20000400, ...
+static void make_table( ARM_MPU_Region_t *table )
+{
+    for (uint32_t i=0;i<16;i++)
+    {
+        table[i].RBAR = ARM_MPU_RBAR(i,0x20000000 + i*1024);
+        table[i].RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_1KB);
+    }
+}
+
+TEST(CONFIGURE_MPU, apply)
+{
+    ARM_MPU_Region_t current[16];
+    ARM_MPU_Region_t next[16];
+    make_table(current);
+    make_table(next);
+    mpu_host.reset();
+    mpu_apply(current,NULL,0,16);
+    EXPECT_EQ(mpu_host.mpu_writes(),32U);
+    EXPECT_EQ(mpu_host.writes[MPU_HOST_RNR],0U);
+    EXPECT_EQ(mpu_host.writes[MPU_HOST_RBAR_A3],4U);
+    EXPECT_EQ(mpu_host.barriers(),3U);
+
+    // nothing changed, nothing written
+    mpu_host.reset_counters();
+    mpu_apply(next,current,0,16);
+    EXPECT_EQ(mpu_host.mpu_writes(),0U);
+    EXPECT_EQ(mpu_host.barriers(),0U);
+
+    // 2-6 and 9 changed, a burst of 4 and two single regions
+    for (uint32_t i : { 2, 3, 4, 5, 6, 9 })
+    {
+        next[i].RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_1KB);
+    }
+    next[9].RBAR = 0; // a missing entry only clears its own region
+    next[9].RASR = 0;
+    mpu_host.reset_counters();
+    mpu_apply(next,current,0,16);
+    EXPECT_EQ(mpu_host.mpu_writes(),12U);
+    EXPECT_EQ(mpu_host.num_dmb,1U);
+    EXPECT_EQ(mpu_host.num_dsb,1U);
+    EXPECT_EQ(mpu_host.num_isb,1U);
+    for (uint32_t i=0;i<16;i++)
+    {
+        EXPECT_EQ(mpu_host.region(i).RBAR,(next[i].RBAR & MPU_RBAR_ADDR_Msk) | i) << "region " << i;
+        EXPECT_EQ(mpu_host.region(i).RASR,next[i].RASR) << "region " << i;
+    }
+
+    // the region numbers come from first_region
+    mpu_host.reset();
+    mpu_apply(&next[0],NULL,12,4);
+    EXPECT_EQ(mpu_host.region(12).RASR,next[0].RASR);
+    EXPECT_EQ(mpu_host.region(15).RBAR,(next[3].RBAR & MPU_RBAR_ADDR_Msk) | 15);
+    EXPECT_EQ(mpu_host.region(0).RASR,0U);
+}
+
+TEST(CONFIGURE_MPU, task_apply)
+{
+    mpu_host.reset();
+    // no task: in memory_map.yaml, so there are no task regions to clear
+    mpu_task_apply(NULL);
+    EXPECT_EQ(mpu_host.mpu_writes(),mpuTaskNumRegions*2);
+    EXPECT_EQ(mpu_host.barriers(),3U);
+}
@@ -0,0 +1,233 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for writing the mpu table into a linked firmware
+*/
+#include "gtest/gtest.h"
+#include "elf_patch.h"
+#include "elf_symbols.h"
+#include "configure_mpu.h"
+#include "mpu_verify.h"
+#include <elf.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TABLE_ENTRIES 15
+#define MPU_TABLE_ADDR 0x00440000
+#define RODATA_ADDR 0x00440100
+
+static void append( std::vector<uint8_t> &image, const void *data, size_t size )
+{
+    const uint8_t *p = (const uint8_t *)data;
+    image.insert(image.end(),p,p+size);
+}
+
+/*
+ * a firmware cut down to what elf_patch_mpu_table() looks at,
+ * sections: null, .mpu_table (mpuTable then mpuTableVerify), .rodata, .symtab, .strtab, .shstrtab
+ */
+static std::string write_firmware( uint32_t table_entries, bool trailer = true )
+{
+    static const char strtab[] = "\0mpuTable";
+    static const char shstrtab[] = "\0.mpu_table\0.rodata\0.symtab\0.strtab\0.shstrtab";
+    Elf32_Sym syms[2];
+    memset(syms,0,sizeof(syms));
+    syms[1].st_name = 1;
+    syms[1].st_value = MPU_TABLE_ADDR;
+    syms[1].st_size = table_entries*8;
+    syms[1].st_info = ELF32_ST_INFO(STB_GLOBAL,STT_OBJECT);
+    syms[1].st_shndx = 1;
+
+    std::vector<uint8_t> image(sizeof(Elf32_Ehdr));
+    Elf32_Shdr sections[6];
+    memset(sections,0,sizeof(sections));
+
+    // the first pass table, all zero, and its mpuTableVerify
+    std::vector<uint8_t> table(table_entries*8 + (trailer ? sizeof(mpu_table_verify_t) : 0));
+    if (trailer)
+    {
+        mpu_table_verify_t first_pass = { MPU_TABLE_VERIFY_MAGIC, 0, MPU_VERIFY_DEFAULT_MASK };
+        memcpy(&table[table_entries*8],&first_pass,sizeof(first_pass));
+    }
+    sections[1] = { 1, SHT_PROGBITS, SHF_ALLOC, MPU_TABLE_ADDR, (uint32_t)image.size(), (uint32_t)table.size(), 0, 0, 4, 0 };
+    append(image,table.data(),table.size());
+    uint32_t rodata[2] = { 0x11111111, 0x22222222 };
+    sections[2] = { 12, SHT_PROGBITS, SHF_ALLOC, RODATA_ADDR, (uint32_t)image.size(), sizeof(rodata), 0, 0, 4, 0 };
+    append(image,rodata,sizeof(rodata));
+    sections[3] = { 20, SHT_SYMTAB, 0, 0, (uint32_t)image.size(), sizeof(syms), 4, 1, 4, sizeof(Elf32_Sym) };
+    append(image,syms,sizeof(syms));
+    sections[4] = { 28, SHT_STRTAB, 0, 0, (uint32_t)image.size(), sizeof(strtab), 0, 0, 1, 0 };
+    append(image,strtab,sizeof(strtab));
+    sections[5] = { 36, SHT_STRTAB, 0, 0, (uint32_t)image.size(), sizeof(shstrtab), 0, 0, 1, 0 };
+    append(image,shstrtab,sizeof(shstrtab));
+    image.resize((image.size()+3) & ~3U);
+
+    Elf32_Ehdr ehdr;
+    memset(&ehdr,0,sizeof(ehdr));
+    memcpy(ehdr.e_ident,ELFMAG,SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_ARM;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf32_Shdr);
+    ehdr.e_shnum = 6;
+    ehdr.e_shstrndx = 5;
+    ehdr.e_shoff = image.size();
+    append(image,sections,sizeof(sections));
+    memcpy(image.data(),&ehdr,sizeof(ehdr));
+
+    char filename[] = "/tmp/elf_patch_XXXXXX";
+    int fd = mkstemp(filename);
+    EXPECT_GE(fd,0);
+    EXPECT_EQ(write(fd,image.data(),image.size()),(ssize_t)image.size());
+    fchmod(fd,0755);
+    close(fd);
+    return filename;
+}
+
+static std::vector<uint8_t> read_back( const std::string &filename )
+{
+    std::vector<uint8_t> image;
+    FILE *f = fopen(filename.c_str(),"rb");
+    EXPECT_TRUE(f != NULL);
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer,1,sizeof(buffer),f)) > 0)
+    {
+        append(image,buffer,n);
+    }
+    fclose(f);
+    return image;
+}
+
+static void build_table( ARM_MPU_Region_t *table )
+{
+    for (uint32_t i=0;i<TABLE_ENTRIES;i++)
+    {
+        table[i].RBAR = ARM_MPU_RBAR(i,0);
+        table[i].RASR = 0;
+    }
+    table[0].RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_NONE,NO_ACCESS,0,ARM_MPU_REGION_SIZE_4GB);
+    table[1].RBAR = ARM_MPU_RBAR(1,0x00400000);
+    table[1].RASR = ARM_MPU_RASR_EX(EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_256KB);
+}
+
+TEST(ELF_PATCH, patch_table)
+{
+    std::string filename = write_firmware(TABLE_ENTRIES);
+    ARM_MPU_Region_t table[TABLE_ENTRIES];
+    build_table(table);
+    elf_patch_constants_t constants = { 0x235a2131, 0x8000 };
+    bool changed = false;
+    ASSERT_TRUE(elf_patch_mpu_table(filename.c_str(),table,TABLE_ENTRIES,&constants,&changed));
+    EXPECT_TRUE(changed);
+
+    // the table, then mpuTableVerify at the end of .mpu_table, and nothing after it
+    std::vector<uint8_t> image = read_back(filename);
+    EXPECT_EQ(memcmp(&image[sizeof(Elf32_Ehdr)],table,sizeof(table)),0);
+    mpu_table_verify_t trailer;
+    memcpy(&trailer,&image[sizeof(Elf32_Ehdr)+sizeof(table)],sizeof(trailer));
+    EXPECT_EQ(trailer.magic,MPU_TABLE_VERIFY_MAGIC);
+    EXPECT_EQ(trailer.crc,0x235a2131U);
+    EXPECT_EQ(trailer.mask,0x8000U);
+    uint32_t rodata[2];
+    memcpy(rodata,&image[sizeof(Elf32_Ehdr)+sizeof(table)+sizeof(trailer)],sizeof(rodata));
+    EXPECT_EQ(rodata[0],0x11111111U);
+    EXPECT_EQ(rodata[1],0x22222222U);
+
+    // still executable
+    struct stat st;
+    ASSERT_EQ(stat(filename.c_str(),&st),0);
+    EXPECT_EQ(st.st_mode & 0777,0755U);
+
+    // the same table again doesn't rewrite the file
+    ASSERT_TRUE(elf_patch_mpu_table(filename.c_str(),table,TABLE_ENTRIES,&constants,&changed));
+    EXPECT_FALSE(changed);
+    unlink(filename.c_str());
+}
+
+TEST(ELF_PATCH, no_trailer)
+{
+    // a .mpu_table without mpuTableVerify after it isn't from this mpu_table.cpp
+    ARM_MPU_Region_t table[TABLE_ENTRIES];
+    build_table(table);
+    elf_patch_constants_t constants = { 0, 0 };
+    bool changed = true;
+    std::string filename = write_firmware(TABLE_ENTRIES,false);
+    std::vector<uint8_t> before = read_back(filename);
+    EXPECT_FALSE(elf_patch_mpu_table(filename.c_str(),table,TABLE_ENTRIES,&constants,&changed));
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(read_back(filename),before);
+    unlink(filename.c_str());
+
+    // the right size but not mpuTableVerify
+    filename = write_firmware(TABLE_ENTRIES);
+    FILE *f = fopen(filename.c_str(),"r+b");
+    ASSERT_TRUE(f != NULL);
+    uint32_t zero = 0;
+    fseek(f,sizeof(Elf32_Ehdr) + TABLE_ENTRIES*8,SEEK_SET);
+    EXPECT_EQ(fwrite(&zero,sizeof(zero),1,f),1U);
+    fclose(f);
+    before = read_back(filename);
+    EXPECT_FALSE(elf_patch_mpu_table(filename.c_str(),table,TABLE_ENTRIES,&constants,&changed));
+    EXPECT_EQ(read_back(filename),before);
+    unlink(filename.c_str());
+}
+
+TEST(ELF_PATCH, size_mismatch)
+{
+    std::string filename = write_firmware(TABLE_ENTRIES);
+    std::vector<uint8_t> before = read_back(filename);
+    ARM_MPU_Region_t table[16];
+    build_table(table);
+    table[15].RBAR = ARM_MPU_RBAR(15,0);
+    table[15].RASR = 0;
+    elf_patch_constants_t constants = { 0, 0 };
+    bool changed = true;
+    EXPECT_FALSE(elf_patch_mpu_table(filename.c_str(),table,16,&constants,&changed));
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(read_back(filename),before);
+    unlink(filename.c_str());
+}
+
+TEST(ELF_PATCH, find_section)
+{
+    // the same firmware gives the sections for 'section:' in memory_map.yaml
+    std::string filename = write_firmware(TABLE_ENTRIES);
+    elf_symbols_t symbols;
+    ASSERT_TRUE(symbols.load(filename.c_str()));
+    uint32_t addr;
+    uint32_t size;
+    ASSERT_TRUE(symbols.find_section(".mpu_table",&addr,&size));
+    EXPECT_EQ(addr,(uint32_t)MPU_TABLE_ADDR);
+    EXPECT_EQ(size,TABLE_ENTRIES*8U + (uint32_t)sizeof(mpu_table_verify_t));
+    ASSERT_TRUE(symbols.find_section(".rodata",&addr,&size));
+    EXPECT_EQ(addr,(uint32_t)RODATA_ADDR);
+    // not allocated on the target
+    EXPECT_FALSE(symbols.find_section(".symtab",&addr,&size));
+    EXPECT_FALSE(symbols.find_section(".bss",&addr,&size));
+    unlink(filename.c_str());
+}
+
+TEST(ELF_PATCH, not_elf)
+{
+    char filename[] = "/tmp/elf_patch_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd,0);
+    EXPECT_EQ(write(fd,"region:\n  start_addr: 0x0\n",26),26);
+    close(fd);
+    ARM_MPU_Region_t table[TABLE_ENTRIES];
+    build_table(table);
+    elf_patch_constants_t constants = { 0, 0 };
+    bool changed;
+    EXPECT_FALSE(elf_patch_mpu_table(filename,table,TABLE_ENTRIES,&constants,&changed));
+    EXPECT_FALSE(elf_patch_mpu_table("/tmp/does_not_exist.elf",table,TABLE_ENTRIES,&constants,&changed));
+    unlink(filename);
+}
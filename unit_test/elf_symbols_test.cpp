@@ -0,0 +1,177 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for reading linker symbols from an elf file
+*/
+#include "gtest/gtest.h"
+#include "elf_symbols.h"
+#include <elf.h>
+#include <string>
+#include <unistd.h>
+
+/// a minimal arm elf file with just a symbol table (sections: null, .symtab, .strtab, .shstrtab)
+static std::string write_elf( void )
+{
+    static const char strtab[] = "\0__data_start__\0Reset_Handler\0local_only\0dup\0$d\0__heap_limit__";
+    static const char shstrtab[] = "\0.symtab\0.strtab\0.shstrtab";
+    Elf32_Sym syms[8];
+    memset(syms,0,sizeof(syms));
+    for (uint32_t i=1;i<7;i++)
+    {
+        syms[i].st_shndx = SHN_ABS;
+    }
+    syms[1].st_name = 1;  // __data_start__
+    syms[1].st_value = 0x0044f800;
+    syms[1].st_info = ELF32_ST_INFO(STB_GLOBAL,STT_NOTYPE);
+    syms[2].st_name = 16; // Reset_Handler (thumb)
+    syms[2].st_value = 0x00400101;
+    syms[2].st_info = ELF32_ST_INFO(STB_GLOBAL,STT_FUNC);
+    syms[3].st_name = 30; // local_only
+    syms[3].st_value = 0x20400000;
+    syms[3].st_info = ELF32_ST_INFO(STB_LOCAL,STT_OBJECT);
+    syms[4].st_name = 41; // dup, the global one wins whatever the order
+    syms[4].st_value = 0x1111;
+    syms[4].st_info = ELF32_ST_INFO(STB_LOCAL,STT_OBJECT);
+    syms[5].st_name = 41;
+    syms[5].st_value = 0x2222;
+    syms[5].st_info = ELF32_ST_INFO(STB_GLOBAL,STT_OBJECT);
+    syms[6].st_name = 45; // $d is a section symbol, not indexed
+    syms[6].st_info = ELF32_ST_INFO(STB_LOCAL,STT_SECTION);
+    syms[7].st_name = 48; // an unresolved weak reference, undefined rather than 0
+    syms[7].st_info = ELF32_ST_INFO(STB_WEAK,STT_NOTYPE);
+    syms[7].st_shndx = SHN_UNDEF;
+
+    Elf32_Ehdr ehdr;
+    memset(&ehdr,0,sizeof(ehdr));
+    memcpy(ehdr.e_ident,ELFMAG,SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_EXEC;
+    ehdr.e_machine = EM_ARM;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf32_Shdr);
+    ehdr.e_shnum = 4;
+    ehdr.e_shstrndx = 3;
+
+    uint32_t symtab_offset = sizeof(ehdr);
+    uint32_t strtab_offset = symtab_offset + sizeof(syms);
+    uint32_t shstrtab_offset = strtab_offset + sizeof(strtab);
+    ehdr.e_shoff = (shstrtab_offset + sizeof(shstrtab) + 3) & ~3U;
+
+    Elf32_Shdr sections[4];
+    memset(sections,0,sizeof(sections));
+    sections[1].sh_name = 1;
+    sections[1].sh_type = SHT_SYMTAB;
+    sections[1].sh_offset = symtab_offset;
+    sections[1].sh_size = sizeof(syms);
+    sections[1].sh_link = 2;
+    sections[1].sh_entsize = sizeof(Elf32_Sym);
+    sections[2].sh_name = 9;
+    sections[2].sh_type = SHT_STRTAB;
+    sections[2].sh_offset = strtab_offset;
+    sections[2].sh_size = sizeof(strtab);
+    sections[3].sh_name = 17;
+    sections[3].sh_type = SHT_STRTAB;
+    sections[3].sh_offset = shstrtab_offset;
+    sections[3].sh_size = sizeof(shstrtab);
+
+    char filename[] = "/tmp/elf_symbols_XXXXXX";
+    int fd = mkstemp(filename);
+    EXPECT_GE(fd,0);
+    FILE *f = fdopen(fd,"wb");
+    fwrite(&ehdr,sizeof(ehdr),1,f);
+    fwrite(syms,sizeof(syms),1,f);
+    fwrite(strtab,sizeof(strtab),1,f);
+    fwrite(shstrtab,sizeof(shstrtab),1,f);
+    static const uint8_t pad[4] = {};
+    fwrite(pad,ehdr.e_shoff - (shstrtab_offset + sizeof(shstrtab)),1,f);
+    fwrite(sections,sizeof(sections),1,f);
+    fclose(f);
+    return filename;
+}
+
+TEST(ELF_SYMBOLS, find)
+{
+    std::string filename = write_elf();
+    elf_symbols_t symbols;
+    ASSERT_TRUE(symbols.load(filename.c_str()));
+    uint32_t value = 0;
+    EXPECT_TRUE(symbols.find("__data_start__",&value));
+    EXPECT_EQ(value,0x0044f800U);
+    EXPECT_TRUE(symbols.find("local_only",&value));
+    EXPECT_EQ(value,0x20400000U);
+    EXPECT_FALSE(symbols.find("__data_end__",&value));
+    EXPECT_FALSE(symbols.find("$d",&value));
+    EXPECT_FALSE(symbols.find("__heap_limit__",&value));
+    EXPECT_EQ(symbols.size(),4U);
+    unlink(filename.c_str());
+}
+
+TEST(ELF_SYMBOLS, thumb_bit)
+{
+    std::string filename = write_elf();
+    elf_symbols_t symbols;
+    ASSERT_TRUE(symbols.load(filename.c_str()));
+    uint32_t value = 0;
+    EXPECT_TRUE(symbols.find("Reset_Handler",&value));
+    EXPECT_EQ(value,0x00400100U);
+    unlink(filename.c_str());
+}
+
+TEST(ELF_SYMBOLS, global_wins)
+{
+    std::string filename = write_elf();
+    elf_symbols_t symbols;
+    ASSERT_TRUE(symbols.load(filename.c_str()));
+    uint32_t value = 0;
+    EXPECT_TRUE(symbols.find("dup",&value));
+    EXPECT_EQ(value,0x2222U);
+    unlink(filename.c_str());
+}
+
+TEST(ELF_SYMBOLS, not_elf)
+{
+    char filename[] = "/tmp/elf_symbols_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd,0);
+    EXPECT_EQ(write(fd,"memory_map: not an elf file\n",28),28);
+    close(fd);
+    elf_symbols_t symbols;
+    EXPECT_FALSE(symbols.load(filename));
+    EXPECT_FALSE(symbols.is_loaded());
+    EXPECT_FALSE(symbols.load("/tmp/does_not_exist.elf"));
+
+    // a failed load after a good one leaves nothing behind
+    std::string elf = write_elf();
+    ASSERT_TRUE(symbols.load(elf.c_str()));
+    EXPECT_FALSE(symbols.load(filename));
+    EXPECT_FALSE(symbols.is_loaded());
+    EXPECT_EQ(symbols.size(),0UL);
+    unlink(filename);
+    unlink(elf.c_str());
+}
+
+TEST(ELF_SYMBOLS, bad_symbol_table)
+{
+    // .symtab links to a section that isn't there, found after the sections were indexed
+    std::string elf = write_elf();
+    FILE *f = fopen(elf.c_str(),"r+b");
+    ASSERT_TRUE(f != NULL);
+    Elf32_Ehdr ehdr;
+    ASSERT_EQ(fread(&ehdr,sizeof(ehdr),1,f),1UL);
+    Elf32_Word sh_link = 9;
+    fseek(f,ehdr.e_shoff + sizeof(Elf32_Shdr) + offsetof(Elf32_Shdr,sh_link),SEEK_SET);
+    fwrite(&sh_link,sizeof(sh_link),1,f);
+    fclose(f);
+    elf_symbols_t symbols;
+    EXPECT_FALSE(symbols.load(elf.c_str()));
+    EXPECT_FALSE(symbols.is_loaded());
+    EXPECT_EQ(symbols.size(),0UL);
+    uint32_t value;
+    EXPECT_FALSE(symbols.find("__data_start__",&value));
+    unlink(elf.c_str());
+}
@@ -0,0 +1,194 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for reading MEMORY and SECTIONS from a linker script
+*/
+#include "gtest/gtest.h"
+#include "linker_script.h"
+#include "memory_map_loader.h"
+#include <string>
+
+static bool load( linker_script_t &script, const std::string &text )
+{
+    return script.load_string(text.c_str(),text.size(),"device.ld");
+}
+
+// cut down from example/device.ld
+static const char device_ld[] =
+    "OUTPUT_FORMAT(\"elf32-littlearm\", \"elf32-bigarm\", \"elf32-littlearm\")\n"
+    "OUTPUT_ARCH(arm)\n"
+    "MEMORY\n"
+    "{\n"
+    "    OCR_DEV       (RWX) : ORIGIN = 0x400000 LENGTH = 0x208000\n"
+    "    OCR_PKTMEM    (RWX) : ORIGIN = 0x6c0000 LENGTH = 0x38000  /* ~204K */\n"
+    "    /* note OCR_PKTMEM occupies\n"
+    "       two mpu entries */\n"
+    "    OCR_SHMEM     (RWX) : ORIGIN = 0x6F8000, LENGTH = 0x7C00   /* must match Configure_MPU() */\n"
+    "    OCR_MUTEXES   (RWX) : org = ORIGIN(OCR_SHMEM) + LENGTH(OCR_SHMEM), len = 768\n"
+    "}\n"
+    "SECTIONS\n"
+    "{\n"
+    "    .text :\n"
+    "    {\n"
+    "       *(.text*)\n"
+    "       _end_of_text = .;\n"
+    "    } > OCR_DEV\n"
+    "    .mpu_table : { . = ALIGN(4); *(.mpu_table) } >OCR_DEV\n"
+    "    .ARM.exidx (NOLOAD):\n"
+    "    {\n"
+    "      __exidx_start = .;\n"
+    "    } > OCR_DEV\n"
+    "    _etext = .;\n"
+    "    .data : AT(_etext) { *(.data) } > OCR_PKTMEM AT> OCR_DEV\n"
+    "    /DISCARD/ : { *(.comment) }\n"
+    "}\n";
+
+TEST(LINKER_SCRIPT, memory)
+{
+    linker_script_t script;
+    ASSERT_TRUE(load(script,device_ld));
+    ASSERT_EQ(script.memories.size(),4U);
+    EXPECT_EQ(script.memories[0].name,"OCR_DEV");
+    EXPECT_EQ(script.memories[0].origin,0x400000U);
+    EXPECT_EQ(script.memories[0].length,0x208000U);
+    EXPECT_EQ(script.memories[0].line,5U);
+    const linker_script_t::memory_t *shmem = script.find_memory("OCR_SHMEM");
+    ASSERT_TRUE(shmem != NULL);
+    EXPECT_EQ(shmem->origin,0x6f8000U);
+    EXPECT_EQ(shmem->length,0x7c00U);
+    EXPECT_EQ(shmem->line,9U);
+    const linker_script_t::memory_t *mutexes = script.find_memory("OCR_MUTEXES");
+    ASSERT_TRUE(mutexes != NULL);
+    EXPECT_EQ(mutexes->origin,0x6ffc00U);
+    EXPECT_EQ(mutexes->length,768U);
+    EXPECT_TRUE(script.find_memory("OCR_CTXT") == NULL);
+
+    uint32_t value;
+    EXPECT_TRUE(script.find("ORIGIN(OCR_PKTMEM)",&value));
+    EXPECT_EQ(value,0x6c0000U);
+    EXPECT_TRUE(script.find("LENGTH(OCR_PKTMEM)",&value));
+    EXPECT_EQ(value,0x38000U);
+    EXPECT_FALSE(script.find("ORIGIN(NOT_THERE)",&value));
+    EXPECT_FALSE(script.find("__data_start__",&value));
+}
+
+TEST(LINKER_SCRIPT, sections)
+{
+    linker_script_t script;
+    ASSERT_TRUE(load(script,device_ld));
+    ASSERT_EQ(script.sections.size(),5U);
+    EXPECT_EQ(script.sections[0].name,".text");
+    EXPECT_EQ(script.sections[0].memory,"OCR_DEV");
+    EXPECT_EQ(script.sections[0].line,14U);
+    EXPECT_EQ(script.sections[1].name,".mpu_table");
+    EXPECT_EQ(script.sections[1].memory,"OCR_DEV");
+    EXPECT_EQ(script.sections[2].name,".ARM.exidx");
+    // the load address (AT>) isn't where it runs
+    const linker_script_t::section_t *data = script.find_output_section(".data");
+    ASSERT_TRUE(data != NULL);
+    EXPECT_EQ(data->memory,"OCR_PKTMEM");
+    EXPECT_EQ(script.sections[4].name,"/DISCARD/");
+    EXPECT_EQ(script.sections[4].memory,"");
+}
+
+TEST(LINKER_SCRIPT, errors)
+{
+    linker_script_t script;
+    EXPECT_FALSE(load(script,"MEMORY\n{\n  RAM : ORIGIN = 0x20000000\n}\n"));
+    EXPECT_FALSE(script.is_loaded());
+    EXPECT_FALSE(load(script,"MEMORY\n{\n  RAM : ORIGIN = 0x20000000, LENGTH = 64Q\n}\n"));
+    EXPECT_FALSE(load(script,"MEMORY\n{\n  RAM : ORIGIN = ORIGIN(FLASH), LENGTH = 64K\n}\n"));
+    EXPECT_FALSE(load(script,"MEMORY\n{\n  RAM : ORIGIN = 0, LENGTH = 64K\n  RAM : ORIGIN = 0, LENGTH = 64K\n}\n"));
+    EXPECT_FALSE(load(script,"MEMORY\n{\n  RAM : ORIGIN = 0, LENGTH = 64K\n"));
+    EXPECT_FALSE(load(script,"MEMORY\n{\n  RAM : ORIGIN = 0, LENGTH = 64K\n}\nSECTIONS\n{\n  .data : { *(.data) } > FLASH\n}\n"));
+    EXPECT_TRUE(load(script,"MEMORY\n{\n  RAM : ORIGIN = 0, LENGTH = 64K\n}\n"));
+    EXPECT_TRUE(script.is_loaded());
+}
+
+/// stands in for the elf file
+class fake_elf_t : public mpu_symbol_table_t {
+public:
+    bool find( std::string_view name, uint32_t *value ) const
+    {
+        if (name != "__data_start__")
+        {
+            return false;
+        }
+        *value = 0x44f800;
+        return true;
+    }
+    bool find_section( std::string_view name, uint32_t *addr, uint32_t *size ) const
+    {
+        if (name != ".mpu_table")
+        {
+            return false;
+        }
+        *addr = 0x440000;
+        *size = 15*8;
+        return true;
+    }
+};
+
+TEST(LINKER_SCRIPT, memory_map)
+{
+    linker_script_t script;
+    fake_elf_t elf;
+    script.next = &elf;
+    ASSERT_TRUE(load(script,device_ld));
+    memory_map_loader_t loader;
+    loader.symbols = &script;
+    std::string yaml =
+        "region:\n"
+        "        memory:           OCR_SHMEM\n"
+        "        AccessAttributes: UNCACHED\n"
+        "region:\n"
+        "        memory:           OCR_DEV\n"
+        "        comment:          OCR\n"
+        "        size:             1MB\n"
+        "region:\n"
+        "        memory:           OCR_DEV\n"
+        "        start_addr:       0x500000\n"
+        "region:\n"
+        "        section:          .mpu_table\n"
+        "region:\n"
+        "        start_addr:       ORIGIN(OCR_DEV)\n"
+        "        end_addr:         __data_start__\n";
+    ASSERT_TRUE(loader.load_string(yaml.c_str(),yaml.size()));
+    ASSERT_EQ(loader.regions.size(),5U);
+    EXPECT_EQ(loader.regions[0].start_addr,0x6f8000U);
+    EXPECT_EQ(loader.regions[0].size,0x7c00U);
+    EXPECT_EQ(loader.regions[0].comment,"OCR_SHMEM");
+    EXPECT_EQ(loader.regions[0].memory,"OCR_SHMEM");
+    EXPECT_EQ(loader.regions[1].start_addr,0x400000U);
+    EXPECT_EQ(loader.regions[1].size,0x100000U);
+    EXPECT_EQ(loader.regions[1].comment,"OCR");
+    // a new start keeps the end of the memory region
+    EXPECT_EQ(loader.regions[2].start_addr,0x500000U);
+    EXPECT_EQ(loader.regions[2].size,0U);
+    EXPECT_EQ(loader.regions[2].end_addr,0x608000U);
+    EXPECT_EQ(loader.regions[3].start_addr,0x440000U);
+    EXPECT_EQ(loader.regions[3].size,120U);
+    EXPECT_EQ(loader.regions[3].comment,".mpu_table");
+    EXPECT_EQ(loader.regions[4].start_addr,0x400000U);
+    EXPECT_EQ(loader.regions[4].end_addr,0x44f800U);
+
+    memory_map_loader_t unknown;
+    unknown.symbols = &script;
+    std::string bad = "region:\n  memory: OCR_CTXT\n";
+    EXPECT_FALSE(unknown.load_string(bad.c_str(),bad.size()));
+    bad = "region:\n  section: .bss\n";
+    EXPECT_FALSE(unknown.load_string(bad.c_str(),bad.size()));
+    // the script says where a section the elf file doesn't have was meant to go
+    testing::internal::CaptureStdout();
+    bad = "region:\n  section: .data\n";
+    EXPECT_FALSE(unknown.load_string(bad.c_str(),bad.size()));
+    std::string printed = testing::internal::GetCapturedStdout();
+    EXPECT_NE(printed.find("'.data' goes in OCR_PKTMEM"),std::string::npos);
+    bad = "region:\n  memory: OCR_DEV\n  section: .text\n";
+    EXPECT_FALSE(unknown.load_string(bad.c_str(),bad.size()));
+    memory_map_loader_t no_script;
+    bad = "region:\n  memory: OCR_DEV\n";
+    EXPECT_FALSE(no_script.load_string(bad.c_str(),bad.size()));
+}
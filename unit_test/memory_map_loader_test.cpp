@@ -0,0 +1,175 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for reading memory_map.yaml
+*/
+#include "gtest/gtest.h"
+#include "memory_map_loader.h"
+#include "configure_mpu.h"
+#include "mpu_test_helpers.h"
+
+TEST(MEMORY_MAP_LOADER, regions)
+{
+    memory_map_loader_t loader;
+    ASSERT_TRUE(load(loader,
+        "# comment\n"
+        "region:\n"
+        "        comment:          start by defining all addresses as no access to avoid PLD errata.\n"
+        "        start_addr:       0x0\n"
+        "        end_addr:         0xffffffff\n"
+        "        AccessAttributes: NO_ACCESS\n"
+        "        AccessPermission: ARM_MPU_AP_NONE\n"
+        "\n"
+        "region:\n"
+        "        comment:          OCR\n"
+        "        start_addr:       0x400000\n"
+        "        size:             1MB\n"
+        "        DisableExec:      EXECUTE\n"
+        "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"));
+    ASSERT_EQ(loader.regions.size(),2U);
+    const region_spec_t &all = loader.regions[0];
+    EXPECT_EQ(all.start_addr,0U);
+    EXPECT_EQ(all.end_addr,0xffffffffU);
+    EXPECT_EQ(all.AccessAttributes,(uint32_t)NO_ACCESS);
+    EXPECT_EQ(all.AccessPermission,(uint32_t)ARM_MPU_AP_NONE);
+    EXPECT_EQ(all.DisableExec,1U);
+    EXPECT_EQ(all.line,1U);
+    const region_spec_t &ocr = loader.regions[1];
+    EXPECT_EQ(ocr.comment,"OCR");
+    EXPECT_EQ(ocr.start_addr,0x400000U);
+    EXPECT_EQ(ocr.size,0x100000U);
+    EXPECT_EQ(ocr.end_addr,0U);
+    EXPECT_EQ(ocr.DisableExec,0U);
+    // the default
+    EXPECT_EQ(ocr.AccessPermission,(uint32_t)ARM_MPU_AP_FULL);
+}
+
+TEST(MEMORY_MAP_LOADER, sequence)
+{
+    memory_map_loader_t loader;
+    ASSERT_TRUE(load(loader,
+        "memory_map:\n"
+        "  - region:\n"
+        "      start_addr: 0x20000000\n"
+        "      size: 64K\n"
+        "  - region: {start_addr: 0x20400000, size: 32K, comment: flow}\n"
+        "  - region:\n"));
+    ASSERT_EQ(loader.regions.size(),3U);
+    EXPECT_EQ(loader.regions[0].start_addr,0x20000000U);
+    EXPECT_EQ(loader.regions[1].size,32U*1024);
+    EXPECT_EQ(loader.regions[1].comment,"flow");
+    // an empty region gets the defaults
+    EXPECT_EQ(loader.regions[2].start_addr,0U);
+    EXPECT_EQ(loader.regions[2].comment,"");
+}
+
+TEST(MEMORY_MAP_LOADER, many_regions)
+{
+    std::string yaml;
+    char buffer[200];
+    for (uint32_t i=0;i<5000;i++)
+    {
+        snprintf(buffer,sizeof(buffer),"- region:\n    start_addr: 0x%08x\n    size: 256\n    comment: dma window %u\n",0x20000000+i*256,i);
+        yaml += buffer;
+    }
+    memory_map_loader_t loader;
+    ASSERT_TRUE(load(loader,yaml));
+    ASSERT_EQ(loader.regions.size(),5000U);
+    EXPECT_EQ(loader.regions[4999].start_addr,0x20000000U+4999*256);
+    EXPECT_EQ(loader.regions[4999].comment,"dma window 4999");
+}
+
+class loader_symbols_t : public mpu_symbol_table_t {
+public:
+    bool find( std::string_view name, uint32_t *value ) const
+    {
+        if (name == "__data_start__")
+        {
+            *value = 0x0044f800;
+            return true;
+        }
+        return false;
+    }
+};
+
+TEST(MEMORY_MAP_LOADER, symbols)
+{
+    loader_symbols_t symbols;
+    memory_map_loader_t loader;
+    loader.symbols = &symbols;
+    ASSERT_TRUE(load(loader,
+        "region:\n"
+        "        comment:          .text (__data_start__=$__data_start__, not $0x4f0000)\n"
+        "        start_addr:       0x400000\n"
+        "        end_addr:         0x$__data_start__\n"
+        "region:\n"
+        "        start_addr:       __data_start__\n"
+        "        end_addr:         ALIGN(__data_start__ + 1, 4K) - 1\n"));
+    ASSERT_EQ(loader.regions.size(),2U);
+    EXPECT_EQ(loader.regions[0].comment,".text (__data_start__=0044f800, not $0x4f0000)");
+    EXPECT_EQ(loader.regions[0].end_addr,0x0044f800U);
+    EXPECT_EQ(loader.regions[1].start_addr,0x0044f800U);
+    EXPECT_EQ(loader.regions[1].end_addr,0x0044ffffU);
+}
+
+class moved_symbols_t : public mpu_symbol_table_t {
+public:
+    bool find( std::string_view name, uint32_t *value ) const
+    {
+        if (name == "__data_start__")
+        {
+            *value = 0x00460000;
+            return true;
+        }
+        return false;
+    }
+};
+
+TEST(MEMORY_MAP_LOADER, parse_once)
+{
+    static const char yaml[] =
+        "region:\n"
+        "        start_addr:       __data_start__\n"
+        "        end_addr:         ALIGN(__data_start__ + 1, 4K) - 1\n"
+        "        comment:          data at $__data_start__\n";
+    memory_map_loader_t parsed;
+    ASSERT_TRUE(parsed.parse_string(yaml,sizeof(yaml)-1));
+    ASSERT_EQ(parsed.sources.size(),1U);
+    EXPECT_TRUE(parsed.regions.empty());
+    EXPECT_TRUE(parsed.sources[0].fields[region_source_t::START_ADDR].expression.is_compiled());
+
+    loader_symbols_t symbols;
+    memory_map_loader_t first;
+    first.symbols = &symbols;
+    ASSERT_TRUE(first.add_regions(parsed));
+    ASSERT_EQ(first.regions.size(),1U);
+    EXPECT_EQ(first.regions[0].start_addr,0x0044f800U);
+    EXPECT_EQ(first.regions[0].end_addr,0x0044ffffU);
+    EXPECT_EQ(first.regions[0].comment,"data at 0044f800");
+
+    moved_symbols_t moved;
+    memory_map_loader_t second;
+    second.symbols = &moved;
+    ASSERT_TRUE(second.add_regions(parsed));
+    ASSERT_EQ(second.regions.size(),1U);
+    EXPECT_EQ(second.regions[0].start_addr,0x00460000U);
+    EXPECT_EQ(second.regions[0].end_addr,0x00460fffU);
+    EXPECT_EQ(second.regions[0].comment,"data at 00460000");
+
+    // no symbols at all
+    memory_map_loader_t none;
+    EXPECT_FALSE(none.add_regions(parsed));
+}
+
+TEST(MEMORY_MAP_LOADER, errors)
+{
+    memory_map_loader_t loader;
+    EXPECT_FALSE(load(loader,"region:\n  start_addr:       hello\n"));
+    EXPECT_FALSE(load(loader,"region:\n  AccessAttributes:      hello\n"));
+    EXPECT_FALSE(load(loader,"region:\n  size: [1, 2]\n"));
+    EXPECT_FALSE(load(loader,"region:\n  size: [1\n"));
+    EXPECT_FALSE(load(loader,"region:\n  end_addr: __data_start__ - 1\n"));
+    EXPECT_FALSE(loader.load_file("/tmp/does_not_exist.yaml"));
+}
@@ -0,0 +1,177 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for calculating many firmware variants in one run
+*/
+#include "gtest/gtest.h"
+#include "mpu_batch.h"
+#include "mpu_calc_session.h"
+#include "memory_map_builder.h"
+#include "mpu_emitter.h"
+#include "mpu_test_helpers.h"
+#include <string>
+#include <unistd.h>
+
+static std::string write_temp( const std::string &text )
+{
+    char filename[] = "/tmp/mpu_batch_XXXXXX";
+    int fd = mkstemp(filename);
+    EXPECT_GE(fd,0);
+    EXPECT_EQ(write(fd,text.data(),text.size()),(ssize_t)text.size());
+    close(fd);
+    return filename;
+}
+
+static bool load_manifest( mpu_batch_t &batch, const std::string &yaml )
+{
+    return batch.load_manifest_string(yaml.c_str(),yaml.size());
+}
+
+TEST(MPU_BATCH, manifest)
+{
+    mpu_batch_t batch;
+    ASSERT_TRUE(load_manifest(batch,
+        "variant:\n"
+        "        name:             board_a\n"
+        "        memory_map:       a.yaml\n"
+        "        elf:              board_a.elf\n"
+        "        output_filename:  board_a/memory_map.h\n"
+        "        mpu_table_size:   15\n"
+        "variant:\n"
+        "        memory_map:       a.yaml\n"
+        "        output_filename:  board_b/memory_map.json\n"
+        "        output_format:    json\n"
+        "        verify_mask:      0x0\n"));
+    ASSERT_EQ(batch.variants.size(),2U);
+    EXPECT_EQ(batch.variants[0].name,"board_a");
+    EXPECT_EQ(batch.variants[0].elf,"board_a.elf");
+    EXPECT_EQ(batch.variants[0].mpu_table_size,15U);
+    EXPECT_EQ(batch.variants[0].output_format,"header");
+    // the name defaults to the output
+    EXPECT_EQ(batch.variants[1].name,"board_b/memory_map.json");
+    EXPECT_EQ(batch.variants[1].mpu_table_size,16U);
+    EXPECT_EQ(batch.variants[1].output_format,"json");
+    EXPECT_EQ(batch.variants[1].verify_mask,0U);
+
+    mpu_batch_t incomplete;
+    EXPECT_FALSE(load_manifest(incomplete,"variant:\n  name: no_output\n  memory_map: a.yaml\n"));
+    mpu_batch_t bad_number;
+    EXPECT_FALSE(load_manifest(bad_number,"variant:\n  memory_map: a.yaml\n  output_filename: a.h\n  mpu_table_size: lots\n"));
+}
+
+TEST(MPU_BATCH, run)
+{
+    std::string memory_map = write_temp(two_entries);
+    std::string out_a = write_temp("");
+    std::string out_b = write_temp("");
+    std::string out_c = write_temp("");
+    mpu_batch_t batch;
+    batch.num_threads = 4;
+    ASSERT_TRUE(load_manifest(batch,
+        "variant:\n  name: a\n  memory_map: " + memory_map + "\n  output_filename: " + out_a + "\n  mpu_table_size: 4\n"
+        "variant:\n  name: b\n  memory_map: " + memory_map + "\n  output_filename: " + out_b + "\n  mpu_table_size: 4\n"
+        "variant:\n  name: c\n  memory_map: " + memory_map + "\n  output_filename: " + out_c + "\n  mpu_table_size: 1\n"));
+    EXPECT_FALSE(batch.run());
+    // the memory map is read once for all three
+    EXPECT_EQ(batch.num_templates(),1U);
+    EXPECT_EQ(batch.num_symbol_tables(),0U);
+
+    EXPECT_TRUE(batch.variants[0].ok);
+    EXPECT_TRUE(batch.variants[0].changed);
+    EXPECT_EQ(batch.variants[0].num_entries,2U);
+    EXPECT_TRUE(batch.variants[1].ok);
+    EXPECT_FALSE(batch.variants[1].overflow);
+    EXPECT_TRUE(batch.variants[2].overflow);
+    EXPECT_EQ(batch.variants[2].num_entries,2U);
+
+    // the same table as mpu_calc memory_map=... mpu_table_size=4
+    memory_map_loader_t loader;
+    ASSERT_TRUE(loader.load_string(two_entries,sizeof(two_entries)-1));
+    memory_map_builder_t builder;
+    builder.add_regions(loader.regions);
+    builder.pad(4);
+    EXPECT_EQ(builder.num_entries,4U);
+    output_buffer_t expected;
+    mpu_emitter_t *emitter = mpu_emitter_create("header");
+    // the two unused entries are skipped by mpu_verify() as well as region 15
+    emitter->verify_mask = MPU_VERIFY_DEFAULT_MASK | 0xc;
+    emitter->emit(builder.display,expected);
+    delete emitter;
+    EXPECT_TRUE(expected.matches_file(out_a.c_str()));
+    EXPECT_TRUE(expected.matches_file(out_b.c_str()));
+
+    output_buffer_t out;
+    batch.report(out);
+    std::string report(out.data(),out.size());
+    EXPECT_NE(report.find("OVERFLOW by 1 entries"),std::string::npos);
+    EXPECT_NE(report.find("3 variants, 2 written, 0 up to date, 1 failed"),std::string::npos);
+
+    // nothing changed the second time
+    mpu_batch_t again;
+    ASSERT_TRUE(load_manifest(again,"variant:\n  memory_map: " + memory_map + "\n  output_filename: " + out_a + "\n  mpu_table_size: 4\n"));
+    EXPECT_TRUE(again.run());
+    EXPECT_FALSE(again.variants[0].changed);
+
+    unlink(memory_map.c_str());
+    unlink(out_a.c_str());
+    unlink(out_b.c_str());
+    unlink(out_c.c_str());
+}
+
+// one memory map with expressions, resolved with each variant's own linker script
+TEST(MPU_BATCH, shared_expressions)
+{
+    static const char ram[] =
+        "region:\n"
+        "        start_addr:       ORIGIN(RAM)\n"
+        "        size:             LENGTH(RAM)\n"
+        "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n";
+    std::string memory_map = write_temp(ram);
+    std::string script_a = write_temp("MEMORY\n{\n  RAM : ORIGIN = 0x400000, LENGTH = 64K\n}\n");
+    std::string script_b = write_temp("MEMORY\n{\n  RAM : ORIGIN = 0x600000, LENGTH = 1M\n}\n");
+    std::string out_a = write_temp("");
+    std::string out_b = write_temp("");
+    mpu_batch_t batch;
+    batch.num_threads = 2;
+    ASSERT_TRUE(load_manifest(batch,
+        "variant:\n  memory_map: " + memory_map + "\n  linker_script: " + script_a + "\n  output_filename: " + out_a + "\n"
+        "variant:\n  memory_map: " + memory_map + "\n  linker_script: " + script_b + "\n  output_filename: " + out_b + "\n"));
+    EXPECT_TRUE(batch.run());
+    EXPECT_EQ(batch.num_templates(),1U);
+
+    std::string scripts[] = { script_a, script_b };
+    std::string outputs[] = { out_a, out_b };
+    for (uint32_t i=0;i<2;i++)
+    {
+        mpu_calc_session_t session;
+        ASSERT_TRUE(session.load_linker_script(scripts[i].c_str()));
+        ASSERT_TRUE(session.load_string(ram,sizeof(ram)-1));
+        ASSERT_TRUE(session.compute());
+        output_buffer_t expected;
+        ASSERT_TRUE(session.emit("header",expected));
+        EXPECT_TRUE(expected.matches_file(outputs[i].c_str()));
+        // and not the other variant's table
+        EXPECT_FALSE(expected.matches_file(outputs[1-i].c_str()));
+    }
+
+    unlink(memory_map.c_str());
+    unlink(script_a.c_str());
+    unlink(script_b.c_str());
+    unlink(out_a.c_str());
+    unlink(out_b.c_str());
+}
+
+TEST(MPU_BATCH, missing_inputs)
+{
+    std::string out_a = write_temp("");
+    mpu_batch_t batch;
+    ASSERT_TRUE(load_manifest(batch,
+        "variant:\n  memory_map: /tmp/does_not_exist.yaml\n  output_filename: " + out_a + "\n"
+        "variant:\n  memory_map: /tmp/does_not_exist.yaml\n  elf: /tmp/does_not_exist.elf\n  output_filename: " + out_a + "\n"));
+    EXPECT_FALSE(batch.run());
+    EXPECT_FALSE(batch.variants[0].ok);
+    EXPECT_FALSE(batch.variants[1].ok);
+    unlink(out_a.c_str());
+}
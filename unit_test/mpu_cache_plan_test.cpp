@@ -0,0 +1,200 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the cache maintenance planner (mpu_cache_plan.h)
+*/
+#include "gtest/gtest.h"
+#include "mpu_host_model.h"
+#include "mpu_cache_plan.h"
+#include "configure_mpu.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t WRITE_BACK = NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE_NON_SHAREABLE;
+
+static ARM_MPU_Region_t region( uint32_t i, uint32_t base, uint32_t attributes, uint32_t SRD, uint32_t size )
+{
+    return ARM_MPU_Region_t{ (uint32_t)ARM_MPU_RBAR(i,base), (uint32_t)ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,attributes,SRD,size) };
+}
+
+/// 512K of write-back sram in region 0, the rest disabled
+struct tables_t {
+    ARM_MPU_Region_t old_regions[16];
+    ARM_MPU_Region_t new_regions[16];
+    tables_t()
+    {
+        memset(old_regions,0,sizeof(old_regions));
+        old_regions[0] = region(0,0x20000000,WRITE_BACK,0,ARM_MPU_REGION_SIZE_512KB);
+        memcpy(new_regions,old_regions,sizeof(new_regions));
+    }
+};
+
+TEST(MPU_CACHE_PLAN, policy)
+{
+    EXPECT_EQ(mpu_cache_policy(0,true),MPU_CACHE_POLICY_UNCACHED);
+    EXPECT_EQ(mpu_cache_policy(region(0,0,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_1KB).RASR,true),MPU_CACHE_POLICY_UNCACHED);
+    EXPECT_EQ(mpu_cache_policy(region(0,0,DEVICE_SHAREABLE,0,ARM_MPU_REGION_SIZE_1KB).RASR,true),MPU_CACHE_POLICY_UNCACHED);
+    EXPECT_EQ(mpu_cache_policy(region(0,0,WRITE_BACK,0,ARM_MPU_REGION_SIZE_1KB).RASR,true),MPU_CACHE_POLICY_WRITE_BACK);
+    EXPECT_EQ(mpu_cache_policy(region(0,0,ARM_MPU_ACCESS_(TEX_000,S0,C1,B0),0,ARM_MPU_REGION_SIZE_1KB).RASR,true),MPU_CACHE_POLICY_WRITE_THROUGH);
+    // TEX=1xx: the inner policy is CB
+    EXPECT_EQ(mpu_cache_policy(region(0,0,ARM_MPU_ACCESS_(TEX_101,S0,C0,B1),0,ARM_MPU_REGION_SIZE_1KB).RASR,true),MPU_CACHE_POLICY_WRITE_BACK);
+    // shareable is write-through with CACR.SIWT, otherwise not cached
+    EXPECT_EQ(mpu_cache_policy(region(0,0,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_1KB).RASR,true),MPU_CACHE_POLICY_WRITE_THROUGH);
+    EXPECT_EQ(mpu_cache_policy(region(0,0,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_1KB).RASR,false),MPU_CACHE_POLICY_UNCACHED);
+
+    EXPECT_EQ(mpu_cache_op(MPU_CACHE_POLICY_WRITE_BACK,MPU_CACHE_POLICY_UNCACHED),MPU_CACHE_OP_CLEAN_INVALIDATE);
+    EXPECT_EQ(mpu_cache_op(MPU_CACHE_POLICY_WRITE_BACK,MPU_CACHE_POLICY_WRITE_THROUGH),MPU_CACHE_OP_CLEAN);
+    EXPECT_EQ(mpu_cache_op(MPU_CACHE_POLICY_WRITE_THROUGH,MPU_CACHE_POLICY_UNCACHED),MPU_CACHE_OP_INVALIDATE);
+    EXPECT_EQ(mpu_cache_op(MPU_CACHE_POLICY_UNCACHED,MPU_CACHE_POLICY_WRITE_BACK),MPU_CACHE_OP_NONE);
+    EXPECT_EQ(mpu_cache_op(MPU_CACHE_POLICY_WRITE_BACK,MPU_CACHE_POLICY_WRITE_BACK),MPU_CACHE_OP_NONE);
+}
+
+TEST(MPU_CACHE_PLAN, uncached_window)
+{
+    // mpu_configure_region() making 8K uncached and then undoing it
+    tables_t t;
+    t.new_regions[15] = region(15,0x20010000,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_8KB);
+    mpu_cache_plan_t plan;
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,true);
+    EXPECT_EQ(plan.whole_cache,(uint32_t)MPU_CACHE_OP_NONE);
+    ASSERT_EQ(plan.num_ranges,1U);
+    EXPECT_EQ(plan.ranges[0].op,(uint32_t)MPU_CACHE_OP_CLEAN_INVALIDATE);
+    EXPECT_EQ(plan.ranges[0].start,0x20010000U);
+    EXPECT_EQ(plan.ranges[0].size,0x2000U);
+    EXPECT_EQ(plan.num_lines,0x2000U/32);
+
+    mpu_cache_plan(&plan,t.new_regions,t.old_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,true);
+    EXPECT_EQ(plan.num_ranges,0U);
+    EXPECT_EQ(plan.whole_cache,(uint32_t)MPU_CACHE_OP_NONE);
+
+    // the same window over write-through memory only needs the lines dropped
+    t.old_regions[0].RASR = t.new_regions[0].RASR = region(0,0x20000000,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_512KB).RASR;
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,true);
+    ASSERT_EQ(plan.num_ranges,1U);
+    EXPECT_EQ(plan.ranges[0].op,(uint32_t)MPU_CACHE_OP_INVALIDATE);
+    // and nothing if the m7 doesn't cache shareable memory
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,false);
+    EXPECT_EQ(plan.num_ranges,0U);
+
+    // changing only the access permission needs nothing
+    tables_t ap;
+    ap.new_regions[0].RASR = region(0,0x20000000,WRITE_BACK,0,ARM_MPU_REGION_SIZE_512KB).RASR ^ (ARM_MPU_AP_FULL << MPU_RASR_AP_Pos) ^ (ARM_MPU_AP_RO << MPU_RASR_AP_Pos);
+    mpu_cache_plan(&plan,ap.old_regions,ap.new_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,true);
+    EXPECT_EQ(plan.num_ranges,0U);
+}
+
+TEST(MPU_CACHE_PLAN, overlapping_regions)
+{
+    // a higher region that doesn't change keeps part of the new one from changing anything
+    tables_t t;
+    t.old_regions[10] = t.new_regions[10] = region(10,0x20012000,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_4KB);
+    t.new_regions[5] = region(5,0x20010000,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_16KB);
+    mpu_cache_plan_t plan;
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,true);
+    ASSERT_EQ(plan.num_ranges,2U);
+    EXPECT_EQ(plan.ranges[0].start,0x20010000U);
+    EXPECT_EQ(plan.ranges[0].size,0x2000U);
+    EXPECT_EQ(plan.ranges[1].start,0x20013000U);
+    EXPECT_EQ(plan.ranges[1].size,0x1000U);
+
+    // disabled subregions leave the memory below them alone
+    t.new_regions[5] = region(5,0x20010000,NORMAL_UNCACHED,0x0f,ARM_MPU_REGION_SIZE_16KB);
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,MPU_CACHE_PLAN_DCACHE_SIZE,true);
+    ASSERT_EQ(plan.num_ranges,1U);
+    EXPECT_EQ(plan.ranges[0].start,0x20013000U);
+    EXPECT_EQ(plan.ranges[0].size,0x1000U);
+}
+
+TEST(MPU_CACHE_PLAN, whole_cache)
+{
+    // 512K going uncached is more lines than a 16K cache has
+    tables_t t;
+    t.new_regions[0].RASR = region(0,0x20000000,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_512KB).RASR;
+    mpu_cache_plan_t plan;
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,16*1024,true);
+    EXPECT_EQ(plan.whole_cache,(uint32_t)MPU_CACHE_OP_CLEAN_INVALIDATE);
+    EXPECT_EQ(plan.num_ranges,0U);
+    EXPECT_EQ(plan.num_lines,16*1024U/32);
+
+    // a write-through switch only needs the whole cache cleaned
+    t.new_regions[0].RASR = region(0,0x20000000,ARM_MPU_ACCESS_(TEX_000,S0,C1,B0),0,ARM_MPU_REGION_SIZE_512KB).RASR;
+    mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,16*1024,true);
+    EXPECT_EQ(plan.whole_cache,(uint32_t)MPU_CACHE_OP_CLEAN);
+
+    // running it
+    mpu_host.reset();
+    mpu_cache_plan_run(&plan);
+    EXPECT_EQ(mpu_host.num_dcache_whole,1U);
+    EXPECT_EQ(mpu_host.num_dcache_cleans,0U);
+
+    tables_t window;
+    window.new_regions[15] = region(15,0x20010000,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_8KB);
+    mpu_cache_plan(&plan,window.old_regions,window.new_regions,16,16*1024,true);
+    mpu_host.reset();
+    mpu_cache_plan_run(&plan);
+    EXPECT_EQ(mpu_host.num_dcache_whole,0U);
+    EXPECT_EQ(mpu_host.num_dcache_clean_invalidates,1U);
+    EXPECT_EQ(mpu_host.dcache_clean_invalidate_bytes,0x2000U);
+}
+
+/// the op for every 32 byte line of a window, from the planner and from looking each line up
+TEST(MPU_CACHE_PLAN, against_every_line)
+{
+    const uint32_t window = 0x20000000;
+    const uint32_t window_size = 256*1024;
+    const uint32_t attributes[] = { WRITE_BACK, NORMAL_UNCACHED, ARM_MPU_ACCESS_(TEX_000,S0,C1,B0), NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE };
+    srand(11);
+    for (uint32_t n=0;n<200;n++)
+    {
+        tables_t t;
+        for (uint32_t i=1;i<16;i++)
+        {
+            for (ARM_MPU_Region_t *table : { t.old_regions, t.new_regions })
+            {
+                if (rand() % 3 == 0)
+                {
+                    uint32_t size = ARM_MPU_REGION_SIZE_256B + rand() % 8;
+                    uint32_t base = window + (rand() % window_size & ~((2U << size)-1));
+                    table[i] = region(i,base,attributes[rand() % 4],rand() % 4 == 0 ? rand() & 0xff : 0,size);
+                }
+            }
+        }
+        mpu_cache_plan_t plan;
+        mpu_cache_plan(&plan,t.old_regions,t.new_regions,16,window_size,true);
+        if (plan.whole_cache != MPU_CACHE_OP_NONE)
+        {
+            // too many pieces, the whole cache is always safe
+            continue;
+        }
+        for (uint32_t addr=window;addr<window+window_size;addr+=32)
+        {
+            uint32_t planned = MPU_CACHE_OP_NONE;
+            for (uint32_t r=0;r<plan.num_ranges;r++)
+            {
+                if (addr >= plan.ranges[r].start && addr - plan.ranges[r].start < plan.ranges[r].size)
+                {
+                    planned = plan.ranges[r].op;
+                }
+            }
+            uint32_t old_RASR = 0;
+            uint32_t new_RASR = 0;
+            for (uint32_t i=0;i<16;i++)
+            {
+                for (uint32_t k=0;k<2;k++)
+                {
+                    const ARM_MPU_Region_t &e = k == 0 ? t.old_regions[i] : t.new_regions[i];
+                    uint32_t log2 = ((e.RASR & MPU_RASR_SIZE_Msk) >> MPU_RASR_SIZE_Pos) + 1;
+                    uint32_t base = e.RBAR & MPU_RBAR_ADDR_Msk;
+                    uint32_t SRD = (e.RASR & MPU_RASR_SRD_Msk) >> MPU_RASR_SRD_Pos;
+                    if ((e.RASR & 1) && addr - base < (1ULL << log2) && !(SRD & (1U << ((addr - base) >> (log2-3)))))
+                    {
+                        (k == 0 ? old_RASR : new_RASR) = e.RASR;
+                    }
+                }
+            }
+            EXPECT_EQ(planned,(uint32_t)mpu_cache_op(mpu_cache_policy(old_RASR,true),mpu_cache_policy(new_RASR,true))) << n << " " << std::hex << addr;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for libmpucalc (mpu_calc_session_t)
+*/
+#include "gtest/gtest.h"
+#include "mpu_calc_session.h"
+#include "configure_mpu.h"
+#include "parallel_for.h"
+#include "mpu_test_helpers.h"
+#include <string>
+#include <vector>
+
+TEST(MPU_CALC_SESSION, yaml_and_specs)
+{
+    mpu_calc_session_t from_yaml;
+    from_yaml.mpu_table_size = 15;
+    ASSERT_TRUE(load(from_yaml,two_entries));
+    ASSERT_TRUE(from_yaml.compute());
+    EXPECT_EQ(from_yaml.num_entries,2U);
+    EXPECT_FALSE(from_yaml.overflow());
+    output_buffer_t yaml_out;
+    ASSERT_TRUE(from_yaml.emit("header",yaml_out));
+
+    // the same regions without yaml
+    mpu_calc_session_t from_specs;
+    from_specs.mpu_table_size = 15;
+    region_spec_t everything;
+    everything.end_addr = 0xffffffff;
+    everything.AccessAttributes = NO_ACCESS;
+    everything.AccessPermission = ARM_MPU_AP_NONE;
+    region_spec_t ocr;
+    ocr.start_addr = 0x400000;
+    ocr.size = 0x100000;
+    ocr.DisableExec = 0;
+    ocr.AccessAttributes = NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE;
+    from_specs.add_region(everything);
+    from_specs.add_region(ocr);
+    ASSERT_TRUE(from_specs.compute());
+    output_buffer_t specs_out;
+    ASSERT_TRUE(from_specs.emit("header",specs_out));
+    EXPECT_EQ(std::string(yaml_out.data(),yaml_out.size()),std::string(specs_out.data(),specs_out.size()));
+
+    std::vector<mpu_interval_t> intervals;
+    from_yaml.resolve(intervals);
+    ASSERT_FALSE(intervals.empty());
+    EXPECT_EQ(intervals[0].start,0U);
+
+    output_buffer_t bad;
+    EXPECT_FALSE(from_yaml.emit("pdf",bad));
+    EXPECT_EQ(bad.size(),0U);
+}
+
+TEST(MPU_CALC_SESSION, overflow)
+{
+    mpu_calc_session_t session;
+    session.mpu_table_size = 1;
+    ASSERT_TRUE(load(session,two_entries));
+    ASSERT_TRUE(session.compute());
+    EXPECT_EQ(session.num_entries,2U);
+    EXPECT_TRUE(session.overflow());
+}
+
+TEST(MPU_CALC_SESSION, threads)
+{
+    mpu_calc_session_t reference;
+    ASSERT_TRUE(load(reference,two_entries));
+    ASSERT_TRUE(reference.compute());
+    output_buffer_t expected;
+    ASSERT_TRUE(reference.emit("json",expected));
+
+    // nothing is shared between sessions, so they can run at the same time
+    const uint32_t num_sessions = 64;
+    std::vector<std::string> results(num_sessions);
+    parallel_for( num_sessions, 8, [&]( uint32_t i ) {
+        mpu_calc_session_t session;
+        output_buffer_t out;
+        if (load(session,two_entries) && session.compute() && session.emit("json",out))
+        {
+            results[i].assign(out.data(),out.size());
+        }
+    } );
+    for (uint32_t i=0;i<num_sessions;i++)
+    {
+        EXPECT_EQ(results[i],std::string(expected.data(),expected.size()));
+    }
+}
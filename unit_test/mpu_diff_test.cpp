@@ -0,0 +1,163 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for mpu_diff_t and read_mpu_table()
+*/
+#include "gtest/gtest.h"
+#include "mpu_calculator.h"
+#include "configure_mpu.h"
+#include "mpu_display.h"
+#include "mpu_diff.h"
+#include "mpu_table_reader.h"
+#include "output_buffer.h"
+#include "mpu_test_helpers.h"
+#include <string>
+
+TEST(MPU_DIFF, identical)
+{
+    mpu_display_t old_display;
+    mpu_display_t new_display;
+    build_memory_map(&old_display,0x0044f800,true);
+    build_memory_map(&new_display,0x0044f800,true);
+
+    mpu_diff_t diff;
+    diff.compare(old_display,new_display);
+    diff.print(stdout,"");
+    EXPECT_FALSE(diff.differs());
+    EXPECT_EQ(diff.changes.size(),0UL);
+    EXPECT_EQ(diff.old_num_entries,diff.new_num_entries);
+}
+
+TEST(MPU_DIFF, flatten_overflow)
+{
+    // 20 entries: 16-19 are regions 0-3 again, and still win over the real 0-3 like they did in table order
+    mpu_display_t display;
+    uint32_t RASR_4K = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_4KB);
+    uint32_t RASR_1K = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_1KB);
+    for (uint32_t i=0;i<16;i++)
+    {
+        display.set(i,ARM_MPU_RBAR(i,0x00400000 + i*0x1000),RASR_4K);
+    }
+    for (uint32_t i=16;i<mpu_display_t::MAX_ENTRIES;i++)
+    {
+        display.set(i,ARM_MPU_RBAR(i,0x00400000 + (i-16)*0x1000),RASR_1K);
+    }
+    std::vector<mpu_interval_t> intervals;
+    display.flatten_memory_map(intervals);
+    // unmapped, then a 1K overflow entry and the rest of the 4K one for each of 0-3, 12 4K entries, unmapped
+    ASSERT_EQ(intervals.size(),1UL + 4*2 + 12 + 1);
+    for (uint32_t i=0;i<4;i++)
+    {
+        const mpu_interval_t &overflow = intervals[1 + i*2];
+        EXPECT_EQ(overflow.start,0x00400000U + i*0x1000);
+        EXPECT_EQ(overflow.stop,0x004003ffU + i*0x1000);
+        EXPECT_STREQ(overflow.entry->access_type_to_string(),"UNCACHED e.g. inbox/outbox, pktmem");
+        EXPECT_EQ(overflow.entry->Region,i);
+        EXPECT_STREQ(intervals[2 + i*2].entry->access_type_to_string(),"WRITE_BACK_READ_AND_WRITE_ALLOCATE (fully cached)");
+        EXPECT_EQ(intervals[2 + i*2].stop,0x00400fffU + i*0x1000);
+    }
+    EXPECT_EQ(intervals[9].entry->Region,4U);
+
+    output_buffer_t out;
+    display.display_memory_map(out,"");
+    std::string text(out.data(),out.size());
+    EXPECT_NE(text.find("00400000 004003ff     1K  0 UNCACHED"),std::string::npos) << text;
+}
+
+TEST(MPU_DIFF, text_grows)
+{
+    mpu_display_t old_display;
+    mpu_display_t new_display;
+    build_memory_map(&old_display,0x0044f800,true);
+    build_memory_map(&new_display,0x00450800,true);
+
+    mpu_diff_t diff;
+    diff.compare(old_display,new_display);
+    diff.print(stdout,"");
+    EXPECT_TRUE(diff.differs());
+    // only the 4K between the old and new end of .text changes, even though most entries were renumbered.
+    ASSERT_EQ(diff.changes.size(),1UL);
+    EXPECT_EQ(diff.changes[0].start,0x0044f800U);
+    EXPECT_EQ(diff.changes[0].stop,0x004507ffU);
+    ASSERT_TRUE(diff.changes[0].old_entry != NULL);
+    ASSERT_TRUE(diff.changes[0].new_entry != NULL);
+    EXPECT_EQ(diff.changes[0].old_entry->AccessPermission,ARM_MPU_AP_FULL);
+    EXPECT_EQ(diff.changes[0].new_entry->AccessPermission,ARM_MPU_AP_RO);
+}
+
+TEST(MPU_DIFF, unmapped)
+{
+    mpu_display_t old_display;
+    mpu_display_t new_display;
+    old_display.set(0,ARM_MPU_RBAR(0,0x00400000),ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_1MB));
+    new_display.set(0,ARM_MPU_RBAR(0,0x00400000),ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0x80,ARM_MPU_REGION_SIZE_1MB));
+
+    mpu_diff_t diff;
+    diff.compare(old_display,new_display);
+    diff.print(stdout,"");
+    ASSERT_EQ(diff.changes.size(),1UL);
+    EXPECT_EQ(diff.changes[0].start,0x004e0000U);
+    EXPECT_EQ(diff.changes[0].stop,0x004fffffU);
+    EXPECT_TRUE(diff.changes[0].old_entry != NULL);
+    EXPECT_TRUE(diff.changes[0].new_entry == NULL);
+}
+
+/*
+ * write the entries the same way mpu_calc does, then read them back.
+ */
+TEST(MPU_DIFF, read_memory_map_h)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0044f800,true);
+    display.set(12,ARM_MPU_RBAR(12,0),0);
+
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *f = open_memstream(&buffer,&size);
+    display.display_memory_map(f,"// ");
+    display.display_entries(f,"    // ");
+    fclose(f);
+
+    mpu_display_t read_back;
+    f = fmemopen(buffer,size,"r");
+    EXPECT_TRUE(read_mpu_table(f,"memory_map.h",&read_back));
+    fclose(f);
+    free(buffer);
+
+    for (uint32_t i=0;i<=12;i++)
+    {
+        EXPECT_EQ(read_back.mpu_table[i].RBAR,display.mpu_table[i].RBAR) << "entry " << i;
+        EXPECT_EQ(read_back.mpu_table[i].RASR,display.mpu_table[i].RASR) << "entry " << i;
+    }
+}
+
+TEST(MPU_DIFF, read_rbar_rasr_pairs)
+{
+    const char text[] =
+        "# captured with mpu_dump()\n"
+        "0x00000010 0x1000003f\n"
+        "0x00400011, 0x060b0027\n";
+    mpu_display_t display;
+    FILE *f = fmemopen((void *)text,strlen(text),"r");
+    EXPECT_TRUE(read_mpu_table(f,"pairs.txt",&display));
+    fclose(f);
+    EXPECT_EQ(display.mpu_table[0].RBAR,0x00000010U);
+    EXPECT_EQ(display.mpu_table[0].RASR,0x1000003fU);
+    EXPECT_EQ(display.mpu_table[1].RBAR,0x00400011U);
+    EXPECT_EQ(display.mpu_table[1].RASR,0x060b0027U);
+}
+
+TEST(MPU_DIFF, read_bad_attributes)
+{
+    const char text[] =
+        "    {\n"
+        "        .RBAR = ARM_MPU_RBAR(0UL, 0x00000000UL),\n"
+        "        .RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE, ARM_MPU_AP_NONE, hello, 0x0, ARM_MPU_REGION_SIZE_4GB)\n"
+        "    },\n";
+    mpu_display_t display;
+    FILE *f = fmemopen((void *)text,strlen(text),"r");
+    EXPECT_FALSE(read_mpu_table(f,"bad.h",&display));
+    fclose(f);
+}
@@ -0,0 +1,190 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for output_buffer_t and the mpu_emitter_t output formats
+*/
+#include "gtest/gtest.h"
+#include "mpu_calculator.h"
+#include "configure_mpu.h"
+#include "mpu_display.h"
+#include "mpu_emitter.h"
+#include "mpu_table_reader.h"
+#include "mpu_test_helpers.h"
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string emit( const char *format, mpu_display_t &display )
+{
+    mpu_emitter_t *emitter = mpu_emitter_create(format);
+    EXPECT_TRUE(emitter != NULL);
+    output_buffer_t out;
+    emitter->emit(display,out);
+    delete emitter;
+    return std::string(out.data(),out.size());
+}
+
+TEST(MPU_EMITTER, output_buffer_grows)
+{
+    output_buffer_t out;
+    std::string expected;
+    for (uint32_t i=0;i<1000;i++)
+    {
+        out.print("line %u %s\n",i,"0123456789abcdef0123456789abcdef");
+        char line[100];
+        snprintf(line,sizeof(line),"line %u %s\n",i,"0123456789abcdef0123456789abcdef");
+        expected += line;
+    }
+    EXPECT_EQ(std::string(out.data(),out.size()),expected);
+    out.clear();
+    EXPECT_EQ(out.size(),0UL);
+}
+
+TEST(MPU_EMITTER, write_if_changed)
+{
+    char filename[] = "/tmp/memory_map_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd,0);
+    close(fd);
+    unlink(filename);
+
+    output_buffer_t out;
+    bool changed = false;
+    out.print("#define MPU_TABLE_VERIFY_CRC 0x%08xUL\n",0x235a2131);
+    ASSERT_TRUE(out.write_if_changed(filename,&changed));
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(out.size(),0UL);
+
+    // the same table again leaves the file alone
+    struct stat before;
+    ASSERT_EQ(stat(filename,&before),0);
+    out.print("#define MPU_TABLE_VERIFY_CRC 0x%08xUL\n",0x235a2131);
+    EXPECT_TRUE(out.matches_file(filename));
+    ASSERT_TRUE(out.write_if_changed(filename,&changed));
+    EXPECT_FALSE(changed);
+    struct stat after;
+    ASSERT_EQ(stat(filename,&after),0);
+    EXPECT_EQ(before.st_mtim.tv_sec,after.st_mtim.tv_sec);
+    EXPECT_EQ(before.st_mtim.tv_nsec,after.st_mtim.tv_nsec);
+
+    // a different table (same size) is written to a new file renamed over the old one
+    ASSERT_EQ(chmod(filename,0640),0);
+    ASSERT_EQ(stat(filename,&before),0);
+    out.print("#define MPU_TABLE_VERIFY_CRC 0x%08xUL\n",0x1c19cae3);
+    EXPECT_FALSE(out.matches_file(filename));
+    ASSERT_TRUE(out.write_if_changed(filename,&changed));
+    EXPECT_TRUE(changed);
+    out.print("#define MPU_TABLE_VERIFY_CRC 0x%08xUL\n",0x1c19cae3);
+    EXPECT_TRUE(out.matches_file(filename));
+    ASSERT_EQ(stat(filename,&after),0);
+    EXPECT_NE(before.st_ino,after.st_ino);
+    EXPECT_EQ(after.st_mode & 07777,0640U);
+    EXPECT_NE(access((std::string(filename) + ".mpu_calc.tmp").c_str(),F_OK),0);
+    unlink(filename);
+
+    EXPECT_FALSE(out.write_if_changed("/tmp/does_not_exist/memory_map.h",&changed));
+}
+
+TEST(MPU_EMITTER, unknown_format)
+{
+    EXPECT_TRUE(mpu_emitter_create("xml") == NULL);
+}
+
+TEST(MPU_EMITTER, header_matches_display)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0043ffff);
+
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *f = open_memstream(&buffer,&size);
+    display.display_memory_map(f,"// ");
+    display.display_entries(f,"    // ");
+    fclose(f);
+
+    // the display output followed by the crc for mpu_verify()
+    std::string header = emit("header",display);
+    EXPECT_EQ(header.substr(0,size),std::string(buffer,size));
+    free(buffer);
+    char crc_line[100];
+    snprintf(crc_line,sizeof(crc_line),"#define MPU_TABLE_VERIFY_CRC 0x%08xUL\n",mpu_table_verify_crc(display.mpu_table,MPU_VERIFY_REGIONS,MPU_VERIFY_DEFAULT_MASK));
+    EXPECT_NE(header.find("#define MPU_TABLE_VERIFY_MASK 0x00008000UL\n"),std::string::npos);
+    EXPECT_NE(header.find(crc_line),std::string::npos);
+}
+
+TEST(MPU_EMITTER, json)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0043ffff);
+    std::string json = emit("json",display);
+    EXPECT_NE(json.find("\"entries\": ["),std::string::npos);
+    EXPECT_NE(json.find("{\"start\": \"0x00400000\", \"end\": \"0x0043ffff\", \"region\": 2, \"XN\": 0, \"AP\": 6"),std::string::npos);
+    EXPECT_EQ(json.substr(json.size()-4),"]\n}\n");
+}
+
+TEST(MPU_EMITTER, csv)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0043ffff);
+    std::string csv = emit("csv",display);
+    EXPECT_EQ(csv.find("start,end,size,region,XN,AP,access,description\n"),0UL);
+    EXPECT_NE(csv.find("0x00440000,0x004fffff,786432,1,1,3,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,"),std::string::npos);
+    EXPECT_NE(csv.find("0x00500000,0xffffffff,4289724416,0,1,0,NO_ACCESS,"),std::string::npos);
+}
+
+TEST(MPU_EMITTER, linker_asserts)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0043ffff);
+    std::string ld = emit("ld",display);
+    EXPECT_NE(ld.find("ASSERT(SIZEOF(.mpu_table) == 3 * 8 + 12,"),std::string::npos);
+    EXPECT_NE(ld.find("ASSERT((ADDR(.text) >= 0x00400000 && ADDR(.text) + SIZEOF(.text) <= 0x00440000),"),std::string::npos);
+    EXPECT_NE(ld.find("ASSERT((ADDR(.data) >= 0x00440000 && ADDR(.data) + SIZEOF(.data) <= 0x00500000),"),std::string::npos);
+}
+
+TEST(MPU_EMITTER, binary)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0043ffff);
+    std::string blob = emit("bin",display);
+    ASSERT_EQ(blob.size(),3*sizeof(ARM_MPU_Region_t) + sizeof(mpu_table_verify_t));
+    EXPECT_EQ(memcmp(blob.data(),display.mpu_table,3*sizeof(ARM_MPU_Region_t)),0);
+    // then what mpu_verify() checks against, so the blob is the whole of .mpu_table
+    mpu_table_verify_t trailer;
+    memcpy(&trailer,blob.data() + 3*sizeof(ARM_MPU_Region_t),sizeof(trailer));
+    EXPECT_EQ(trailer.magic,MPU_TABLE_VERIFY_MAGIC);
+    EXPECT_EQ(trailer.crc,mpu_table_verify_crc(display.mpu_table,MPU_VERIFY_REGIONS,MPU_VERIFY_DEFAULT_MASK));
+    EXPECT_EQ(trailer.mask,MPU_VERIFY_DEFAULT_MASK);
+
+    // the blob can be read back like a memory_map.h
+    FILE *f = fmemopen((void *)blob.data(),blob.size(),"r");
+    mpu_display_t read_back;
+    ASSERT_TRUE(read_mpu_table(f,"blob",&read_back));
+    fclose(f);
+    for (uint32_t i=0;i<3;i++)
+    {
+        EXPECT_EQ(read_back.mpu_table[i].RBAR,display.mpu_table[i].RBAR);
+        EXPECT_EQ(read_back.mpu_table[i].RASR,display.mpu_table[i].RASR);
+    }
+}
+
+TEST(MPU_EMITTER, binary_manifest)
+{
+    mpu_display_t display;
+    build_memory_map(&display,0x0043ffff);
+    mpu_binary_emitter_t binary;
+    binary.source_crc = 0x12345678;
+    output_buffer_t out;
+    binary.manifest(display,out);
+    std::string manifest(out.data(),out.size());
+    std::string blob = emit("bin",display);
+    char line[100];
+    EXPECT_NE(manifest.find("entries=3\nsize=36\n"),std::string::npos);
+    snprintf(line,sizeof(line),"crc32=0x%08x\n",mpu_crc32(0,blob.data(),blob.size()));
+    EXPECT_NE(manifest.find(line),std::string::npos);
+    snprintf(line,sizeof(line),"verify_crc=0x%08x\n",mpu_table_verify_crc(display.mpu_table,MPU_VERIFY_REGIONS,MPU_VERIFY_DEFAULT_MASK));
+    EXPECT_NE(manifest.find(line),std::string::npos);
+    EXPECT_NE(manifest.find("source_crc32=0x12345678\n"),std::string::npos);
+}
@@ -0,0 +1,112 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for address expressions in memory_map.yaml
+*/
+#include "gtest/gtest.h"
+#include "mpu_expression.h"
+#include <map>
+
+/// the symbols from the example linker script
+class test_symbols_t : public mpu_symbol_table_t {
+public:
+    std::map<std::string,uint32_t,std::less<>> symbols;
+    bool find( std::string_view name, uint32_t *value ) const
+    {
+        std::map<std::string,uint32_t,std::less<>>::const_iterator it = symbols.find(name);
+        if (it == symbols.end())
+        {
+            return false;
+        }
+        *value = it->second;
+        return true;
+    }
+};
+
+static uint32_t evaluate( const char *text, const mpu_symbol_table_t *symbols = NULL )
+{
+    mpu_expression_t expression;
+    uint32_t value = 0xdeadbeef;
+    EXPECT_TRUE(expression.compile(text)) << text << ": " << expression.error;
+    EXPECT_TRUE(expression.evaluate(symbols,&value)) << text << ": " << expression.error;
+    return value;
+}
+
+static std::string error( const char *text, const mpu_symbol_table_t *symbols = NULL )
+{
+    mpu_expression_t expression;
+    uint32_t value;
+    if (expression.compile(text) && expression.evaluate(symbols,&value))
+    {
+        return "no error";
+    }
+    return expression.error;
+}
+
+TEST(MPU_EXPRESSION, literals)
+{
+    EXPECT_EQ(evaluate("0x004f8000"),0x004f8000U);
+    EXPECT_EQ(evaluate("0xffffffff"),0xffffffffU);
+    EXPECT_EQ(evaluate("32K"),32U*1024);
+    EXPECT_EQ(evaluate("1MB"),1024U*1024);
+    EXPECT_EQ(evaluate("33M"),33U*1024*1024);
+    EXPECT_EQ(evaluate("1234"),1234U);
+    // same as the old parser, 4G wraps to 0
+    EXPECT_EQ(evaluate("4G"),0U);
+}
+
+TEST(MPU_EXPRESSION, arithmetic)
+{
+    EXPECT_EQ(evaluate("0x400000 + 256K"),0x440000U);
+    EXPECT_EQ(evaluate("1 + 2 * 3"),7U);
+    EXPECT_EQ(evaluate("(1 + 2) * 3"),9U);
+    EXPECT_EQ(evaluate("1M / 4 - 1"),0x3ffffU);
+    EXPECT_EQ(evaluate("-1"),0xffffffffU);
+    EXPECT_EQ(evaluate("ALIGN(0x1001, 4K)"),0x2000U);
+    EXPECT_EQ(evaluate("ALIGN(0x2000, 4K)"),0x2000U);
+}
+
+TEST(MPU_EXPRESSION, symbols)
+{
+    test_symbols_t symbols;
+    symbols.symbols["__data_start__"] = 0x0044f800;
+    symbols.symbols["__logging_start__"] = 0x0048ac00;
+    symbols.symbols["__bss_end__"] = 0x00480123;
+    EXPECT_EQ(evaluate("__logging_start__",&symbols),0x0048ac00U);
+    EXPECT_EQ(evaluate("__data_start__ - 1",&symbols),0x0044f7ffU);
+    EXPECT_EQ(evaluate("ALIGN(__bss_end__, 4K)",&symbols),0x00481000U);
+    EXPECT_EQ(error("__bss_start__",&symbols),"unknown symbol '__bss_start__'");
+    EXPECT_EQ(error("__data_start__"),"unknown symbol '__data_start__'");
+}
+
+TEST(MPU_EXPRESSION, compile_once)
+{
+    mpu_expression_t expression;
+    ASSERT_TRUE(expression.compile("ALIGN(__bss_end__, 32)"));
+    EXPECT_TRUE(expression.uses_symbols());
+    test_symbols_t symbols;
+    uint32_t value;
+    for (uint32_t end=0x100;end<0x200;end+=7)
+    {
+        symbols.symbols["__bss_end__"] = end;
+        ASSERT_TRUE(expression.evaluate(&symbols,&value));
+        EXPECT_EQ(value,(end+31) & ~31U);
+    }
+}
+
+TEST(MPU_EXPRESSION, errors)
+{
+    EXPECT_EQ(error("hello + "),"expected a number or symbol at the end");
+    EXPECT_EQ(error("0xzz"),"expected hex at '0xzz'");
+    EXPECT_EQ(error("12Q + 1"),"expected decimal at '12Q + 1'");
+    EXPECT_EQ(error("(1 + 2"),"expected ')' at the end");
+    EXPECT_EQ(error("1 2"),"expected an operator at '2'");
+    EXPECT_EQ(error("ALIGN(1 2)"),"expected ',' at '2)'");
+    EXPECT_EQ(error("1 / 0"),"divide by zero");
+    EXPECT_EQ(error("ALIGN(1, 3)"),"ALIGN to 0x3 is not a power of 2");
+    EXPECT_TRUE(mpu_expression_t::is_expression("__data_start__ - 1"));
+    EXPECT_FALSE(mpu_expression_t::is_expression("0x400000"));
+    EXPECT_FALSE(mpu_expression_t::is_expression("hello"));
+}
@@ -0,0 +1,116 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for mpu_fleet_t
+*/
+#include "gtest/gtest.h"
+#include "mpu_calculator.h"
+#include "configure_mpu.h"
+#include "mpu_display.h"
+#include "mpu_emitter.h"
+#include "mpu_fleet.h"
+#include "mpu_snapshot.h"
+#include "mpu_test_helpers.h"
+#include <string>
+#include <sys/stat.h>
+
+static void write_file( const std::string &filename, const void *data, size_t size )
+{
+    FILE *f = fopen(filename.c_str(),"wb");
+    ASSERT_TRUE(f != NULL);
+    fwrite(data,1,size,f);
+    fclose(f);
+}
+
+static void write_memory_map_h( const std::string &filename, mpu_display_t &display )
+{
+    mpu_header_emitter_t emitter;
+    output_buffer_t out;
+    emitter.emit(display,out);
+    write_file(filename,out.data(),out.size());
+}
+
+// the snapshot mpu_dump() would log after Configure_MPU() loaded the table, optionally with a stack guard in region 15
+static void write_snapshot( const std::string &filename, mpu_display_t &display, uint32_t stack_guard )
+{
+    mpu_snapshot_t snapshot;
+    memset(&snapshot,0,sizeof(snapshot));
+    snapshot.mpu_TYPE = 16 << MPU_TYPE_DREGION_Pos;
+    snapshot.mpu_CTRL = MPU_CTRL_ENABLE_Msk;
+    for (uint32_t i=0;i<16;i++)
+    {
+        // RBAR reads back with the region number and without VALID
+        snapshot.regions[i].RBAR = (display.mpu_table[i].RBAR & MPU_RBAR_ADDR_Msk) | i;
+        snapshot.regions[i].RASR = display.mpu_table[i].RASR;
+    }
+    if (stack_guard != 0)
+    {
+        snapshot.regions[15].RBAR = stack_guard | 15;
+        snapshot.regions[15].RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_32B);
+    }
+    uint32_t size = mpu_snapshot_seal(&snapshot,16);
+    write_file(filename,&snapshot,size);
+}
+
+TEST(MPU_FLEET, analyze)
+{
+    char path[] = "/tmp/mpu_fleet_XXXXXX";
+    ASSERT_TRUE(mkdtemp(path) != NULL);
+    std::string root = path;
+    mkdir((root + "/v1").c_str(),0700);
+    mkdir((root + "/v2").c_str(),0700);
+
+    mpu_display_t v1;
+    mpu_display_t v2;
+    mpu_display_t patched;
+    build_memory_map(&v1,0x0044f800);
+    build_memory_map(&v2,0x0044ffff);
+    build_memory_map(&patched,0x0043ffff);
+    write_memory_map_h(root + "/v1/memory_map.h",v1);
+    write_memory_map_h(root + "/v2/memory_map.h",v2);
+
+    // v1: 10 units on the shipped table with different stack guards, 2 units on a patched table
+    for (uint32_t i=0;i<10;i++)
+    {
+        write_snapshot(root + "/v1/unit_" + std::to_string(i) + ".bin",v1,0x00480000 + i*0x100);
+    }
+    write_snapshot(root + "/v1/unit_10.bin",patched,0);
+    write_snapshot(root + "/v1/unit_11.bin",patched,0);
+    // v2: 3 units on the shipped table and one snapshot that was truncated
+    for (uint32_t i=0;i<3;i++)
+    {
+        write_snapshot(root + "/v2/unit_" + std::to_string(i) + ".bin",v2,0);
+    }
+    write_file(root + "/v2/truncated.bin","MPUS",4);
+
+    mpu_fleet_t fleet;
+    fleet.num_threads = 4;
+    ASSERT_TRUE(fleet.add_directory(root.c_str()));
+    fleet.analyze();
+    output_buffer_t out;
+    fleet.report(out);
+    std::string report(out.data(),out.size());
+    out.flush(stdout);
+
+    EXPECT_EQ(fleet.units.size(),16UL);
+    EXPECT_EQ(fleet.num_unreadable,1U);
+    // the stack guards are masked, so v1, patched and v2
+    EXPECT_EQ(fleet.unique_tables.size(),3UL);
+    ASSERT_EQ(fleet.builds.size(),2UL);
+    EXPECT_EQ(fleet.builds[0].name,"v1");
+    EXPECT_EQ(fleet.builds[0].num_units,12U);
+    EXPECT_EQ(fleet.builds[0].num_differ,2U);
+    EXPECT_EQ(fleet.builds[1].name,"v2");
+    EXPECT_EQ(fleet.builds[1].num_units,3U);
+    EXPECT_EQ(fleet.builds[1].num_differ,0U);
+    // region 15 has a stack guard in 10 units
+    EXPECT_EQ(fleet.region_changes[15],10U);
+    EXPECT_EQ(fleet.region_changes[0],0U);
+
+    EXPECT_NE(report.find("v1: 2 units (e.g. " + root + "/v1/unit_10.bin) run table 1 which differs from memory_map.h"),std::string::npos);
+
+    std::string command = "rm -rf " + root;
+    EXPECT_EQ(system(command.c_str()),0);
+}
@@ -0,0 +1,111 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the single entry encoder (mpu_region_fit.h), checked against trying every entry
+*/
+#include "gtest/gtest.h"
+#include "mpu_region_fit.h"
+#include "configure_mpu.h"
+#include <stdlib.h>
+
+// a fixed range is a constant
+static_assert( mpu_region_cover(0,0x20040100,0x1000,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED).over == 0x400, "" );
+static_assert( mpu_region_inside(0,0x20040000,0x3000,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED).under == 0, "" );
+
+/// what every entry (size, block, run of subregions) that overlaps [base,end) covers
+template<typename F>
+static void for_each_entry( uint64_t base, uint64_t end, F f )
+{
+    for (uint32_t k=5;k<=32;k++)
+    {
+        uint64_t block = 1ULL << k;
+        uint64_t sub = k >= 8 ? block/8 : block;
+        for (uint64_t b = base & ~(block-1); b < end; b += block)
+        {
+            for (uint64_t first=b;first<b+block;first+=sub)
+            {
+                for (uint64_t last=first+sub;last<=b+block;last+=sub)
+                {
+                    f(first,last);
+                }
+            }
+        }
+    }
+}
+
+static void expect_best( uint32_t base, uint32_t size )
+{
+    uint64_t end = (uint64_t)base + size;
+    uint64_t smallest_cover = 1ULL << 33;
+    uint64_t largest_inside = 0;
+    for_each_entry(base,end,[&]( uint64_t start, uint64_t stop ) {
+        if (start <= base && stop >= end && stop-start < smallest_cover)
+        {
+            smallest_cover = stop-start;
+        }
+        if (start >= base && stop <= end && stop-start > largest_inside)
+        {
+            largest_inside = stop-start;
+        }
+    });
+
+    mpu_region_fit_t cover = mpu_region_cover(3,base,size,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED);
+    EXPECT_EQ(cover.end - cover.start,smallest_cover) << std::hex << base << " " << size;
+    EXPECT_LE(cover.start,base);
+    EXPECT_GE(cover.end,end);
+    EXPECT_EQ(cover.over,smallest_cover - size);
+    EXPECT_EQ(cover.under,0U);
+
+    mpu_region_fit_t inside = mpu_region_inside(3,base,size,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED);
+    EXPECT_EQ(inside.end - inside.start,largest_inside) << std::hex << base << " " << size;
+    EXPECT_EQ(inside.under,size - largest_inside);
+    EXPECT_EQ(inside.over,0U);
+    if (largest_inside != 0)
+    {
+        EXPECT_GE(inside.start,base);
+        EXPECT_LE(inside.end,end);
+    }
+    else
+    {
+        EXPECT_EQ(inside.entry.RASR,0U);
+    }
+}
+
+TEST(MPU_REGION_FIT, encoding)
+{
+    // 0x20041000..0x20043000 is subregions 2-5 of the 16K block at 0x20040000
+    mpu_region_fit_t fit = mpu_region_cover(7,0x20041000,0x2000,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED);
+    EXPECT_EQ(fit.entry.RBAR,ARM_MPU_RBAR(7,0x20040000));
+    EXPECT_EQ(fit.entry.RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0xc3,ARM_MPU_REGION_SIZE_16KB));
+    EXPECT_EQ(fit.start,0x20041000U);
+    EXPECT_EQ(fit.over,0U);
+
+    // the whole address space
+    fit = mpu_region_cover(0,0,0xffffffff,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED);
+    EXPECT_EQ(fit.entry.RASR,ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_4GB));
+    EXPECT_EQ(fit.end,0x100000000ULL);
+    EXPECT_EQ(fit.over,1U);
+
+    // nothing to cover
+    EXPECT_EQ(mpu_region_cover(0,0x1000,0,0,0,0).entry.RASR,0U);
+    fit = mpu_region_inside(0,0x1001,40,0,0,0);
+    EXPECT_EQ(fit.entry.RASR,0U);
+    EXPECT_EQ(fit.under,40U);
+}
+
+TEST(MPU_REGION_FIT, against_every_entry)
+{
+    expect_best(0x20000000,0x8000);
+    expect_best(0x20000020,0x7fc0);
+    expect_best(0x1fff0000,0x20000);
+    expect_best(0xffff0000,0x10000);
+    srand(7);
+    for (uint32_t i=0;i<400;i++)
+    {
+        uint32_t base = 0x20000000 + (rand() % 0x10000) * 8;
+        uint32_t size = 1 + rand() % (1 << (4 + rand() % 14));
+        expect_best(base,size);
+    }
+}
@@ -0,0 +1,98 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the pool of free mpu regions (mpu_slots.h) against the simulated registers
+*/
+#include "gtest/gtest.h"
+#include "mpu_host_model.h"
+#include "mpu_slots.h"
+#include "configure_mpu.h"
+#include "mpu_table.h"
+#include "parallel_for.h"
+#include <atomic>
+
+static const uint32_t RASR_16K = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_16KB);
+
+TEST(MPU_SLOTS, pool)
+{
+    ARM_MPU_Region_t table[4] = {};
+    table[0].RASR = RASR_16K;
+    table[2].RASR = RASR_16K;
+    // the enabled entries, the reserved regions and the ones mpu_verify() checks aren't in the pool
+    EXPECT_EQ(mpu_slots_pool(table,4,0xffff,0x8000),0x7ffaU);
+    EXPECT_EQ(mpu_slots_pool(table,4,0xe00f,0x8000),0x600aU);
+    EXPECT_EQ(mpu_slots_pool(table,4,0xffffffff,0),0xfffaU);
+
+    // memory_map.h's unused entries (11-13) are in MPU_TABLE_VERIFY_MASK, region 15 is the stack guard's
+    mpu_host.reset();
+    Configure_MPU();
+    EXPECT_EQ(mpuSlotsFree,0x3800U);
+    {
+        scoped_mpu_region window(ARM_MPU_RBAR(0,0x20040000),RASR_16K);
+        EXPECT_EQ(window.number(),13);
+        EXPECT_TRUE(mpu_verify());
+    }
+    mpu_slots_init(0);
+    scoped_mpu_region none(ARM_MPU_RBAR(0,0x20040000),RASR_16K);
+    EXPECT_FALSE(none.ok());
+    EXPECT_EQ(none.number(),-1);
+}
+
+TEST(MPU_SLOTS, scoped_region)
+{
+    mpu_host.reset();
+    mpu_slots_init(0x6000);
+    {
+        scoped_mpu_region dma(ARM_MPU_RBAR(3,0x20040000),RASR_16K);
+        ASSERT_TRUE(dma.ok());
+        EXPECT_EQ(dma.number(),14);
+        EXPECT_EQ(mpu_host.region(14).RBAR,0x20040000U | 14);
+        EXPECT_EQ(mpu_host.region(14).RASR,RASR_16K);
+        {
+            scoped_mpu_region watch(ARM_MPU_RBAR(0,0x20000000),RASR_16K);
+            EXPECT_EQ(watch.number(),13);
+            scoped_mpu_region full(ARM_MPU_RBAR(0,0x20000000),RASR_16K);
+            EXPECT_FALSE(full.ok());
+            EXPECT_EQ(mpuSlotsFree,0U);
+        }
+        EXPECT_EQ(mpu_host.region(13).RASR,0U);
+        EXPECT_EQ(mpuSlotsFree,0x2000U);
+        EXPECT_EQ(mpu_host.region(14).RASR,RASR_16K);
+    }
+    EXPECT_EQ(mpu_host.region(14).RASR,0U);
+    EXPECT_EQ(mpuSlotsFree,0x6000U);
+
+    // RNR isn't written, and interrupts are only off for the RBAR/RASR pair
+    EXPECT_EQ(mpu_host.writes[MPU_HOST_RNR],0U);
+    EXPECT_EQ(mpu_host.mpu_writes(),2U*4);
+    EXPECT_EQ(mpu_host.num_interrupt_disables,4U);
+    EXPECT_EQ(mpu_host.primask,0U);
+}
+
+TEST(MPU_SLOTS, threads)
+{
+    // the allocator alone (the simulated registers aren't thread safe)
+    mpu_slots_init(0x7ff0);
+    std::atomic<uint32_t> owners[16] = {};
+    std::atomic<uint32_t> clashes{0};
+    parallel_for( 64, 8, [&]( uint32_t ) {
+        for (uint32_t n=0;n<1000;n++)
+        {
+            int32_t region = mpu_slot_alloc();
+            if (region < 0)
+            {
+                continue;
+            }
+            if (owners[region]++ != 0)
+            {
+                clashes++;
+            }
+            owners[region]--;
+            mpu_slot_free((uint32_t)region);
+        }
+    } );
+    EXPECT_EQ(clashes,0U);
+    EXPECT_EQ(mpuSlotsFree,0x7ff0U);
+}
@@ -0,0 +1,91 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the binary snapshot logged by mpu_dump()
+*/
+#include "gtest/gtest.h"
+#include "configure_mpu.h"
+#include "mpu_display.h"
+#include "mpu_snapshot.h"
+#include "mpu_table_reader.h"
+
+// what mpu_snapshot_capture() would read from an m7 with 16 regions
+static uint32_t build_snapshot( mpu_snapshot_t *snapshot )
+{
+    memset(snapshot,0,sizeof(*snapshot));
+    snapshot->mpu_TYPE = 16 << MPU_TYPE_DREGION_Pos;
+    snapshot->mpu_CTRL = MPU_CTRL_ENABLE_Msk | MPU_CTRL_HFNMIENA_Msk;
+    for (uint32_t i=0;i<16;i++)
+    {
+        snapshot->regions[i].RBAR = ARM_MPU_RBAR(i,0);
+    }
+    snapshot->regions[0].RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_NONE,NO_ACCESS,0,ARM_MPU_REGION_SIZE_4GB);
+    snapshot->regions[1].RBAR = ARM_MPU_RBAR(1,0x00400000);
+    snapshot->regions[1].RASR = ARM_MPU_RASR_EX(EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_256KB);
+    return mpu_snapshot_seal(snapshot,16);
+}
+
+TEST(MPU_SNAPSHOT, crc32)
+{
+    // the standard crc32 check value
+    EXPECT_EQ(mpu_crc32(0,"123456789",9),0xcbf43926U);
+    // and it can be calculated in pieces
+    EXPECT_EQ(mpu_crc32(mpu_crc32(0,"1234",4),"56789",5),0xcbf43926U);
+}
+
+TEST(MPU_SNAPSHOT, round_trip)
+{
+    mpu_snapshot_t snapshot;
+    uint32_t size = build_snapshot(&snapshot);
+    EXPECT_EQ(size,148U);
+
+    // log records are not necessarily aligned
+    uint8_t record[sizeof(snapshot)+1];
+    memcpy(&record[1],&snapshot,size);
+
+    mpu_display_t display;
+    uint32_t mpu_TYPE;
+    uint32_t mpu_CTRL;
+    ASSERT_TRUE(display.load_snapshot(&record[1],size,&mpu_TYPE,&mpu_CTRL));
+    EXPECT_EQ(mpu_TYPE,snapshot.mpu_TYPE);
+    EXPECT_EQ(mpu_CTRL,snapshot.mpu_CTRL);
+    for (uint32_t i=0;i<16;i++)
+    {
+        EXPECT_EQ(display.mpu_table[i].RBAR,snapshot.regions[i].RBAR) << "entry " << i;
+        EXPECT_EQ(display.mpu_table[i].RASR,snapshot.regions[i].RASR) << "entry " << i;
+    }
+    display.display_memory_map(stdout,"");
+}
+
+TEST(MPU_SNAPSHOT, corrupt)
+{
+    mpu_snapshot_t snapshot;
+    uint32_t size = build_snapshot(&snapshot);
+    mpu_display_t display;
+    uint32_t mpu_TYPE;
+    uint32_t mpu_CTRL;
+
+    EXPECT_TRUE(mpu_snapshot_check(&snapshot,size) == NULL);
+    EXPECT_STREQ(mpu_snapshot_check(&snapshot,size-1),"truncated snapshot");
+
+    snapshot.regions[1].RASR ^= 1;
+    EXPECT_STREQ(mpu_snapshot_check(&snapshot,size),"snapshot crc mismatch");
+    EXPECT_FALSE(display.load_snapshot(&snapshot,size,&mpu_TYPE,&mpu_CTRL));
+
+    snapshot.magic = 0;
+    EXPECT_STREQ(mpu_snapshot_check(&snapshot,size),"not an mpu snapshot");
+}
+
+TEST(MPU_SNAPSHOT, read_mpu_table)
+{
+    mpu_snapshot_t snapshot;
+    uint32_t size = build_snapshot(&snapshot);
+    mpu_display_t display;
+    FILE *f = fmemopen(&snapshot,size,"rb");
+    EXPECT_TRUE(read_mpu_table(f,"snapshot.bin",&display));
+    fclose(f);
+    EXPECT_EQ(display.mpu_table[1].RBAR,snapshot.regions[1].RBAR);
+    EXPECT_EQ(display.mpu_table[1].RASR,snapshot.regions[1].RASR);
+}
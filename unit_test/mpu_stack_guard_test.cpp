@@ -0,0 +1,120 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the precomputed stack guard (mpu_stack_guard.h)
+*/
+#include "gtest/gtest.h"
+#include "mpu_stack_guard.h"
+#include "mpu_calculator.h"
+#include <stdlib.h>
+
+// the encoding is a compile time constant
+static_assert( mpu_stack_guard_t<256>::encode(0x20010000).RBAR == ARM_MPU_RBAR(15,0x20010000), "" );
+// an unaligned guard stays in the first 256 bytes of the stack
+static_assert( mpu_stack_guard_t<256>::fit(0x20010004).start >= 0x20010004, "" );
+static_assert( mpu_stack_guard_t<256>::fit(0x20010004).end <= 0x20010104, "" );
+
+/// what MPUThreadGuard_calculate() used to do for every task
+static ARM_MPU_Region_t calculate( uint32_t stack, uint32_t size )
+{
+    mpu_calculator_t mpu_calc;
+    mpu_calc.mpu_region_number = 15;
+    mpu_calc.build_best_mpu_entries(stack,stack+size-1,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE);
+    return mpu_calc.mpu_table[0];
+}
+
+template<uint32_t size>
+static void expect_same_as_calculator()
+{
+    for (uint32_t stack : { 0x00400000U, 0x20000000U, 0x20010000U, 0x2007f000U & ~(size-1) })
+    {
+        ARM_MPU_Region_t guard = mpu_stack_guard_t<size>::encode(stack);
+        ARM_MPU_Region_t calculated = calculate(stack,size);
+        EXPECT_EQ(guard.RBAR,calculated.RBAR) << "size " << size << " stack " << std::hex << stack;
+        EXPECT_EQ(guard.RASR,calculated.RASR) << "size " << size << " stack " << std::hex << stack;
+    }
+}
+
+TEST(MPU_STACK_GUARD, same_as_calculator)
+{
+    // an aligned guard is one whole region either way
+    expect_same_as_calculator<256>();
+    expect_same_as_calculator<1024>();
+    expect_same_as_calculator<4096>();
+    expect_same_as_calculator<65536>();
+}
+
+template<uint32_t size>
+static void expect_inside( uint32_t stack )
+{
+    ARM_MPU_Region_t guard = mpu_stack_guard_t<size>::encode(stack);
+    EXPECT_NE(guard.RASR,0U) << "size " << size << " stack " << std::hex << stack;
+    EXPECT_EQ(guard.RBAR & MPU_RBAR_REGION_Msk,15U);
+    // guarded: most of the first size bytes, and nothing above them
+    uint32_t guarded = 0;
+    for (uint32_t a=stack-size;a<stack+2*size;a+=4)
+    {
+        bool inside = a >= stack && a < stack+size;
+        if (!inside)
+        {
+            EXPECT_FALSE(mpu_region_contains(guard,a)) << "size " << size << " stack " << std::hex << stack << " addr " << a;
+        }
+        guarded += mpu_region_contains(guard,a) ? 4 : 0;
+    }
+    EXPECT_GE(guarded,size/2) << "size " << size << " stack " << std::hex << stack;
+}
+
+TEST(MPU_STACK_GUARD, unaligned)
+{
+    // the subregions that fit rather than moving up into the usable stack
+    for (uint32_t offset : { 8U, 0x20U, 0x48U, 0xf8U })
+    {
+        expect_inside<256>(0x20010000+offset);
+        expect_inside<1024>(0x20010000+offset);
+        expect_inside<4096>(0x20010000+offset);
+    }
+    ARM_MPU_Region_t guard = mpu_stack_guard_t<256>::encode(0x20010008);
+    EXPECT_EQ(guard.RBAR,ARM_MPU_RBAR(15,0x20010000));
+    EXPECT_EQ((guard.RASR & MPU_RASR_SRD_Msk) >> MPU_RASR_SRD_Pos,0x01U);
+    // a 32 byte guard has no subregions, nothing fits
+    EXPECT_EQ(mpu_stack_guard_t<32>::encode(0x20000008).RASR,0U);
+    EXPECT_EQ(mpu_stack_guard_t<32>::encode(0x20000020).RBAR,ARM_MPU_RBAR(15,0x20000020));
+}
+
+static uint32_t num_allocated;
+
+static void *count_malloc( size_t size )
+{
+    num_allocated++;
+    return malloc(size);
+}
+
+static void count_free( void *p )
+{
+    num_allocated--;
+    free(p);
+}
+
+TEST(MPU_STACK_GUARD, malloc)
+{
+    for (uint32_t alignment : { 32U, 256U, 4096U })
+    {
+        void *stacks[8];
+        for (uint32_t i=0;i<8;i++)
+        {
+            stacks[i] = mpu_stack_guard_malloc_aligned(1000+i*8,alignment,count_malloc);
+            ASSERT_TRUE(stacks[i] != NULL);
+            EXPECT_EQ((uintptr_t)stacks[i] & (alignment-1),0U);
+            memset(stacks[i],0x5a,1000+i*8);
+        }
+        EXPECT_EQ(num_allocated,8U);
+        for (uint32_t i=0;i<8;i++)
+        {
+            mpu_stack_guard_free(stacks[i],count_free);
+        }
+        EXPECT_EQ(num_allocated,0U);
+    }
+    EXPECT_TRUE(mpu_stack_guard_malloc_aligned(16,256,[]( size_t ) -> void * { return NULL; }) == NULL);
+}
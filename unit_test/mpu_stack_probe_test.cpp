@@ -0,0 +1,145 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for measuring the stack depth with a moving guard (mpu_stack_probe.h)
+*/
+#include "gtest/gtest.h"
+#include "mpu_host_model.h"
+#include "mpu_stack_guard.h"
+#include "mpu_stack_probe.h"
+#include "configure_mpu.h"
+#include <stdlib.h>
+
+// a 4K stack with a 256 byte stack guard at the bottom
+static const uint32_t stack = 0x20010000;
+static const uint32_t top = stack + 0x1000;
+
+/// the task's guard entry after MPUThreadGuard_calculate(), running with the background map writable
+static void start_task( ARM_MPU_Region_t &guard )
+{
+    guard = mpu_stack_guard_t<256>::encode(stack);
+    mpu_host.reset();
+    ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+}
+
+/// what the context switch does when the task runs
+static void apply( const ARM_MPU_Region_t &guard )
+{
+    mpu_region_store(MPU_STACK_GUARD_REGION,guard.RBAR,guard.RASR);
+}
+
+/// push the words from sp down to sp - bytes, the highest first
+static bool push( mpu_stack_probe_t &probe, uint32_t sp, uint32_t bytes )
+{
+    for (uint32_t a=sp-4;a+bytes >= sp;a-=4)
+    {
+        if (!mpu_stack_probe_simulate(&probe,a))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(MPU_STACK_PROBE, init)
+{
+    ARM_MPU_Region_t guard;
+    start_task(guard);
+    mpu_stack_probe_t probe;
+    EXPECT_FALSE(mpu_stack_probe_init(&probe,&guard,top,top - 0x100,48,"bad"));
+    EXPECT_FALSE(mpu_stack_probe_init(&probe,&guard,top,top - 0x100,16,"bad"));
+    EXPECT_EQ(guard.RBAR,ARM_MPU_RBAR(15,stack));
+
+    ASSERT_TRUE(mpu_stack_probe_init(&probe,&guard,top,top - 0x100,64,"task"));
+    EXPECT_EQ(probe.floor,stack + 0x100);
+    EXPECT_EQ(probe.watermark,top - 0x100);
+    EXPECT_EQ(probe.max_depth,0x100U);
+    // the largest block the watermark's alignment allows: 0x20010f00 is 256 byte aligned
+    EXPECT_EQ(guard.RBAR,ARM_MPU_RBAR(15,top - 0x200));
+    EXPECT_EQ((guard.RASR & MPU_RASR_SIZE_Msk) >> MPU_RASR_SIZE_Pos,(uint32_t)ARM_MPU_REGION_SIZE_256B);
+    EXPECT_EQ((guard.RASR & MPU_RASR_AP_Msk) >> MPU_RASR_AP_Pos,(uint32_t)ARM_MPU_AP_RO);
+}
+
+TEST(MPU_STACK_PROBE, fault)
+{
+    ARM_MPU_Region_t guard;
+    start_task(guard);
+    mpu_stack_probe_t probe;
+    ASSERT_TRUE(mpu_stack_probe_init(&probe,&guard,top,top - 0x40,64,"task"));
+    apply(guard);
+    EXPECT_TRUE(mpu_host.writable(top - 0x40));
+    EXPECT_FALSE(mpu_host.writable(top - 0x44));
+
+    // only a write into the probe moves it
+    EXPECT_FALSE(mpu_stack_probe_fault(&probe,top - 0x400));
+    mpu_host.reset_counters();
+    EXPECT_TRUE(mpu_stack_probe_fault(&probe,top - 0x48));
+    EXPECT_EQ(probe.max_depth,0x48U);
+    EXPECT_EQ(probe.watermark,top - 0x80);
+    EXPECT_EQ(probe.faults,1U);
+    EXPECT_EQ(mpu_host.region(15).RBAR,(top - 0x100) | 15);
+    EXPECT_EQ(mpu_host.region(15).RASR,guard.RASR);
+    EXPECT_TRUE(mpu_host.writable(top - 0x80));
+    EXPECT_FALSE(mpu_host.writable(top - 0x84));
+    // disabled then moved, one RBAR/RASR pair per window
+    EXPECT_EQ(mpu_host.mpu_writes(),4U);
+    EXPECT_EQ(mpu_host.max_masked_accesses,2U);
+}
+
+TEST(MPU_STACK_PROBE, overflow)
+{
+    ARM_MPU_Region_t guard;
+    start_task(guard);
+    ARM_MPU_Region_t stack_guard = guard;
+    mpu_stack_probe_t probe;
+    ASSERT_TRUE(mpu_stack_probe_init(&probe,&guard,top,top - 0x40,32,"task"));
+    apply(guard);
+
+    // all the way down to the stack guard, which is back in place
+    EXPECT_TRUE(push(probe,top - 0x40,top - 0x40 - (stack + 0x100)));
+    // the last fault was the first word pushed into the bottom step
+    EXPECT_EQ(probe.max_depth,0x1000U - 0x100 - 28);
+    EXPECT_EQ(probe.watermark,probe.floor);
+    EXPECT_EQ(guard.RBAR,stack_guard.RBAR);
+    EXPECT_EQ(guard.RASR,stack_guard.RASR);
+    EXPECT_EQ(mpu_host.region(15).RASR,stack_guard.RASR);
+
+    // and the next push is a real overflow
+    EXPECT_FALSE(mpu_stack_probe_simulate(&probe,stack + 0xfc));
+    EXPECT_EQ(probe.faults,(0x1000U - 0x40 - 0x100)/32);
+}
+
+TEST(MPU_STACK_PROBE, soak)
+{
+    // random call chains, each frame pushed from the top down
+    for (uint32_t step : { 32U, 64U, 256U })
+    {
+        ARM_MPU_Region_t guard;
+        start_task(guard);
+        mpu_stack_probe_t probe;
+        ASSERT_TRUE(mpu_stack_probe_init(&probe,&guard,top,top - 0x20,step,"task"));
+        apply(guard);
+        srand(step);
+        uint32_t deepest = 0x20;
+        for (uint32_t run=0;run<200;run++)
+        {
+            uint32_t sp = top - 0x20;
+            uint32_t calls = rand() % 12;
+            for (uint32_t c=0;c<calls;c++)
+            {
+                uint32_t frame = 8 + (rand() % 32) * 4;
+                ASSERT_TRUE(push(probe,sp,frame));
+                sp -= frame;
+            }
+            deepest = top - sp > deepest ? top - sp : deepest;
+        }
+        // the deepest write to within a step, and nothing below the watermark was written
+        EXPECT_LE(probe.max_depth,deepest) << "step " << step;
+        EXPECT_LT(deepest - probe.max_depth,step) << "step " << step;
+        EXPECT_GE(top - probe.watermark,deepest) << "step " << step;
+        // far fewer faults than writes
+        EXPECT_LE(probe.faults,(deepest + step-1)/step) << "step " << step;
+    }
+}
@@ -0,0 +1,89 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the cycle statistics of the mpu functions (mpu_stats.h)
+*/
+#include "gtest/gtest.h"
+#include "mpu_stats.h"
+#include "configure_mpu.h"
+#include "output_buffer.h"
+#include <string>
+
+TEST(MPU_STATS, record)
+{
+    mpu_stats_init(600);
+    for (uint32_t cycles : { 40U, 64U, 100U, 5000U, 0xffffffffU })
+    {
+        mpu_stats_record(MPU_STATS_VERIFY,cycles);
+    }
+    const mpu_stats_path_t &path = mpuStats.paths[MPU_STATS_VERIFY];
+    EXPECT_EQ(path.count,5U);
+    EXPECT_EQ(path.min,40U);
+    EXPECT_EQ(path.max,0xffffffffU);
+    EXPECT_EQ(path.total,40ULL + 64 + 100 + 5000 + 0xffffffffULL);
+    EXPECT_EQ(path.histogram[0],1U);  // < 64
+    EXPECT_EQ(path.histogram[1],2U);  // 64..127
+    EXPECT_EQ(path.histogram[7],1U);  // 4096..8191
+    EXPECT_EQ(path.histogram[MPU_STATS_BUCKETS-1],1U);
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_DUMP].count,0U);
+
+    mpu_stats_reset();
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_VERIFY].count,0U);
+    EXPECT_EQ(mpuStats.cycles_per_us,600U);
+}
+
+TEST(MPU_STATS, timers)
+{
+    mpu_host.reset();
+    mpu_stats_init(1000);
+    Configure_MPU();
+    mpu_configure_region(0x20000000,32*1024,NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_UNCACHED);
+    mpu_clear_region();
+    EXPECT_TRUE(mpu_verify());
+    mpu_dump();
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_CONFIGURE].count,1U);
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_CONFIGURE_REGION].count,1U);
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_VERIFY].count,1U);
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_DUMP].count,1U);
+    // 4 times for mpu_configure_region() (the spare, retire, write, the spare cleared), once for
+    // mpu_clear_region(), both after reading the 16 regions for the cache plan, and once per
+    // region mpu_verify() reads (the 12 outside the verify mask)
+    EXPECT_EQ(mpuStats.paths[MPU_STATS_INTERRUPTS_DISABLED].count,mpu_host.num_interrupt_disables);
+    EXPECT_EQ(mpu_host.num_interrupt_disables,16U + 4 + 16 + 1 + 12);
+    // the records are made after interrupts are enabled again, a window is only its mpu accesses
+    // (mpu_verify()'s RNR, RBAR and RASR)
+    EXPECT_EQ(mpu_host.max_masked_accesses,3U);
+    mpu_host.reset_counters();
+    {
+        cpu_interrupt_disable_guard disable_interrupts;
+        mpu_stats_record(MPU_STATS_DUMP,1);
+    }
+    EXPECT_EQ(mpu_host.max_masked_accesses,5U);
+    // the interrupts disabled part of mpu_verify() is inside it
+    EXPECT_LE(mpuStats.paths[MPU_STATS_INTERRUPTS_DISABLED].min,mpuStats.paths[MPU_STATS_VERIFY].max);
+}
+
+TEST(MPU_STATS, record_round_trip)
+{
+    mpu_stats_init(600);
+    mpu_stats_record(MPU_STATS_TASK_APPLY,120);
+    mpu_stats_record(MPU_STATS_TASK_APPLY,180);
+    mpu_stats_t stats = mpuStats;
+    uint32_t size = mpu_stats_seal(&stats);
+    EXPECT_EQ(size,sizeof(mpu_stats_t));
+    EXPECT_TRUE(mpu_stats_check(&stats,size) == NULL);
+    EXPECT_STREQ(mpu_stats_check(&stats,size-1),"truncated statistics");
+    stats.paths[0].count++;
+    EXPECT_STREQ(mpu_stats_check(&stats,size),"statistics crc mismatch");
+    stats.magic = 0;
+    EXPECT_STREQ(mpu_stats_check(&stats,size),"not mpu statistics");
+
+    output_buffer_t out;
+    mpu_stats_print(out,&mpuStats);
+    std::string text(out.data(),out.size());
+    EXPECT_NE(text.find("mpu_task_apply                2        120        150        180       0.30"),std::string::npos) << text;
+    EXPECT_NE(text.find(" <128:1 <256:1"),std::string::npos) << text;
+    EXPECT_EQ(text.find("mpu_dump"),std::string::npos) << text;
+}
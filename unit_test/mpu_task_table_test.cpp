@@ -0,0 +1,174 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the per task regions (task: in memory_map.yaml)
+*/
+#include "gtest/gtest.h"
+#include "memory_map_builder.h"
+#include "memory_map_loader.h"
+#include "mpu_calc_session.h"
+#include "mpu_task_table.h"
+#include "configure_mpu.h"
+#include "mpu_test_helpers.h"
+#include <string>
+
+static const char tasks_yaml[] =
+    "region:\n"
+    "        comment:          no access\n"
+    "        start_addr:       0x0\n"
+    "        end_addr:         0xffffffff\n"
+    "        AccessAttributes: NO_ACCESS\n"
+    "        AccessPermission: ARM_MPU_AP_NONE\n"
+    "task:\n"
+    "        name:             net_rx\n"
+    "        region:\n"
+    "                comment:          net_rx stack\n"
+    "                start_addr:       0x20010000\n"
+    "                size:             4K\n"
+    "                AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"
+    "        region:\n"
+    "                comment:          rx queue\n"
+    "                start_addr:       0x20020000\n"
+    "                size:             1K\n"
+    "                AccessAttributes: UNCACHED\n"
+    "region:\n"
+    "        comment:          OCR\n"
+    "        start_addr:       0x400000\n"
+    "        size:             1MB\n"
+    "        DisableExec:      EXECUTE\n"
+    "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"
+    "task:\n"
+    "        region:\n"
+    "                start_addr:       0x20030000\n"
+    "                size:             8K\n"
+    "                AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"
+    "        name:             logger\n";
+
+TEST(MPU_TASK_TABLE, loader)
+{
+    memory_map_loader_t loader;
+    ASSERT_TRUE(load(loader,tasks_yaml));
+    ASSERT_EQ(loader.tasks.size(),2U);
+    EXPECT_EQ(loader.tasks[0].name,"net_rx");
+    EXPECT_EQ(loader.tasks[0].line,6U);
+    // the name can come after the regions
+    EXPECT_EQ(loader.tasks[1].name,"logger");
+    ASSERT_EQ(loader.regions.size(),5U);
+    EXPECT_EQ(loader.regions[0].task,-1);
+    EXPECT_EQ(loader.regions[1].task,0);
+    EXPECT_EQ(loader.regions[2].task,0);
+    EXPECT_EQ(loader.regions[3].task,-1);
+    EXPECT_EQ(loader.regions[4].task,1);
+
+    memory_map_loader_t bad;
+    EXPECT_FALSE(load(bad,"task:\n  region:\n    start_addr: 0x0\n    size: 32\n"));
+    EXPECT_FALSE(load(bad,"task:\n  name: not a name\n"));
+    EXPECT_FALSE(load(bad,"task:\n  name: a\ntask:\n  name: a\n"));
+    EXPECT_FALSE(load(bad,"task: a\n"));
+    EXPECT_FALSE(load(bad,"task:\n  name: outer\n  task:\n    name: inner\n"));
+}
+
+TEST(MPU_TASK_TABLE, build)
+{
+    memory_map_loader_t loader;
+    ASSERT_TRUE(load(loader,tasks_yaml));
+    memory_map_builder_t global;
+    global.add_regions(loader.regions);
+    // the task regions aren't in the global table
+    EXPECT_EQ(global.num_entries,2U);
+
+    mpu_task_tables_t tasks;
+    ASSERT_TRUE(tasks.build(loader,global.num_entries,5));
+    EXPECT_EQ(tasks.first_region,2U);
+    EXPECT_EQ(tasks.num_regions,3U);
+    EXPECT_EQ(tasks.verify_mask(),0x1cU);
+    ASSERT_EQ(tasks.tasks.size(),2U);
+
+    // net_rx: regions 2 and 3, region 4 disabled
+    const ARM_MPU_Region_t *net_rx = tasks.tasks[0].display.mpu_table;
+    EXPECT_EQ(net_rx[2].RBAR,ARM_MPU_RBAR(2,0x20010000));
+    EXPECT_EQ(net_rx[3].RBAR,ARM_MPU_RBAR(3,0x20020000));
+    EXPECT_NE(net_rx[3].RASR,0U);
+    EXPECT_EQ(net_rx[4].RBAR,ARM_MPU_RBAR(4,0));
+    EXPECT_EQ(net_rx[4].RASR,0U);
+    // logger: region 2, regions 3 and 4 disabled so nothing of net_rx is left
+    const ARM_MPU_Region_t *logger = tasks.tasks[1].display.mpu_table;
+    EXPECT_EQ(logger[2].RBAR,ARM_MPU_RBAR(2,0x20030000));
+    EXPECT_EQ(logger[3].RASR,0U);
+    EXPECT_EQ(logger[4].RASR,0U);
+
+    output_buffer_t out;
+    tasks.emit(out);
+    std::string text(out.data(),out.size());
+    EXPECT_NE(text.find("#define MPU_TASK_FIRST_REGION 2UL\n"),std::string::npos);
+    EXPECT_NE(text.find("#define MPU_TASK_NUM_REGIONS 3UL\n"),std::string::npos);
+    EXPECT_NE(text.find("static const ARM_MPU_Region_t mpuTask_net_rx[MPU_TASK_NUM_REGIONS] = {\n"),std::string::npos);
+    EXPECT_NE(text.find("{ \"logger\", mpuTask_logger },"),std::string::npos);
+    EXPECT_NE(text.find(".RBAR = ARM_MPU_RBAR(4UL,"),std::string::npos);
+    // the global table's entries aren't repeated
+    EXPECT_EQ(text.find("ARM_MPU_RBAR(1UL,"),std::string::npos);
+
+    // net_rx doesn't fit in one slot
+    mpu_task_tables_t small;
+    EXPECT_FALSE(small.build(loader,global.num_entries,3));
+}
+
+TEST(MPU_TASK_TABLE, default_table_size)
+{
+    // mpu_calc's default mpu_table_size=16 still leaves region 15 to the stack guard
+    mpu_calc_session_t session;
+    std::string yaml = "region:\n  start_addr: 0x0\n  end_addr: 0xffffffff\n"
+        "task:\n  name: a\n  region:\n    start_addr: 0x20000000\n    size: 4K\n";
+    ASSERT_TRUE(session.load_string(yaml.c_str(),yaml.size()) && session.compute());
+    EXPECT_EQ(session.tasks.first_region,1U);
+    EXPECT_EQ(session.tasks.num_regions,14U);
+    EXPECT_EQ(session.tasks.tasks[0].display.mpu_table[15].RASR,0U);
+    output_buffer_t out;
+    session.tasks.emit(out);
+    std::string text(out.data(),out.size());
+    EXPECT_NE(text.find("#define MPU_TASK_NUM_REGIONS 14UL\n"),std::string::npos);
+    EXPECT_EQ(text.find("ARM_MPU_RBAR(15UL,"),std::string::npos);
+}
+
+TEST(MPU_TASK_TABLE, compute_again)
+{
+    // the task slots are added to the mask compute() emits, not to the one that was given
+    mpu_calc_session_t session;
+    session.mpu_table_size = 15;
+    ASSERT_TRUE(session.load_string(tasks_yaml,sizeof(tasks_yaml)-1) && session.compute());
+    EXPECT_EQ(session.verify_mask,MPU_VERIFY_DEFAULT_MASK);
+    EXPECT_EQ(session.table_verify_mask,MPU_VERIFY_DEFAULT_MASK | session.tasks.verify_mask());
+    EXPECT_NE(session.tasks.verify_mask(),0U);
+
+    // without the tasks the slots are checked again
+    mpu_calc_session_t plain;
+    plain.mpu_table_size = 15;
+    session.loader.tasks.clear();
+    ASSERT_TRUE(session.compute());
+    ASSERT_TRUE(plain.load_string(tasks_yaml,sizeof(tasks_yaml)-1));
+    plain.loader.tasks.clear();
+    ASSERT_TRUE(plain.compute());
+    EXPECT_EQ(session.tasks.verify_mask(),0U);
+    EXPECT_EQ(session.table_verify_mask,plain.table_verify_mask);
+}
+
+TEST(MPU_TASK_TABLE, no_tasks)
+{
+    // the mpu_task_regions.h used for the first pass has no tasks
+    EXPECT_EQ(mpuTaskCount,0U);
+    EXPECT_EQ(mpuTaskNumRegions,0U);
+    EXPECT_TRUE(mpu_task_find("net_rx") == NULL);
+
+    memory_map_loader_t loader;
+    ASSERT_TRUE(load(loader,"region:\n  start_addr: 0x0\n  size: 4G\n"));
+    mpu_task_tables_t tasks;
+    ASSERT_TRUE(tasks.build(loader,1,15));
+    // the unused slots are still checked if there are no tasks
+    EXPECT_EQ(tasks.verify_mask(),0U);
+    output_buffer_t out;
+    tasks.emit(out);
+    std::string text(out.data(),out.size());
+    EXPECT_NE(text.find("#define MPU_TASK_SETTINGS { NULL, NULL },\n"),std::string::npos);
+}
@@ -0,0 +1,63 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   small memory maps (as mpu_display_t and as yaml) shared by the unit tests
+*/
+#ifndef MPU_TEST_HELPERS_H
+#define MPU_TEST_HELPERS_H
+
+#include "gtest/gtest.h"
+#include "mpu_calculator.h"
+#include "configure_mpu.h"
+#include "mpu_display.h"
+#include <string>
+
+/// add the entries for one region to the display (like add_region() in mpu_calc.cpp)
+static inline void add_region( mpu_display_t *display, uint32_t *region_number, uint32_t start_addr, uint32_t end_addr, uint32_t DisableExec, uint32_t AccessPermission, uint32_t AccessAttributes )
+{
+    mpu_calculator_t mpu_calc;
+    mpu_calc.mpu_region_number = *region_number;
+    ASSERT_TRUE(mpu_calc.build_best_mpu_entries(start_addr,end_addr,DisableExec,AccessPermission,AccessAttributes));
+    for (uint32_t i=0;i<mpu_calc.num_entries;i++)
+    {
+        display->set(*region_number,mpu_calc.mpu_table[i].RBAR,mpu_calc.mpu_table[i].RASR);
+        (*region_number)++;
+    }
+}
+
+/// a cut down version of memory_map.yaml with the end of .text as a parameter, and optionally the uncached inbox/outbox
+static inline void build_memory_map( mpu_display_t *display, uint32_t data_start, bool inbox = false )
+{
+    uint32_t region_number = 0;
+    add_region(display,&region_number,0x0,0xffffffff,NEVER_EXECUTE,ARM_MPU_AP_NONE,NO_ACCESS);
+    add_region(display,&region_number,0x00400000,0x004fffff,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE);
+    add_region(display,&region_number,0x00400000,data_start,EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE);
+    if (inbox)
+    {
+        add_region(display,&region_number,0x004f8000,0x004fbfff,NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED);
+    }
+}
+
+/// yaml into anything with load_string() (memory_map_loader_t, mpu_calc_session_t)
+template<typename T>
+static inline bool load( T &loader, const std::string &yaml )
+{
+    return loader.load_string(yaml.c_str(),yaml.size());
+}
+
+/// 0x0-0xffffffff no access and 1MB of OCR, two entries
+static const char two_entries[] =
+    "region:\n"
+    "        start_addr:       0x0\n"
+    "        end_addr:         0xffffffff\n"
+    "        AccessAttributes: NO_ACCESS\n"
+    "        AccessPermission: ARM_MPU_AP_NONE\n"
+    "region:\n"
+    "        start_addr:       0x400000\n"
+    "        size:             1MB\n"
+    "        DisableExec:      EXECUTE\n"
+    "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n";
+
+#endif
@@ -0,0 +1,113 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the crc used by mpu_verify(), using a model of the mpu registers
+*/
+#include "gtest/gtest.h"
+#include "configure_mpu.h"
+#include "mpu_display.h"
+#include "mpu_verify.h"
+
+/*
+ * behaves like the armv7-m MPU->RNR/RBAR/RASR registers:
+ *   - writing RBAR with VALID set selects the region from RBAR.REGION
+ *   - reading RBAR returns the address and the current region number (VALID reads as 0)
+ */
+class mpu_registers_t {
+public:
+    uint32_t RNR;
+    ARM_MPU_Region_t regions[MPU_VERIFY_REGIONS];
+
+    mpu_registers_t():RNR(0),regions(){}
+    void write_RBAR( uint32_t RBAR )
+    {
+        if (RBAR & MPU_RBAR_VALID_Msk)
+        {
+            RNR = RBAR & MPU_RBAR_REGION_Msk;
+        }
+        regions[RNR].RBAR = RBAR & MPU_RBAR_ADDR_Msk;
+    }
+    uint32_t read_RBAR() { return regions[RNR].RBAR | RNR; }
+    void write_RASR( uint32_t RASR ) { regions[RNR].RASR = RASR; }
+    uint32_t read_RASR() { return regions[RNR].RASR; }
+
+    // same as ARM_MPU_ClrRegion() and ARM_MPU_Load() in Configure_MPU()
+    void load( const ARM_MPU_Region_t *table, uint32_t num_entries )
+    {
+        for (uint32_t i=0;i<MPU_VERIFY_REGIONS;i++)
+        {
+            RNR = i;
+            write_RASR(0);
+        }
+        for (uint32_t i=0;i<num_entries;i++)
+        {
+            write_RBAR(table[i].RBAR);
+            write_RASR(table[i].RASR);
+        }
+    }
+    // same as mpu_verify() on the target
+    uint32_t verify_crc( uint32_t mask )
+    {
+        return mpu_verify_crc( mask, [this]( uint32_t i, ARM_MPU_Region_t *region ) {
+            RNR = i;
+            region->RBAR = read_RBAR();
+            region->RASR = read_RASR();
+        } );
+    }
+};
+
+static const ARM_MPU_Region_t table[] = {
+    { ARM_MPU_RBAR(0,0x00000000), ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_NONE,NO_ACCESS,0,ARM_MPU_REGION_SIZE_4GB) },
+    { ARM_MPU_RBAR(1,0x00400000), ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_1MB) },
+    { ARM_MPU_RBAR(2,0x00400000), ARM_MPU_RASR_EX(EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_256KB) },
+    { ARM_MPU_RBAR(3,0x00000000), 0 },
+};
+static const uint32_t num_entries = sizeof(table)/sizeof(table[0]);
+
+TEST(MPU_VERIFY, registers_match_table)
+{
+    mpu_registers_t mpu;
+    // leave a stale address in a region that is cleared
+    mpu.regions[7].RBAR = 0x20000000;
+    mpu.load(table,num_entries);
+    uint32_t expected = mpu_table_verify_crc(table,num_entries,MPU_VERIFY_DEFAULT_MASK);
+    EXPECT_EQ(mpu.verify_crc(MPU_VERIFY_DEFAULT_MASK),expected);
+}
+
+TEST(MPU_VERIFY, masked_region_can_change)
+{
+    mpu_registers_t mpu;
+    mpu.load(table,num_entries);
+    uint32_t expected = mpu_table_verify_crc(table,num_entries,MPU_VERIFY_DEFAULT_MASK);
+    // e.g. a stack guard in region 15
+    mpu.write_RBAR(ARM_MPU_RBAR(15,0x00480000));
+    mpu.write_RASR(ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_RO,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_32B));
+    EXPECT_EQ(mpu.verify_crc(MPU_VERIFY_DEFAULT_MASK),expected);
+    // but not if the mask doesn't include it
+    EXPECT_NE(mpu.verify_crc(0),mpu_table_verify_crc(table,num_entries,0));
+}
+
+TEST(MPU_VERIFY, detects_changes)
+{
+    mpu_registers_t mpu;
+    mpu.load(table,num_entries);
+    uint32_t expected = mpu_table_verify_crc(table,num_entries,MPU_VERIFY_DEFAULT_MASK);
+
+    // region 2 made writable
+    mpu.write_RBAR(table[2].RBAR);
+    mpu.write_RASR(ARM_MPU_RASR_EX(EXECUTE,ARM_MPU_AP_FULL,NORMAL_WRITE_BACK_READ_AND_WRITE_ALLOCATE,0,ARM_MPU_REGION_SIZE_256KB));
+    EXPECT_NE(mpu.verify_crc(MPU_VERIFY_DEFAULT_MASK),expected);
+
+    // region 1 moved
+    mpu.load(table,num_entries);
+    mpu.write_RBAR(ARM_MPU_RBAR(1,0x00500000));
+    EXPECT_NE(mpu.verify_crc(MPU_VERIFY_DEFAULT_MASK),expected);
+
+    // an unused region enabled
+    mpu.load(table,num_entries);
+    mpu.write_RBAR(ARM_MPU_RBAR(9,0x00000000));
+    mpu.write_RASR(table[0].RASR);
+    EXPECT_NE(mpu.verify_crc(MPU_VERIFY_DEFAULT_MASK),expected);
+}
@@ -0,0 +1,264 @@
+/* copyright Microchip 2022, MIT License */
+
+/**
+* @file
+* @brief
+*   unit tests for the virtual regions (hotness: in memory_map.yaml)
+*/
+#include "gtest/gtest.h"
+#include "mpu_calc_session.h"
+#include "mpu_host_model.h"
+#include "mpu_virtual.h"
+#include "configure_mpu.h"
+#include <stdlib.h>
+#include <string>
+
+static const char virtual_yaml[] =
+    "region:\n"
+    "        comment:          no access\n"
+    "        start_addr:       0x0\n"
+    "        end_addr:         0xffffffff\n"
+    "        AccessAttributes: NO_ACCESS\n"
+    "        AccessPermission: ARM_MPU_AP_NONE\n"
+    "region:\n"
+    "        comment:          cold buffer\n"
+    "        start_addr:       0x20020000\n"
+    "        size:             8K\n"
+    "        AccessAttributes: UNCACHED\n"
+    "        hotness:          10\n"
+    "region:\n"
+    "        comment:          OCR\n"
+    "        start_addr:       0x400000\n"
+    "        size:             1MB\n"
+    "        DisableExec:      EXECUTE\n"
+    "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"
+    "region:\n"
+    "        comment:          hot buffer\n"
+    "        start_addr:       0x20000000\n"
+    "        size:             4K\n"
+    "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"
+    "        hotness:          200\n"
+    "region:\n"
+    "        comment:          warm buffer\n"
+    "        start_addr:       0x20010000\n"
+    "        size:             4K\n"
+    "        AccessAttributes: WRITE_BACK_READ_AND_WRITE_ALLOCATE\n"
+    "        hotness:          50\n";
+
+static bool compute( mpu_calc_session_t &session, const std::string &yaml, uint32_t virtual_slots )
+{
+    session.virtual_slots = virtual_slots;
+    return session.load_string(yaml.c_str(),yaml.size()) && session.compute();
+}
+
+TEST(MPU_VIRTUAL, build)
+{
+    mpu_calc_session_t session;
+    ASSERT_TRUE(compute(session,virtual_yaml,2));
+    EXPECT_EQ(session.loader.regions[1].hotness,10);
+    EXPECT_EQ(session.loader.regions[2].hotness,-1);
+    // the virtual regions aren't in the global table
+    EXPECT_EQ(session.num_entries,2U);
+    const mpu_virtual_regions_t &v = session.virtual_regions;
+    EXPECT_EQ(v.first_slot,2U);
+    EXPECT_EQ(v.num_slots,2U);
+    ASSERT_EQ(v.entries.size(),3U);
+    // hottest first
+    EXPECT_EQ(v.comments[0],"hot buffer");
+    EXPECT_EQ(v.comments[1],"warm buffer");
+    EXPECT_EQ(v.comments[2],"cold buffer");
+    EXPECT_EQ(v.weights[0],200);
+    EXPECT_EQ(v.weights[2],10);
+    EXPECT_EQ(v.entries[0].RBAR,0x20000000U);
+    EXPECT_EQ(session.table_verify_mask & 0xc,0xcU);
+
+    output_buffer_t out;
+    session.emit_virtual(out);
+    std::string header(out.data(),out.size());
+    EXPECT_NE(header.find("#define MPU_VIRTUAL_FIRST_SLOT 2UL"),std::string::npos);
+    EXPECT_NE(header.find("#define MPU_VIRTUAL_NUM_ENTRIES 3UL"),std::string::npos);
+    EXPECT_NE(header.find("mpuVirtualWeights[] = { 200, 50, 10, };"),std::string::npos);
+}
+
+TEST(MPU_VIRTUAL, errors)
+{
+    mpu_calc_session_t no_slots;
+    EXPECT_FALSE(compute(no_slots,virtual_yaml,0));
+
+    mpu_calc_session_t too_many;
+    too_many.mpu_table_size = 3;
+    EXPECT_FALSE(compute(too_many,virtual_yaml,2));
+
+    // with the default mpu_table_size=16 region 15 is still the stack guard's
+    mpu_calc_session_t below_15;
+    EXPECT_TRUE(compute(below_15,virtual_yaml,13));
+    EXPECT_EQ(below_15.table_verify_mask & 0x8000,0x8000U);
+    mpu_calc_session_t on_15;
+    EXPECT_FALSE(compute(on_15,virtual_yaml,14));
+
+    // OCR is accessible, so an access to it would never fault
+    mpu_calc_session_t mapped;
+    EXPECT_FALSE(compute(mapped,std::string(virtual_yaml) + "region:\n  start_addr: 0x400000\n  size: 4K\n  hotness: 1\n",2));
+
+    mpu_calc_session_t overlap;
+    EXPECT_FALSE(compute(overlap,std::string(virtual_yaml) + "region:\n  start_addr: 0x20000800\n  size: 4K\n  hotness: 1\n",2));
+
+    memory_map_loader_t bad;
+    EXPECT_FALSE(bad.load_string("region:\n  hotness: 256\n",22));
+    const char in_task[] = "task:\n  name: a\n  region:\n    hotness: 1\n";
+    EXPECT_FALSE(bad.load_string(in_task,sizeof(in_task)-1));
+}
+
+/// the global table, the hottest virtual entries, and the mpu enabled
+static void configure( mpu_calc_session_t &session, mpu_virtual_table_t &table, mpu_virtual_t &vmpu )
+{
+    table = session.virtual_regions.table();
+    mpu_host.reset();
+    mpu_apply(session.builder.display.mpu_table,NULL,0,session.mpu_table_size);
+    mpu_virtual_load(&vmpu,&table);
+    ARM_MPU_Enable(MPU_CTRL_HFNMIENA_Msk);
+}
+
+TEST(MPU_VIRTUAL, fault)
+{
+    mpu_calc_session_t session;
+    ASSERT_TRUE(compute(session,virtual_yaml,2));
+    mpu_virtual_table_t table;
+    mpu_virtual_t vmpu;
+    configure(session,table,vmpu);
+    EXPECT_EQ(vmpu.slot_entry[0],0);
+    EXPECT_EQ(vmpu.slot_entry[1],1);
+    EXPECT_TRUE(mpu_host.accessible(0x20000000));
+    EXPECT_TRUE(mpu_host.accessible(0x20010ffc));
+    EXPECT_FALSE(mpu_host.accessible(0x20020000));
+    EXPECT_EQ(mpu_virtual_find(&table,0x20021ffc),2);
+    EXPECT_EQ(mpu_virtual_find(&table,0x20030000),-1);
+
+    // the warm buffer is swapped out, it has the lower count
+    mpu_host.reset_counters();
+    EXPECT_TRUE(mpu_virtual_fault(&vmpu,0x20020000));
+    EXPECT_EQ(mpu_host.region(3).RBAR,0x20020000U | 3);
+    EXPECT_EQ(mpu_host.region(3).RASR,table.entries[2].RASR);
+    // the victim is disabled, then the slot written, one RBAR/RASR pair per window
+    EXPECT_EQ(mpu_host.mpu_writes(),4U);
+    EXPECT_EQ(mpu_host.num_interrupt_disables,2U);
+    EXPECT_EQ(mpu_host.max_masked_accesses,2U);
+    EXPECT_EQ(vmpu.slot_entry[1],2);
+    // the hand passed slot 0 once more than slot 1 (it started there)
+    EXPECT_EQ(vmpu.slot_count[0],200-51);
+    EXPECT_TRUE(mpu_host.accessible(0x20020000));
+    EXPECT_FALSE(mpu_host.accessible(0x20010000));
+
+    // loaded already, or not virtual: a real fault
+    EXPECT_FALSE(mpu_virtual_fault(&vmpu,0x20000000));
+    EXPECT_FALSE(mpu_virtual_fault(&vmpu,0x30000000));
+    EXPECT_EQ(vmpu.faults,3U);
+    EXPECT_EQ(vmpu.swaps,1U);
+    EXPECT_EQ(vmpu.misses,2U);
+}
+
+/// the clock done one step at a time, to check mpu_virtual_fault()'s shortcut
+struct reference_clock_t {
+    uint32_t num_slots;
+    uint32_t hand;
+    uint32_t count[MPU_VIRTUAL_MAX_SLOTS];
+    uint32_t entry[MPU_VIRTUAL_MAX_SLOTS];
+
+    uint32_t replace( uint32_t new_entry, uint32_t weight )
+    {
+        while (count[hand] != 0)
+        {
+            count[hand]--;
+            hand = (hand + 1) % num_slots;
+        }
+        uint32_t slot = hand;
+        entry[slot] = new_entry;
+        count[slot] = weight;
+        hand = (slot + 1) % num_slots;
+        return slot;
+    }
+};
+
+TEST(MPU_VIRTUAL, clock)
+{
+    // 24 entries of 4K with random hotness into 5 slots
+    static ARM_MPU_Region_t entries[24];
+    static uint8_t weights[24];
+    srand(5);
+    for (uint32_t i=0;i<24;i++)
+    {
+        entries[i].RBAR = ARM_MPU_RBAR(0,0x20000000 + i*0x1000);
+        entries[i].RASR = ARM_MPU_RASR_EX(NEVER_EXECUTE,ARM_MPU_AP_FULL,NORMAL_UNCACHED,0,ARM_MPU_REGION_SIZE_4KB);
+        weights[i] = rand() % 8;
+    }
+    mpu_virtual_table_t table = { entries, weights, 24, 8, 5 };
+    mpu_virtual_t vmpu;
+    mpu_host.reset();
+    mpu_virtual_load(&vmpu,&table);
+
+    reference_clock_t reference = { 5, 0, {}, {} };
+    for (uint32_t s=0;s<5;s++)
+    {
+        reference.count[s] = weights[s];
+        reference.entry[s] = s;
+    }
+    for (uint32_t i=0;i<2000;i++)
+    {
+        uint32_t e = rand() % 24;
+        bool loaded = false;
+        for (uint32_t s=0;s<5;s++)
+        {
+            loaded = loaded || reference.entry[s] == e;
+        }
+        ASSERT_EQ(mpu_virtual_fault(&vmpu,0x20000000 + e*0x1000 + 4),!loaded);
+        if (!loaded)
+        {
+            uint32_t slot = reference.replace(e,weights[e]);
+            ASSERT_EQ(vmpu.slot_entry[slot],e);
+            ASSERT_EQ(mpu_host.region(8+slot).RBAR,(0x20000000 + e*0x1000) | (8+slot));
+        }
+        for (uint32_t s=0;s<5;s++)
+        {
+            ASSERT_EQ(vmpu.slot_count[s],reference.count[s]);
+        }
+        ASSERT_EQ(vmpu.hand,reference.hand);
+    }
+}
+
+TEST(MPU_VIRTUAL, trace)
+{
+    // 80% hot, 15% warm, 5% cold
+    std::vector<uint32_t> trace;
+    uint32_t not_hot = 0;
+    srand(7);
+    for (uint32_t i=0;i<1000;i++)
+    {
+        uint32_t r = rand() % 100;
+        trace.push_back(r < 80 ? 0x20000100 : r < 95 ? 0x20010100 : 0x20020100 + (r & 1)*0x1000);
+        not_hot += r < 80 ? 0 : 1;
+    }
+    uint32_t swaps[4] = {};
+    for (uint32_t slots=1;slots<=3;slots++)
+    {
+        mpu_calc_session_t session;
+        ASSERT_TRUE(compute(session,virtual_yaml,slots));
+        mpu_virtual_table_t table;
+        mpu_virtual_t vmpu;
+        configure(session,table,vmpu);
+        uint32_t counts[3] = {};
+        for (uint32_t address : trace)
+        {
+            counts[mpu_virtual_simulate(&vmpu,address)]++;
+        }
+        EXPECT_EQ(counts[MPU_VIRTUAL_SWAP],vmpu.swaps);
+        EXPECT_EQ(counts[MPU_VIRTUAL_FAULT],0U);
+        swaps[slots] = vmpu.swaps;
+    }
+    // with a slot for every entry nothing is swapped
+    EXPECT_EQ(swaps[3],0U);
+    EXPECT_GT(swaps[1],swaps[2]);
+    // one slot swaps out for each access that isn't hot and back again at most,
+    // with two the hot entry keeps its slot
+    EXPECT_LE(swaps[1],2*not_hot);
+    EXPECT_LE(swaps[2],not_hot);
+}